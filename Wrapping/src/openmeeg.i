@@ -5,6 +5,8 @@
 
 %{
     #define SWIG_FILE_WITH_INIT
+    #include <cmath>
+    #include <stdexcept>
     #include <vect3.h>
     #include <vertex.h>
     #include <triangle.h>
@@ -23,6 +25,7 @@
     #include <assemble.h>
     #include <gain.h>
     #include <forward.h>
+    #include <progress.h>
 
     using namespace OpenMEEG;
 
@@ -30,26 +33,54 @@
 
         #include <numpy/arrayobject.h>
 
+        /* Zero-copy exchange of values between NumPy and OpenMEEG.
+
+           - C++ -> NumPy: asarray returns an array using the storage of the Matrix/Vector/SymMatrix.
+             The array base is a capsule holding a (shallow, reference counted) copy of the object,
+             so the values stay valid as long as the array lives, whatever happens to the python
+             object the array was taken from.
+
+           - NumPy -> C++: fromarray, vector_fromarray and symmatrix_fromarray use the buffer of
+             Fortran ordered arrays of doubles directly (through a LinOpValue referencing external
+             storage). The buffer is released (and the NumPy array reference dropped) when the last
+             OpenMEEG object using it is destroyed. Other arrays are converted once by NumPy.
+
+           The wrappers release the GIL (swig -threads), except those of the functions below which use
+           the python API. The last OpenMEEG object using a buffer may be destroyed without the GIL. */
+
+        template <typename T>
+        static void delete_object(PyObject* capsule) {
+            delete static_cast<T*>(PyCapsule_GetPointer(capsule,NULL));
+        }
+
+        template <typename T>
+        static PyObject* array_view(const T& object,const int ndims,npy_intp* dims) {
+            PyObject* array = PyArray_NewFromDescr(&PyArray_Type,PyArray_DescrFromType(NPY_DOUBLE),ndims,dims,NULL,
+                                                   static_cast<void*>(object.data()),NPY_FARRAY,NULL);
+            if (!array)
+                return NULL;
+            T* copy = new T(object); // Shares (and references) the values.
+            PyObject* owner = PyCapsule_New(copy,NULL,delete_object<T>);
+            if (!owner) {
+                delete copy;
+                Py_DECREF(array);
+                return NULL;
+            }
+            // The reference to owner is stolen, even on failure.
+            if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject*>(array),owner)<0) {
+                Py_DECREF(array);
+                return NULL;
+            }
+            return array;
+        }
+
         static PyObject* asarray(OpenMEEG::Matrix* _mat) {
             if (!_mat) {
                 PyErr_SetString(PyExc_RuntimeError, "Zero pointer passed instead of valid Matrix struct.");
                 return(NULL);
             }
-
-            /* array object */
-            PyArrayObject* matarray = 0;
-
-            /* Get the number of dimensions from the Matrix
-             */
-            npy_intp ar_dim[7], ndims;
-            ndims = 2;
-            ar_dim[0] = _mat->nlin();
-            ar_dim[1] = _mat->ncol();
-
-            /* create numpy array */
-            matarray = (PyArrayObject*) PyArray_NewFromDescr(&PyArray_Type, PyArray_DescrFromType(PyArray_DOUBLE), ndims, ar_dim, NULL, (void *) _mat->data(),NPY_FARRAY,NULL);
-
-            return PyArray_Return((PyArrayObject*) matarray);
+            npy_intp dims[2] = { static_cast<npy_intp>(_mat->nlin()), static_cast<npy_intp>(_mat->ncol()) };
+            return array_view(*_mat,2,dims);
         }
 
         static PyObject* asarray(OpenMEEG::Vector* _vec) {
@@ -57,43 +88,104 @@
                 PyErr_SetString(PyExc_RuntimeError, "Zero pointer passed instead of valid Vector struct.");
                 return(NULL);
             }
+            npy_intp dims[1] = { static_cast<npy_intp>(_vec->size()) };
+            return array_view(*_vec,1,dims);
+        }
+
+        /* The packed upper triangle (column major) of the SymMatrix, as used by symmatrix_fromarray. */
+
+        static PyObject* asarray(OpenMEEG::SymMatrix* _mat) {
+            if (!_mat) {
+                PyErr_SetString(PyExc_RuntimeError, "Zero pointer passed instead of valid SymMatrix struct.");
+                return(NULL);
+            }
+            npy_intp dims[1] = { static_cast<npy_intp>(_mat->size()) };
+            return array_view(*_mat,1,dims);
+        }
+
+        static void release_buffer(void* view) {
+            const PyGILState_STATE state = PyGILState_Ensure();
+            Py_buffer* buffer = static_cast<Py_buffer*>(view);
+            PyBuffer_Release(buffer);
+            delete buffer;
+            PyGILState_Release(state);
+        }
+
+        static bool is_double_buffer(const Py_buffer& buffer,const int min_dims,const int max_dims) {
+            const std::string format = (buffer.format) ? buffer.format : "B";
+            return buffer.itemsize==sizeof(double) && format[format.size()-1]=='d' &&
+                   buffer.ndim>=min_dims && buffer.ndim<=max_dims;
+        }
 
-            /* array object */
-            PyArrayObject* matarray = 0;
+        /* Buffer of a Fortran ordered array of doubles: obj itself when possible, otherwise a converted copy. */
 
-            /* Get the size of the Vector
-             */
-            npy_intp ar_dim[7], ndims;
-            ndims = 1;
-            ar_dim[0] = _vec->size();
+        static Py_buffer* fortran_buffer(PyObject* obj,const int min_dims,const int max_dims) {
+            const int flags = PyBUF_F_CONTIGUOUS | PyBUF_FORMAT | PyBUF_WRITABLE;
+            Py_buffer* buffer = new Py_buffer;
+            if (PyObject_CheckBuffer(obj) && PyObject_GetBuffer(obj,buffer,flags)==0) {
+                if (is_double_buffer(*buffer,min_dims,max_dims))
+                    return buffer;
+                PyBuffer_Release(buffer);
+            }
+            PyErr_Clear();
 
-            /* create numpy array */
-            matarray = (PyArrayObject*) PyArray_NewFromDescr(&PyArray_Type, PyArray_DescrFromType(PyArray_DOUBLE), ndims, ar_dim, NULL, (void *) _vec->data(),NPY_FARRAY,NULL);
+            PyObject* array = PyArray_FROMANY(obj,NPY_DOUBLE,min_dims,max_dims,NPY_FARRAY);
+            if (!array || PyObject_GetBuffer(array,buffer,flags)!=0) {
+                Py_XDECREF(array);
+                delete buffer;
+                throw std::invalid_argument("Cannot convert the argument to a Fortran ordered array of doubles.");
+            }
+            Py_DECREF(array); // The buffer keeps its own reference.
+            return buffer;
+        }
 
-            return PyArray_Return ((PyArrayObject*) matarray);
+        static OpenMEEG::LinOpValue* external_value(Py_buffer* buffer) {
+            return new OpenMEEG::LinOpValue(static_cast<double*>(buffer->buf),release_buffer,buffer);
         }
 
-        /* Create a Matrix from an array
-           how to assign elements, ex: A(1,2)=4. ? setvalue ? TODO */
+        /* Create a Matrix sharing the values of an array (1d arrays give a one column Matrix). */
+
         static OpenMEEG::Matrix fromarray(PyObject* mat) {
-            if (!mat) {
-                PyErr_SetString(PyExc_RuntimeError, "Zero pointer passed instead of valid array.");
-                return(NULL);
-            }
-            PyArrayObject *matt;
-            matt = (PyArrayObject *)PyArray_FromObject(mat, NPY_DOUBLE, 1, 2);
-            size_t nl = matt->dimensions[0];
-            size_t nc = 1;
-            if (matt->nd ==2) nc = matt->dimensions[1];
-            OpenMEEG::Matrix omat(nl, nc);
-            for (unsigned i = 0; i< nl; ++i) {
-                for (unsigned j = 0; j< nc; ++j) {
-                    omat(i,j)= *(double * )(matt->data + i*matt->strides[0] + j*matt->strides[matt->nd-1]);
+            if (!mat)
+                throw std::invalid_argument("Zero pointer passed instead of valid array.");
+            Py_buffer* buffer = fortran_buffer(mat,1,2);
+            const size_t nl = buffer->shape[0];
+            const size_t nc = (buffer->ndim==2) ? buffer->shape[1] : 1;
+            return OpenMEEG::Matrix(nl,nc,external_value(buffer));
+        }
+
+        static OpenMEEG::Vector vector_fromarray(PyObject* vec) {
+            if (!vec)
+                throw std::invalid_argument("Zero pointer passed instead of valid array.");
+            Py_buffer* buffer = fortran_buffer(vec,1,1);
+            return OpenMEEG::Vector(buffer->shape[0],external_value(buffer));
+        }
+
+        /* A 1d array of size n(n+1)/2 is used as the packed upper triangle of a n x n SymMatrix (no copy).
+           A 2d square array is packed (copy of its upper triangle). */
+
+        static OpenMEEG::SymMatrix symmatrix_fromarray(PyObject* mat) {
+            if (!mat)
+                throw std::invalid_argument("Zero pointer passed instead of valid array.");
+            Py_buffer* buffer = fortran_buffer(mat,1,2);
+            if (buffer->ndim==1) {
+                const size_t size = buffer->shape[0];
+                const size_t n    = static_cast<size_t>((std::sqrt(8.0*size+1.0)-1.0)/2.0+0.5);
+                if (n*(n+1)/2!=size) {
+                    release_buffer(buffer);
+                    throw std::invalid_argument("The size of a packed SymMatrix must be n(n+1)/2.");
                 }
+                return OpenMEEG::SymMatrix(n,external_value(buffer));
             }
-            return omat;
+            const size_t n = buffer->shape[0];
+            if (static_cast<size_t>(buffer->shape[1])!=n) {
+                release_buffer(buffer);
+                throw std::invalid_argument("A SymMatrix can only be built from a square array.");
+            }
+            const OpenMEEG::Matrix full(n,n,external_value(buffer));
+            return OpenMEEG::SymMatrix(full);
         }
-        
+
     #endif
 %}
 
@@ -167,6 +259,13 @@ namespace OpenMEEG {
 %include <gain.h>
 %include <forward.h>
 
+%ignore OpenMEEG::Cancelled;
+%ignore OpenMEEG::Progress::check;
+%ignore OpenMEEG::Progress::current;
+%ignore OpenMEEG::Progress::add_work;
+%ignore OpenMEEG::Progress::advance;
+%include <progress.h>
+
 %extend OpenMEEG::Triangle {
     // TODO almost.. if I do: t.index() I get:
     // <Swig Object of type 'unsigned int *' at 0x22129f0>
@@ -205,6 +304,146 @@ instead we have a pointer to it:
 <Swig Object of type 'Interface *' at 0xa1e1590>
 */
 
+%nothread asarray;
+%nothread fromarray;
+%nothread vector_fromarray;
+%nothread symmatrix_fromarray;
+
 static PyObject* asarray(OpenMEEG::Matrix* _mat);
 static PyObject* asarray(OpenMEEG::Vector* _vec);
+static PyObject* asarray(OpenMEEG::SymMatrix* _mat);
 static OpenMEEG::Matrix fromarray(PyObject* _mat);
+static OpenMEEG::Vector vector_fromarray(PyObject* _vec);
+static OpenMEEG::SymMatrix symmatrix_fromarray(PyObject* _mat);
+
+/* Asynchronous computations: the wrappers release the GIL, so the computations run in background
+   threads concurrently with the other python threads (and with each other). */
+
+%pythoncode {
+import threading as _threading
+
+try:
+    from concurrent.futures import CancelledError, TimeoutError
+except ImportError:
+    class CancelledError(RuntimeError):
+        """The computation of a Future was cancelled."""
+
+    class TimeoutError(RuntimeError):
+        """The result of a Future was not available in time."""
+
+class Future(object):
+    """Result of a computation run in a background thread (see submit).
+
+    done(), running(), result(timeout), exception(timeout) and add_done_callback(fn) are those
+    of concurrent.futures. progress() is the number of (done, total) tasks of the assembly loops
+    started so far. cancel() stops these loops (but not the factorizations): result() then raises
+    CancelledError. The arguments of the computation must not be modified before it is done.
+    """
+
+    def __init__(self, function, args, kwargs, progress=None, interval=1.0):
+        self._progress = Progress()
+        self._done = _threading.Event()
+        self._lock = _threading.Lock()
+        self._callbacks = []
+        self._result = None
+        self._exception = None
+        thread = _threading.Thread(target=self._run, args=(function, args, kwargs))
+        thread.daemon = True
+        thread.start()
+        if progress is not None:
+            monitor = _threading.Thread(target=self._monitor, args=(progress, interval))
+            monitor.daemon = True
+            monitor.start()
+
+    def _run(self, function, args, kwargs):
+        self._progress.attach()
+        try:
+            self._result = function(*args, **kwargs)
+        except BaseException as e:
+            self._exception = e
+            if not isinstance(e, Exception):
+                raise
+        finally:
+            # Whatever was raised (even SystemExit or KeyboardInterrupt), the future is done.
+            self._progress.detach()
+            if self._progress.cancelled():
+                self._result = None
+                self._exception = CancelledError("The computation was cancelled.")
+            self._lock.acquire()
+            self._done.set()
+            callbacks, self._callbacks = self._callbacks, []
+            self._lock.release()
+            for callback in callbacks:
+                callback(self)
+
+    def _monitor(self, callback, interval):
+        while not self._done.wait(interval):
+            callback(*self.progress())
+        callback(*self.progress())
+
+    def done(self):
+        return self._done.is_set()
+
+    def running(self):
+        return not self.done()
+
+    def cancel(self):
+        if self.done():
+            return False
+        self._progress.cancel()
+        return True
+
+    def cancelled(self):
+        return self.done() and isinstance(self._exception, CancelledError)
+
+    def progress(self):
+        return (self._progress.done(), self._progress.total())
+
+    def exception(self, timeout=None):
+        if not self._done.wait(timeout):
+            raise TimeoutError()
+        return self._exception
+
+    def result(self, timeout=None):
+        if self.exception(timeout) is not None:
+            raise self._exception
+        return self._result
+
+    def add_done_callback(self, fn):
+        self._lock.acquire()
+        pending = not self._done.is_set()
+        if pending:
+            self._callbacks.append(fn)
+        self._lock.release()
+        if not pending:
+            fn(self)
+
+def submit(function, *args, **kwargs):
+    """Run function(*args, **kwargs) in a background thread and return its Future.
+
+    The keyword arguments progress (called with the (done, total) tasks every interval seconds and
+    when the computation ends) and interval (default 1 second) are not passed to function:
+
+        hm = openmeeg.submit(openmeeg.HeadMat, geom, 3, progress=report)
+        dsm = openmeeg.DipSourceMat_async(geom, dipoles, 3, True, "")
+        hminv = hm.result().inverse()
+    """
+    progress = kwargs.pop('progress', None)
+    interval = kwargs.pop('interval', 1.0)
+    return Future(function, args, kwargs, progress, interval)
+
+def _async_variant(function):
+    def variant(*args, **kwargs):
+        return submit(function, *args, **kwargs)
+    variant.__name__ = function.__name__ + '_async'
+    variant.__doc__ = "Asynchronous %s, returning a Future (see submit)." % function.__name__
+    return variant
+
+for _name in ['HeadMat', 'DistributedHeadMat', 'SurfSourceMat', 'DipSourceMat', 'EITSourceMat', 'Surf2VolMat',
+              'Head2EEGMat', 'Head2ECoGMat', 'Head2MEGMat', 'SurfSource2MEGMat', 'DipSource2MEGMat',
+              'DipSource2InternalPotMat', 'CorticalMat', 'GainMEG', 'GainEEG', 'GainEEGadjoint', 'GainMEGadjoint',
+              'GainEEGMEGadjoint', 'GainInternalPot', 'GainStimInternalPot', 'Forward']:
+    if _name in globals():
+        globals()[_name + '_async'] = _async_variant(globals()[_name])
+del _name
+}
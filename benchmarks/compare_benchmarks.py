@@ -0,0 +1,71 @@
+#!/usr/bin/env python
+"""Compare two benchmark files produced by run_benchmarks.py.
+
+Records are matched on (model, stage, threads, gauss_order). A stage is
+reported as a regression when its wall time grew by more than the relative
+threshold and by more than the absolute minimum (to ignore noise on very
+short stages). The exit status is 1 when a regression is found.
+"""
+
+import argparse
+import json
+import sys
+
+def key(r):
+    return (r["model"], r["stage"], r["threads"], r["gauss_order"])
+
+def load(filename):
+    with open(filename) as f:
+        data = json.load(f)
+    return data, dict((key(r), r) for r in data["results"] if r.get("status", 0) == 0 and "wall" in r)
+
+def describe(machine):
+    build = machine.get("build", {})
+    return "%s, %s cpus, rev %s, %s %s" % (machine.get("processor"), machine.get("cpu_count"),
+                                         (machine.get("git_revision") or "?")[:10],
+                                         build.get("CMAKE_BUILD_TYPE", ""), build.get("CMAKE_CXX_FLAGS", ""))
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("reference", help="baseline benchmark file")
+    parser.add_argument("candidate", help="new benchmark file")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="relative slowdown reported as a regression (default 0.10)")
+    parser.add_argument("--min-seconds", type=float, default=0.05,
+                        help="ignore differences smaller than this (default 0.05s)")
+    parser.add_argument("--metric", choices=["wall", "cpu"], default="wall")
+    args = parser.parse_args()
+
+    ref_data, ref = load(args.reference)
+    new_data, new = load(args.candidate)
+    print("reference: " + describe(ref_data["machine"]))
+    print("candidate: " + describe(new_data["machine"]))
+    if ref_data["machine"].get("processor") != new_data["machine"].get("processor"):
+        print("warning: the two runs were made on different processors")
+    print("")
+
+    regressions = 0
+    print("%-10s %-9s %7s %5s %10s %10s %8s" % ("model", "stage", "threads", "order", "reference", "candidate", "change"))
+    for k in sorted(set(ref) & set(new)):
+        old = ref[k][args.metric]
+        cur = new[k][args.metric]
+        change = (cur-old)/old if old > 0 else 0.0
+        flag = ""
+        if cur > old*(1.0+args.threshold) and cur-old > args.min_seconds:
+            flag = "  REGRESSION"
+            regressions += 1
+        elif cur < old*(1.0-args.threshold) and old-cur > args.min_seconds:
+            flag = "  improved"
+        print("%-10s %-9s %7d %5d %10.3f %10.3f %+7.1f%%%s" % (k + (old, cur, 100.0*change, flag)))
+
+    for k in sorted(set(ref) - set(new)):
+        print("missing in candidate: %s %s threads=%d order=%d" % k)
+    for k in sorted(set(new) - set(ref)):
+        print("new in candidate: %s %s threads=%d order=%d" % k)
+
+    print("")
+    print("%d regression(s) above %.0f%%" % (regressions, 100.0*args.threshold))
+    return 1 if regressions else 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,358 @@
+#!/usr/bin/env python
+"""Reproducible timing of the OpenMEEG forward pipeline.
+
+Every pipeline stage (HM, HMInv, DSM, SSM, H2EM, H2MM, DS2MM, Surf2Vol,
+DS2IPM, gains, EIT) is run with the command line tools on the bundled head
+models, on the nerve1 model and on nested spheres of increasing refinement
+made by om_make_nested_spheres, for each requested thread count and
+integration order. The gains of the nested sphere models are compared with
+the analytic solutions of tests/analytic, which gives accuracy vs time curves.
+The result is a single JSON file holding the machine description and one
+record per (model, stage, threads, gauss_order) that can be compared with
+compare_benchmarks.py.
+"""
+
+import argparse
+import json
+import math
+import os
+import platform
+import shutil
+import subprocess
+import sys
+import time
+
+HEAD_MODELS = ["Head1", "Head2", "Head3",
+               "HeadNNa1", "HeadNNa2", "HeadNNa3",
+               "HeadNNb1", "HeadNNb2", "HeadNNb3",
+               "HeadNNc1", "HeadNNc2", "HeadNNc3"]
+
+# ---------------------------------------------------------------------------
+# Machine description
+# ---------------------------------------------------------------------------
+
+def read_first(path, key):
+    try:
+        with open(path) as f:
+            for line in f:
+                if line.startswith(key):
+                    return line.split(":", 1)[1].strip()
+    except IOError:
+        pass
+    return None
+
+def cmake_cache(build_dir):
+    settings = {}
+    keys = ["CMAKE_CXX_COMPILER", "CMAKE_CXX_FLAGS", "CMAKE_BUILD_TYPE",
+            "USE_OMP", "USE_ATLAS", "USE_MKL", "LAPACK_LIBRARIES"]
+    try:
+        with open(os.path.join(build_dir, "CMakeCache.txt")) as f:
+            for line in f:
+                name = line.split(":", 1)[0]
+                if name in keys and "=" in line:
+                    settings[name] = line.split("=", 1)[1].strip()
+    except IOError:
+        pass
+    return settings
+
+def git_revision(source_dir):
+    try:
+        out = subprocess.check_output(["git", "rev-parse", "HEAD"], cwd=source_dir,
+                                      stderr=subprocess.DEVNULL)
+        return out.decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+def machine_info(args):
+    mem = read_first("/proc/meminfo", "MemTotal")
+    return {
+        "hostname": platform.node(),
+        "platform": platform.platform(),
+        "processor": read_first("/proc/cpuinfo", "model name") or platform.processor(),
+        "cpu_count": os.cpu_count() if hasattr(os, "cpu_count") else None,
+        "memory": mem,
+        "python": platform.python_version(),
+        "git_revision": git_revision(args.source_dir),
+        "build": cmake_cache(args.build_dir),
+        "date": time.strftime("%Y-%m-%dT%H:%M:%S"),
+    }
+
+# ---------------------------------------------------------------------------
+# Synthetic nested spheres
+# ---------------------------------------------------------------------------
+
+def make_sphere_model(args, level):
+    # om_make_nested_spheres uses the radii and conductivities of Head1-3 by default, so the
+    # sensors and dipoles of Head1 can be reused and compared with the analytic solutions.
+    name = "Sphere%d" % level
+    mdir = os.path.join(args.workdir, "models", name)
+    if not os.path.isdir(mdir):
+        os.makedirs(mdir)
+    exe = find_tool(args.build_dir, "om_make_nested_spheres")
+    if exe is None:
+        sys.stderr.write("Skipping %s: om_make_nested_spheres not found\n" % name)
+        return None
+    with open(os.path.join(mdir, "log.txt"), "w") as log:
+        if subprocess.call([exe, "-l", str(level), "-o", os.path.join(mdir, name)], stdout=log, stderr=subprocess.STDOUT) != 0:
+            sys.stderr.write("Skipping %s: om_make_nested_spheres failed\n" % name)
+            return None
+    m = head_model(args.source_dir, "Head1")
+    m.update({
+        "name": name, "refinement": level, "vertices": 10*4**level+2, "triangles": 20*4**level,
+        "geom": os.path.join(mdir, name+".geom"), "cond": os.path.join(mdir, name+".cond"),
+    })
+    return m
+
+# ---------------------------------------------------------------------------
+# Models and stages
+# ---------------------------------------------------------------------------
+
+def existing(path):
+    return path if path and os.path.exists(path) else None
+
+def head_model(source_dir, name):
+    mdir = os.path.join(source_dir, "data", "Models", name)
+    cdir = os.path.join(source_dir, "data", "Computations", name)
+    # NN variants share the sensors of the corresponding Head model.
+    base = "Head" + name[-1]
+    bdir = os.path.join(source_dir, "data", "Computations", base)
+    def sensors(suffix):
+        return existing(os.path.join(cdir, name+suffix)) or existing(os.path.join(bdir, base+suffix))
+    return {
+        "name": name,
+        "geom": existing(os.path.join(mdir, name+".geom")),
+        "cond": existing(os.path.join(mdir, name+".cond")),
+        "dip": existing(os.path.join(cdir, name+".dip")) or existing(os.path.join(mdir, name+".dip")),
+        "src": existing(os.path.join(mdir, name+".tri")),
+        "patches": sensors(".patches"),
+        "squids": sensors(".squids"),
+        "points": existing(os.path.join(source_dir, "tests", "analytic", "eeg_internal_points.txt")),
+        "analytic": analytic_solutions(source_dir, name),
+    }
+
+def analytic_solutions(source_dir, name):
+    # Reference potentials/fields of the nested sphere models (columns are the dipoles of HeadX.dip).
+    if name not in ["Head1", "Head2", "Head3"]:
+        return {}
+    adir = os.path.join(source_dir, "tests", "analytic")
+    solutions = {
+        "GainEEG": os.path.join(adir, "eeg_head%s_analytic.txt" % name[-1]),
+        "GainMEG": os.path.join(adir, "meg_analytic.txt"),
+        "GainIP":  os.path.join(adir, "eeg_internal_analytic.txt"),
+    }
+    return dict((k, v) for (k, v) in solutions.items() if os.path.exists(v))
+
+def head_stages(m, out):
+    def f(stage):
+        return os.path.join(out, m["name"] + "." + stage)
+    g, c = m["geom"], m["cond"]
+    return [
+        ("HM",       "om_assemble", ["-HM", g, c, f("hm")],                     [g, c]),
+        ("HMInv",    "om_minverser", [f("hm"), f("hm_inv")],                     [f("hm")]),
+        ("DSM",      "om_assemble", ["-DSM", g, c, m["dip"], f("dsm")],         [g, c, m["dip"]]),
+        ("SSM",      "om_assemble", ["-SSM", g, c, m["src"], f("ssm")],         [g, c, m["src"]]),
+        ("H2EM",     "om_assemble", ["-H2EM", g, c, m["patches"], f("h2em")],   [g, c, m["patches"]]),
+        ("H2MM",     "om_assemble", ["-H2MM", g, c, m["squids"], f("h2mm")],    [g, c, m["squids"]]),
+        ("DS2MM",    "om_assemble", ["-DS2MM", m["dip"], m["squids"], f("ds2mm")], [m["dip"], m["squids"]]),
+        ("Surf2Vol", "om_assemble", ["-H2IPM", g, c, m["points"], f("h2ipm")], [g, c, m["points"]]),
+        ("DS2IPM",   "om_assemble", ["-DS2IPM", g, c, m["dip"], m["points"], f("ds2ipm")], [g, c, m["dip"], m["points"]]),
+        # Gains are written as text to be compared with the analytic solutions.
+        ("GainEEG",  "om_gain",     ["-EEG", f("hm_inv"), f("dsm"), f("h2em"), f("eeg_gain.txt")],
+                                    [f("hm_inv"), f("dsm"), f("h2em")]),
+        ("GainMEG",  "om_gain",     ["-MEG", f("hm_inv"), f("dsm"), f("h2mm"), f("ds2mm"), f("meg_gain.txt")],
+                                    [f("hm_inv"), f("dsm"), f("h2mm"), f("ds2mm")]),
+        ("GainIP",   "om_gain",     ["-IP", f("hm_inv"), f("dsm"), f("h2ipm"), f("ds2ipm"), f("ip_gain.txt")],
+                                    [f("hm_inv"), f("dsm"), f("h2ipm"), f("ds2ipm")]),
+    ]
+
+def eit_electrodes(patches, electrodes, radius=0.1):
+    # EIT electrodes need a radius as 4th column, make_nerve only writes the positions.
+    with open(patches) as f, open(electrodes, "w") as g:
+        for line in f:
+            if line.strip():
+                g.write("%s %g\n" % (line.strip(), radius))
+
+def nerve_stages(source_dir, out):
+    params = os.path.join(source_dir, "data", "Models", "nerve1", "nerve1.parameters")
+    points = os.path.join(source_dir, "data", "Computations", "nerve1", "positions", "test0")
+    def f(suffix):
+        return os.path.join(out, "nerve1." + suffix)
+    g, c = f("geom"), f("cond")
+    return [
+        ("MakeNerve", "om_make_nerve", ["-useparameters", params, g, c, f("int.tri"), f("ext.tri"),
+                                        f("stimelec"), f("patchcount")], [params]),
+        ("Electrodes", None, lambda: eit_electrodes(f("stimelec"), f("electrodes")), [f("stimelec")]),
+        ("HM",        "om_assemble", ["-HM", g, c, f("hm")],                        [g, c]),
+        ("HMInv",     "om_minverser", [f("hm"), f("hm_inv")],                        [f("hm")]),
+        ("EITSM",     "om_assemble", ["-EITSM", g, c, f("electrodes"), f("eitsm")], [g, c, f("electrodes")]),
+        ("Surf2Vol",  "om_assemble", ["-H2IPM", g, c, points, f("h2ipm")],          [g, c, points]),
+    ]
+
+# ---------------------------------------------------------------------------
+# Running
+# ---------------------------------------------------------------------------
+
+def read_text_matrix(filename):
+    with open(filename) as f:
+        return [[float(x) for x in line.split()] for line in f if line.strip()]
+
+def accuracy(result, reference):
+    # Same measures as compare_matrix: relative difference measure and magnitude ratio per column.
+    u, v = read_text_matrix(result), read_text_matrix(reference)
+    if len(u) != len(v) or len(u) == 0:
+        return None
+    ncols = min(len(u[0]), len(v[0]))
+    rdm, mag = [], []
+    for j in range(ncols):
+        a = [row[j] for row in u]
+        b = [row[j] for row in v]
+        na = math.sqrt(sum(x*x for x in a))
+        nb = math.sqrt(sum(x*x for x in b))
+        if na == 0.0 or nb == 0.0:
+            continue
+        rdm.append(math.sqrt(sum((x/na-y/nb)**2 for (x, y) in zip(a, b))))
+        mag.append(na/nb)
+    if not rdm:
+        return None
+    return {"rdm": rdm, "mag": mag, "max_rdm": max(rdm), "max_mag_error": max(abs(1.0-x) for x in mag)}
+
+def find_tool(build_dir, tool):
+    for sub in ["src", "tools", "."]:
+        path = os.path.join(build_dir, sub, tool)
+        if os.path.exists(path):
+            return path
+    return shutil.which(tool) if hasattr(shutil, "which") else None
+
+def run_once(cmd, env, log):
+    # The child is reaped with wait4 to get its own resource usage: RUSAGE_CHILDREN would give the
+    # peak memory of all the children run so far.
+    start = time.perf_counter()
+    proc = subprocess.Popen(cmd, env=env, stdout=log, stderr=subprocess.STDOUT, cwd=os.path.dirname(cmd[-1]))
+    _, status, usage = os.wait4(proc.pid, 0)
+    wall = time.perf_counter() - start
+    proc.returncode = -os.WTERMSIG(status) if os.WIFSIGNALED(status) else os.WEXITSTATUS(status)
+    cpu = usage.ru_utime + usage.ru_stime
+    return proc.returncode, wall, cpu, usage.ru_maxrss
+
+def run_stages(args, model, stages, threads, order, records):
+    out = os.path.join(args.workdir, "runs", "%s-t%d-g%d" % (model["name"], threads, order))
+    if not os.path.isdir(out):
+        os.makedirs(out)
+    env = dict(os.environ)
+    env["OMP_NUM_THREADS"] = str(threads)
+    env["OPENBLAS_NUM_THREADS"] = "1" if threads > 1 and args.blas_single else str(threads)
+    env["MKL_NUM_THREADS"] = env["OPENBLAS_NUM_THREADS"]
+    with open(os.path.join(out, "log.txt"), "w") as log:
+        for (stage, tool, params, inputs) in stages(out):
+            if any(i is None or not os.path.exists(i) for i in inputs):
+                continue
+            if tool is None:
+                # Preparation step, not timed.
+                params()
+                continue
+            if args.stages and stage not in args.stages:
+                continue
+            exe = find_tool(args.build_dir, tool)
+            if exe is None:
+                sys.stderr.write("Skipping %s/%s: %s not found\n" % (model["name"], stage, tool))
+                continue
+            cmd = [exe] + params
+            if tool == "om_assemble":
+                cmd += ["-gauss-order", str(order)]
+            timing = os.path.join(out, stage + ".timings.json")
+            if tool != "om_make_nerve":
+                cmd += ["-timings", timing]
+            # -timings and -gauss-order are extracted before positional arguments are read,
+            # hence appending them does not change the meaning of the output path.
+            best = None
+            for _ in range(args.repeat):
+                status, wall, cpu, rss = run_once(cmd, env, log)
+                if status != 0:
+                    break
+                if best is None or wall < best[0]:
+                    best = (wall, cpu, rss)
+            record = {
+                "model": model["name"], "stage": stage, "threads": threads, "gauss_order": order,
+                "command": " ".join([tool] + cmd[1:]), "status": status,
+            }
+            for key in ["refinement", "vertices", "triangles"]:
+                if key in model:
+                    record[key] = model[key]
+            if best is not None:
+                record.update({"wall": best[0], "cpu": best[1], "max_rss_kb": best[2]})
+                if os.path.exists(timing):
+                    with open(timing) as f:
+                        try:
+                            record["phases"] = json.load(f)
+                        except ValueError:
+                            pass
+                reference = model.get("analytic", {}).get(stage)
+                if reference:
+                    error = accuracy(params[-1], reference)
+                    if error:
+                        record["accuracy"] = error
+            records.append(record)
+            sys.stdout.write("%-10s %-9s threads=%-2d order=%d  %s\n" %
+                             (model["name"], stage, threads, order,
+                              ("wall %.3fs cpu %.3fs" % (best[0], best[1]) if best else "FAILED (%d)" % status) +
+                              ("  rdm %.4f" % record["accuracy"]["max_rdm"] if "accuracy" in record else "")))
+            sys.stdout.flush()
+            if status != 0:
+                break
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--build-dir", required=True, help="OpenMEEG build directory")
+    parser.add_argument("--source-dir", default=os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+    parser.add_argument("--workdir", default="benchmark_work", help="directory for intermediate files")
+    parser.add_argument("--output", default="benchmark.json")
+    parser.add_argument("--models", nargs="*", default=HEAD_MODELS + ["nerve1"],
+                        help="bundled models to run (default: all)")
+    parser.add_argument("--spheres", nargs="*", type=int, default=[1, 2, 3],
+                        help="refinement levels of the synthetic nested spheres")
+    parser.add_argument("--threads", nargs="*", type=int, default=[1])
+    parser.add_argument("--gauss-orders", nargs="*", type=int, default=[3], choices=[0, 1, 2, 3],
+                        help="integration orders (om_assemble only has the orders 0 to 3)")
+    parser.add_argument("--stages", nargs="*", default=None,
+                        help="restrict to these stages (inputs are taken from previous runs in the workdir)")
+    parser.add_argument("--repeat", type=int, default=1, help="keep the best of n runs")
+    parser.add_argument("--blas-single", action="store_true",
+                        help="force single threaded BLAS when OpenMP threads > 1")
+    args = parser.parse_args()
+    if args.repeat < 1:
+        parser.error("--repeat must be at least 1")
+    args.build_dir = os.path.abspath(args.build_dir)
+    args.source_dir = os.path.abspath(args.source_dir)
+    args.workdir = os.path.abspath(args.workdir)
+
+    models = []
+    for name in args.models:
+        if name == "nerve1":
+            models.append(({"name": "nerve1"}, lambda out: nerve_stages(args.source_dir, out)))
+        else:
+            m = head_model(args.source_dir, name)
+            if m["geom"] is None:
+                sys.stderr.write("Skipping unknown model %s\n" % name)
+                continue
+            models.append((m, lambda out, m=m: head_stages(m, out)))
+    for level in args.spheres:
+        m = make_sphere_model(args, level)
+        if m is not None:
+            models.append((m, lambda out, m=m: head_stages(m, out)))
+
+    records = []
+    for threads in args.threads:
+        for order in args.gauss_orders:
+            for (model, stages) in models:
+                run_stages(args, model, stages, threads, order, records)
+
+    result = {"machine": machine_info(args), "settings": {
+                  "threads": args.threads, "gauss_orders": args.gauss_orders, "repeat": args.repeat},
+              "results": records}
+    with open(args.output, "w") as f:
+        json.dump(result, f, indent=1)
+    sys.stdout.write("Benchmark results written to %s\n" % args.output)
+    return 0 if all(r["status"] == 0 for r in records) else 1
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -169,3 +169,40 @@ assert((m2-om.fromarray(mat)).frobenius_norm() < 1e-15)
 #print mat.sum()
 #mat[0:2, 1:3] = 0
 #print mat[0:5, 0:5]
+
+# No copy: the Matrix made from an array shares its values
+m3 = om.fromarray(mat)
+mat[0, 0] += 1.
+assert(om.asarray(m3)[0, 0] == mat[0, 0])
+mat[0, 0] -= 1.
+
+# Arrays keep the values alive after the OpenMEEG object is gone
+vec2 = om.asarray(om.vector_fromarray(vec))
+assert(abs(vec2 - vec).max() < 1e-15)
+
+# SymMatrix: packed upper triangle
+hm_packed = om.asarray(hm)
+hm2 = om.symmatrix_fromarray(hm_packed)
+assert((om.Matrix(hm2) - om.Matrix(hm)).frobenius_norm() < 1e-15)
+
+###############################################################################
+# Asynchronous computations (the GIL is released while they run)
+
+hm_future = om.HeadMat_async(geom, gauss_order)
+dsm_future = om.submit(om.DipSourceMat, geom, dipoles, gauss_order,
+                       use_adaptive_integration, "")
+hm_async = hm_future.result()
+dsm_async = dsm_future.result()
+assert((om.Matrix(hm_async) - om.Matrix(hm)).frobenius_norm() < 1e-15)
+assert((dsm_async - dsm).frobenius_norm() < 1e-15)
+done, total = hm_future.progress()
+assert(total > 0 and done == total)
+
+# A cancelled computation raises CancelledError
+hm_future = om.HeadMat_async(geom, gauss_order)
+if hm_future.cancel():
+    try:
+        hm_future.result()
+        assert(False)
+    except om.CancelledError:
+        assert(hm_future.cancelled())
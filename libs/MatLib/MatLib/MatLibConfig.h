@@ -128,6 +128,7 @@ knowledge of the CeCILL-B license and that you accept its terms.
         void BLAS(dtpmv,DTPMV)(const char&,const char&,const char&,const int&,const double*,double*,const int&);
         void BLAS(dsymm,DSYMM)(const char&,const char&,const int&,const int&,const double&,const double*,const int&,const double*,const int&, const double&,double*,const int&);
         void BLAS(dgemm,DGEMM)(const char&,const char&,const int&,const int&,const int&,const double&,const double*,const int&,const double*,const int&,const double&,double*,const int&);
+        void BLAS(sgemm,SGEMM)(const char&,const char&,const int&,const int&,const int&,const float&,const float*,const int&,const float*,const int&,const float&,float*,const int&);
         void BLAS(dtrmm,DTRMM)(const char&,const char&,const char&,const char&,const int&,const int&,const double&,const double*,const int&,const double*,const int&);
         void BLAS(dgemv,DGEMV)(const char&,const int&,const int&,const double&,const double*,const int&,const double*,const int&,const double&,double*,const int&);
     }
@@ -150,8 +151,15 @@ knowledge of the CeCILL-B license and that you accept its terms.
         void FC_GLOBAL(dsptri,DSPTRI)(const char&,const int&,double*,int*,double*,int&);
         void FC_GLOBAL(dpptrf,DPPTRF)(const char&,const int&,double*,int&);
         void FC_GLOBAL(dpptri,DPPTRI)(const char&,const int&,double*,int&);
+        void FC_GLOBAL(dpptrs,DPPTRS)(const char&,const int&,const int&,const double*,double*,const int&,int&);
+        void FC_GLOBAL(dgetrf,DGETRF)(const int&,const int&,double*,const int&,int*,int&);
+        void FC_GLOBAL(dtrtrs,DTRTRS)(const char&,const char&,const char&,const int&,const int&,const double*,const int&,double*,const int&,int&);
+        void FC_GLOBAL(dgeqrf,DGEQRF)(const int&,const int&,double*,const int&,double*,double*,const int&,int&);
+        void FC_GLOBAL(dormqr,DORMQR)(const char&,const char&,const int&,const int&,const int&,const double*,const int&,const double*,double*,const int&,double*,const int&,int&);
         void FC_GLOBAL(dspevd,DSPEVD)(const char&,const char&,const int&,double*,double*,double*,const int&,double*,const int&,int*,const int&,int&);
         void FC_GLOBAL(dsptrs,DSPTRS)(const char&,const int&,const int&,double*,int*,double*,const int&,int&);
+        void FC_GLOBAL(ssptrf,SSPTRF)(const char&,const int&,float*,int*,int&);
+        void FC_GLOBAL(ssptrs,SSPTRS)(const char&,const int&,const int&,float*,int*,float*,const int&,int&);
     }
 #endif
 
@@ -163,8 +171,14 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #define DTPTRI FC_GLOBAL(dtptri,DTPTRI)
 #define DPPTRF FC_GLOBAL(dpptrf,DPPTRF)
 #define DPPTRI FC_GLOBAL(dpptri,DPPTRI)
+#define DPPTRS FC_GLOBAL(dpptrs,DPPTRS)
+#define DTRTRS FC_GLOBAL(dtrtrs,DTRTRS)
+#define DGEQRF FC_GLOBAL(dgeqrf,DGEQRF)
+#define DORMQR FC_GLOBAL(dormqr,DORMQR)
 #define DSPEVD FC_GLOBAL(dspevd,DSPEVD)
 #define DSPTRS FC_GLOBAL(dsptrs,DSPTRS)
+#define SSPTRF FC_GLOBAL(ssptrf,SSPTRF)
+#define SSPTRS FC_GLOBAL(ssptrs,SSPTRS)
 
 #if defined(USE_ATLAS) || defined(USE_MKL)
     #define DGER(X1,X2,X3,X4,X5,X6,X7,X8,X9) BLAS(dger,DGER)(CblasColMajor,X1,X2,X3,X4,X5,X6,X7,X8,X9)
@@ -173,6 +187,7 @@ knowledge of the CeCILL-B license and that you accept its terms.
     #define DSYMM(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11,X12) BLAS(dsymm,DSYMM)(CblasColMajor,X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11,X12)
     #define DGEMV(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11) BLAS(dgemv,DGEMV)(CblasColMajor,X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11)
     #define DGEMM(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11,X12,X13) BLAS(dgemm,DGEMM)(CblasColMajor,X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11,X12,X13)
+    #define SGEMM(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11,X12,X13) BLAS(sgemm,SGEMM)(CblasColMajor,X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11,X12,X13)
     #define DTRMM(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11) BLAS(dtrmm,DTRMM)(CblasColMajor,X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11)
     #if defined(USE_ATLAS)
         #ifdef __APPLE__
@@ -196,6 +211,7 @@ knowledge of the CeCILL-B license and that you accept its terms.
     #define DSYMM(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11,X12) BLAS(dsymm,DSYMM)(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11,X12)
     #define DGEMV(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11) BLAS(dgemv,DGEMV)(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11)
     #define DGEMM(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11,X12,X13) BLAS(dgemm,DGEMM)(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11,X12,X13)
+    #define SGEMM(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11,X12,X13) BLAS(sgemm,SGEMM)(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11,X12,X13)
     #define DTRMM(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11) BLAS(dtrmm,DTRMM)(X1,X2,X3,X4,X5,X6,X7,X8,X9,X10,X11)
     #define DGETRF LAPACK(dgetrf,DGETRF)
     #if defined(USE_ACML)
@@ -0,0 +1,250 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+#ifdef WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif
+
+#include <allocator.h>
+
+namespace OpenMEEG {
+
+    namespace maths {
+
+        namespace {
+
+            //  Each block starts with a header (padded to the alignment) recording how to free it.
+
+            typedef enum { ALIGNED_MALLOC, MAPPED } BlockKind;
+
+            struct BlockHeader {
+                void*      base;
+                size_t     length;
+                size_t     bytes;
+                BlockKind  kind;
+            };
+
+            const size_t huge_page_size      = static_cast<size_t>(2) << 20;
+            const size_t small_page_size     = 4096;
+            const size_t first_touch_minimum = static_cast<size_t>(1) << 20;
+
+            Allocator::Statistics stats;
+            Allocator*            current = 0;
+
+            Allocator::HugePages env_huge_pages() {
+                const char* env = getenv("OPENMEEG_HUGE_PAGES");
+                if (env==0)
+                    return Allocator::NO_HUGE_PAGES;
+                if (!strcmp(env,"transparent"))
+                    return Allocator::TRANSPARENT_HUGE_PAGES;
+                if (!strcmp(env,"explicit"))
+                    return Allocator::EXPLICIT_HUGE_PAGES;
+                return Allocator::NO_HUGE_PAGES;
+            }
+
+            Allocator::FirstTouch env_first_touch() {
+                const char* env = getenv("OPENMEEG_FIRST_TOUCH");
+                if (env==0)
+                    return Allocator::NO_FIRST_TOUCH;
+                if (!strcmp(env,"owner"))
+                    return Allocator::OWNER_COMPUTES;
+                if (!strcmp(env,"interleaved"))
+                    return Allocator::INTERLEAVED;
+                return Allocator::NO_FIRST_TOUCH;
+            }
+
+            Allocator& default_allocator() {
+                static Allocator allocator(env_huge_pages(),env_first_touch());
+                return allocator;
+            }
+
+            void* aligned_malloc(const size_t align,const size_t length) {
+            #ifdef WIN32
+                return _aligned_malloc(length,align);
+            #else
+                void* base;
+                return (posix_memalign(&base,align,length)==0) ? base : 0;
+            #endif
+            }
+
+            void aligned_free(void* base) {
+            #ifdef WIN32
+                _aligned_free(base);
+            #else
+                free(base);
+            #endif
+            }
+
+            //  Zero the block by chunks of consecutive doubles given to the threads: a single chunk
+            //  per thread (same partition as a static loop over the storage) or pages round robin.
+
+            void touch_pages(double* data,const size_t n,const size_t page,const Allocator::FirstTouch mode) {
+                int nthreads = 1;
+            #ifdef USE_OMP
+                nthreads = omp_get_max_threads();
+            #endif
+                const size_t chunk   = (mode==Allocator::INTERLEAVED) ? page/sizeof(double) : (n+nthreads-1)/nthreads;
+                const int    nchunks = static_cast<int>((n+chunk-1)/chunk);
+                #pragma omp parallel for schedule(static,1)
+                for (int c=0;c<nchunks;++c) {
+                    const size_t start = c*chunk;
+                    const size_t end   = std::min(start+chunk,n);
+                    std::fill(data+start,data+end,0.0);
+                }
+            }
+        }
+
+        BadAlloc::BadAlloc(const size_t n): nbytes(n) {
+            std::ostringstream ost;
+            ost << "Unable to allocate " << n << " bytes for a matrix or a vector.";
+            msg = ost.str();
+        }
+
+        double* Allocator::allocate(const size_t n) {
+            if (n>(static_cast<size_t>(-1)-huge_page_size)/sizeof(double)) {
+                #pragma omp critical(openmeeg_allocator)
+                ++stats.failures;
+                throw BadAlloc(static_cast<size_t>(-1));
+            }
+
+            const size_t bytes  = n*sizeof(double);
+            const size_t length = bytes+alignment;
+            BlockHeader  header = { 0, length, bytes, ALIGNED_MALLOC };
+            bool         huge   = false;
+            size_t       page   = small_page_size;
+
+            if (hugepages!=NO_HUGE_PAGES && length>=huge_page_size) {
+                header.length = ((length+huge_page_size-1)/huge_page_size)*huge_page_size;
+            #ifdef MAP_HUGETLB
+                if (hugepages==EXPLICIT_HUGE_PAGES) {
+                    void* base = mmap(0,header.length,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,-1,0);
+                    if (base!=MAP_FAILED) {
+                        header.base = base;
+                        header.kind = MAPPED;
+                        huge        = true;
+                    }
+                }
+            #endif
+                if (header.base==0) {
+                    //  Transparent huge pages (also the fallback when the explicit pool is exhausted).
+                    header.base = aligned_malloc(huge_page_size,header.length);
+                #ifdef MADV_HUGEPAGE
+                    huge = header.base!=0 && madvise(header.base,header.length,MADV_HUGEPAGE)==0;
+                #endif
+                }
+                if (huge)
+                    page = huge_page_size;
+            } else {
+                header.base = aligned_malloc(alignment,length);
+            }
+
+            if (header.base==0) {
+                #pragma omp critical(openmeeg_allocator)
+                ++stats.failures;
+                throw BadAlloc(bytes);
+            }
+
+            double* data = reinterpret_cast<double*>(static_cast<char*>(header.base)+alignment);
+            *(reinterpret_cast<BlockHeader*>(data)-1) = header;
+
+            #pragma omp critical(openmeeg_allocator)
+            {
+                ++stats.allocations;
+                if (huge)
+                    ++stats.huge_page_allocations;
+                stats.bytes_in_use += bytes;
+                stats.peak_bytes = std::max(stats.peak_bytes,stats.bytes_in_use);
+            }
+
+            if (firsttouch!=NO_FIRST_TOUCH && bytes>=first_touch_minimum)
+                touch_pages(data,n,page,firsttouch);
+
+            return data;
+        }
+
+        void Allocator::deallocate(double* data) {
+            if (data==0)
+                return;
+
+            const BlockHeader header = *(reinterpret_cast<BlockHeader*>(data)-1);
+
+            #pragma omp critical(openmeeg_allocator)
+            {
+                ++stats.deallocations;
+                stats.bytes_in_use -= header.bytes;
+            }
+
+        #ifndef WIN32
+            if (header.kind==MAPPED) {
+                munmap(header.base,header.length);
+                return;
+            }
+        #endif
+            aligned_free(header.base);
+        }
+
+        Allocator& Allocator::get() { return (current) ? *current : default_allocator(); }
+        void Allocator::set(Allocator* a) { current = a; }
+
+        Allocator::Statistics Allocator::statistics() {
+            Statistics s;
+            #pragma omp critical(openmeeg_allocator)
+            s = stats;
+            return s;
+        }
+
+        void Allocator::report(std::ostream& os) {
+            const Statistics s = statistics();
+            os << "Allocations: " << s.allocations << " (" << s.huge_page_allocations << " on huge pages, "
+               << s.failures << " failed), deallocations: " << s.deallocations << std::endl
+               << "Memory in use: " << s.bytes_in_use/1048576.0 << " MB, peak: " << s.peak_bytes/1048576.0 << " MB" << std::endl;
+        }
+    }
+}
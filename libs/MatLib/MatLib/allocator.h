@@ -0,0 +1,133 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_ALLOCATOR_H
+#define OPENMEEG_ALLOCATOR_H
+
+#include <new>
+#include <string>
+#include <iostream>
+
+#include <DLLDefinesOpenMEEGMaths.h>
+
+namespace OpenMEEG {
+
+    namespace maths {
+
+        /// Thrown (instead of exiting) when the storage of a matrix or vector cannot be allocated.
+        /// Being a std::bad_alloc, it is recoverable: the caller may free memory or use a smaller problem.
+
+        class OPENMEEGMATHS_EXPORT BadAlloc: public std::bad_alloc {
+        public:
+
+            BadAlloc(const size_t n);
+            ~BadAlloc() throw() { }
+
+            size_t      bytes() const { return nbytes; }
+            const char* what() const throw() { return msg.c_str(); }
+
+        private:
+
+            size_t      nbytes;
+            std::string msg;
+        };
+
+        /** \brief Storage allocator of LinOpValue (matrices and vectors).
+
+            Blocks are aligned on 64 bytes (a cache line, enough for any SIMD width). Large blocks can
+            be backed by huge pages (transparent ones through madvise, or explicit ones from the
+            hugetlbfs pool with a fallback to normal pages) and can be zeroed in parallel at
+            allocation, so that the pages are first touched by the threads that later use them:
+            OWNER_COMPUTES matches the static OpenMP loops over the storage (Matrix::set, the
+            assembly), INTERLEAVED spreads the pages round robin over the threads (and thus over
+            the NUMA nodes).
+
+            The default allocator is configured from the environment variables OPENMEEG_HUGE_PAGES
+            (none, transparent, explicit) and OPENMEEG_FIRST_TOUCH (none, owner, interleaved).
+            Another allocator can be installed with Allocator::set: it must outlive all the blocks
+            it allocates (each block remembers its allocator). */
+
+        class OPENMEEGMATHS_EXPORT Allocator {
+        public:
+
+            typedef enum { NO_HUGE_PAGES, TRANSPARENT_HUGE_PAGES, EXPLICIT_HUGE_PAGES } HugePages;
+            typedef enum { NO_FIRST_TOUCH, OWNER_COMPUTES, INTERLEAVED } FirstTouch;
+
+            struct Statistics {
+                Statistics(): allocations(0),deallocations(0),failures(0),huge_page_allocations(0),bytes_in_use(0),peak_bytes(0) { }
+                unsigned long allocations;
+                unsigned long deallocations;
+                unsigned long failures;
+                unsigned long huge_page_allocations;
+                size_t        bytes_in_use;
+                size_t        peak_bytes;
+            };
+
+            static const size_t alignment = 64;
+
+            Allocator(const HugePages hp=NO_HUGE_PAGES,const FirstTouch ft=NO_FIRST_TOUCH): hugepages(hp),firsttouch(ft) { }
+            virtual ~Allocator() { }
+
+            /// Storage for n doubles, aligned on Allocator::alignment. Throws BadAlloc on failure.
+            virtual double* allocate(const size_t n);
+            virtual void    deallocate(double* p);
+
+            HugePages  huge_pages()  const { return hugepages;  }
+            FirstTouch first_touch() const { return firsttouch; }
+
+            void set_huge_pages(const HugePages hp)   { hugepages  = hp; }
+            void set_first_touch(const FirstTouch ft) { firsttouch = ft; }
+
+            /// The allocator used for new matrices. set(0) restores the default one.
+            static Allocator& get();
+            static void       set(Allocator* a);
+
+            /// Counters of all the allocators.
+            static Statistics statistics();
+            static void       report(std::ostream& os);
+
+        protected:
+
+            HugePages  hugepages;
+            FirstTouch firsttouch;
+        };
+    }
+}
+
+#endif  //! OPENMEEG_ALLOCATOR_H
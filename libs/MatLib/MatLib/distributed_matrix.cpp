@@ -0,0 +1,594 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <cmath>
+#include <iostream>
+#include <streambuf>
+
+#include <MatLibConfig.h>
+#include <MathsIO.H>
+#include <distributed_matrix.h>
+
+namespace OpenMEEG {
+
+    namespace {
+
+        void fail(const std::string& message,MPI_Comm comm) {
+            std::cerr << "Error: " << message << std::endl;
+            MPI_Abort(comm,1);
+        }
+
+        int rank_of(MPI_Comm comm) { int rank; MPI_Comm_rank(comm,&rank); return rank; }
+        int size_of(MPI_Comm comm) { int size; MPI_Comm_size(comm,&size); return size; }
+
+        // Displacements of the counts (in MPI_Alltoallv or MPI_Allgatherv).
+
+        std::vector<int> displacements(const std::vector<int>& counts) {
+            std::vector<int> displs(counts.size(),0);
+            for (unsigned i=1;i<counts.size();++i)
+                displs[i] = displs[i-1]+counts[i-1];
+            return displs;
+        }
+
+        class NullBuffer: public std::streambuf {
+        protected:
+            int overflow(int c) { return c; }
+        };
+
+        NullBuffer null_buffer;
+
+        // Subtract the sum over all the processes of the contributions to the rows first..first+size-1 from B.
+
+        void subtract_contributions(const size_t first,const size_t size,const Matrix& delta,Matrix& B,
+                                    std::vector<double>& local,std::vector<double>& sum,MPI_Comm comm)
+        {
+            for (size_t j=0;j<B.ncol();++j)
+                for (size_t i=0;i<size;++i)
+                    local[j*size+i] = delta(first+i,j);
+            MPI_Allreduce(&local[0],&sum[0],size*B.ncol(),MPI_DOUBLE,MPI_SUM,comm);
+            for (size_t j=0;j<B.ncol();++j)
+                for (size_t i=0;i<size;++i)
+                    B(first+i,j) -= sum[j*size+i];
+        }
+
+        // Copy the rows first..first+size-1 of B of the process root to all the others.
+
+        void broadcast_rows(const size_t first,const size_t size,Matrix& B,std::vector<double>& buffer,const int root,MPI_Comm comm) {
+            for (size_t j=0;j<B.ncol();++j)
+                for (size_t i=0;i<size;++i)
+                    buffer[j*size+i] = B(first+i,j);
+            MPI_Bcast(&buffer[0],size*B.ncol(),MPI_DOUBLE,root,comm);
+            for (size_t j=0;j<B.ncol();++j)
+                for (size_t i=0;i<size;++i)
+                    B(first+i,j) = buffer[j*size+i];
+        }
+    }
+
+    BlockCyclicLayout::BlockCyclicLayout(const size_t N,const size_t NB,MPI_Comm c): n(N),nb(NB),comm(c) {
+        const int nprocs = size_of(comm);
+        nprow = 1;
+        for (int p=1;p*p<=nprocs;++p)
+            if (nprocs%p==0)
+                nprow = p;
+        npcol = nprocs/nprow;
+        const int rank = rank_of(comm);
+        myrow = rank/npcol;
+        mycol = rank%npcol;
+    }
+
+    size_t BlockCyclicLayout::numroc(const size_t n,const size_t nb,const int iproc,const int nprocs) {
+        const size_t nblocks = n/nb;
+        const size_t extra   = nblocks%nprocs;
+        size_t num = (nblocks/nprocs)*nb;
+        if (static_cast<size_t>(iproc)<extra)
+            num += nb;
+        else if (static_cast<size_t>(iproc)==extra)
+            num += n%nb;
+        return num;
+    }
+
+    void BlockCyclicLayout::descriptor(int desc[9],const int ctxt) const {
+        desc[0] = 1; // dense matrix
+        desc[1] = ctxt;
+        desc[2] = desc[3] = n;
+        desc[4] = desc[5] = nb;
+        desc[6] = desc[7] = 0;
+        desc[8] = std::max(local_rows(),static_cast<size_t>(1));
+    }
+
+    DistributedSymMatrix::DistributedSymMatrix(const size_t n,MPI_Comm comm,const size_t nb):
+        layout_(n,nb,comm),values(lld()*layout_.local_cols()),factorized(false)
+    { }
+
+    void DistributedSymMatrix::set(const double d) {
+        values.assign(lld()*layout_.local_cols(),d);
+        factors    = Matrix();
+        factorized = false;
+    }
+
+    double DistributedSymMatrix::entry(const size_t i,const size_t j) const {
+        const size_t r = std::min(i,j);
+        const size_t c = std::max(i,j);
+        const int owner = layout_.rank(layout_.row_owner(r),layout_.col_owner(c));
+        double value = owns(r,c) ? (*this)(r,c) : 0.0;
+        MPI_Bcast(&value,1,MPI_DOUBLE,owner,communicator());
+        return value;
+    }
+
+    Matrix DistributedSymMatrix::fetch(const std::vector<size_t>& rows,const std::vector<size_t>& cols) const {
+
+        // The entry (r,c) is asked to the owner of (min(r,c),max(r,c)): as (r,c) to the process of the
+        // row owner of r and the column owner of c if r<=c, and as (c,r) to the process of the row owner
+        // of c and the column owner of r otherwise. For each process p, the request holds the rows and
+        // columns it may own (by position in rows and cols) and only the entries that p actually stores
+        // are sent back, in the order of the loops below.
+
+        MPI_Comm comm = communicator();
+        const int nprocs = size_of(comm);
+        std::vector<std::vector<size_t> > upper_rows(nprocs),upper_cols(nprocs),lower_rows(nprocs),lower_cols(nprocs);
+        for (int prow=0;prow<layout_.grid_rows();++prow)
+            for (int pcol=0;pcol<layout_.grid_cols();++pcol) {
+                const int p = layout_.rank(prow,pcol);
+                for (size_t i=0;i<rows.size();++i) {
+                    if (layout_.row_owner(rows[i])==prow)
+                        upper_rows[p].push_back(i);
+                    if (layout_.col_owner(rows[i])==pcol)
+                        lower_rows[p].push_back(i);
+                }
+                for (size_t j=0;j<cols.size();++j) {
+                    if (layout_.col_owner(cols[j])==pcol)
+                        upper_cols[p].push_back(j);
+                    if (layout_.row_owner(cols[j])==prow)
+                        lower_cols[p].push_back(j);
+                }
+            }
+
+        std::vector<unsigned long> requests;
+        std::vector<int> request_counts(nprocs);
+        std::vector<int> reply_counts(nprocs,0);
+        for (int p=0;p<nprocs;++p) {
+            const size_t start = requests.size();
+            requests.push_back(upper_rows[p].size());
+            requests.push_back(upper_cols[p].size());
+            requests.push_back(lower_rows[p].size());
+            requests.push_back(lower_cols[p].size());
+            for (size_t k=0;k<upper_rows[p].size();++k) requests.push_back(rows[upper_rows[p][k]]);
+            for (size_t k=0;k<upper_cols[p].size();++k) requests.push_back(cols[upper_cols[p][k]]);
+            for (size_t k=0;k<lower_rows[p].size();++k) requests.push_back(rows[lower_rows[p][k]]);
+            for (size_t k=0;k<lower_cols[p].size();++k) requests.push_back(cols[lower_cols[p][k]]);
+            request_counts[p] = requests.size()-start;
+            for (size_t l=0;l<upper_cols[p].size();++l)
+                for (size_t k=0;k<upper_rows[p].size();++k)
+                    if (rows[upper_rows[p][k]]<=cols[upper_cols[p][l]])
+                        ++reply_counts[p];
+            for (size_t k=0;k<lower_rows[p].size();++k)
+                for (size_t l=0;l<lower_cols[p].size();++l)
+                    if (cols[lower_cols[p][l]]<rows[lower_rows[p][k]])
+                        ++reply_counts[p];
+        }
+
+        std::vector<int> received_counts(nprocs);
+        MPI_Alltoall(&request_counts[0],1,MPI_INT,&received_counts[0],1,MPI_INT,comm);
+        const std::vector<int> request_displs  = displacements(request_counts);
+        const std::vector<int> received_displs = displacements(received_counts);
+        std::vector<unsigned long> received(received_displs.back()+received_counts.back()+1);
+        MPI_Alltoallv(&requests[0],&request_counts[0],&request_displs[0],MPI_UNSIGNED_LONG,
+                      &received[0],&received_counts[0],&received_displs[0],MPI_UNSIGNED_LONG,comm);
+
+        // Answer the requests of all the processes.
+
+        std::vector<double> answers;
+        std::vector<int> answer_counts(nprocs);
+        for (int q=0;q<nprocs;++q) {
+            const size_t start = answers.size();
+            const unsigned long* request = &received[received_displs[q]];
+            const size_t nur = request[0];
+            const size_t nuc = request[1];
+            const size_t nlr = request[2];
+            const size_t nlc = request[3];
+            const unsigned long* ur = request+4;
+            const unsigned long* uc = ur+nur;
+            const unsigned long* lr = uc+nuc;
+            const unsigned long* lc = lr+nlr;
+            for (size_t l=0;l<nuc;++l)
+                for (size_t k=0;k<nur;++k)
+                    if (ur[k]<=uc[l])
+                        answers.push_back((*this)(ur[k],uc[l]));
+            for (size_t k=0;k<nlr;++k)
+                for (size_t l=0;l<nlc;++l)
+                    if (lc[l]<lr[k])
+                        answers.push_back((*this)(lc[l],lr[k]));
+            answer_counts[q] = answers.size()-start;
+        }
+        answers.push_back(0.0);
+
+        const std::vector<int> answer_displs = displacements(answer_counts);
+        const std::vector<int> reply_displs  = displacements(reply_counts);
+        std::vector<double> replies(reply_displs.back()+reply_counts.back()+1);
+        MPI_Alltoallv(&answers[0],&answer_counts[0],&answer_displs[0],MPI_DOUBLE,
+                      &replies[0],&reply_counts[0],&reply_displs[0],MPI_DOUBLE,comm);
+
+        Matrix B(rows.size(),cols.size());
+        for (int p=0;p<nprocs;++p) {
+            const double* reply = &replies[reply_displs[p]];
+            for (size_t l=0;l<upper_cols[p].size();++l)
+                for (size_t k=0;k<upper_rows[p].size();++k)
+                    if (rows[upper_rows[p][k]]<=cols[upper_cols[p][l]])
+                        B(upper_rows[p][k],upper_cols[p][l]) = *reply++;
+            for (size_t k=0;k<lower_rows[p].size();++k)
+                for (size_t l=0;l<lower_cols[p].size();++l)
+                    if (cols[lower_cols[p][l]]<rows[lower_rows[p][k]])
+                        B(lower_rows[p][k],lower_cols[p][l]) = *reply++;
+        }
+        return B;
+    }
+
+    DistributedSymMatrix::Segments DistributedSymMatrix::upper_segments(const int prow,const int pcol,const size_t J) const {
+        const size_t nb  = layout_.block_size();
+        const size_t ld  = std::max(layout_.local_rows(prow),static_cast<size_t>(1));
+        Segments segments;
+        for (size_t j=J*nb;j<J*nb+layout_.block_size(J);++j) {
+            const size_t lj = layout_.local_col(j);
+            for (size_t I=prow;I*nb<=j;I+=layout_.grid_rows()) {
+                const size_t i0 = I*nb;
+                segments.push_back(Segment(i0+j*(j+1)/2,lj*ld+layout_.local_row(i0),std::min(layout_.block_size(I),j-i0+1)));
+            }
+        }
+        return segments;
+    }
+
+    SymMatrix DistributedSymMatrix::gather(const int root) const {
+        MPI_Comm comm = communicator();
+        const int nprocs = size_of(comm);
+        std::vector<int> counts(nprocs);
+        for (int prow=0;prow<layout_.grid_rows();++prow)
+            for (int pcol=0;pcol<layout_.grid_cols();++pcol)
+                counts[layout_.rank(prow,pcol)] = std::max(layout_.local_rows(prow),static_cast<size_t>(1))*layout_.local_cols(pcol);
+        const std::vector<int> displs = displacements(counts);
+        const bool is_root = rank_of(comm)==root;
+        std::vector<double> all(is_root ? displs.back()+counts.back()+1 : 1);
+        MPI_Gatherv(const_cast<double*>(data()),values.size(),MPI_DOUBLE,&all[0],&counts[0],&displs[0],MPI_DOUBLE,root,comm);
+
+        SymMatrix S;
+        if (is_root) {
+            S = SymMatrix(nlin());
+            for (int prow=0;prow<layout_.grid_rows();++prow)
+                for (int pcol=0;pcol<layout_.grid_cols();++pcol) {
+                    const double* local = &all[displs[layout_.rank(prow,pcol)]];
+                    for (size_t J=pcol;J<layout_.nb_blocks();J+=layout_.grid_cols()) {
+                        const Segments& segments = upper_segments(prow,pcol,J);
+                        for (Segments::const_iterator s=segments.begin();s!=segments.end();++s)
+                            std::copy(local+s->local,local+s->local+s->length,S.data()+s->offset);
+                    }
+                }
+        }
+        return S;
+    }
+
+    bool DistributedSymMatrix::binary_format(const std::string& filename) const {
+        try {
+            return maths::MathsIO::format_from_suffix(filename)->identity()=="binary";
+        } catch (...) {
+            return false;
+        }
+    }
+
+    // The binary format is the size n (as an unsigned) followed by the packed upper triangle. Each block
+    // column of the local array is read or written by a collective MPI-IO call, with a file view made
+    // of the segments of the packed storage that the process owns.
+
+    void DistributedSymMatrix::save(const std::string& filename) const {
+        MPI_Comm comm = communicator();
+        if (!binary_format(filename)) {
+            const SymMatrix& S = gather();
+            if (rank_of(comm)==0)
+                S.save(filename);
+            return;
+        }
+
+        MPI_File file;
+        if (MPI_File_open(comm,const_cast<char*>(filename.c_str()),MPI_MODE_CREATE|MPI_MODE_WRONLY,MPI_INFO_NULL,&file)!=MPI_SUCCESS)
+            fail("cannot open file "+filename+" for writing.",comm);
+        MPI_File_set_size(file,0);
+        if (rank_of(comm)==0) {
+            unsigned n = nlin();
+            MPI_File_write_at(file,0,&n,sizeof(unsigned),MPI_BYTE,MPI_STATUS_IGNORE);
+        }
+
+        const size_t ncols = layout_.grid_cols();
+        const size_t rounds = (layout_.nb_blocks()+ncols-1)/ncols;
+        for (size_t round=0;round<rounds;++round) {
+            const size_t J = layout_.my_col()+round*ncols;
+            std::vector<double> buffer(1);
+            std::vector<int> lengths;
+            std::vector<MPI_Aint> offsets;
+            if (J<layout_.nb_blocks()) {
+                const Segments& segments = upper_segments(layout_.my_row(),layout_.my_col(),J);
+                buffer.clear();
+                for (Segments::const_iterator s=segments.begin();s!=segments.end();++s) {
+                    buffer.insert(buffer.end(),&values[s->local],&values[s->local]+s->length);
+                    lengths.push_back(s->length);
+                    offsets.push_back(s->offset*sizeof(double));
+                }
+            }
+            MPI_Datatype view;
+            if (lengths.size()!=0) {
+                MPI_Type_create_hindexed(lengths.size(),&lengths[0],&offsets[0],MPI_DOUBLE,&view);
+                MPI_Type_commit(&view);
+            } else {
+                view = MPI_DOUBLE;
+            }
+            MPI_File_set_view(file,sizeof(unsigned),MPI_DOUBLE,view,const_cast<char*>("native"),MPI_INFO_NULL);
+            MPI_File_write_all(file,&buffer[0],(lengths.size()!=0) ? buffer.size() : 0,MPI_DOUBLE,MPI_STATUS_IGNORE);
+            if (lengths.size()!=0)
+                MPI_Type_free(&view);
+        }
+        MPI_File_close(&file);
+    }
+
+    void DistributedSymMatrix::load(const std::string& filename) {
+        MPI_Comm comm = (layout_.communicator()==MPI_COMM_NULL) ? MPI_COMM_WORLD : communicator();
+        const size_t nb = (layout_.size()==0) ? static_cast<size_t>(default_block_size) : layout_.block_size();
+        if (!binary_format(filename)) {
+            SymMatrix S;
+            unsigned long n = 0;
+            if (rank_of(comm)==0) {
+                S.load(filename);
+                n = S.nlin();
+            }
+            MPI_Bcast(&n,1,MPI_UNSIGNED_LONG,0,comm);
+            *this = DistributedSymMatrix(n,comm,nb);
+            std::vector<double> all(1);
+            std::vector<int> counts(size_of(comm)),displs;
+            for (int prow=0;prow<layout_.grid_rows();++prow)
+                for (int pcol=0;pcol<layout_.grid_cols();++pcol)
+                    counts[layout_.rank(prow,pcol)] = std::max(layout_.local_rows(prow),static_cast<size_t>(1))*layout_.local_cols(pcol);
+            displs = displacements(counts);
+            if (rank_of(comm)==0) {
+                all.resize(displs.back()+counts.back()+1);
+                for (int prow=0;prow<layout_.grid_rows();++prow)
+                    for (int pcol=0;pcol<layout_.grid_cols();++pcol) {
+                        double* local = &all[displs[layout_.rank(prow,pcol)]];
+                        for (size_t J=pcol;J<layout_.nb_blocks();J+=layout_.grid_cols()) {
+                            const Segments& segments = upper_segments(prow,pcol,J);
+                            for (Segments::const_iterator s=segments.begin();s!=segments.end();++s)
+                                std::copy(S.data()+s->offset,S.data()+s->offset+s->length,local+s->local);
+                        }
+                    }
+            }
+            MPI_Scatterv(&all[0],&counts[0],&displs[0],MPI_DOUBLE,data(),counts[rank_of(comm)],MPI_DOUBLE,0,comm);
+            return;
+        }
+
+        MPI_File file;
+        if (MPI_File_open(comm,const_cast<char*>(filename.c_str()),MPI_MODE_RDONLY,MPI_INFO_NULL,&file)!=MPI_SUCCESS)
+            fail("cannot open file "+filename+" for reading.",comm);
+        unsigned n;
+        MPI_Offset size;
+        MPI_File_read_at_all(file,0,&n,sizeof(unsigned),MPI_BYTE,MPI_STATUS_IGNORE);
+        MPI_File_get_size(file,&size);
+        if (static_cast<size_t>(size)!=sizeof(unsigned)+sizeof(double)*(static_cast<size_t>(n)*(n+1)/2))
+            fail(filename+" is not a symmetric matrix in binary format.",comm);
+        *this = DistributedSymMatrix(n,comm,nb);
+
+        const size_t ncols = layout_.grid_cols();
+        const size_t rounds = (layout_.nb_blocks()+ncols-1)/ncols;
+        for (size_t round=0;round<rounds;++round) {
+            const size_t J = layout_.my_col()+round*ncols;
+            Segments segments;
+            std::vector<int> lengths;
+            std::vector<MPI_Aint> offsets;
+            size_t count = 0;
+            if (J<layout_.nb_blocks()) {
+                segments = upper_segments(layout_.my_row(),layout_.my_col(),J);
+                for (Segments::const_iterator s=segments.begin();s!=segments.end();++s) {
+                    lengths.push_back(s->length);
+                    offsets.push_back(s->offset*sizeof(double));
+                    count += s->length;
+                }
+            }
+            std::vector<double> buffer(count+1);
+            MPI_Datatype view;
+            if (lengths.size()!=0) {
+                MPI_Type_create_hindexed(lengths.size(),&lengths[0],&offsets[0],MPI_DOUBLE,&view);
+                MPI_Type_commit(&view);
+            } else {
+                view = MPI_DOUBLE;
+            }
+            MPI_File_set_view(file,sizeof(unsigned),MPI_DOUBLE,view,const_cast<char*>("native"),MPI_INFO_NULL);
+            MPI_File_read_all(file,&buffer[0],count,MPI_DOUBLE,MPI_STATUS_IGNORE);
+            if (lengths.size()!=0)
+                MPI_Type_free(&view);
+            const double* b = &buffer[0];
+            for (Segments::const_iterator s=segments.begin();s!=segments.end();b+=s->length,++s)
+                std::copy(b,b+s->length,&values[s->local]);
+        }
+        MPI_File_close(&file);
+    }
+
+    // Right looking block LU factorization with partial pivoting (the scheme of ScaLAPACK pdgetrf) of the whole
+    // matrix, redistributed by block columns: the block column J goes to the process J mod nprocs. At step k,
+    // the owner of the block column k factorizes the panel A(k*nb:n,k), so that the pivots are searched in the
+    // whole column, and broadcasts it with its pivots. Each process then swaps the rows of its block columns,
+    // computes its blocks of the row k of U and updates its trailing blocks.
+    // Pivoting between blocks is needed for the head matrices, whose leading blocks are often singular.
+
+    void DistributedSymMatrix::factorize() {
+    #ifdef HAVE_LAPACK
+        MPI_Comm comm = communicator();
+        const int    nprocs = size_of(comm);
+        const int    rank   = rank_of(comm);
+        const size_t n      = nlin();
+        const size_t nb     = layout_.block_size();
+        const size_t K      = layout_.nb_blocks();
+
+        std::vector<size_t> rows(n),cols;
+        for (size_t i=0;i<n;++i)
+            rows[i] = i;
+        for (size_t J=rank;J<K;J+=nprocs)
+            for (size_t j=0;j<layout_.block_size(J);++j)
+                cols.push_back(J*nb+j);
+        factors = fetch(rows,cols);
+        std::vector<double>().swap(values);
+        pivots.assign(n,0);
+
+        std::vector<double> panel;
+        for (size_t k=0;k<K;++k) {
+            const size_t bk    = layout_.block_size(k);
+            const size_t first = k*nb;
+            const size_t m     = n-first;
+            const int    owner = k%nprocs;
+            int*         ipiv  = &pivots[first];
+
+            panel.resize(m*bk);
+            if (rank==owner) {
+                double* A = factor_column(k)+first;
+                int info;
+                FC_GLOBAL(dgetrf,DGETRF)(m,bk,A,n,ipiv,info);
+                if (info>0)
+                    fail("the distributed matrix is singular.",comm);
+                for (size_t j=0;j<bk;++j)
+                    std::copy(A+j*n,A+j*n+m,&panel[j*m]);
+            }
+            MPI_Bcast(&panel[0],m*bk,MPI_DOUBLE,owner,comm);
+            MPI_Bcast(ipiv,bk,MPI_INT,owner,comm);
+            for (size_t i=0;i<bk;++i)
+                ipiv[i] += first-1; // global and 0-based.
+
+            for (size_t J=rank;J<K;J+=nprocs) {
+                if (J==k)
+                    continue;
+                const size_t bj = layout_.block_size(J);
+                double* A = factor_column(J);
+                for (size_t i=first;i<first+bk;++i)
+                    if (pivots[i]!=static_cast<int>(i))
+                        for (size_t j=0;j<bj;++j)
+                            std::swap(A[j*n+i],A[j*n+pivots[i]]);
+                if (J<k)
+                    continue;
+                int info;
+                DTRTRS('L','N','U',bk,bj,&panel[0],m,A+first,n,info);
+                if (m>bk)
+                    DGEMM(CblasNoTrans,CblasNoTrans,m-bk,bj,bk,-1.0,&panel[bk],m,A+first,n,1.0,A+first+bk,n);
+            }
+        }
+        factorized = true;
+    #else
+        fail("the distributed factorization needs LAPACK.",communicator());
+    #endif
+    }
+
+    // Solution of PLUX=B: row interchanges, forward substitution with L and backward substitution with U.
+    // Each process accumulates the contributions of its block columns, which are summed when a block of
+    // X is reached. The owner of this block then solves its diagonal block and broadcasts the result.
+
+    void DistributedSymMatrix::solveLin(Matrix& B) const {
+    #ifdef HAVE_LAPACK
+        MPI_Comm comm = communicator();
+        if (!factorized)
+            fail("the distributed matrix must be factorized before solving.",comm);
+
+        const int    nprocs = size_of(comm);
+        const int    rank   = rank_of(comm);
+        const size_t n      = nlin();
+        const size_t nb     = layout_.block_size();
+        const size_t K      = layout_.nb_blocks();
+        const size_t nrhs   = B.ncol();
+
+        for (size_t i=0;i<n;++i)
+            if (pivots[i]!=static_cast<int>(i))
+                for (size_t j=0;j<nrhs;++j)
+                    std::swap(B(i,j),B(pivots[i],j));
+
+        Matrix delta(n,nrhs);
+        std::vector<double> local(nb*nrhs),sum(nb*nrhs);
+
+        delta.set(0.0);
+        for (size_t k=0;k<K;++k) {
+            const size_t bk    = layout_.block_size(k);
+            const size_t first = k*nb;
+            const int    owner = k%nprocs;
+            subtract_contributions(first,bk,delta,B,local,sum,comm);
+            if (rank==owner) {
+                const double* L = factor_column(k);
+                int info;
+                DTRTRS('L','N','U',bk,nrhs,L+first,n,B.data()+first,n,info);
+                if (first+bk<n)
+                    DGEMM(CblasNoTrans,CblasNoTrans,n-first-bk,nrhs,bk,1.0,L+first+bk,n,B.data()+first,n,1.0,delta.data()+first+bk,n);
+            }
+            broadcast_rows(first,bk,B,local,owner,comm);
+        }
+
+        delta.set(0.0);
+        for (size_t k=K;k-->0;) {
+            const size_t bk    = layout_.block_size(k);
+            const size_t first = k*nb;
+            const int    owner = k%nprocs;
+            subtract_contributions(first,bk,delta,B,local,sum,comm);
+            if (rank==owner) {
+                const double* U = factor_column(k);
+                int info;
+                DTRTRS('U','N','N',bk,nrhs,U+first,n,B.data()+first,n,info);
+                if (first>0)
+                    DGEMM(CblasNoTrans,CblasNoTrans,first,nrhs,bk,1.0,U,n,B.data()+first,n,1.0,delta.data(),n);
+            }
+            broadcast_rows(first,bk,B,local,owner,comm);
+        }
+    #else
+        fail("the distributed factorization needs LAPACK.",communicator());
+    #endif
+    }
+
+    MPIEnvironment::MPIEnvironment(int& argc,char**& argv): cout_buffer(0) {
+        int initialized;
+        MPI_Initialized(&initialized);
+        if (!initialized)
+            MPI_Init(&argc,&argv);
+        MPI_Comm_rank(MPI_COMM_WORLD,&rank_);
+        MPI_Comm_size(MPI_COMM_WORLD,&size_);
+        if (rank_!=0)
+            cout_buffer = std::cout.rdbuf(&null_buffer);
+    }
+
+    MPIEnvironment::~MPIEnvironment() {
+        if (cout_buffer!=0)
+            std::cout.rdbuf(cout_buffer);
+        MPI_Finalize();
+    }
+}
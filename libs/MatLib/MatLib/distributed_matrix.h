@@ -0,0 +1,257 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_DISTRIBUTED_MATRIX_H
+#define OPENMEEG_DISTRIBUTED_MATRIX_H
+
+#include <vector>
+#include <string>
+#include <cassert>
+#include <algorithm>
+
+#include <mpi.h>
+
+#include <DLLDefinesOpenMEEGMaths.h>
+#include <matrix.h>
+#include <symmatrix.h>
+
+namespace OpenMEEG {
+
+    /** \brief 2D block-cyclic distribution of a square matrix over the processes of a communicator.
+
+        This is the ScaLAPACK layout: the matrix is cut into nb x nb blocks and block (I,J) belongs to
+        the process (I mod nprow,J mod npcol) of a nprow x npcol grid, the processes being numbered in
+        row major order on the grid (as by Cblacs_gridinit with the "Row" order). Each process stores
+        its blocks in a column major local array of local_rows() x local_cols() entries, which together
+        with descriptor() can be handed over to the ScaLAPACK routines.
+    **/
+
+    class OPENMEEGMATHS_EXPORT BlockCyclicLayout {
+    public:
+
+        BlockCyclicLayout(): n(0),nb(1),nprow(1),npcol(1),myrow(0),mycol(0),comm(MPI_COMM_NULL) { }
+
+        /// Layout of a n x n matrix on the most square grid made of all the processes of comm.
+
+        BlockCyclicLayout(const size_t n,const size_t nb,MPI_Comm comm);
+
+        size_t   size()       const { return n;              }
+        size_t   block_size() const { return nb;             }
+        size_t   nb_blocks()  const { return (n+nb-1)/nb;    }
+        int      grid_rows()  const { return nprow;          }
+        int      grid_cols()  const { return npcol;          }
+        int      my_row()     const { return myrow;          }
+        int      my_col()     const { return mycol;          }
+        MPI_Comm communicator() const { return comm; }
+
+        /// Size of block I (the last one may be smaller).
+
+        size_t block_size(const size_t I) const { return std::min(nb,n-I*nb); }
+
+        /// Rank of the process at position (prow,pcol) of the grid.
+
+        int rank(const int prow,const int pcol) const { return prow*npcol+pcol; }
+
+        int row_owner(const size_t i) const { return (i/nb)%nprow; }
+        int col_owner(const size_t j) const { return (j/nb)%npcol; }
+
+        bool owns(const size_t i,const size_t j) const { return row_owner(i)==myrow && col_owner(j)==mycol; }
+
+        /// Local sizes and local positions of the global indices (the index must belong to the process).
+
+        size_t local_rows(const int prow) const { return numroc(n,nb,prow,nprow); }
+        size_t local_cols(const int pcol) const { return numroc(n,nb,pcol,npcol); }
+        size_t local_rows()               const { return local_rows(myrow);       }
+        size_t local_cols()               const { return local_cols(mycol);       }
+
+        size_t local_row(const size_t i) const { return ((i/nb)/nprow)*nb+i%nb; }
+        size_t local_col(const size_t j) const { return ((j/nb)/npcol)*nb+j%nb; }
+
+        /// ScaLAPACK array descriptor of the local arrays (for the BLACS context ctxt).
+
+        void descriptor(int desc[9],const int ctxt) const;
+
+        /// Number of rows (or columns) of the n x n matrix owned by the process iproc among nprocs (as ScaLAPACK numroc).
+
+        static size_t numroc(const size_t n,const size_t nb,const int iproc,const int nprocs);
+
+    private:
+
+        size_t   n;
+        size_t   nb;
+        int      nprow;
+        int      npcol;
+        int      myrow;
+        int      mycol;
+        MPI_Comm comm;
+    };
+
+    /** \brief Symmetric matrix distributed over the processes of a communicator with a block-cyclic layout.
+
+        As for SymMatrix, (i,j) and (j,i) denote the same entry, which is stored in the upper triangle
+        (the blocks of the lower triangle are allocated but not referenced). A process may only access
+        the entries it owns(). The methods documented as collective must be called by all the processes
+        of the communicator.
+
+        factorize() computes the LU factorization with partial pivoting of the matrix, with the factors
+        distributed by block columns (cyclically over the processes). The entries of the matrix are then
+        released: solveLin() may be called, but the matrix must be set() or load()ed before being used again.
+    **/
+
+    class OPENMEEGMATHS_EXPORT DistributedSymMatrix {
+    public:
+
+        static const size_t default_block_size = 64;
+
+        DistributedSymMatrix(): factorized(false) { }
+        DistributedSymMatrix(const size_t n,MPI_Comm comm=MPI_COMM_WORLD,const size_t nb=default_block_size);
+
+        size_t nlin() const { return layout_.size(); }
+        size_t ncol() const { return layout_.size(); }
+
+        const BlockCyclicLayout& layout() const { return layout_; }
+        MPI_Comm communicator() const { return layout_.communicator(); }
+
+        /// Local array (column major, with leading dimension lld()).
+
+        double*       data()       { return values.empty() ? 0 : &values[0]; }
+        const double* data() const { return values.empty() ? 0 : &values[0]; }
+        size_t  lld()  const { return std::max(layout_.local_rows(),static_cast<size_t>(1)); }
+
+        bool owns(const size_t i,const size_t j) const { return (i<=j) ? layout_.owns(i,j) : layout_.owns(j,i); }
+
+        inline double  operator()(const size_t i,const size_t j) const;
+        inline double& operator()(const size_t i,const size_t j);
+
+        void set(const double d);
+
+        /// The entry (i,j) on all the processes (collective).
+
+        double entry(const size_t i,const size_t j) const;
+
+        /// The entries (rows[k],cols[l]) on the calling process (collective, rows and cols may differ between processes).
+
+        Matrix fetch(const std::vector<size_t>& rows,const std::vector<size_t>& cols) const;
+
+        /// The whole matrix on the process root (collective).
+
+        SymMatrix gather(const int root=0) const;
+
+        /// Save and load (collective). The binary format is read and written in parallel by MPI-IO,
+        /// the other formats go through the process 0.
+
+        void save(const std::string& filename) const;
+        void load(const std::string& filename);
+
+        /// Factorization, replacing the entries (collective).
+
+        void factorize();
+
+        /// Solution of AX=B, B (replicated on all the processes) is overwritten by X (collective, factorize() first).
+
+        void solveLin(Matrix& B) const;
+
+    private:
+
+        struct Segment {
+            Segment(const size_t o,const size_t l,const size_t len): offset(o),local(l),length(len) { }
+            size_t offset; // position in the packed upper triangular storage.
+            size_t local;  // position in the local array of the process.
+            size_t length;
+        };
+
+        typedef std::vector<Segment> Segments;
+
+        /// Upper triangular entries of the block column J of the process (prow,pcol), as runs contiguous
+        /// in both the packed and the local storages.
+
+        Segments upper_segments(const int prow,const int pcol,const size_t J) const;
+
+        bool binary_format(const std::string& filename) const;
+
+        /// The first column of the block column J in the factors (J must belong to the process).
+
+        double*       factor_column(const size_t J)       { return factors.data()+(J/nb_processes())*layout_.block_size()*nlin(); }
+        const double* factor_column(const size_t J) const { return factors.data()+(J/nb_processes())*layout_.block_size()*nlin(); }
+        size_t        nb_processes() const                { return layout_.grid_rows()*layout_.grid_cols(); }
+
+        BlockCyclicLayout   layout_;
+        std::vector<double> values;
+        bool                factorized;
+        Matrix              factors; // L and U, the block columns of the process (n x local columns).
+        std::vector<int>    pivots;  // global row interchanges (0-based).
+    };
+
+    inline double DistributedSymMatrix::operator()(const size_t i,const size_t j) const {
+        assert(owns(i,j));
+        return (i<=j) ? values[layout_.local_col(j)*lld()+layout_.local_row(i)] : values[layout_.local_col(i)*lld()+layout_.local_row(j)];
+    }
+
+    inline double& DistributedSymMatrix::operator()(const size_t i,const size_t j) {
+        assert(owns(i,j));
+        return (i<=j) ? values[layout_.local_col(j)*lld()+layout_.local_row(i)] : values[layout_.local_col(i)*lld()+layout_.local_row(j)];
+    }
+
+    /// Entries computed by the calling process when assembling a distributed matrix (see the operators).
+
+    inline bool owns(const DistributedSymMatrix& M,const unsigned i,const unsigned j) { return M.owns(i,j); }
+
+    /** \brief MPI initialization for the lifetime of a program.
+
+        The standard output of all the processes but the first one is discarded.
+    **/
+
+    class OPENMEEGMATHS_EXPORT MPIEnvironment {
+    public:
+
+        MPIEnvironment(int& argc,char**& argv);
+        ~MPIEnvironment();
+
+        int rank() const { return rank_; }
+        int size() const { return size_; }
+
+    private:
+
+        int rank_;
+        int size_;
+        std::streambuf* cout_buffer;
+    };
+}
+
+#endif  //! OPENMEEG_DISTRIBUTED_MATRIX_H
@@ -40,8 +40,13 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #ifndef OPENMEEG_FAST_SPARSE_MATRIX_H
 #define OPENMEEG_FAST_SPARSE_MATRIX_H
 
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
 #include "MatLibConfig.h"
 #include "vector.h"
+#include "matrix.h"
 #include "sparse_matrix.h"
 
 namespace OpenMEEG {
@@ -50,6 +55,16 @@ namespace OpenMEEG {
     {
     public:
 
+        /// Entry (i,j,value) used to assemble a matrix: entries of the same position are summed.
+
+        struct Triplet {
+            Triplet(const size_t l,const size_t c,const double v): i(l),j(c),value(v) { }
+            size_t i,j;
+            double value;
+        };
+
+        typedef std::vector<Triplet> Triplets;
+
         inline friend std::ostream& operator<<(std::ostream& f,const FastSparseMatrix &M);
 
     protected:
@@ -68,6 +83,7 @@ namespace OpenMEEG {
         inline FastSparseMatrix(size_t n,size_t p, size_t sp);
         inline FastSparseMatrix( const SparseMatrix &M);
         inline FastSparseMatrix( const FastSparseMatrix &M);
+        inline FastSparseMatrix(size_t n,size_t p,const Triplets& triplets);
         inline ~FastSparseMatrix() {destroy();}
         inline size_t nlin() const ;
         inline size_t ncol() const ;
@@ -77,8 +93,19 @@ namespace OpenMEEG {
         inline double operator()(size_t i,size_t j) const;
         inline double& operator()(size_t i,size_t j);
         inline Vector operator * (const Vector &v) const;
+        inline Matrix operator * (const Matrix &M) const;
         inline void operator =( const FastSparseMatrix &M);
 
+        size_t nnz() const { return rowindex[m_nlin]; }
+        double frobenius_norm() const;
+
+        /// The entries of line i are [row_begin(i),row_end(i)), in increasing column order.
+
+        size_t row_begin(size_t i) const { return rowindex[i];   }
+        size_t row_end(size_t i)   const { return rowindex[i+1]; }
+        size_t column(size_t k)    const { return js[k];         }
+        double value(size_t k)     const { return tank[k];       }
+
         inline double& operator[](size_t i) {return tank[i];};
 
         inline void info() const;
@@ -162,6 +189,62 @@ namespace OpenMEEG {
 
     }
 
+    //  The triplets are bucketed by line, then each line is sorted and its duplicates summed in parallel.
+    //  Duplicates are summed in increasing order of their values, so that the result does not depend
+    //  on the order of the triplets (e.g. on the number of threads that produced them).
+
+    namespace details {
+        struct ColumnValueOrder {
+            bool operator()(const std::pair<size_t,double>& a,const std::pair<size_t,double>& b) const {
+                return (a.first<b.first) || (a.first==b.first && a.second<b.second);
+            }
+        };
+    }
+
+    inline FastSparseMatrix::FastSparseMatrix(size_t n,size_t p,const Triplets& triplets)
+    {
+        std::vector<size_t> starts(n+1,0);
+        for (Triplets::const_iterator it=triplets.begin();it!=triplets.end();++it) {
+            assert(it->i<n && it->j<p);
+            ++starts[it->i+1];
+        }
+        for (size_t i=0;i<n;++i)
+            starts[i+1] += starts[i];
+
+        std::vector<std::pair<size_t,double> > entries(triplets.size());
+        std::vector<size_t> next(starts.begin(),starts.end()-1);
+        for (Triplets::const_iterator it=triplets.begin();it!=triplets.end();++it)
+            entries[next[it->i]++] = std::make_pair(it->j,it->value);
+
+        std::vector<size_t> counts(n);
+        #pragma omp parallel for schedule(dynamic,256) if(triplets.size()>parallel_set_minimum)
+        for (int i=0;i<static_cast<int>(n);++i) {
+            const std::vector<std::pair<size_t,double> >::iterator first = entries.begin()+starts[i];
+            const std::vector<std::pair<size_t,double> >::iterator last  = entries.begin()+starts[i+1];
+            std::sort(first,last,details::ColumnValueOrder());
+            std::vector<std::pair<size_t,double> >::iterator out = first;
+            for (std::vector<std::pair<size_t,double> >::iterator it=first;it!=last;++it)
+                if (it!=first && it->first==(out-1)->first)
+                    (out-1)->second += it->second;
+                else
+                    *out++ = *it;
+            counts[i] = out-first;
+        }
+
+        size_t nz = 0;
+        for (size_t i=0;i<n;++i)
+            nz += counts[i];
+        alloc(n,p,nz);
+        rowindex[0] = 0;
+        for (size_t i=0;i<n;++i) {
+            rowindex[i+1] = rowindex[i]+counts[i];
+            for (size_t k=0;k<counts[i];++k) {
+                js[rowindex[i]+k]   = entries[starts[i]+k].first;
+                tank[rowindex[i]+k] = entries[starts[i]+k].second;
+            }
+        }
+    }
+
     inline void FastSparseMatrix::write(std::ostream& f) const
     {
         size_t nz=rowindex[m_nlin];
@@ -247,7 +330,8 @@ namespace OpenMEEG {
         Vector *_v=(Vector *)&v;
         double *pt_vect=&(*_v)(0);
 
-        for(size_t i=0;i<m_nlin;i++)
+        #pragma omp parallel for if(nnz()>parallel_set_minimum)
+        for(int i=0;i<static_cast<int>(m_nlin);i++)
         {
             double& total=pt_result[i];
             for(size_t j=rowindex[i];j<rowindex[i+1];j++) {
@@ -256,5 +340,35 @@ namespace OpenMEEG {
         }
         return result;
     }
+
+    inline Matrix FastSparseMatrix::operator * (const Matrix &M) const
+    {
+        assert(m_ncol==M.nlin());
+        Matrix result(m_nlin,M.ncol());
+
+        //  Columns are independent: each one is a sparse matrix vector product.
+
+        #pragma omp parallel for if(nnz()*M.ncol()>parallel_set_minimum)
+        for(int c=0;c<static_cast<int>(M.ncol());c++)
+        {
+            const double* pt_vect   = M.data()+c*M.nlin();
+            double*       pt_result = result.data()+c*m_nlin;
+            for(size_t i=0;i<m_nlin;i++) {
+                double total = 0.0;
+                for(size_t j=rowindex[i];j<rowindex[i+1];j++)
+                    total += tank[j]*pt_vect[js[j]];
+                pt_result[i] = total;
+            }
+        }
+        return result;
+    }
+
+    inline double FastSparseMatrix::frobenius_norm() const
+    {
+        double sum = 0.0;
+        for(size_t k=0;k<nnz();k++)
+            sum += tank[k]*tank[k];
+        return std::sqrt(sum);
+    }
 }
 #endif /* OPENMEEG_FAST_SPARSE_MATRIX_H */
@@ -41,10 +41,13 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #define OPENMEEG_LINOP_H
 
 #include <cstdlib>
+#include <algorithm>
 
 #include "MatLibConfig.h"
 #include "om_utils.h"
 #include "RC.H"
+#include "timings.h"
+#include "allocator.h"
 
 namespace OpenMEEG {
 
@@ -118,32 +121,61 @@ namespace OpenMEEG {
 
     typedef enum { DEEP_COPY } DeepCopy;
 
+    /// MIXED_PRECISION computations run their dominant kernels in single precision and use
+    /// double precision to check (and refine) the result, falling back to FULL_PRECISION if needed.
+    typedef enum { FULL_PRECISION, MIXED_PRECISION } Precision;
+
+    /// Below this number of values, filling a matrix is not worth starting threads.
+    const size_t parallel_set_minimum = 1<<16;
+
     struct OPENMEEGMATHS_EXPORT LinOpValue: public utils::RCObject {
+
+        /// Called instead of the allocator when the storage is owned by someone else.
+
+        typedef void (*Release)(void*);
+
         double *data;
 
-        LinOpValue(): data(0) { }
+        LinOpValue(): data(0),allocator(0),release(0),owner(0) { }
+
+        /// Uninitialized storage for n values from the current maths::Allocator.
+        /// Throws maths::BadAlloc (a std::bad_alloc) when the memory is exhausted.
 
-        LinOpValue(const size_t n) {
-            try {
-                this->data = new double[n];
-            }
-            catch (std::bad_alloc&) {
-                std::cerr << "Error memory allocation failed... " << std::endl;
-                exit(1);
-            }
+        LinOpValue(const size_t n): allocator(&maths::Allocator::get()),release(0),owner(0) {
+            data = allocator->allocate(n);
+            timings::allocated(n*sizeof(double));
         }
 
-        LinOpValue(const size_t n,const double* initval) { init(n,initval); }
-        LinOpValue(const size_t n,const LinOpValue& v)   { init(n,v.data);  }
+        LinOpValue(const size_t n,const double* initval): allocator(0),release(0),owner(0) { init(n,initval); }
+        LinOpValue(const size_t n,const LinOpValue& v):   allocator(0),release(0),owner(0) { init(n,v.data);  }
+
+        /// Reference external storage without copying it (e.g. the buffer of a NumPy array).
+        /// The values are neither copied nor freed: rel(own) is called when the last reference goes away.
+
+        LinOpValue(double* external,Release rel,void* own): data(external),allocator(0),release(rel),owner(own) { }
 
         void init(const size_t n,const double* initval) {
-            data = new double[n];
+            allocator = &maths::Allocator::get();
+            data = allocator->allocate(n);
+            timings::allocated(n*sizeof(double));
             std::copy(initval,initval+n,data);
         }
 
-        ~LinOpValue() { delete[] data; }
+        ~LinOpValue() {
+            if (release)
+                release(owner);
+            else if (allocator)
+                allocator->deallocate(data);
+        }
 
+        bool external() const { return release!=0; }
         bool empty() const { return data==0; }
+
+    private:
+
+        maths::Allocator* allocator;
+        Release           release;
+        void*             owner;
     };
 }
 #endif  //! OPENMEEG_LINOP_H
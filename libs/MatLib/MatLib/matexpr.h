@@ -0,0 +1,308 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_MATEXPR_H
+#define OPENMEEG_MATEXPR_H
+
+#include <cmath>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+#include "MatLibConfig.h"
+#include "matrix.h"
+#include "symmatrix.h"
+#include "sparse_matrix.h"
+#include "matvectOps.h"
+#include "timings.h"
+
+namespace OpenMEEG {
+
+    namespace maths {
+
+        /** \brief Lazy expressions of the form L*S*R (+C), with S symmetric.
+
+            The products of the gain computations are of this type (L maps the unknowns onto the
+            sensors, S is the inverse head matrix and R the source matrix). Nothing is computed when
+            the expression is built: eval() picks the cheapest association from the dimensions
+            ((L*S)*R when there are fewer sensors than sources, L*(S*R) otherwise) and the last
+            product is accumulated directly into the result (beta=1), so that adding C
+            costs no temporary.
+
+            With MIXED_PRECISION, the products are computed with single precision GEMMs and the
+            result is checked with a probe vector x: if L*S*R*x computed in single precision differs
+            from L*(S*(R*x)) computed in double precision by more than the tolerance (relative error),
+            the expression is evaluated again in full precision.
+
+            Usage: Matrix G = C+product(L,S,R); or Matrix G = product(L,S,R); */
+
+        inline double mult_cost(const Matrix& L)       { return static_cast<double>(L.nlin())*L.ncol(); }
+        inline double mult_cost(const SparseMatrix& L) { return static_cast<double>(L.size());       }
+
+        //  res += L*Y
+
+        inline void accumulate_product(const Matrix& L,const Matrix& Y,Matrix& res) {
+            assert(L.ncol()==Y.nlin() && res.nlin()==L.nlin() && res.ncol()==Y.ncol());
+        #ifdef HAVE_BLAS
+            DGEMM(CblasNoTrans,CblasNoTrans,(int)L.nlin(),(int)Y.ncol(),(int)L.ncol(),1.,L.data(),(int)L.nlin(),Y.data(),(int)Y.nlin(),1.,res.data(),(int)res.nlin());
+        #else
+            for (size_t j=0;j<Y.ncol();++j)
+                for (size_t k=0;k<L.ncol();++k)
+                    for (size_t i=0;i<L.nlin();++i)
+                        res(i,j) += L(i,k)*Y(k,j);
+        #endif
+        }
+
+        inline void accumulate_product(const SparseMatrix& L,const Matrix& Y,Matrix& res) {
+            assert(L.ncol()==Y.nlin() && res.nlin()==L.nlin() && res.ncol()==Y.ncol());
+            for (SparseMatrix::const_iterator it=L.begin();it!=L.end();++it) {
+                const size_t i   = it->first.first;
+                const size_t j   = it->first.second;
+                const double val = it->second;
+                for (size_t k=0;k<Y.ncol();++k)
+                    res(i,k) += val*Y(j,k);
+            }
+        }
+
+    #ifdef HAVE_BLAS
+
+        //  Single precision kernels (column major float buffers).
+
+        //  C = A*B, A is m x k and B is k x p.
+
+        inline void sgemm(const float* A,const size_t m,const size_t k,const float* B,const size_t p,float* C) {
+            SGEMM(CblasNoTrans,CblasNoTrans,(int)m,(int)p,(int)k,1.0f,A,(int)m,B,(int)k,0.0f,C,(int)m);
+        }
+
+        //  Y = S*X, X is n x p. S is converted to single precision by panels of columns.
+
+        inline void sym_product(const SymMatrix& S,const std::vector<float>& X,const size_t p,std::vector<float>& Y) {
+            const size_t n = S.nlin();
+            const size_t w = std::min(SymMatrix::panel_width(n),n);
+            std::vector<double> P(n*w);
+            std::vector<float>  Pf(n*w);
+            Y.resize(n*p);
+            for (size_t j=0;j<n;j+=w) {
+                const size_t jsize = std::min(w,n-j);
+                S.unpack_columns(j,jsize,&P[0]);
+                std::copy(P.begin(),P.begin()+n*jsize,Pf.begin());
+                SGEMM(CblasTrans,CblasNoTrans,(int)jsize,(int)p,(int)n,1.0f,&Pf[0],(int)n,&X[0],(int)n,0.0f,&Y[j],(int)n);
+            }
+        }
+
+        //  Y = X*S, X is m x n.
+
+        inline void product_sym(const std::vector<float>& X,const size_t m,const SymMatrix& S,std::vector<float>& Y) {
+            const size_t n = S.nlin();
+            const size_t w = std::min(SymMatrix::panel_width(n),n);
+            std::vector<double> P(n*w);
+            std::vector<float>  Pf(n*w);
+            Y.resize(m*n);
+            for (size_t j=0;j<n;j+=w) {
+                const size_t jsize = std::min(w,n-j);
+                S.unpack_columns(j,jsize,&P[0]);
+                std::copy(P.begin(),P.begin()+n*jsize,Pf.begin());
+                sgemm(&X[0],m,n,&Pf[0],jsize,&Y[j*m]);
+            }
+        }
+
+        //  LS = L*S
+
+        inline void left_product(const Matrix& L,const SymMatrix& S,std::vector<float>& LS) {
+            const std::vector<float> Lf(L.data(),L.data()+L.size());
+            product_sym(Lf,L.nlin(),S,LS);
+        }
+
+        inline void left_product(const SparseMatrix& L,const SymMatrix& S,std::vector<float>& LS) {
+            const Matrix M = L*S;
+            LS.assign(M.data(),M.data()+M.size());
+        }
+
+        //  T = L*Y, Y has p columns.
+
+        inline void apply(const Matrix& L,const std::vector<float>& Y,const size_t p,std::vector<float>& T) {
+            const std::vector<float> Lf(L.data(),L.data()+L.size());
+            T.resize(L.nlin()*p);
+            sgemm(&Lf[0],L.nlin(),L.ncol(),&Y[0],p,&T[0]);
+        }
+
+        inline void apply(const SparseMatrix& L,const std::vector<float>& Y,const size_t p,std::vector<float>& T) {
+            const size_t m = L.nlin();
+            const size_t n = L.ncol();
+            T.assign(m*p,0.0f);
+            for (SparseMatrix::const_iterator it=L.begin();it!=L.end();++it) {
+                const size_t i   = it->first.first;
+                const size_t j   = it->first.second;
+                const float  val = static_cast<float>(it->second);
+                for (size_t k=0;k<p;++k)
+                    T[i+k*m] += val*Y[j+k*n];
+            }
+        }
+
+    #endif
+
+        template <typename LHS>
+        class SymProduct {
+        public:
+
+            SymProduct(const LHS& l,const SymMatrix& s,const Matrix& r,const Precision p=FULL_PRECISION,const double tol=1e-5):
+                L(l),S(s),R(r),precision(p),tolerance(tol)
+            {
+                assert(L.ncol()==S.nlin() && S.ncol()==R.nlin());
+            }
+
+            size_t nlin() const { return L.nlin(); }
+            size_t ncol() const { return R.ncol(); }
+
+            //  Number of multiply-adds of (L*S)*R and of L*(S*R).
+
+            double left_cost() const {
+                return mult_cost(L)*S.nlin()+static_cast<double>(L.nlin())*S.nlin()*R.ncol();
+            }
+
+            double right_cost() const {
+                return static_cast<double>(S.nlin())*S.nlin()*R.ncol()+mult_cost(L)*R.ncol();
+            }
+
+            bool left_first() const { return left_cost()<=right_cost(); }
+
+            Matrix eval() const {
+                Matrix res(nlin(),ncol());
+                res.set(0.0);
+                accumulate(res);
+                return res;
+            }
+
+            //  Returns C+L*S*R in a single new matrix.
+
+            Matrix eval(const Matrix& C) const {
+                assert(C.nlin()==nlin() && C.ncol()==ncol());
+                Matrix res(C,DEEP_COPY);
+                accumulate(res);
+                return res;
+            }
+
+            //  res += L*S*R
+
+            //  When the mixed precision product is not accurate enough, the double precision one appears
+            //  as a fallback phase in the timing report.
+
+            void accumulate(Matrix& res) const {
+                if (precision==MIXED_PRECISION && accumulate_mixed(res))
+                    return;
+                timings::Scope timed_scope((precision==MIXED_PRECISION) ? "SymProduct (double precision fallback)" : "SymProduct");
+                if (left_first()) {
+                    const Matrix LS = L*S;
+                    accumulate_product(LS,R,res);
+                } else {
+                    const Matrix SR = S*R;
+                    accumulate_product(L,SR,res);
+                }
+            }
+
+            //  Single precision version of accumulate. Returns false (and leaves res untouched)
+            //  when the result is not accurate enough.
+
+            bool accumulate_mixed(Matrix& res) const {
+            #ifdef HAVE_BLAS
+                TIMED_SCOPE("SymProduct (mixed precision)");
+                const size_t m = nlin();
+                const size_t p = ncol();
+                const std::vector<float> Rf(R.data(),R.data()+R.size());
+                std::vector<float> T;
+                if (left_first()) {
+                    std::vector<float> LS;
+                    left_product(L,S,LS);
+                    T.resize(m*p);
+                    sgemm(&LS[0],m,S.nlin(),&Rf[0],p,&T[0]);
+                } else {
+                    std::vector<float> SR;
+                    sym_product(S,Rf,p,SR);
+                    apply(L,SR,p,T);
+                }
+
+                Vector x(p);
+                for (size_t k=0;k<p;++k)
+                    x(k) = std::cos(k+1.0);
+                const Vector y = L*(S*(R*x));
+                double err  = 0.0;
+                double norm = 0.0;
+                for (size_t i=0;i<m;++i) {
+                    double v = 0.0;
+                    for (size_t k=0;k<p;++k)
+                        v += T[i+k*m]*x(k);
+                    err  += (v-y(i))*(v-y(i));
+                    norm += y(i)*y(i);
+                }
+                if (err>tolerance*tolerance*norm)
+                    return false;
+
+                for (size_t i=0;i<res.size();++i)
+                    res.data()[i] += T[i];
+                return true;
+            #else
+                return false;
+            #endif
+            }
+
+            operator Matrix() const { return eval(); }
+
+        private:
+
+            const LHS&       L;
+            const SymMatrix& S;
+            const Matrix&    R;
+            const Precision  precision;
+            const double     tolerance;
+        };
+
+        template <typename LHS>
+        SymProduct<LHS> product(const LHS& L,const SymMatrix& S,const Matrix& R,const Precision p=FULL_PRECISION) {
+            return SymProduct<LHS>(L,S,R,p);
+        }
+
+        template <typename LHS>
+        Matrix operator+(const Matrix& C,const SymProduct<LHS>& P) { return P.eval(C); }
+
+        template <typename LHS>
+        Matrix operator+(const SymProduct<LHS>& P,const Matrix& C) { return P.eval(C); }
+    }
+}
+
+#endif  //! OPENMEEG_MATEXPR_H
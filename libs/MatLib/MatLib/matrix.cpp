@@ -53,7 +53,10 @@ knowledge of the CeCILL-B license and that you accept its terms.
 namespace OpenMEEG {
 
     const Matrix& Matrix::set(const double d) {
-        for(size_t i=0;i<size();i++) data()[i]=d;
+        //  Static schedule: each thread touches the part of the storage it handles in the other static loops.
+        const size_t n = size();
+        #pragma omp parallel for schedule(static) if(n>=parallel_set_minimum)
+        for (size_t i=0;i<n;i++) data()[i]=d;
         return *this;
     }
 
@@ -77,6 +80,7 @@ namespace OpenMEEG {
 
     /// pseudo inverse
     Matrix Matrix::pinverse(double tolrel) const {
+        TIMED_SCOPE("Matrix::pinverse");
     #ifdef HAVE_LAPACK
         if (ncol() > nlin()) {
             return transpose().pinverse().transpose();
@@ -121,13 +125,18 @@ namespace OpenMEEG {
     }
 
     void Matrix::svd(Matrix &U, Matrix &S, Matrix &V, bool complete) const {
+        TIMED_SCOPE("Matrix::svd");
     #ifdef HAVE_LAPACK
         Matrix cpy(*this,DEEP_COPY);
         int mini = (int)std::min(nlin(),ncol());
         int maxi = (int)std::max(nlin(),ncol());
-        U = Matrix(nlin(),nlin()); U.set(0);
-        S = Matrix(nlin(),ncol()); S.set(0);
-        V = Matrix(ncol(),ncol()); V.set(0);
+        //  The economy SVD only needs the first min(m,n) singular vectors: for a wide matrix such as
+        //  a gain, the full V would be ncol x ncol.
+        const size_t urows = (complete) ? nlin() : mini;
+        const size_t vrows = (complete) ? ncol() : mini;
+        U = Matrix(nlin(),urows); U.set(0);
+        S = (complete) ? Matrix(nlin(),ncol()) : Matrix(mini,mini); S.set(0);
+        V = Matrix(vrows,ncol()); V.set(0);
         double *s = new double[mini];
         // int lwork = 4 *mini*mini + maxi + 9*mini; 
         // http://www.netlib.no/netlib/lapack/double/dgesdd.f :
@@ -262,6 +271,7 @@ namespace OpenMEEG {
     // =======
 
     void Matrix::load(const char *filename) {
+        TIMED_SCOPE("Matrix::load");
         maths::ifstream ifs(filename);
         try {
             ifs >> maths::format(filename,maths::format::FromSuffix) >> *this;
@@ -273,6 +283,7 @@ namespace OpenMEEG {
     }
 
     void Matrix::save(const char *filename) const {
+        TIMED_SCOPE("Matrix::save");
         maths::ofstream ofs(filename);
         try {
             ofs << maths::format(filename,maths::format::FromSuffix) << *this;
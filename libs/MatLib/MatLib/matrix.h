@@ -45,6 +45,8 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #include <cassert>
 #include <cstdlib>
 #include <string>
+#include <vector>
+#include <algorithm>
 
 #ifdef USE_MATIO
 #include <matio.h>
@@ -80,6 +82,9 @@ namespace OpenMEEG {
         Matrix(const size_t M,const size_t N): LinOp(M,N,FULL,2),value(new LinOpValue(N*M)) { }
         Matrix(const Matrix& A,const DeepCopy): LinOp(A.nlin(),A.ncol(),FULL,2),value(new LinOpValue(A.size(),A.data())) { }
 
+        /// Matrix using (without copy) the column major values v (e.g. external storage).
+        Matrix(const size_t M,const size_t N,LinOpValue* v): LinOp(M,N,FULL,2),value(v) { }
+
         explicit Matrix(const SymMatrix& A);
         explicit Matrix(const SparseMatrix& A);
 
@@ -207,6 +212,7 @@ namespace OpenMEEG {
     }
 
     inline Vector Matrix::operator*(const Vector &v) const {
+        TIMED_SCOPE("Matrix*Vector");
         assert(ncol()==v.nlin());
         Vector y(nlin());
     #ifdef HAVE_BLAS
@@ -291,6 +297,7 @@ namespace OpenMEEG {
     }
 
     inline Vector Matrix::tmult(const Vector &v) const {
+        TIMED_SCOPE("Matrix::tmult");
         assert(nlin()==v.nlin());
         Vector y(ncol());
     #ifdef HAVE_BLAS
@@ -307,6 +314,7 @@ namespace OpenMEEG {
     }
 
     inline Matrix Matrix::inverse() const {
+        TIMED_SCOPE("Matrix::inverse");
     #ifdef HAVE_LAPACK
         assert(nlin()==ncol());
         Matrix invA(*this,DEEP_COPY);
@@ -348,6 +356,7 @@ namespace OpenMEEG {
     }
 
     inline Matrix Matrix::operator *(const Matrix &B) const {
+        TIMED_SCOPE("Matrix*Matrix");
         assert(ncol()==B.nlin());
         size_t p=ncol();
         Matrix C(nlin(),B.ncol());
@@ -369,6 +378,7 @@ namespace OpenMEEG {
     }
     
     inline Matrix Matrix::tmult(const Matrix &B) const {
+        TIMED_SCOPE("Matrix::tmult");
         assert(nlin()==B.nlin());
         size_t p=nlin();
         Matrix C(ncol(),B.ncol());
@@ -390,6 +400,7 @@ namespace OpenMEEG {
     }
 
     inline Matrix Matrix::multt(const Matrix &B) const {
+        TIMED_SCOPE("Matrix::multt");
         assert(ncol()==B.ncol());
         size_t p=ncol();
         Matrix C(nlin(),B.nlin());
@@ -411,6 +422,7 @@ namespace OpenMEEG {
     }
 
     inline Matrix Matrix::tmultt(const Matrix &B) const {
+        TIMED_SCOPE("Matrix::tmultt");
         assert(nlin()==B.ncol());
         size_t p=nlin();
         Matrix C(ncol(),B.nlin());
@@ -432,15 +444,20 @@ namespace OpenMEEG {
     }
 
     inline Matrix Matrix::operator*(const SymMatrix &B) const {
+        TIMED_SCOPE("Matrix*SymMatrix");
         assert(ncol()==B.ncol());
         Matrix C(nlin(),B.ncol());
 
     #ifdef HAVE_BLAS
-        Matrix D(B);
-        const int n = nlin();
-        const int m = D.ncol();
-        const int l = C.nlin();
-        DSYMM(CblasRight,CblasUpper,n,m,1.,D.data(),m,data(),n,0.,C.data(),l);
+        //  Columns [j,j+jsize) of the product are (*this)*Panel_j: B is never expanded to a full matrix.
+        const size_t n = B.nlin();
+        const size_t w = std::min(SymMatrix::panel_width(n),n);
+        std::vector<double> P(n*w);
+        for (size_t j=0;j<n;j+=w) {
+            const size_t jsize = std::min(w,n-j);
+            B.unpack_columns(j,jsize,&P[0]);
+            DGEMM(CblasNoTrans,CblasNoTrans,(int)nlin(),(int)jsize,(int)n,1.,data(),(int)nlin(),&P[0],(int)n,0.,C.data()+j*C.nlin(),(int)C.nlin());
+        }
     #else
         for (size_t j=0;j<B.ncol();j++)
             for (size_t i=0;i<ncol();i++) {
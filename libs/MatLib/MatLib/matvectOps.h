@@ -40,6 +40,10 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #ifndef OPENMEEG_MATVECTOPS_H
 #define OPENMEEG_MATVECTOPS_H
 
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
 #include "vector.h"
 #include "matrix.h"
 #include "symmatrix.h"
@@ -49,13 +53,31 @@ namespace OpenMEEG {
 
     inline SymMatrix SymMatrix::operator*(const SymMatrix &m) const
     {
+        TIMED_SCOPE("SymMatrix*SymMatrix");
         assert(nlin()==m.nlin());
     #ifdef HAVE_BLAS
-        Matrix D(*this);
-        Matrix B(m);
-        Matrix C(nlin(),nlin());
-        DSYMM(CblasLeft,CblasUpper,(int)nlin(),(int)B.ncol(),1.,D.data(),(int)D.ncol(),B.data(),(int)B.nlin(),0,C.data(),(int)C.nlin());
-        return SymMatrix(C);
+        //  Only the upper triangle of the product is kept: block (I,J) of panels, I<=J, is Panel_I(this)^T*Panel_J(m).
+        const size_t n = nlin();
+        const size_t w = std::min(panel_width(n),n);
+        SymMatrix C(n);
+        std::vector<double> P(n*w);
+        std::vector<double> Q(n*w);
+        std::vector<double> T(w*w);
+        for (size_t j=0;j<n;j+=w) {
+            const size_t jsize = std::min(w,n-j);
+            m.unpack_columns(j,jsize,&Q[0]);
+            for (size_t i=0;i<=j;i+=w) {
+                const size_t isize = std::min(w,n-i);
+                unpack_columns(i,isize,&P[0]);
+                DGEMM(CblasTrans,CblasNoTrans,(int)isize,(int)jsize,(int)n,1.,&P[0],(int)n,&Q[0],(int)n,0.,&T[0],(int)isize);
+                for (size_t b=0;b<jsize;++b) {
+                    const size_t k = j+b;
+                    const size_t imax = std::min(isize,k-i+1);
+                    std::copy(&T[b*isize],&T[b*isize]+imax,C.data()+k*(k+1)/2+i);
+                }
+            }
+        }
+        return C;
     #else
         SymMatrix C(nlin());
         for ( size_t j = 0; j < m.ncol(); ++j) {
@@ -72,11 +94,19 @@ namespace OpenMEEG {
 
     inline Matrix SymMatrix::operator*(const Matrix &B) const
     {
+        TIMED_SCOPE("SymMatrix*Matrix");
         assert(ncol()==B.nlin());
         Matrix C(nlin(),B.ncol());
     #ifdef HAVE_BLAS
-        Matrix D(*this);
-        DSYMM(CblasLeft,CblasUpper ,(int)nlin(), (int)B.ncol(), 1. , D.data(), (int)D.ncol(), B.data(), (int)B.nlin(), 0, C.data(),(int)C.nlin());
+        //  Lines [j,j+jsize) of the product are Panel_j^T*B: the packed storage is never expanded.
+        const size_t n = nlin();
+        const size_t w = std::min(panel_width(n),n);
+        std::vector<double> P(n*w);
+        for (size_t j=0;j<n;j+=w) {
+            const size_t jsize = std::min(w,n-j);
+            unpack_columns(j,jsize,&P[0]);
+            DGEMM(CblasTrans,CblasNoTrans,(int)jsize,(int)B.ncol(),(int)n,1.,&P[0],(int)n,B.data(),(int)B.nlin(),0.,C.data()+j,(int)C.nlin());
+        }
     #else
         for ( size_t j = 0; j < B.ncol(); ++j) {
             for ( size_t i = 0; i < ncol(); ++i) {
@@ -92,6 +122,7 @@ namespace OpenMEEG {
 
     inline Matrix SymMatrix::solveLin(Matrix &RHS) const
     {
+        TIMED_SCOPE("SymMatrix::solveLin");
     #ifdef HAVE_LAPACK
         SymMatrix A(*this,DEEP_COPY);
         // LU
@@ -107,5 +138,64 @@ namespace OpenMEEG {
         exit(1);
     #endif
     }
+
+    //  With MIXED_PRECISION, the matrix is factorized in single precision (half the memory and about
+    //  twice the speed) and the solution is improved by iterative refinement: the residual is computed
+    //  in double precision and the correction is obtained from the single precision factors.
+    //  The double precision solver is used when the factorization fails or the refinement stagnates.
+
+    inline Matrix SymMatrix::solveLin(Matrix& RHS,const Precision precision) const
+    {
+        if (precision==FULL_PRECISION)
+            return solveLin(RHS);
+
+        TIMED_SCOPE("SymMatrix::solveLin (mixed precision)");
+    #ifdef HAVE_LAPACK
+        const int    n     = nlin();
+        const int    nrhs  = RHS.ncol();
+        const Matrix B(RHS,DEEP_COPY);
+
+        std::vector<float> A(data(),data()+size());
+        std::vector<float> W(B.data(),B.data()+B.size());
+        std::vector<int>   pivots(n);
+        int Info;
+        SSPTRF('U',n,&A[0],&pivots[0],Info);
+        if (Info==0)
+            SSPTRS('U',n,nrhs,&A[0],&pivots[0],&W[0],n,Info);
+
+        if (Info==0) {
+            std::copy(W.begin(),W.end(),RHS.data());
+
+            //  Stop when the residual is at the level of the double precision rounding errors.
+
+            double anorm = 0.0;
+            for (size_t j=0;j<nlin();++j)
+                for (size_t i=0;i<=j;++i)
+                    anorm += ((i==j) ? 1.0 : 2.0)*data()[i+j*(j+1)/2]*data()[i+j*(j+1)/2];
+            anorm = std::sqrt(anorm);
+
+            const unsigned max_iterations = 30;
+            double previous = 0.0;
+            for (unsigned iter=0;iter<max_iterations;++iter) {
+                const Matrix R = B-(*this)*RHS;
+                const double rnorm = R.frobenius_norm();
+                if (rnorm<=anorm*RHS.frobenius_norm()*std::sqrt(static_cast<double>(n))*1.1e-16)
+                    return RHS;
+                if (iter>0 && rnorm>0.5*previous)
+                    break;
+                previous = rnorm;
+                std::copy(R.data(),R.data()+R.size(),W.begin());
+                SSPTRS('U',n,nrhs,&A[0],&pivots[0],&W[0],n,Info);
+                if (Info!=0)
+                    break;
+                for (size_t i=0;i<RHS.size();++i)
+                    RHS.data()[i] += W[i];
+            }
+        }
+
+        std::copy(B.data(),B.data()+B.size(),RHS.data());
+    #endif
+        return solveLin(RHS);
+    }
 }
 #endif // ! OPENMEEG_MATVECTOPS_H
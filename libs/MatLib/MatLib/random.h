@@ -0,0 +1,113 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_RANDOM_H
+#define OPENMEEG_RANDOM_H
+
+#include <cmath>
+#include <stdint.h>
+
+namespace OpenMEEG {
+
+    namespace maths {
+
+        /** \brief Counter based random generator (Philox4x32-10, Salmon et al., SC'11).
+
+            The output is a pure function of the key (the seed) and of a 128 bits counter, so that
+            the numbers attached to a given counter (e.g. a sample and a channel) do not depend on
+            the order in which they are generated: any number of threads, in any order and on any
+            chunking of the data, produce exactly the same sequence for a given seed.
+        **/
+
+        class Philox {
+        public:
+
+            Philox(const uint64_t seed=0) {
+                key[0] = static_cast<uint32_t>(seed);
+                key[1] = static_cast<uint32_t>(seed>>32);
+            }
+
+            /// \brief The four 32 bits words of the block of counter (c0,c1) (the high words of the counter are 0).
+            void operator()(const uint64_t c0,const uint64_t c1,uint32_t out[4]) const {
+                uint32_t ctr[4] = { static_cast<uint32_t>(c0), static_cast<uint32_t>(c0>>32),
+                                    static_cast<uint32_t>(c1), static_cast<uint32_t>(c1>>32) };
+                block(ctr,out);
+            }
+
+            void block(const uint32_t in[4],uint32_t out[4]) const {
+                uint32_t ctr[4] = { in[0], in[1], in[2], in[3] };
+                uint32_t k[2]   = { key[0], key[1] };
+                for (unsigned r=0;r<10;++r) {
+                    if (r!=0) {
+                        k[0] += 0x9E3779B9U;
+                        k[1] += 0xBB67AE85U;
+                    }
+                    const uint64_t p0 = static_cast<uint64_t>(0xD2511F53U)*ctr[0];
+                    const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57U)*ctr[2];
+                    const uint32_t c[4] = { static_cast<uint32_t>(p1>>32)^ctr[1]^k[0], static_cast<uint32_t>(p1),
+                                            static_cast<uint32_t>(p0>>32)^ctr[3]^k[1], static_cast<uint32_t>(p0) };
+                    ctr[0] = c[0]; ctr[1] = c[1]; ctr[2] = c[2]; ctr[3] = c[3];
+                }
+                out[0] = ctr[0]; out[1] = ctr[1]; out[2] = ctr[2]; out[3] = ctr[3];
+            }
+
+            /// \brief Uniform number in (0,1) with 53 random bits from two words.
+            static double uniform(const uint32_t hi,const uint32_t lo) {
+                const uint64_t bits = (static_cast<uint64_t>(hi)<<21)^(lo>>11);
+                return (static_cast<double>(bits)+0.5)*(1.0/9007199254740992.0);
+            }
+
+            /// \brief Two independent standard normal numbers (Box-Muller) from the block of counter (c0,c1).
+            void gaussians(const uint64_t c0,const uint64_t c1,double& g0,double& g1) const {
+                uint32_t w[4];
+                (*this)(c0,c1,w);
+                const double r = std::sqrt(-2.0*std::log(uniform(w[0],w[1])));
+                const double a = 6.283185307179586476925*uniform(w[2],w[3]);
+                g0 = r*std::cos(a);
+                g1 = r*std::sin(a);
+            }
+
+        private:
+
+            uint32_t key[2];
+        };
+    }
+}
+
+#endif  //! OPENMEEG_RANDOM_H
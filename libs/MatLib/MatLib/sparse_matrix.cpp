@@ -37,6 +37,9 @@ The fact that you are presently reading this means that you have had
 knowledge of the CeCILL-B license and that you accept its terms.
 */
 
+#include <vector>
+#include <algorithm>
+
 #include "sparse_matrix.h"
 #include "symmatrix.h"
 
@@ -52,6 +55,7 @@ namespace OpenMEEG {
 
     Vector SparseMatrix::operator*(const Vector &x) const
     {
+        TIMED_SCOPE("SparseMatrix*Vector");
         Vector ret(nlin());
         ret.set(0);
 
@@ -68,18 +72,63 @@ namespace OpenMEEG {
 
     Matrix SparseMatrix::operator*(const SymMatrix &mat) const
     {
+        TIMED_SCOPE("SparseMatrix*SymMatrix");
         assert(ncol()==mat.nlin());
         Matrix out(nlin(),mat.ncol());
         out.set(0.0);
+        if (mat.nlin()==0 || nlin()==0)
+            return out;
+
+        //  Only the lines of mat hit by a column of this matrix are needed: number them
+        //  and express the non zero entries with respect to this compact numbering.
+
+        std::vector<size_t> used;
+        std::vector<size_t> lines;
+        std::vector<size_t> rows;
+        std::vector<double> values;
+        for (Tank::const_iterator it=m_tank.begin();it!=m_tank.end();++it)
+            used.push_back(it->first.second);
+        std::sort(used.begin(),used.end());
+        used.erase(std::unique(used.begin(),used.end()),used.end());
+        for (Tank::const_iterator it=m_tank.begin();it!=m_tank.end();++it) {
+            lines.push_back(it->first.first);
+            rows.push_back(std::lower_bound(used.begin(),used.end(),it->first.second)-used.begin());
+            values.push_back(it->second);
+        }
 
-        Tank::const_iterator it;
-        for(it = m_tank.begin(); it != m_tank.end(); ++it) {
-            size_t i = it->first.first;
-            size_t j = it->first.second;
-            double val = it->second;
-            for(size_t k = 0; k < mat.ncol(); ++k) {
-                out(i,k) += val * mat(j,k);
+        //  The columns of the result are computed by panels: the needed lines of mat are gathered
+        //  (line major) directly from the packed storage, then combined into a line major panel of out.
+
+        const size_t  n      = mat.nlin();
+        const size_t  nu     = used.size();
+        const double* packed = mat.data();
+        const size_t  w      = std::min(SymMatrix::panel_width(std::max(nu,nlin())),n);
+        const int     npanels = (n+w-1)/w;
+
+        #pragma omp parallel for
+        for (int p=0;p<npanels;++p) {
+            const size_t k0    = p*w;
+            const size_t ksize = std::min(w,n-k0);
+            std::vector<double> G(nu*ksize);
+            std::vector<double> R(nlin()*ksize,0.0);
+            for (size_t r=0;r<nu;++r) {
+                const size_t j = used[r];
+                double* g = &G[r*ksize];
+                for (size_t c=0;c<ksize;++c) {
+                    const size_t k = k0+c;
+                    g[c] = (k<=j) ? packed[k+j*(j+1)/2] : packed[j+k*(k+1)/2];
+                }
+            }
+            for (size_t e=0;e<values.size();++e) {
+                const double* g   = &G[rows[e]*ksize];
+                double*       res = &R[lines[e]*ksize];
+                const double  val = values[e];
+                for (size_t c=0;c<ksize;++c)
+                    res[c] += val*g[c];
             }
+            for (size_t c=0;c<ksize;++c)
+                for (size_t i=0;i<nlin();++i)
+                    out(i,k0+c) = R[i*ksize+c];
         }
 
         return out;
@@ -87,6 +136,7 @@ namespace OpenMEEG {
 
     Matrix SparseMatrix::operator*(const Matrix &mat) const
     {
+        TIMED_SCOPE("SparseMatrix*Matrix");
         assert(ncol()==mat.nlin());
         Matrix out(nlin(),mat.ncol());
         out.set(0.0);
@@ -105,6 +155,7 @@ namespace OpenMEEG {
 
     SparseMatrix SparseMatrix::operator*(const SparseMatrix &mat) const
     {
+        TIMED_SCOPE("SparseMatrix*SparseMatrix");
         // fast enough ?
         assert(ncol() == mat.nlin());
         SparseMatrix out(nlin(), mat.ncol());
@@ -200,6 +251,7 @@ namespace OpenMEEG {
     // =======
 
     void SparseMatrix::load(const char *filename) {
+        TIMED_SCOPE("SparseMatrix::load");
         maths::ifstream ifs(filename);
         try {
             ifs >> maths::format(filename,maths::format::FromSuffix) >> *this;
@@ -211,6 +263,7 @@ namespace OpenMEEG {
     }
 
     void SparseMatrix::save(const char *filename) const {
+        TIMED_SCOPE("SparseMatrix::save");
         maths::ofstream ofs(filename);
         try {
             ofs << maths::format(filename,maths::format::FromSuffix) << *this;
@@ -69,7 +69,9 @@ namespace OpenMEEG {
     }
 
     void SymMatrix::set(double x) {
-        for (size_t i=0;i<(nlin()*(nlin()+1))/2;i++)
+        const size_t n = size();
+        #pragma omp parallel for schedule(static) if(n>=parallel_set_minimum)
+        for (size_t i=0;i<n;i++)
             data()[i]=x;
     }
 
@@ -158,6 +160,7 @@ namespace OpenMEEG {
     // =======
 
     void SymMatrix::load(const char *filename) {
+        TIMED_SCOPE("SymMatrix::load");
         maths::ifstream ifs(filename);
         try {
             ifs >> maths::format(filename,maths::format::FromSuffix) >> *this;
@@ -169,6 +172,7 @@ namespace OpenMEEG {
     }
 
     void SymMatrix::save(const char *filename) const {
+        TIMED_SCOPE("SymMatrix::save");
         maths::ofstream ofs(filename);
         try {
             ofs << maths::format(filename,maths::format::FromSuffix) << *this;
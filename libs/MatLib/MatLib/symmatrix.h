@@ -44,6 +44,7 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #include <cassert>
 #include <cstdlib>
 #include <string>
+#include <algorithm>
 
 #include <vector.h>
 #include <linop.h>
@@ -67,6 +68,9 @@ namespace OpenMEEG {
         SymMatrix(size_t M,size_t N): LinOp(N,N,SYMMETRIC,2),value(new LinOpValue(size())) { assert(N==M); }
         SymMatrix(const SymMatrix& S,const DeepCopy): LinOp(S.nlin(),S.nlin(),SYMMETRIC,2),value(new LinOpValue(S.size(),S.data())) { }
 
+        /// SymMatrix using (without copy) the packed upper triangular values v (e.g. external storage).
+        SymMatrix(const size_t N,LinOpValue* v): LinOp(N,N,SYMMETRIC,2),value(v) { }
+
         explicit SymMatrix(const Vector& v);
         explicit SymMatrix(const Matrix& A);
 
@@ -94,6 +98,7 @@ namespace OpenMEEG {
         Vector    solveLin(const Vector &B) const;
         void      solveLin(Vector * B, int nbvect);
         Matrix    solveLin(Matrix& B) const;
+        Matrix    solveLin(Matrix& B,const Precision precision) const;
 
         const SymMatrix& operator=(const double d);
 
@@ -121,9 +126,44 @@ namespace OpenMEEG {
         void save(const std::string& s) const { save(s.c_str()); }
         void load(const std::string& s)       { load(s.c_str()); }
 
+        /** \brief Copy the columns [jstart,jstart+jsize) (both triangles) into the column major n x jsize buffer panel.
+            Products work on such panels instead of expanding the packed storage to a full matrix. */
+        void unpack_columns(const size_t jstart,const size_t jsize,double* panel) const;
+
+        /// Number of columns of the panels used for products with a matrix of n lines.
+        static size_t panel_width(const size_t n);
+
         friend class Matrix;
     };
 
+    inline void SymMatrix::unpack_columns(const size_t jstart,const size_t jsize,double* panel) const {
+        assert(jstart+jsize<=nlin());
+        const size_t  n      = nlin();
+        const double* packed = data();
+
+        //  Upper part (i<=k): contiguous in the packed storage.
+
+        for (size_t c=0;c<jsize;++c) {
+            const size_t k = jstart+c;
+            std::copy(packed+k*(k+1)/2,packed+k*(k+1)/2+k+1,panel+c*n);
+        }
+
+        //  Lower part (i>k): element (i,k) is (k,i), read contiguously along the packed column i.
+
+        for (size_t i=jstart+1;i<n;++i) {
+            const double* col  = packed+i*(i+1)/2+jstart;
+            const size_t  cmax = std::min(i-jstart,jsize);
+            for (size_t c=0;c<cmax;++c)
+                panel[i+c*n] = col[c];
+        }
+    }
+
+    inline size_t SymMatrix::panel_width(const size_t n) {
+        //  Panels of about 4MB, with at least 32 columns for an efficient GEMM.
+        const size_t width = (static_cast<size_t>(1)<<19)/std::max(n,static_cast<size_t>(1));
+        return std::max(width,static_cast<size_t>(32));
+    }
+
     inline double SymMatrix::operator()(size_t i,size_t j) const {
         assert(i<nlin() && j<nlin());
         if(i<=j)
@@ -142,6 +182,7 @@ namespace OpenMEEG {
 
     //returns the solution of (this)*X = B
     inline Vector SymMatrix::solveLin(const Vector &B) const {
+        TIMED_SCOPE("SymMatrix::solveLin");
         SymMatrix invA(*this,DEEP_COPY);
         Vector X(B,DEEP_COPY);
 
@@ -162,6 +203,7 @@ namespace OpenMEEG {
 
     // stores in B the solution of (this)*X = B, where B is a set of nbvect vector
     inline void SymMatrix::solveLin(Vector * B, int nbvect) {
+        TIMED_SCOPE("SymMatrix::solveLin");
         SymMatrix invA(*this,DEEP_COPY);
 
     #ifdef HAVE_LAPACK
@@ -201,6 +243,7 @@ namespace OpenMEEG {
     }
 
     inline SymMatrix SymMatrix::posdefinverse() const {
+        TIMED_SCOPE("SymMatrix::posdefinverse");
         // supposes (*this) is definite positive
         SymMatrix invA(*this,DEEP_COPY);
     #ifdef HAVE_LAPACK
@@ -215,6 +258,7 @@ namespace OpenMEEG {
     }
 
     inline double SymMatrix::det() {
+        TIMED_SCOPE("SymMatrix::det");
         SymMatrix invA(*this,DEEP_COPY);
         double d = 1.0;
     #ifdef HAVE_LAPACK
@@ -296,6 +340,7 @@ namespace OpenMEEG {
     }
 
     inline SymMatrix SymMatrix::inverse() const {
+        TIMED_SCOPE("SymMatrix::inverse");
     #ifdef HAVE_LAPACK
         SymMatrix invA(*this, DEEP_COPY);
         // LU
@@ -317,6 +362,7 @@ namespace OpenMEEG {
     }
 
     inline void SymMatrix::invert() {
+        TIMED_SCOPE("SymMatrix::invert");
     #ifdef HAVE_LAPACK
         // LU
         int *pivots = new int[nlin()];
@@ -337,6 +383,7 @@ namespace OpenMEEG {
     }
 
     inline Vector SymMatrix::operator *(const Vector &v) const {
+        TIMED_SCOPE("SymMatrix*Vector");
         assert(nlin()==v.size());
         Vector y(nlin());
     #ifdef HAVE_BLAS
@@ -0,0 +1,171 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <MatLibConfig.h>
+#include <thread_budget.h>
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif
+
+#if !defined(USE_MKL) && defined(HAVE_OPENBLAS_SET_NUM_THREADS)
+extern "C" {
+    void openblas_set_num_threads(int);
+    int  openblas_get_num_threads();
+}
+#elif !defined(USE_MKL) && defined(HAVE_BLI_THREAD_SET_NUM_THREADS)
+#include <stdint.h>
+extern "C" {
+    void    bli_thread_set_num_threads(int64_t);
+    int64_t bli_thread_get_num_threads();
+}
+#endif
+
+namespace OpenMEEG {
+
+    namespace threads {
+
+        namespace {
+
+            //  Shared by all the threads (e.g. several python threads running assemblies), and only
+            //  accessed in the critical section blas_threads.
+
+            unsigned current      = 0; // 0: not set yet.
+            unsigned initial      = 0; // the default budget.
+            unsigned serial_depth = 0; // number of live SerialBlas scopes.
+
+            //  Threads of the BLAS backend (0 if unknown).
+
+            unsigned blas_threads() {
+            #if defined(USE_MKL)
+                return mkl_get_max_threads();
+            #elif defined(HAVE_OPENBLAS_SET_NUM_THREADS)
+                return openblas_get_num_threads();
+            #elif defined(HAVE_BLI_THREAD_SET_NUM_THREADS)
+                return static_cast<unsigned>(bli_thread_get_num_threads());
+            #else
+                return 0;
+            #endif
+            }
+
+            unsigned default_budget() {
+            #ifdef USE_OMP
+                return omp_get_max_threads();
+            #else
+                const unsigned n = blas_threads();
+                return (n==0) ? 1 : n;
+            #endif
+            }
+
+            void apply_budget(const unsigned n) {
+                if (initial==0)
+                    initial = default_budget();
+                current = (n==0) ? initial : n;
+            #ifdef USE_OMP
+                omp_set_num_threads(current);
+                #if _OPENMP>=200805
+                    omp_set_max_active_levels(1);
+                #else
+                    omp_set_nested(0);
+                #endif
+            #endif
+                if (serial_depth==0)
+                    set_blas_threads(current);
+            }
+
+            unsigned current_budget() {
+                if (current==0)
+                    apply_budget(0);
+                return current;
+            }
+        }
+
+        bool blas_threads_settable() {
+        #if defined(USE_MKL) || defined(HAVE_OPENBLAS_SET_NUM_THREADS) || defined(HAVE_BLI_THREAD_SET_NUM_THREADS)
+            return true;
+        #else
+            return false;
+        #endif
+        }
+
+        void set_blas_threads(const unsigned n) {
+        #if defined(USE_MKL)
+            mkl_set_num_threads(n);
+        #elif defined(HAVE_OPENBLAS_SET_NUM_THREADS)
+            openblas_set_num_threads(n);
+        #elif defined(HAVE_BLI_THREAD_SET_NUM_THREADS)
+            bli_thread_set_num_threads(n);
+        #else
+            (void) n;
+        #endif
+        }
+
+        void set_budget(const unsigned n) {
+            #pragma omp critical (blas_threads)
+            apply_budget(n);
+        }
+
+        unsigned budget() {
+            unsigned n;
+            #pragma omp critical (blas_threads)
+            n = current_budget();
+            return n;
+        }
+
+        //  Without OpenMP, there are no parallel regions calling BLAS and the scopes have no effect.
+
+        SerialBlas::SerialBlas() {
+        #ifdef USE_OMP
+            #pragma omp critical (blas_threads)
+            if (serial_depth++==0) {
+                current_budget();
+                set_blas_threads(1);
+            }
+        #endif
+        }
+
+        SerialBlas::~SerialBlas() {
+        #ifdef USE_OMP
+            #pragma omp critical (blas_threads)
+            if (--serial_depth==0)
+                set_blas_threads(current_budget());
+        #endif
+        }
+    }
+}
@@ -0,0 +1,93 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_THREAD_BUDGET_H
+#define OPENMEEG_THREAD_BUDGET_H
+
+#include <DLLDefinesOpenMEEGMaths.h>
+
+namespace OpenMEEG {
+
+    /** \brief Number of threads shared by the OpenMP parallel regions and the BLAS/LAPACK backend.
+
+        The assembly loops are parallelized with OpenMP while the dense linear algebra (factorizations,
+        products) relies on the threads of the BLAS backend. Both use the same budget, but not at the
+        same time: the BLAS threads are reduced to one during the OpenMP phases (see SerialBlas) and
+        get the whole budget back afterwards. Nested OpenMP regions are run serially.
+
+        The number of BLAS threads can be set with OpenBLAS, MKL and BLIS. With other backends,
+        only the OpenMP threads follow the budget.
+    **/
+
+    namespace threads {
+
+        /// \brief Set the budget to n threads (0: the OpenMP default, i.e. OMP_NUM_THREADS or the number of processors).
+
+        OPENMEEGMATHS_EXPORT void set_budget(const unsigned n=0);
+
+        /// \brief The current budget (the default one if set_budget was not called).
+
+        OPENMEEGMATHS_EXPORT unsigned budget();
+
+        /// \brief Set the number of threads of the BLAS backend, when it allows it.
+
+        OPENMEEGMATHS_EXPORT void set_blas_threads(const unsigned n);
+
+        /// \brief Whether set_blas_threads has an effect.
+
+        OPENMEEGMATHS_EXPORT bool blas_threads_settable();
+
+        /** \brief Single threaded BLAS calls during the lifetime of the object.
+
+            Used for the phases parallelized by OpenMP, whose threads may call BLAS themselves.
+            Scopes may be nested or live in several threads at once: the budget is given back to BLAS when
+            the last one ends. They must be created outside of the parallel regions. Without OpenMP, they
+            have no effect.
+        **/
+
+        class OPENMEEGMATHS_EXPORT SerialBlas {
+        public:
+
+            SerialBlas();
+            ~SerialBlas();
+        };
+    }
+}
+
+#endif  //! OPENMEEG_THREAD_BUDGET_H
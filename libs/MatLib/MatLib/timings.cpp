@@ -0,0 +1,224 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+#ifndef WIN32
+#include <sys/time.h>
+#endif
+
+#include <timings.h>
+#include <allocator.h>
+
+namespace OpenMEEG {
+
+    namespace timings {
+
+        bool  State::active  = false;
+        Node* State::current = 0;
+
+        static double start_wall = 0.0;
+        static double start_cpu  = 0.0;
+
+        Node::~Node() {
+            for (std::vector<Node*>::iterator it=children.begin();it!=children.end();++it)
+                delete *it;
+        }
+
+        Node* Node::child(const std::string& n) {
+            for (std::vector<Node*>::iterator it=children.begin();it!=children.end();++it)
+                if ((*it)->name==n)
+                    return *it;
+            children.push_back(new Node(n,this));
+            return children.back();
+        }
+
+        double wall_clock() {
+        #if defined(USE_OMP)
+            return omp_get_wtime();
+        #elif defined(WIN32)
+            return static_cast<double>(clock())/CLOCKS_PER_SEC; // clock() is the wall time on windows.
+        #else
+            struct timeval tv;
+            gettimeofday(&tv,0);
+            return tv.tv_sec+1e-6*tv.tv_usec;
+        #endif
+        }
+
+        Node& root() {
+            static Node* r = new Node("total",0);
+            return *r;
+        }
+
+        void enable(const std::string& name) {
+            Node& r = root();
+            for (std::vector<Node*>::iterator it=r.children.begin();it!=r.children.end();++it)
+                delete *it;
+            r.children.clear();
+            r.name         = name.substr(name.find_last_of("/\\")+1);
+            r.calls        = 1;
+            r.kernel_calls = 0;
+            r.bytes        = 0;
+            r.threads      = max_threads();
+            start_wall     = wall_clock();
+            start_cpu      = cpu_clock();
+            State::current = &r;
+            State::active  = true;
+        }
+
+        void disable() {
+            if (!State::active)
+                return;
+            root().wall   = wall_clock()-start_wall;
+            root().cpu    = cpu_clock()-start_cpu;
+            State::active = false;
+        }
+
+        void add_kernel_calls(const unsigned long n) {
+            Node* node = State::current;
+            #pragma omp atomic
+            node->kernel_calls += n;
+        }
+
+        void add_bytes(const size_t n) {
+            Node* node = State::current;
+            #pragma omp atomic
+            node->bytes += n;
+        }
+
+        void Scope::open(const char* name) {
+            node = State::current->child(name);
+            node->threads = std::max(node->threads,max_threads());
+            ++node->calls;
+            State::current = node;
+            wall0 = wall_clock();
+            cpu0  = cpu_clock();
+        }
+
+        void Scope::close() {
+            node->wall += wall_clock()-wall0;
+            node->cpu  += cpu_clock()-cpu0;
+            State::current = node->parent;
+        }
+
+        //  Reports.
+
+        static void update_root() {
+            if (State::active) {
+                root().wall = wall_clock()-start_wall;
+                root().cpu  = cpu_clock()-start_cpu;
+            }
+        }
+
+        static void report(std::ostream& os,const Node& node,const unsigned depth) {
+            os << std::string(2*depth,' ') << std::left << std::setw(40-2*depth) << node.name << std::right
+               << std::setw(8)  << node.calls
+               << std::setw(12) << std::fixed << std::setprecision(3) << node.wall
+               << std::setw(12) << node.cpu
+               << std::setw(5)  << node.threads
+               << std::setw(14) << node.bytes
+               << std::setw(14) << node.kernel_calls << std::endl;
+            for (std::vector<Node*>::const_iterator it=node.children.begin();it!=node.children.end();++it)
+                report(os,**it,depth+1);
+        }
+
+        void report(std::ostream& os) {
+            update_root();
+            os << std::left << std::setw(40) << "phase" << std::right << std::setw(8) << "calls" << std::setw(12) << "wall (s)"
+               << std::setw(12) << "cpu (s)" << std::setw(5) << "thr" << std::setw(14) << "bytes" << std::setw(14) << "kernels" << std::endl;
+            report(os,root(),0);
+            maths::Allocator::report(os);
+        }
+
+        static void report_json(std::ostream& os,const Node& node,const unsigned depth) {
+            const std::string indent(2*depth,' ');
+            os << indent << "{ \"name\": \"" << node.name << "\", \"calls\": " << node.calls
+               << ", \"wall\": " << node.wall << ", \"cpu\": " << node.cpu << ", \"threads\": " << node.threads
+               << ", \"bytes\": " << node.bytes << ", \"kernel_calls\": " << node.kernel_calls << ", \"children\": [";
+            for (std::vector<Node*>::const_iterator it=node.children.begin();it!=node.children.end();++it) {
+                os << ((it==node.children.begin()) ? "\n" : ",\n");
+                report_json(os,**it,depth+1);
+            }
+            if (!node.children.empty())
+                os << std::endl << indent;
+            os << "] }";
+        }
+
+        void report_json(std::ostream& os) {
+            update_root();
+            os << std::setprecision(6);
+            report_json(os,root(),0);
+            os << std::endl;
+        }
+
+        static void report_csv(std::ostream& os,const Node& node,const std::string& path) {
+            const std::string name = (path.empty()) ? node.name : path+"/"+node.name;
+            os << name << ',' << node.calls << ',' << node.wall << ',' << node.cpu << ','
+               << node.threads << ',' << node.bytes << ',' << node.kernel_calls << std::endl;
+            for (std::vector<Node*>::const_iterator it=node.children.begin();it!=node.children.end();++it)
+                report_csv(os,**it,name);
+        }
+
+        void report_csv(std::ostream& os) {
+            update_root();
+            os << std::setprecision(6);
+            os << "phase,calls,wall,cpu,threads,bytes,kernel_calls" << std::endl;
+            report_csv(os,root(),"");
+        }
+
+        void save_report(const std::string& filename) {
+            std::ofstream ofs(filename.c_str());
+            if (!ofs) {
+                std::cerr << "Unable to write the timings report " << filename << std::endl;
+                return;
+            }
+            const std::string::size_type pos = filename.find_last_of(".");
+            const std::string suffix = (pos==std::string::npos) ? "" : filename.substr(pos+1);
+            if (suffix=="json") {
+                report_json(ofs);
+            } else if (suffix=="csv") {
+                report_csv(ofs);
+            } else {
+                report(ofs);
+            }
+        }
+    }
+}
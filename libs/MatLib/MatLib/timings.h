@@ -0,0 +1,154 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_TIMINGS_H
+#define OPENMEEG_TIMINGS_H
+
+#include <ctime>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif
+
+#include <DLLDefinesOpenMEEGMaths.h>
+
+namespace OpenMEEG {
+
+    /** \brief Lightweight instrumentation of the computation phases.
+
+        Timings are collected in a tree of named nodes. A timings::Scope object (or the TIMED_SCOPE
+        macro) opens a child of the current node and records, on exit, the wall clock and CPU time
+        spent, the number of threads available, the bytes allocated for matrices and the number
+        of kernel evaluations reported with timings::count.
+
+        Collection is disabled by default, in which case a scope costs a single test. Scopes opened
+        from inside an OpenMP parallel region are ignored (the tree is only modified by the serial
+        code), but count and allocated may be called from any thread.
+    **/
+
+    namespace timings {
+
+        struct OPENMEEGMATHS_EXPORT Node {
+
+            Node(const std::string& n,Node* p): name(n),parent(p),calls(0),kernel_calls(0),bytes(0),threads(1),wall(0.0),cpu(0.0) { }
+            ~Node();
+
+            Node* child(const std::string& name);
+
+            std::string        name;
+            Node*              parent;
+            std::vector<Node*> children;
+            unsigned long      calls;
+            unsigned long      kernel_calls;
+            size_t             bytes;
+            int                threads;
+            double             wall;
+            double             cpu;
+        };
+
+        struct OPENMEEGMATHS_EXPORT State {
+            static bool  active;
+            static Node* current;
+        };
+
+        inline bool enabled() { return State::active; }
+
+        inline bool in_parallel() {
+        #ifdef USE_OMP
+            return omp_in_parallel();
+        #else
+            return false;
+        #endif
+        }
+
+        inline int max_threads() {
+        #ifdef USE_OMP
+            return omp_get_max_threads();
+        #else
+            return 1;
+        #endif
+        }
+
+        /// \brief Wall clock time in seconds (clock() only measures CPU time, summed over all threads).
+        OPENMEEGMATHS_EXPORT double wall_clock();
+        inline double cpu_clock() { return static_cast<double>(clock())/CLOCKS_PER_SEC; }
+
+        OPENMEEGMATHS_EXPORT void enable(const std::string& name="total");
+        OPENMEEGMATHS_EXPORT void disable();
+        OPENMEEGMATHS_EXPORT Node& root();
+
+        OPENMEEGMATHS_EXPORT void add_kernel_calls(const unsigned long n);
+        OPENMEEGMATHS_EXPORT void add_bytes(const size_t n);
+
+        /// \brief Report n evaluations of a kernel (e.g. triangle/triangle integrals) to the current phase.
+        inline void count(const unsigned long n) { if (enabled()) add_kernel_calls(n); }
+        inline void allocated(const size_t n)    { if (enabled()) add_bytes(n);        }
+
+        /// \brief Write the timing tree as an indented text, a JSON document or a CSV table.
+        OPENMEEGMATHS_EXPORT void report(std::ostream& os);
+        OPENMEEGMATHS_EXPORT void report_json(std::ostream& os);
+        OPENMEEGMATHS_EXPORT void report_csv(std::ostream& os);
+
+        /// \brief Save the report in a file whose format (json, csv or text) is deduced from the suffix.
+        OPENMEEGMATHS_EXPORT void save_report(const std::string& filename);
+
+        class OPENMEEGMATHS_EXPORT Scope {
+        public:
+
+            Scope(const char* name): node(0) { if (enabled() && !in_parallel()) open(name); }
+            ~Scope() { if (node) close(); }
+
+        private:
+
+            void open(const char* name);
+            void close();
+
+            Node*  node;
+            double wall0;
+            double cpu0;
+        };
+    }
+}
+
+#define TIMED_SCOPE(name) OpenMEEG::timings::Scope timed_scope(name)
+
+#endif  //! OPENMEEG_TIMINGS_H
@@ -80,6 +80,7 @@ namespace OpenMEEG {
     }
 
     Vector Vector::operator*(const Matrix& m) const {
+        TIMED_SCOPE("Vector*Matrix");
         assert(nlin()==m.nlin());
         Vector c(m.ncol());
         return m.transpose()*(*this);
@@ -149,9 +150,10 @@ namespace OpenMEEG {
     }
 
     void Vector::load(const char *filename) {
+        TIMED_SCOPE("Vector::load");
         maths::ifstream ifs(filename);
         try {
-            ifs >> maths::format(filename, maths::format::FromSuffix) << *this;
+            ifs >> maths::format(filename, maths::format::FromSuffix) >> *this;
         }
         catch (maths::Exception& e) {
             std::cout << e.what() << " Doing my best...." << std::endl;
@@ -160,6 +162,7 @@ namespace OpenMEEG {
     }
 
     void Vector::save(const char *filename) const {
+        TIMED_SCOPE("Vector::save");
         maths::ofstream ofs(filename);
         try {
             ofs << maths::format(filename,maths::format::FromSuffix) << *this;
@@ -66,6 +66,9 @@ namespace OpenMEEG {
         Vector(const size_t N): LinOp(N,1,FULL,1),value(new LinOpValue(size())) { }
         Vector(const Vector& A,const DeepCopy): LinOp(A.nlin(),1,FULL,1),value(new LinOpValue(A.size(),A.data())) { }
 
+        /// Vector using (without copy) the values v (e.g. external storage).
+        Vector(const size_t N,LinOpValue* v): LinOp(N,1,FULL,1),value(v) { }
+
         explicit Vector(Matrix& A);
         explicit Vector(SymMatrix& A);
 
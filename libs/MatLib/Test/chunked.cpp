@@ -0,0 +1,211 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+#include <MatLibConfig.h>
+#include <matrix.h>
+#include <symmatrix.h>
+#include <sparse_matrix.h>
+#include <ChunkedBinIO.H>
+#include <vector.h>
+
+using namespace OpenMEEG;
+
+void check(const bool cond,const char* msg) {
+    if (!cond) {
+        std::cerr << "Error: " << msg << std::endl;
+        exit(1);
+    }
+}
+
+int main () {
+
+    std::cout << std::endl << "========== chunked ==========" << std::endl;
+
+    maths::ChunkedBinIO::set_tile_size(16,16);
+
+    // Full matrix with partial edge tiles.
+
+    Matrix M(50,37);
+    for (size_t i=0;i<M.nlin();++i)
+        for (size_t j=0;j<M.ncol();++j)
+            M(i,j) = (j%5==0) ? 0.0 : cos(double(i))+j;
+
+    M.save("chunked-full.omc");
+    Matrix M1;
+    M1.load("chunked-full.omc");
+    check(M1.nlin()==M.nlin() && M1.ncol()==M.ncol() && (M1-M).frobenius_norm()==0.0,"full matrix round trip");
+
+    maths::ChunkedMatrixReader reader("chunked-full.omc");
+    check(reader.check(),"checksums");
+    Matrix S = reader.submat(7,30,20,9);
+    check((S-M.submat(7,30,20,9)).frobenius_norm()==0.0,"submatrix read");
+    Matrix C = reader.columns(33,4);
+    check((C-M.submat(0,50,33,4)).frobenius_norm()==0.0,"columns read");
+
+    // Symmetric matrix.
+
+    SymMatrix Sym(41);
+    for (size_t i=0;i<Sym.nlin();++i)
+        for (size_t j=i;j<Sym.ncol();++j)
+            Sym(i,j) = 1.0/(1.0+i+j);
+
+    Sym.save("chunked-symm.omc");
+    SymMatrix Sym1;
+    Sym1.load("chunked-symm.omc");
+    check((Matrix(Sym1)-Matrix(Sym)).frobenius_norm()==0.0,"symmetric matrix round trip");
+    maths::ChunkedMatrixReader sreader("chunked-symm.omc");
+    check((sreader.submat(30,11,2,20)-Matrix(Sym).submat(30,11,2,20)).frobenius_norm()==0.0,"symmetric submatrix read");
+
+    // Vector.
+
+    Vector V(1000);
+    for (size_t i=0;i<V.size();++i)
+        V(i) = (i%7) ? 1.5 : -double(i);
+    V.save("chunked-vect.omc");
+    Vector V1;
+    V1.load("chunked-vect.omc");
+    check(V1.size()==V.size(),"vector round trip");
+    for (size_t i=0;i<V.size();++i)
+        check(V1(i)==V(i),"vector round trip");
+
+    // Sparse matrix.
+
+    SparseMatrix Sp(100,80);
+    Sp(0,0)   = 1.0;
+    Sp(17,33) = -2.0;
+    Sp(99,79) = 3.5;
+    Sp.save("chunked-sparse.omc");
+    SparseMatrix Sp1;
+    Sp1.load("chunked-sparse.omc");
+    check(Sp1.size()==3 && Sp1(17,33)==-2.0 && Sp1(99,79)==3.5,"sparse matrix round trip");
+
+    // Tiles written concurrently, as from assembly threads.
+
+    {
+        maths::ChunkedMatrixWriter writer("chunked-tiles.omc",M,16,16);
+        const int ntiles = writer.ntile_rows()*writer.ntile_cols();
+        #pragma omp parallel for
+        for (int t=0;t<ntiles;++t) {
+            const size_t bi = t%writer.ntile_rows();
+            const size_t bj = t/writer.ntile_rows();
+            Matrix tile = M.submat(bi*16,writer.tile_rows(bi),bj*16,writer.tile_cols(bj));
+            writer.write_tile(bi,bj,tile);
+        }
+    }
+    M1.load("chunked-tiles.omc");
+    check((M1-M).frobenius_norm()==0.0,"parallel tile writes");
+
+    // Single precision storage.
+
+    maths::ChunkedBinIO::set_single_precision(true);
+    M.save("chunked-single.omc");
+    maths::ChunkedBinIO::set_single_precision(false);
+    maths::ChunkedMatrixReader freader("chunked-single.omc");
+    check(freader.single_precision() && freader.check(),"single precision header");
+    M1.load("chunked-single.omc");
+    check((M1-M).frobenius_norm()<=1e-7*M.frobenius_norm(),"single precision round trip");
+    check((freader.submat(7,30,20,9)-M1.submat(7,30,20,9)).frobenius_norm()==0.0,"single precision submatrix read");
+
+    // Corruption is detected.
+
+    {
+        std::fstream fs("chunked-tiles.omc",std::ios::in|std::ios::out|std::ios::binary);
+        fs.seekp(100);
+        fs.put('\x5a');
+    }
+    maths::ChunkedMatrixReader creader("chunked-tiles.omc");
+    check(!creader.check(),"corruption detection");
+
+    // Truncated files and tiles outside of the file are rejected at opening.
+
+    std::vector<char> bytes;
+    {
+        std::ifstream ifs("chunked-full.omc",std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(ifs),std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream ofs("chunked-truncated.omc",std::ios::binary);
+        ofs.write(&bytes[0],bytes.size()-10);
+    }
+    bool rejected = false;
+    try {
+        maths::ChunkedMatrixReader treader("chunked-truncated.omc");
+    } catch (maths::Exception&) {
+        rejected = true;
+    }
+    check(rejected,"truncated file detection");
+
+    //  Make the offset of the last tile (last index entry) point past the index.
+
+    const uint64_t offset = bytes.size();
+    std::copy(reinterpret_cast<const char*>(&offset),reinterpret_cast<const char*>(&offset)+sizeof(offset),bytes.end()-32);
+    {
+        std::ofstream ofs("chunked-badindex.omc",std::ios::binary);
+        ofs.write(&bytes[0],bytes.size());
+    }
+    rejected = false;
+    try {
+        maths::ChunkedMatrixReader ireader("chunked-badindex.omc");
+    } catch (maths::Exception&) {
+        rejected = true;
+    }
+    check(rejected,"bad index detection");
+
+    // Write errors in the parallel tile loops are reported by an exception.
+
+    std::ostringstream failing;
+    rejected = false;
+    try {
+        maths::ChunkedMatrixWriter writer(failing,M,16,16);
+        failing.setstate(std::ios::badbit);
+        writer.write(M);
+    } catch (maths::Exception&) {
+        rejected = true;
+    }
+    check(rejected,"write error detection");
+
+    return 0;
+}
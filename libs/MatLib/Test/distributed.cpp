@@ -0,0 +1,166 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#include <MatLibConfig.h>
+#include <matrix.h>
+#include <symmatrix.h>
+#include <matvectOps.h>
+#include <distributed_matrix.h>
+
+using namespace OpenMEEG;
+
+void check(const bool cond,const char* msg) {
+    if (!cond) {
+        std::cerr << "Error: " << msg << std::endl;
+        MPI_Abort(MPI_COMM_WORLD,1);
+    }
+}
+
+// A symmetric indefinite matrix.
+
+double value(const size_t i,const size_t j) {
+    return 1.0/(1.0+i+j)+((i==j) ? ((i%2) ? 3.0 : -2.0) : 0.0);
+}
+
+int main(int argc,char** argv) {
+
+    MPIEnvironment mpi(argc,argv);
+
+    std::cout << std::endl << "========== distributed ==========" << std::endl;
+
+    // Blocks of 16 with a partial last block.
+
+    const size_t n = 150;
+    SymMatrix S(n);
+    for (size_t j=0;j<n;++j)
+        for (size_t i=0;i<=j;++i)
+            S(i,j) = value(i,j);
+
+    DistributedSymMatrix D(n,MPI_COMM_WORLD,16);
+    D.set(0.0);
+    size_t owned = 0;
+    for (size_t j=0;j<n;++j)
+        for (size_t i=0;i<n;++i)
+            if (D.owns(i,j) && i<=j) {
+                D(j,i) = value(i,j);
+                ++owned;
+            }
+    unsigned long total = 0,local = owned;
+    MPI_Allreduce(&local,&total,1,MPI_UNSIGNED_LONG,MPI_SUM,MPI_COMM_WORLD);
+    check(total==n*(n+1)/2,"each entry has exactly one owner");
+
+    check(D.entry(3,120)==S(3,120) && D.entry(120,3)==S(3,120),"entry");
+
+    // Fetch different entries on each process.
+
+    std::vector<size_t> rows,cols;
+    for (size_t i=mpi.rank();i<n;i+=7)
+        rows.push_back(i);
+    for (size_t j=n-1-mpi.rank();j<n;j-=5)
+        cols.push_back(j);
+    const Matrix F = D.fetch(rows,cols);
+    for (size_t j=0;j<cols.size();++j)
+        for (size_t i=0;i<rows.size();++i)
+            check(F(i,j)==S(rows[i],cols[j]),"fetch");
+
+    const SymMatrix G = D.gather();
+    if (mpi.rank()==0)
+        check((Matrix(G)-Matrix(S)).frobenius_norm()==0.0,"gather");
+
+    // Parallel binary write and read, and the other formats.
+
+    D.save("distributed.bin");
+    DistributedSymMatrix D1;
+    D1.load("distributed.bin");
+    check(D1.nlin()==n,"binary load");
+    if (mpi.rank()==0) {
+        SymMatrix S1;
+        S1.load("distributed.bin");
+        check((Matrix(S1)-Matrix(S)).frobenius_norm()==0.0,"parallel binary write");
+    }
+    for (size_t j=0;j<n;++j)
+        for (size_t i=0;i<=j;++i)
+            if (D1.owns(i,j))
+                check(D1(i,j)==S(i,j),"parallel binary read");
+
+    D.save("distributed.txt");
+    DistributedSymMatrix D2;
+    D2.load("distributed.txt");
+    const SymMatrix G2 = D2.gather();
+    if (mpi.rank()==0)
+        check((Matrix(G2)-Matrix(S)).frobenius_norm()<=1e-5*Matrix(S).frobenius_norm(),"text save and load");
+
+    // Factorization and solution.
+
+    Matrix B(n,3);
+    for (size_t j=0;j<B.ncol();++j)
+        for (size_t i=0;i<n;++i)
+            B(i,j) = cos(double(i*(j+1)));
+    Matrix B1(B,DEEP_COPY);
+    const Matrix X = S.solveLin(B1);
+    D1.factorize();
+    D1.solveLin(B);
+    check((B-X).frobenius_norm()<=1e-10*X.frobenius_norm(),"distributed solve");
+
+    // A saddle point matrix, whose leading blocks are singular (as those of the head matrices).
+
+    const size_t m = 40;
+    SymMatrix Z(n);
+    DistributedSymMatrix DZ(n,MPI_COMM_WORLD,16);
+    for (size_t j=0;j<n;++j)
+        for (size_t i=0;i<=j;++i) {
+            Z(i,j) = (j<m) ? 0.0 : value(i,j)+((j==i+m) ? 1.0 : 0.0);
+            if (DZ.owns(i,j))
+                DZ(i,j) = Z(i,j);
+        }
+    Matrix RZ(n,2);
+    for (size_t j=0;j<RZ.ncol();++j)
+        for (size_t i=0;i<n;++i)
+            RZ(i,j) = sin(double(i+j));
+    Matrix XZ(RZ,DEEP_COPY);
+    DZ.factorize();
+    DZ.solveLin(XZ);
+    check((Matrix(Z)*XZ-RZ).frobenius_norm()<=1e-10*RZ.frobenius_norm(),"distributed solve with pivoting");
+
+    return 0;
+}
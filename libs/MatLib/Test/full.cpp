@@ -44,6 +44,9 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #include <matrix.h>
 #include <generic_test.hpp>
 
+static unsigned released = 0;
+static void release_storage(void* storage) { ++released; delete[] static_cast<double*>(storage); }
+
 int main () {
 
     using namespace OpenMEEG;
@@ -133,5 +136,62 @@ int main () {
         std::cerr << "Error: PseudoInverse is WRONG-1" << std::endl;
         exit(1);
     }
+
+    // External storage: no copy, released once with the last reference.
+    {
+        double* storage = new double[6];
+        for (unsigned i=0;i<6;++i)
+            storage[i] = i;
+        Matrix E(2,3,new LinOpValue(storage,release_storage,storage));
+        Matrix E1 = E;
+        E(1,2) = 10.0;
+        if (E.data()!=storage || E1(1,2)!=10.0 || E1(1,1)!=3.0) {
+            std::cerr << "Error: external storage is WRONG" << std::endl;
+            exit(1);
+        }
+    }
+    if (released!=1) {
+        std::cerr << "Error: external storage released " << released << " times" << std::endl;
+        exit(1);
+    }
+
+    // Allocator: aligned storage, huge pages and first touch zeroing, statistics,
+    // and an exception (not an exit) when the memory is exhausted.
+    {
+        const maths::Allocator::Statistics before = maths::Allocator::statistics();
+        maths::Allocator allocator(maths::Allocator::TRANSPARENT_HUGE_PAGES,maths::Allocator::INTERLEAVED);
+        maths::Allocator::set(&allocator);
+        {
+            Matrix small(3,5);
+            Matrix large(1000,600);
+            maths::Allocator::set(0);
+            if (reinterpret_cast<size_t>(small.data())%maths::Allocator::alignment!=0 ||
+                reinterpret_cast<size_t>(large.data())%maths::Allocator::alignment!=0) {
+                std::cerr << "Error: matrix storage is not aligned" << std::endl;
+                exit(1);
+            }
+            if (large.frobenius_norm()!=0.0) {
+                std::cerr << "Error: first touch did not zero the storage" << std::endl;
+                exit(1);
+            }
+        }
+        const maths::Allocator::Statistics after = maths::Allocator::statistics();
+        if (after.allocations!=before.allocations+2 || after.deallocations!=before.deallocations+2 || after.bytes_in_use!=before.bytes_in_use) {
+            std::cerr << "Error: wrong allocation statistics" << std::endl;
+            exit(1);
+        }
+
+        bool thrown = false;
+        try {
+            Matrix huge(static_cast<size_t>(1)<<20,static_cast<size_t>(1)<<30);
+        } catch (std::bad_alloc&) {
+            thrown = true;
+        }
+        if (!thrown || maths::Allocator::statistics().failures!=after.failures+1) {
+            std::cerr << "Error: failed allocations must throw" << std::endl;
+            exit(1);
+        }
+        maths::Allocator::report(std::cout);
+    }
     return 0;
 }
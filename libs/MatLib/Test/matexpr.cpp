@@ -0,0 +1,137 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include <MatLibConfig.h>
+#include <matrix.h>
+#include <symmatrix.h>
+#include <sparse_matrix.h>
+#include <matexpr.h>
+#include <matvectOps.h>
+
+using namespace OpenMEEG;
+
+void check(const bool cond,const char* msg) {
+    if (!cond) {
+        std::cerr << "Error: " << msg << std::endl;
+        exit(1);
+    }
+}
+
+double rel_error(const Matrix& A,const Matrix& B) {
+    return (A-B).frobenius_norm()/B.frobenius_norm();
+}
+
+int main () {
+
+    std::cout << std::endl << "========== matrix expressions ==========" << std::endl;
+
+    const size_t n = 60;
+    SymMatrix S(n);
+    for (size_t i=0;i<n;++i)
+        for (size_t j=i;j<n;++j)
+            S(i,j) = 1.0/(1.0+i+j);
+
+    Matrix L(5,n);
+    SparseMatrix sp(5,n);
+    for (size_t i=0;i<L.nlin();++i)
+        for (size_t j=0;j<n;++j) {
+            L(i,j) = sin(1.0+i*j);
+            if ((i+j)%7==0)
+                sp(i,j) = L(i,j);
+        }
+
+    const Matrix FS(S);
+
+    // Few sources (right association) and many sources (left association).
+
+    const size_t nsources[] = { 2, 40 };
+    for (unsigned k=0;k<2;++k) {
+        Matrix R(n,nsources[k]);
+        Matrix C(L.nlin(),R.ncol());
+        for (size_t j=0;j<R.ncol();++j) {
+            for (size_t i=0;i<n;++i)
+                R(i,j) = cos(0.5*i+j);
+            for (size_t i=0;i<C.nlin();++i)
+                C(i,j) = i+0.1*j;
+        }
+
+        const maths::SymProduct<Matrix> P = maths::product(L,S,R);
+        check(P.left_first()==(k==1),"association order");
+
+        const Matrix ref = (L*FS)*R;
+        check(rel_error(P.eval(),ref)<1e-12,"dense product");
+        check(rel_error(C+P,C+ref)<1e-12,"dense product with accumulation");
+
+        const Matrix sref = (Matrix(sp)*FS)*R;
+        const Matrix G = C+maths::product(sp,S,R);
+        check(rel_error(maths::product(sp,S,R).eval(),sref)<1e-12,"sparse product");
+        check(rel_error(G,C+sref)<1e-12,"sparse product with accumulation");
+        check(C(1,1)==1.1,"accumulation must not modify its operand");
+    }
+
+    // Mixed precision: single precision products checked against a double precision probe,
+    // and single precision factorization refined in double precision.
+
+    SymMatrix D(n);
+    for (size_t i=0;i<n;++i)
+        for (size_t j=i;j<n;++j)
+            D(i,j) = (i==j) ? 4.0 : 1.0/(1.0+i+j);
+
+    Matrix R(n,40);
+    for (size_t j=0;j<R.ncol();++j)
+        for (size_t i=0;i<n;++i)
+            R(i,j) = cos(0.5*i+j);
+
+    const Matrix mref = (L*Matrix(D))*R;
+    check(rel_error(maths::product(L,D,R,MIXED_PRECISION).eval(),mref)<1e-5,"mixed precision product");
+    check(rel_error(maths::SymProduct<Matrix>(L,D,R,MIXED_PRECISION,1e-14).eval(),mref)<1e-12,"mixed precision fallback");
+
+    Matrix B1(R);
+    Matrix B2(R);
+    const Matrix X1 = D.solveLin(B1);
+    const Matrix X2 = D.solveLin(B2,MIXED_PRECISION);
+    check(rel_error(X2,X1)<1e-12,"mixed precision solve");
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include <random.h>
+
+using namespace OpenMEEG;
+
+void check(const bool cond,const char* msg) {
+    if (!cond) {
+        std::cerr << "Error: " << msg << std::endl;
+        exit(1);
+    }
+}
+
+int main () {
+
+    std::cout << std::endl << "========== random ==========" << std::endl;
+
+    //  Known answers of Philox4x32-10 (Random123).
+
+    uint32_t out[4];
+    const uint32_t zero[4] = { 0, 0, 0, 0 };
+    maths::Philox(0).block(zero,out);
+    check(out[0]==0x6627e8d5U && out[1]==0xe169c58dU && out[2]==0xbc57ac4cU && out[3]==0x9b00dbd8U,"known answer (zero)");
+
+    const uint32_t ones[4] = { 0xffffffffU, 0xffffffffU, 0xffffffffU, 0xffffffffU };
+    maths::Philox(0xffffffffffffffffULL).block(ones,out);
+    check(out[0]==0x408f276dU && out[1]==0x41c83b0eU && out[2]==0xa20bc7c6U && out[3]==0x6d5451fdU,"known answer (ones)");
+
+    //  Moments of the gaussians, reproducibility and seed dependence.
+
+    const maths::Philox rng(42);
+    const unsigned n = 200000;
+    double sum = 0.0;
+    double sum2 = 0.0;
+    for (unsigned k=0;k<n;++k) {
+        double g0,g1;
+        rng.gaussians(k,3,g0,g1);
+        sum  += g0+g1;
+        sum2 += g0*g0+g1*g1;
+    }
+    const double mean = sum/(2*n);
+    const double var  = sum2/(2*n)-mean*mean;
+    check(std::abs(mean)<0.01 && std::abs(var-1.0)<0.01,"gaussian moments");
+
+    double a0,a1,b0,b1;
+    rng.gaussians(123,4,a0,a1);
+    maths::Philox(42).gaussians(123,4,b0,b1);
+    check(a0==b0 && a1==b1,"reproducibility");
+    maths::Philox(43).gaussians(123,4,b0,b1);
+    check(a0!=b0 && a1!=b1,"seed dependence");
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
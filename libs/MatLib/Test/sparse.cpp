@@ -38,6 +38,8 @@ knowledge of the CeCILL-B license and that you accept its terms.
 */
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
 #include <MatLibConfig.h>
 #include <sparse_matrix.h>
@@ -88,10 +90,49 @@ int main () {
         exit(1);
     }
 
+    // Product with an empty SymMatrix.
+    const Matrix Mempty = SparseMatrix(3,0)*SymMatrix(static_cast<size_t>(0));
+    if ( Mempty.nlin()!=3 || Mempty.ncol()!=0 ) {
+        std::cerr << "Error: Sparse*SymMatrix with an empty SymMatrix is WRONG" << std::endl;
+        exit(1);
+    }
+
     std::cout << std::endl << "========== fast sparse matrices ==========" << std::endl;
     std::cout << spM;
     FastSparseMatrix fspM(spM);
     std::cout << fspM;
 
+    // Assembly from triplets: duplicates are summed, whatever their order.
+    FastSparseMatrix::Triplets triplets;
+    SparseMatrix spM3(10,7);
+    for ( unsigned i=0;i<40;++i) {
+        n = (n*1237+1493)%1723;
+        const double value = 1.0/(1.0+n%13);
+        triplets.push_back(FastSparseMatrix::Triplet(n%10,(n/10)%7,value));
+        spM3(n%10,(n/10)%7) += value;
+    }
+    const FastSparseMatrix fspM3(10,7,triplets);
+    std::reverse(triplets.begin(),triplets.end());
+    const FastSparseMatrix fspM4(10,7,triplets);
+    Matrix U3(7,3);
+    for ( unsigned i=0;i<U3.nlin();++i)
+        for ( unsigned j=0;j<U3.ncol();++j)
+            U3(i,j) = 0.5+i-2.0*j;
+    Vector v3(7);
+    v3.set(0.25);
+    v3(2) = -1.;
+    Mzero = fspM3*U3-spM3*U3;
+    Vzero = fspM3*v3-spM3*v3;
+    if ( fspM3.nnz()!=spM3.size() || Mzero.frobenius_norm()+Vzero.norm()>eps || std::abs(fspM3.frobenius_norm()-spM3.frobenius_norm())>eps ) {
+        std::cerr << "Error: FastSparseMatrix assembly from triplets is WRONG" << std::endl;
+        exit(1);
+    }
+    for ( unsigned i=0;i<fspM3.nlin();++i)
+        for ( size_t k=fspM3.row_begin(i);k<fspM3.row_end(i);++k)
+            if ( fspM3.column(k)!=fspM4.column(k) || fspM3.value(k)!=fspM4.value(k) ) {
+                std::cerr << "Error: FastSparseMatrix assembly depends on the order of the triplets" << std::endl;
+                exit(1);
+            }
+
     return 0;
 }
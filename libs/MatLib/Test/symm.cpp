@@ -38,11 +38,14 @@ knowledge of the CeCILL-B license and that you accept its terms.
 */
 
 #include <cmath>
+#include <cstdlib>
 #include <iostream>
 
 #include <MatLibConfig.h>
 #include <symmatrix.h>
 #include <matrix.h>
+#include <sparse_matrix.h>
+#include <matvectOps.h>
 #include <generic_test.hpp>
 
 int main() {
@@ -64,5 +67,42 @@ int main() {
     std::cout << "Matrice R : " << std::endl;
     R.info();
 
+    // Products are computed by panels of columns: use a size with several panels
+    // and compare with the products of the expanded matrices.
+
+    const unsigned n = 800;
+    SymMatrix A(n);
+    SymMatrix B(n);
+    Matrix    M(5,n);
+    SparseMatrix sp(7,n);
+    for (unsigned i=0;i<n;++i) {
+        for (unsigned j=i;j<n;++j) {
+            A(i,j) = 1.0/(1.0+i+j)+((i==j) ? 1.0 : 0.0);
+            B(i,j) = cos(0.1*i+0.3*j);
+        }
+        for (unsigned k=0;k<M.nlin();++k)
+            M(k,i) = sin(1.0+k*i);
+    }
+    for (unsigned k=0;k<3*n;k+=7)
+        sp(k%7,(k*13)%n) += 0.5+k;
+
+    const Matrix FA(A);
+    const Matrix FB(B);
+    const Matrix FM(M.transpose());
+    const double errs[] = {
+        (Matrix(A*B)-Matrix(SymMatrix(FA*FB))).frobenius_norm()/(FA*FB).frobenius_norm(),
+        (A*FM-FA*FM).frobenius_norm()/(FA*FM).frobenius_norm(),
+        (M*A-M*FA).frobenius_norm()/(M*FA).frobenius_norm(),
+        (sp*A-Matrix(sp)*FA).frobenius_norm()/(Matrix(sp)*FA).frobenius_norm()
+    };
+    const char* names[] = { "SymMatrix*SymMatrix", "SymMatrix*Matrix", "Matrix*SymMatrix", "SparseMatrix*SymMatrix" };
+    for (unsigned i=0;i<4;++i) {
+        std::cout << names[i] << " relative error: " << errs[i] << std::endl;
+        if (errs[i]>eps) {
+            std::cerr << "Error: " << names[i] << " differs from the product of full matrices." << std::endl;
+            exit(1);
+        }
+    }
+
     return 0;
 }
@@ -107,3 +107,13 @@ ENDIF()
 
 SET(HAVE_LAPACK TRUE)
 SET(HAVE_BLAS TRUE)
+
+#   Functions setting the number of threads of the BLAS backend (see thread_budget.h).
+
+IF (NOT USE_MKL)
+    INCLUDE(CheckFunctionExists)
+    SET(CMAKE_REQUIRED_LIBRARIES ${LAPACK_LIBRARIES})
+    CHECK_FUNCTION_EXISTS(openblas_set_num_threads HAVE_OPENBLAS_SET_NUM_THREADS)
+    CHECK_FUNCTION_EXISTS(bli_thread_set_num_threads HAVE_BLI_THREAD_SET_NUM_THREADS)
+    SET(CMAKE_REQUIRED_LIBRARIES)
+ENDIF()
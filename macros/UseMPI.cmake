@@ -0,0 +1,12 @@
+OPTION(USE_MPI "Distribute the head matrix assembly and the adjoint gains over MPI processes" OFF)
+
+IF(USE_MPI)
+    FIND_PACKAGE(MPI REQUIRED)
+    INCLUDE_DIRECTORIES(${MPI_CXX_INCLUDE_PATH})
+    ADD_DEFINITIONS(-DUSE_MPI)
+    IF(NOT MPIEXEC)
+        SET(MPIEXEC ${MPIEXEC_EXECUTABLE})
+    ENDIF()
+    SET(MPI_TEST_PROCESSES 4 CACHE STRING "Number of processes of the MPI tests")
+    MARK_AS_ADVANCED(MPI_TEST_PROCESSES)
+ENDIF(USE_MPI)
@@ -41,6 +41,7 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #define OPENMEEG_ANALYTICS_H
 
 #include <mesh.h>
+#include <geometry_view.h>
 
 #ifdef HAVE_ISNORMAL_IN_NAMESPACE_STD
 #include <cmath>
@@ -75,100 +76,97 @@ namespace OpenMEEG {
         return (std::isnormal(arg) && arg > 0.0) ? log(arg) : fabs(log(norm2p1x / norm2p0x));
     }
 
-    class OPENMEEG_EXPORT analyticS
+    /// Base of the kernels working on a triangle: they read the setup of the triangle either from the table
+    /// of a GeometryView (no computation at all) or from their own copy, when initialized from a triangle.
+
+    class OPENMEEG_EXPORT analyticTriangle
     {
-        Vect3 p0, p1, p2; //!< vertices of the triangle
-        Vect3 p2p1, p1p0, p0p2;
-        Vect3 nu0, nu1, nu2;
-        Vect3 n;
-        double norm2p2p1, norm2p1p0, norm2p0p2;
-        double tanTHETA0m, tanTHETA0p, tanTHETA1m, tanTHETA1p, tanTHETA2m, tanTHETA2p;
-        
-        void init_aux() {
-            nu0 = (p1p0^n);
-            nu1 = (p2p1^n);
-            nu2 = (p0p2^n);
-            nu0.normalize();
-            nu1.normalize();
-            nu2.normalize();
+    protected:
+        KernelSetup        own;
+        const KernelSetup* setup;
+
+        analyticTriangle(): setup(&own) {}
+        analyticTriangle(const analyticTriangle& a): own(a.own), setup((a.setup == &a.own) ? &own : a.setup) {}
+
+        analyticTriangle& operator=(const analyticTriangle& a) {
+            own   = a.own;
+            setup = (a.setup == &a.own) ? &own : a.setup;
+            return *this;
+        }
+
+        void use(const KernelSetup& s) { setup = &s; }
+
+        void compute(const Vect3& p0, const Vect3& p1, const Vect3& p2, const Vect3& n, const double area) {
+            own.init(p0, p1, p2, n, area);
+            setup = &own;
         }
 
+        void compute(const Triangle& T) { compute(T.s1(), T.s2(), T.s3(), T.normal(), T.area()); }
+    };
+
+    class OPENMEEG_EXPORT analyticS: public analyticTriangle
+    {
     public:
         analyticS(){}
         ~analyticS(){}
-        void init(const Triangle& T)
-        {
-            // all computations needed when the first triangle of integration is changed
-            p0 = T.s1();
-            p1 = T.s2();
-            p2 = T.s3();
-
-            p1p0 = p1-p0; p2p1 = p2-p1; p0p2 = p0-p2;
-            norm2p1p0 = p1p0.norm(); norm2p2p1 = p2p1.norm(); norm2p0p2 = p0p2.norm();
 
-            n = T.normal(); // since triangle's normal is already normalized
-            init_aux();
-        }
+        // all computations needed when the first triangle of integration is changed
+        void init(const Triangle& T)          { compute(T); }
+        void init(const KernelSetup& s)       { use(s);     }
+        void init(const GeometryView& view, const unsigned t) { use(view.setup(t)); }
 
         void init( const Vect3& v0, const Vect3& v1, const Vect3& v2 )
         {
-            // all computations needed when the first triangle of integration is changed
-            p0 = v0;
-            p1 = v1;
-            p2 = v2;
-            p1p0 = p1-p0; p2p1 = p2-p1; p0p2 = p0-p2;
-            norm2p1p0 = p1p0.norm(); norm2p2p1 = p2p1.norm(); norm2p0p2 = p0p2.norm();
-
-            n = p1p0^p0p2;
-            n /= n.norm();
-            init_aux();
+            Vect3 n = (v1-v0)^(v0-v2);
+            const double norm = n.norm();
+            n /= norm;
+            compute(v0, v1, v2, n, 0.5*norm);
         }
 
         inline double f(const Vect3& x) const
         {
             // analytical value of the internal integral of S operator at point X
-            const Vect3& p0x = p0-x;
-            const Vect3& p1x = p1-x;
-            const Vect3& p2x = p2-x;
+            const KernelSetup& s = *setup;
+            const Vect3& p0x = s.p0-x;
+            const Vect3& p1x = s.p1-x;
+            const Vect3& p2x = s.p2-x;
             const double norm2p0x = p0x.norm();
             const double norm2p1x = p1x.norm();
             const double norm2p2x = p2x.norm();
 
-            const double g0 = integral_simplified_green(p0x, norm2p0x, p1x, norm2p1x, p1p0, norm2p1p0);
-            const double g1 = integral_simplified_green(p1x, norm2p1x, p2x, norm2p2x, p2p1, norm2p2p1);
-            const double g2 = integral_simplified_green(p2x, norm2p2x, p0x, norm2p0x, p0p2, norm2p0p2);
+            const double g0 = integral_simplified_green(p0x, norm2p0x, p1x, norm2p1x, s.p1p0, s.norm2p1p0);
+            const double g1 = integral_simplified_green(p1x, norm2p1x, p2x, norm2p2x, s.p2p1, s.norm2p2p1);
+            const double g2 = integral_simplified_green(p2x, norm2p2x, p0x, norm2p0x, s.p0p2, s.norm2p0p2);
 
-            const double alpha = p0x*n;
+            const double alpha = p0x*s.n;
 
-            return (((p0x*nu0)*g0+(p1x*nu1)*g1+(p2x*nu2)*g2)-alpha*x.solangl(p0, p1, p2));
+            return (((p0x*s.nu0)*g0+(p1x*s.nu1)*g1+(p2x*s.nu2)*g2)-alpha*x.solangl(s.p0, s.p1, s.p2));
         }
     };
 
-    class OPENMEEG_EXPORT analyticD
+    class OPENMEEG_EXPORT analyticD: public analyticTriangle
     {
-        Vect3 v1, v2, v3;
         unsigned i;
-        double aire;
 
     public:
         analyticD()  {}
         ~analyticD() {}
         inline void init( const Triangle& T, const Vertex& V) {
-            v1 = T.s1();
-            v2 = T.s2();
-            v3 = T.s3();
-            (V == v1) ? i = 1 : (V == v2) ? i = 2 : i = 3;
-            aire = T.area();
+            compute(T);
+            (V == own.p0) ? i = 1 : (V == own.p1) ? i = 2 : i = 3;
+        }
+        inline void init(const GeometryView& view, const unsigned t, const int32_t v) {
+            use(view.setup(t));
+            i = view.corner_of(t, v)+1;
         }
 
         inline double f(const Vect3& x) const {
             //Analytical value of the inner integral in operator D. See DeMunck article for further details.
             //  for non-optimized version of operator D
             //  returns the value of the inner integral of operator D on a triangle used for a P1 function
-            const Vect3& Y1 = v1-x;
-            const Vect3& Y2 = v2-x;
-            const Vect3& Y3 = v3-x;
-
+            const Vect3& Y1 = setup->p0-x;
+            const Vect3& Y2 = setup->p1-x;
+            const Vect3& Y3 = setup->p2-x;
             const double y1 = Y1.norm();
             const double y2 = Y2.norm();
             const double y3 = Y3.norm();
@@ -198,29 +196,23 @@ namespace OpenMEEG {
     };
 
 
-    class OPENMEEG_EXPORT analyticD3
+    class OPENMEEG_EXPORT analyticD3: public analyticTriangle
     {
-        Vertex v1, v2, v3;
-        double aire;
-
     public:
         analyticD3()  {}
         ~analyticD3() {}
-        inline void init( const Triangle& T) {
-            v1 = T.s1();
-            v2 = T.s2();
-            v3 = T.s3();
-            aire = T.area();
-        }
+        inline void init( const Triangle& T)    { compute(T); }
+        inline void init(const KernelSetup& s) { use(s);     }
+        inline void init(const GeometryView& view, const unsigned t) { use(view.setup(t)); }
 
         inline Vect3 f(const Vect3& x) const {
             //Analytical value of the inner integral in operator D. See DeMunck article for further details.
             //  for non-optimized version of operator D
             //  returns in a vector, the inner integrals of operator D on a triangle viewed as a part of the 3
             //  P1 functions it has a part in.
-            Vect3 Y1 = v1-x;
-            Vect3 Y2 = v2-x;
-            Vect3 Y3 = v3-x;
+            Vect3 Y1 = setup->p0-x;
+            Vect3 Y2 = setup->p1-x;
+            Vect3 Y3 = setup->p2-x;
             double y1 = Y1.norm();
             double y2 = Y2.norm();
             double y3 = Y3.norm();
@@ -279,43 +271,34 @@ namespace OpenMEEG {
         }
     };
 
-    class OPENMEEG_EXPORT analyticDipPotDer
+    class OPENMEEG_EXPORT analyticDipPotDer: public analyticTriangle
     {
         Vect3 q, r0;
-        Vect3 H0, H1, H2;
-        Vect3 H0p0DivNorm2, H1p1DivNorm2, H2p2DivNorm2, n;
 
     public:
         analyticDipPotDer(){}
         ~analyticDipPotDer(){}
         inline void init( const Triangle& T, const Vect3 &_q, const Vect3& _r0) {
-            q = _q;
+            compute(T);
+            q  = _q;
             r0 = _r0;
+        }
 
-            Vect3 p0, p1, p2, p1p0, p2p1, p0p2, p1p0n, p2p1n, p0p2n, p1H0, p2H1, p0H2;
-            p0 = T.s1();
-            p1 = T.s2();
-            p2 = T.s3();
-
-            p1p0 = p0-p1; p2p1 = p1-p2; p0p2 = p2-p0;
-            p1p0n = p1p0; p1p0n.normalize(); p2p1n = p2p1; p2p1n.normalize(); p0p2n = p0p2; p0p2n.normalize();
-
-            p1H0 = (p1p0*p2p1n)*p2p1n; H0 = p1H0+p1; H0p0DivNorm2 = p0-H0; H0p0DivNorm2 = H0p0DivNorm2/H0p0DivNorm2.norm2();
-            p2H1 = (p2p1*p0p2n)*p0p2n; H1 = p2H1+p2; H1p1DivNorm2 = p1-H1; H1p1DivNorm2 = H1p1DivNorm2/H1p1DivNorm2.norm2();
-            p0H2 = (p0p2*p1p0n)*p1p0n; H2 = p0H2+p0; H2p2DivNorm2 = p2-H2; H2p2DivNorm2 = H2p2DivNorm2/H2p2DivNorm2.norm2();
-
-            n = -p1p0^p0p2;
-            n.normalize();
+        inline void init(const GeometryView& view, const unsigned t, const Vect3 &_q, const Vect3& _r0) {
+            use(view.setup(t));
+            q  = _q;
+            r0 = _r0;
         }
 
         inline Vect3 f(const Vect3& x) const
         {
-            Vect3 P1part(H0p0DivNorm2*(x-H0), H1p1DivNorm2*(x-H1), H2p2DivNorm2*(x-H2));
+            const KernelSetup& s = *setup;
+            Vect3 P1part(s.H0p0DivNorm2*(x-s.H0), s.H1p1DivNorm2*(x-s.H1), s.H2p2DivNorm2*(x-s.H2));
 
             // RK: B = n.grad_x(A) with grad_x(A)= q/||^3 - 3r(q.r)/||^5
             Vect3 r = x-r0;
             double rn = r.norm();
-            double EMpart = n*(q/pow(rn, 3.)-3*(q*r)*r/pow(rn, 5.));
+            double EMpart = s.dn*(q/pow(rn, 3.)-3*(q*r)*r/pow(rn, 5.));
 
             return -EMpart*P1part; // RK: why - sign ?
         }
@@ -36,6 +36,7 @@ The fact that you are presently reading this means that you have had
 knowledge of the CeCILL-B license and that you accept its terms.
 */
 
+#include <cstdlib>
 #include <fstream>
 #include <cstring>
 #include <sstream>
@@ -43,6 +44,7 @@ knowledge of the CeCILL-B license and that you accept its terms.
 
 #include <mesh.h>
 #include <integrator.h>
+#include <checkpoint.h>
 #include <cpuChrono.h>
 #include <assemble.h>
 #include <sensors.h>
@@ -57,7 +59,43 @@ void getHelp(char** argv);
 
 int main(int argc, char** argv)
 {
+#ifdef USE_MPI
+    MPIEnvironment mpi(argc, argv);
+#endif
+
     print_version(argv[0]);
+    thread_option(argc, argv);
+
+    // Optional timing report (json, csv or text depending on the suffix)
+    const std::string timings_file = extract_option(argc, argv, "-timings");
+    if ( timings_file != "" ) {
+        timings::enable(argv[0]);
+    }
+
+    // Optional integration order (default 3)
+    const std::string gauss_order_option = extract_option(argc, argv, "-gauss-order");
+    if ( gauss_order_option != "" ) {
+        // Only the rules of orders 0 to 3 (3, 6, 7 and 16 points) exist.
+        char* end;
+        const long order = strtol(gauss_order_option.c_str(), &end, 10);
+        if ( *end != '\0' || end == gauss_order_option.c_str() || order < 0 || order > 3 ) {
+            std::cerr << "Invalid Gauss order " << gauss_order_option << ": it must be 0, 1, 2 or 3." << endl;
+            exit(1);
+        }
+        gauss_order = order;
+    }
+
+    // Optional accuracy target of the quadratures (the order is then chosen for each pair of triangles)
+    const std::string accuracy_option = extract_option(argc, argv, "-quadrature-accuracy");
+    if ( accuracy_option != "" ) {
+        QuadraturePolicy::set_accuracy(atof(accuracy_option.c_str()));
+    }
+
+    // Optional checkpoint directory (long assemblies then restart where they stopped)
+    const std::string checkpoint_dir = extract_option(argc, argv, "-checkpoint");
+    if ( checkpoint_dir != "" ) {
+        Checkpoint::set_directory(checkpoint_dir);
+    }
 
     bool OLD_ORDERING = false;
     if ( argc<2) {
@@ -74,6 +112,13 @@ int main(int argc, char** argv)
 
     disp_argv(argc, argv);
 
+#ifdef USE_MPI
+    if ( mpi.size() > 1 && strcmp(argv[1], "-HeadMat") && strcmp(argv[1], "-HM") && strcmp(argv[1], "-hm") ) {
+        std::cerr << "Only the head matrix (-HM) is assembled by several MPI processes." << endl;
+        exit(1);
+    }
+#endif
+
     // Start Chrono
     cpuChrono C;
     C.start();
@@ -104,8 +149,19 @@ int main(int argc, char** argv)
         }
 
         // Assembling Matrix from discretization :
+    #ifdef USE_MPI
+        if ( mpi.size() > 1 ) {
+            // Each process assembles the entries it owns, the (binary) file is written in parallel.
+            DistributedHeadMat HM(geo, gauss_order);
+            HM.save(argv[4]);
+        } else {
+            HeadMat HM(geo, gauss_order);
+            HM.save(argv[4]);
+        }
+    #else
         HeadMat HM(geo, gauss_order);
         HM.save(argv[4]);
+    #endif
     }
 
     /*********************************************************************************************
@@ -518,14 +574,37 @@ int main(int argc, char** argv)
     // Stop Chrono
     C.stop();
     C.dispEllapsed();
+
+    // The rules are only counted with -timings.
+    if ( QuadraturePolicy::enabled() && timings::enabled() ) {
+        QuadraturePolicy::report(std::cout);
+    }
+
+    // The results are saved: the checkpoints are no longer needed.
+    if ( Checkpoint::enabled() ) {
+        Checkpoint::discard_all();
+    }
+
+    if ( timings_file != "" ) {
+        timings::save_report(timings_file);
+    }
 }
 
 void getHelp(char** argv) {
     cout << argv[0] <<" [-option] [filepaths...]" << endl << endl;
+    cout << "   -timings file : write a timing report (file.json, file.csv or text) of the computation phases." << endl;
+    cout << "   -threads n : number of threads used by the assembly and by the linear algebra (default OMP_NUM_THREADS)." << endl;
+    cout << "   -gauss-order n : order (0 to 3) of the Gauss quadrature used for the integrals (default 3)." << endl;
+    cout << "   -quadrature-accuracy eps : choose the order of each integral between two triangles from their distance," << endl;
+    cout << "                              for a relative accuracy eps (e.g. 1e-4), the Gauss order being the maximum." << endl;
+    cout << "                              With -timings, the number of integrals computed with each rule is also printed." << endl;
+    cout << "   -checkpoint dir : save the completed blocks of the HeadMat, DipSourceMat and Head2MEGMat assemblies in the" << endl;
+    cout << "                     existing directory dir, so that a run interrupted before its end restarts from them." << endl << endl;
 
     cout << "option :" << endl;
     cout << "   -HeadMat, -HM, -hm :   " << endl;
     cout << "       Compute Head Matrix for Symmetric BEM (left-hand side of linear system)." << endl;
+    cout << "       When run by several MPI processes (mpirun), the matrix is assembled in parallel by all of them." << endl;
     cout << "             Arguments :" << endl;
     cout << "               geometry file (.geom)" << endl;
     cout << "               conductivity file (.cond)" << endl;
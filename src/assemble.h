@@ -48,14 +48,29 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #include <geometry.h>
 #include <sensors.h>
 
+#ifdef USE_MPI
+#include <distributed_matrix.h>
+#endif
+
 namespace OpenMEEG {
 
+    class GeometryView;
+
     class OPENMEEG_EXPORT HeadMat: public virtual SymMatrix {
     public:
         HeadMat (const Geometry& geo, const unsigned gauss_order=3);
         virtual ~HeadMat () {};
     };
 
+#ifdef USE_MPI
+    /// Head matrix distributed over the processes of comm, each one assembling the entries it owns.
+
+    class OPENMEEG_EXPORT DistributedHeadMat: public DistributedSymMatrix {
+    public:
+        DistributedHeadMat (const Geometry& geo, const unsigned gauss_order=3, MPI_Comm comm=MPI_COMM_WORLD);
+    };
+#endif
+
     class OPENMEEG_EXPORT SurfSourceMat: public virtual Matrix {
     public:
         SurfSourceMat (const Geometry& geo, Mesh& sources, const unsigned gauss_order=3);
@@ -66,6 +81,12 @@ namespace OpenMEEG {
     public:
         DipSourceMat (const Geometry& geo, const Matrix& dipoles, const unsigned gauss_order=3,
                       const bool adapt_rhs = true, const std::string& domain_name = "");
+
+        /// Same, reusing the view of geo (see GeometryView) and with the named checkpoint (see Checkpoint):
+        /// callers assembling several groups of dipoles give each group its own checkpoint.
+
+        DipSourceMat (const GeometryView& view, const Geometry& geo, const Matrix& dipoles, const unsigned gauss_order,
+                      const bool adapt_rhs, const std::string& domain_name, const std::string& checkpoint);
         virtual ~DipSourceMat () {};
     };
 
@@ -40,28 +40,63 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+#include <sstream>
+#include <algorithm>
+
 #include <operators.h>
+#include <checkpoint.h>
 #include <om_utils.h>
 
 namespace OpenMEEG {
 
+    //  Number of points of a block of the Ferguson checkpoint.
+
+    static const unsigned points_per_block = 32;
+
     // geo = geometry 
     // mat = storage for Ferguson Matrix
     // pts = where the magnetic field is to be computed
     // n   = numbers of places where magnetic field is to be computed
     void assemble_ferguson(const Geometry& geo, Matrix& mat, const Matrix& pts)
     {
-        unsigned miit = 0; // for progressbar: mesh index iterator
-        // Computation of blocks of Ferguson's Matrix
-        for ( Geometry::const_iterator mit = geo.begin(); mit != geo.end(); ++mit, ++miit) {
-            unsigned offsetI = 0;
-            unsigned n = pts.nlin();
-            double coeff = geo.sigma_diff(*mit)*MU0/(4.*M_PI);
-            for ( unsigned i = 0; i < n; ++i) {
-                PROGRESSBAR(miit*n+i, geo.nb_meshes()*n);
-                Vect3 p(pts(i, 0), pts(i, 1), pts(i, 2));
-                operatorFerguson(p, *mit, mat, offsetI, coeff);
-                offsetI += 3;
+        TIMED_SCOPE("assemble_ferguson");
+        const GeometryView view(geo);
+        const unsigned n = pts.nlin();
+
+        //  With checkpoints, the points are handled by groups: the 3 lines of each point of a group (for all
+        //  the meshes) are a block of the checkpoint.
+
+        Checkpoint checkpoint("Ferguson", Fingerprint() << geo << pts);
+        const unsigned group = checkpoint.active() ? points_per_block : std::max(n, 1U);
+
+        for ( unsigned first = 0; first < n; first += group) {
+            const unsigned last = std::min(first+group, n);
+
+            std::ostringstream name;
+            name << "points" << first;
+            Matrix done;
+            if ( checkpoint.restore(name.str(), done) && done.nlin() == 3*(last-first) && done.ncol() == mat.ncol() ) {
+                for ( unsigned i = 0; i < done.nlin(); ++i) {
+                    mat.setlin(3*first+i, done.getlin(i));
+                }
+                continue;
+            }
+
+            unsigned miit = 0; // for progressbar: mesh index iterator
+            // Computation of blocks of Ferguson's Matrix
+            for ( Geometry::const_iterator mit = geo.begin(); mit != geo.end(); ++mit, ++miit) {
+                unsigned offsetI = 3*first;
+                double coeff = geo.sigma_diff(*mit)*MU0/(4.*M_PI);
+                for ( unsigned i = first; i < last; ++i) {
+                    PROGRESSBAR(first*geo.nb_meshes()+miit*(last-first)+i-first, geo.nb_meshes()*n);
+                    Vect3 p(pts(i, 0), pts(i, 1), pts(i, 2));
+                    operatorFerguson(view, p, *mit, mat, offsetI, coeff);
+                    offsetI += 3;
+                }
+            }
+
+            if ( checkpoint.active() ) {
+                checkpoint.save(name.str(), mat.submat(3*first, 3*(last-first), 0, mat.ncol()));
             }
         }
     }
@@ -41,11 +41,17 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #endif
 
 #include <math.h>
+#include <vector>
+#include <sstream>
+#include <algorithm>
 
 #include <matrix.h>
 #include <symmatrix.h>
+#include <matvectOps.h>
 #include <geometry.h>
 #include <operators.h>
+#include <integrator.h>
+#include <checkpoint.h>
 #include <assemble.h>
 
 namespace OpenMEEG {
@@ -58,17 +64,108 @@ namespace OpenMEEG {
             for ( Mesh::const_vertex_iterator vit1 = omit->mesh().vertex_begin(); vit1 != omit->mesh().vertex_end(); ++vit1) {
                 #pragma omp parallel for
                 for ( Mesh::const_vertex_iterator vit2 = vit1; vit2 < omit->mesh().vertex_end(); ++vit2) {
-                    M((*vit1)->index(), (*vit2)->index()) += coef;
+                    if ( owns(M, (*vit1)->index(), (*vit2)->index()) ) {
+                        M((*vit1)->index(), (*vit2)->index()) += coef;
+                    }
+                }
+            }
+        }
+    }
+
+    // Indices of the unknowns of a mesh: its vertices and its triangles (unless they are not unknowns, for
+    // the outermost meshes).
+
+    static std::vector<unsigned> unknowns(const Mesh& m, const unsigned size)
+    {
+        std::vector<unsigned> indices;
+        for ( Mesh::const_vertex_iterator vit = m.vertex_begin(); vit != m.vertex_end(); ++vit) {
+            indices.push_back((*vit)->index());
+        }
+        for ( Mesh::const_iterator tit = m.begin(); tit != m.end(); ++tit) {
+            if ( tit->index() < size ) {
+                indices.push_back(tit->index());
+            }
+        }
+        return indices;
+    }
+
+    // The block of mat between the unknowns of two meshes, i.e. all the entries modified by their operators.
+
+    static Matrix block(const SymMatrix& mat, const std::vector<unsigned>& rows, const std::vector<unsigned>& cols)
+    {
+        Matrix B(rows.size(), cols.size());
+        for ( unsigned j = 0; j < cols.size(); ++j) {
+            for ( unsigned i = 0; i < rows.size(); ++i) {
+                B(i, j) = mat(rows[i], cols[j]);
+            }
+        }
+        return B;
+    }
+
+    // Add a block to mat. An entry of mat may appear twice in the block (as (i,j) and (j,i)): it is added once.
+
+    static void add_block(SymMatrix& mat, const std::vector<unsigned>& rows, const std::vector<unsigned>& cols, const Matrix& B)
+    {
+        std::vector<bool> in_rows(mat.nlin(), false);
+        std::vector<bool> in_cols(mat.nlin(), false);
+        for ( unsigned i = 0; i < rows.size(); ++i) {
+            in_rows[rows[i]] = true;
+        }
+        for ( unsigned j = 0; j < cols.size(); ++j) {
+            in_cols[cols[j]] = true;
+        }
+        for ( unsigned j = 0; j < cols.size(); ++j) {
+            for ( unsigned i = 0; i < rows.size(); ++i) {
+                const unsigned r = rows[i];
+                const unsigned c = cols[j];
+                if ( r <= c || !in_rows[c] || !in_cols[r] ) {
+                    mat(r, c) += B(i, j);
                 }
             }
         }
     }
 
+    // The operators of a pair of meshes sharing a domain in the head matrix.
+
+    template<class T>
+    static void assemble_pair(const Geometry& geo, const GeometryView& view, const Mesh& m1, const Mesh& m2, const int orientation, T& mat, const unsigned gauss_order)
+    {
+        const double K = 1.0 / (4.0 * M_PI);
+        const double Scoeff =   orientation * geo.sigma_inv(m1, m2) * K;
+        const double Dcoeff = - orientation * geo.indicator(m1, m2) * K;
+        double Ncoeff;
+
+        if ( !(m1.outermost() || m2.outermost()) ) {
+            // Computing S block first because it's needed for the corresponding N block
+            operatorS(view, m1, m2, mat, Scoeff, gauss_order);
+            Ncoeff = geo.sigma(m1, m2)/geo.sigma_inv(m1, m2);
+        } else {
+            Ncoeff = orientation * geo.sigma(m1, m2) * K;
+        }
+
+        if ( !m1.outermost() ) {
+            // Computing D block
+            operatorD(view, m1, m2, mat, Dcoeff, gauss_order);
+        }
+        if ( ( m1 != m2 ) && ( !m2.outermost() ) ) {
+            // Computing D* block
+            operatorD(view, m1, m2, mat, Dcoeff, gauss_order, true);
+        }
+
+        // Computing N block
+        operatorN(view, m1, m2, mat, Ncoeff, gauss_order);
+    }
+
     void assemble_HM(const Geometry& geo, SymMatrix& mat, const unsigned gauss_order) 
     {
+        TIMED_SCOPE("assemble_HM");
         mat = SymMatrix((geo.size()-geo.outermost_interface().nb_triangles()));
         mat.set(0.0);
-        double K = 1.0 / (4.0 * M_PI);
+        const GeometryView view(geo);
+
+        // Each pair of meshes is a block of the checkpoint: what its operators added to mat.
+
+        Checkpoint checkpoint("HeadMat", Fingerprint() << geo << gauss_order << QuadraturePolicy::accuracy());
 
         // We iterate over the meshes (or pair of domains) to fill the lower half of the HeadMat (since its symmetry)
         for ( Geometry::const_iterator mit1 = geo.begin(); mit1 != geo.end(); ++mit1) {
@@ -82,29 +179,26 @@ namespace OpenMEEG {
 
                 if ( orientation != 0 ) {
 
-                    double Scoeff =   orientation * geo.sigma_inv(*mit1, *mit2) * K;
-                    double Dcoeff = - orientation * geo.indicator(*mit1, *mit2) * K;
-                    double Ncoeff;
-
-                    if ( !(mit1->outermost() || mit2->outermost()) ) {
-                        // Computing S block first because it's needed for the corresponding N block
-                        operatorS(*mit1, *mit2, mat, Scoeff, gauss_order);
-                        Ncoeff = geo.sigma(*mit1, *mit2)/geo.sigma_inv(*mit1, *mit2);
-                    } else {
-                        Ncoeff = orientation * geo.sigma(*mit1, *mit2) * K;
+                    std::ostringstream name;
+                    name << "pair" << (mit1-geo.begin()) << "-" << (mit2-geo.begin());
+                    std::vector<unsigned> rows, cols;
+                    Matrix before;
+                    if ( checkpoint.active() ) {
+                        rows = unknowns(*mit1, mat.nlin());
+                        cols = unknowns(*mit2, mat.nlin());
+                        Matrix done;
+                        if ( checkpoint.restore(name.str(), done) && done.nlin() == rows.size() && done.ncol() == cols.size() ) {
+                            add_block(mat, rows, cols, done);
+                            continue;
+                        }
+                        before = block(mat, rows, cols);
                     }
 
-                    if ( !mit1->outermost() ) {
-                        // Computing D block
-                        operatorD(*mit1, *mit2, mat, Dcoeff, gauss_order);
-                    }
-                    if ( ( *mit1 != *mit2 ) && ( !mit2->outermost() ) ) {
-                        // Computing D* block
-                        operatorD(*mit1, *mit2, mat, Dcoeff, gauss_order, true);
-                    }
+                    assemble_pair(geo, view, *mit1, *mit2, orientation, mat, gauss_order);
 
-                    // Computing N block
-                    operatorN(*mit1, *mit2, mat, Ncoeff, gauss_order);
+                    if ( checkpoint.active() ) {
+                        checkpoint.save(name.str(), block(mat, rows, cols)-before);
+                    }
                 }
             }
         }
@@ -115,8 +209,92 @@ namespace OpenMEEG {
         deflat(mat, i, mat(i_first, i_first) / (geo.outermost_interface().nb_vertices()));
     }
 
+    #ifdef USE_MPI
+    // Each process computes the entries of mat that it owns. All the processes go through the same
+    // pairs of meshes, as the operator N of a distributed matrix exchanges entries of S.
+
+    void assemble_HM(const Geometry& geo, DistributedSymMatrix& mat, const unsigned gauss_order)
+    {
+        TIMED_SCOPE("assemble_HM");
+        mat = DistributedSymMatrix(geo.size()-geo.outermost_interface().nb_triangles(), mat.communicator());
+        mat.set(0.0);
+        const GeometryView view(geo);
+
+        for ( Geometry::const_iterator mit1 = geo.begin(); mit1 != geo.end(); ++mit1) {
+            for ( Geometry::const_iterator mit2 = geo.begin(); (mit2 != (mit1+1)); ++mit2) {
+                const int orientation = geo.oriented(*mit1, *mit2);
+                if ( orientation != 0 ) {
+                    assemble_pair(geo, view, *mit1, *mit2, orientation, mat, gauss_order);
+                }
+            }
+        }
+
+        const Interface i = geo.outermost_interface();
+        unsigned i_first = (*i.begin()->mesh().vertex_begin())->index();
+        deflat(mat, i, mat.entry(i_first, i_first) / (geo.outermost_interface().nb_vertices()));
+    }
+    #endif
+
+    // Orthonormal basis of the null space of the Nl x Nc matrix A (Nl < Nc, full row rank):
+    // the last Nc-Nl columns of Q in the QR factorization A' = QR. Q is applied to [0;I] and never formed.
+    static Matrix null_space_basis(const Matrix& A)
+    {
+        const int m = A.ncol();
+        const int n = A.nlin();
+        const int k = m-n;
+        Matrix N(m, k);
+    #ifdef HAVE_LAPACK
+        N.set(0.0);
+        for ( int i = 0; i < k; ++i) {
+            N(n+i, i) = 1.0;
+        }
+        Matrix At = A.transpose();
+        std::vector<double> tau(n);
+        int info;
+        double lwork;
+        DGEQRF(m, n, At.data(), m, &tau[0], &lwork, -1, info);
+        std::vector<double> work(static_cast<size_t>(lwork));
+        DGEQRF(m, n, At.data(), m, &tau[0], &work[0], work.size(), info);
+        DORMQR('L', 'N', m, k, n, At.data(), m, &tau[0], N.data(), m, &lwork, -1, info);
+        work.resize(std::max(work.size(), static_cast<size_t>(lwork)));
+        DORMQR('L', 'N', m, k, n, At.data(), m, &tau[0], N.data(), m, &work[0], work.size(), info);
+    #else
+        Matrix U, s, W;
+        A.svd(U, s, W);
+        N = W.submat(0, m, n, k);
+    #endif
+        return N;
+    }
+
+    // Solution of ZX = B (B is overwritten) for a symmetric Z. The gradient norm of the P0 elements is not
+    // positive semi-definite, so Z may be indefinite or even singular: a U'U factorization is tried first,
+    // then the Bunch-Kaufman one and, when Z is singular, its pseudo-inverse is used (as formerly).
+    static Matrix symmetric_solve(const SymMatrix& Z, Matrix& B)
+    {
+    #ifdef HAVE_LAPACK
+        SymMatrix U(Z, DEEP_COPY);
+        int info;
+        DPPTRF('U', U.nlin(), U.data(), info);
+        if ( info == 0 ) {
+            DPPTRS('U', U.nlin(), B.ncol(), U.data(), B.data(), B.nlin(), info);
+            return B;
+        }
+        SymMatrix LD(Z, DEEP_COPY);
+        std::vector<int> pivots(LD.nlin());
+        DSPTRF('U', LD.nlin(), LD.data(), &pivots[0], info);
+        if ( info == 0 ) {
+            std::cout << "The regularized system is not positive definite, using a symmetric indefinite solver." << std::endl;
+            DSPTRS('U', LD.nlin(), B.ncol(), LD.data(), &pivots[0], B.data(), B.nlin(), info);
+            return B;
+        }
+        std::cout << "The regularized system is singular, using its pseudo-inverse." << std::endl;
+    #endif
+        return Matrix(Z).pinverse()*B;
+    }
+
     void assemble_cortical(const Geometry& geo, Matrix& mat, const Head2EEGMat& M, const std::string& domain_name, const unsigned gauss_order, double alpha, double beta, const std::string &filename)
     {
+        TIMED_SCOPE("assemble_cortical");
         // Following the article: M. Clerc, J. Kybic "Cortical mapping by Laplace–Cauchy transmission using a boundary element method".
         // Assumptions:
         // - domain_name: the domain containing the sources is an innermost domain (defined as the interior of only one interface (called Cortex)
@@ -131,14 +309,26 @@ namespace OpenMEEG {
         // shape of the new matrix:
         unsigned Nl = geo.size()-geo.outermost_interface().nb_triangles()-Cortex.nb_vertices()-Cortex.nb_triangles();
         unsigned Nc = geo.size()-geo.outermost_interface().nb_triangles();
+        const unsigned Nk = Nc-Nl;
+        // ** Get N: an orthonormal basis of the null space of the rows kept in mat (mat*N = 0) **
+        // It is stored in place of the Nc x Nc projector P = N*N', which is never formed.
+        Matrix N;
         std::fstream f(filename.c_str());
-        Matrix P;
-        if ( !f ) {
+        if ( f ) {
+            std::cout << "Loading null-space basis (" << filename << ")." << std::endl;
+            N.load(filename);
+            if ( N.nlin() != Nc || N.ncol() != Nk ) {
+                std::cout << "The file is not a " << Nc << "x" << Nk << " null-space basis (former projector ?): recomputing it." << std::endl;
+                N = Matrix();
+            }
+        }
+        if ( N.nlin() == 0 ) {
             // build the HeadMat:
             // The following is the same as assemble_HM except N_11, D_11 and S_11 are not computed.
             SymMatrix mat_temp(Nc);
             mat_temp.set(0.0);
             double K = 1.0 / (4.0 * M_PI);
+            const GeometryView view(geo);
             // We iterate over the meshes (or pair of domains) to fill the lower half of the HeadMat (since its symmetry)
             for ( Geometry::const_iterator mit1 = geo.begin(); mit1 != geo.end(); ++mit1) {
                 for ( Geometry::const_iterator mit2 = geo.begin(); (mit2 != (mit1+1)); ++mit2) {
@@ -152,22 +342,22 @@ namespace OpenMEEG {
                         double Ncoeff;
                         if ( !(mit1->outermost() || mit2->outermost()) && ( (*mit1 != *mit2)||( *mit1 != cortex) ) ) {
                             // Computing S block first because it's needed for the corresponding N block
-                            operatorS(*mit1, *mit2, mat_temp, Scoeff, gauss_order);
+                            operatorS(view, *mit1, *mit2, mat_temp, Scoeff, gauss_order);
                             Ncoeff = geo.sigma(*mit1, *mit2)/geo.sigma_inv(*mit1, *mit2);
                         } else {
                             Ncoeff = orientation * geo.sigma(*mit1, *mit2) * K;
                         }
                         if ( !mit1->outermost() && (( (*mit1 != *mit2)||( *mit1 != cortex) )) ) {
                             // Computing D block
-                            operatorD(*mit1, *mit2, mat_temp, Dcoeff, gauss_order);
+                            operatorD(view, *mit1, *mit2, mat_temp, Dcoeff, gauss_order);
                         }
                         if ( ( *mit1 != *mit2 ) && ( !mit2->outermost() ) ) {
                             // Computing D* block
-                            operatorD(*mit1, *mit2, mat_temp, Dcoeff, gauss_order, true);
+                            operatorD(view, *mit1, *mit2, mat_temp, Dcoeff, gauss_order, true);
                         }
                         // Computing N block
                         if ( (*mit1 != *mit2)||( *mit1 != cortex) ) {
-                            operatorN(*mit1, *mit2, mat_temp, Ncoeff, gauss_order);
+                            operatorN(view, *mit1, *mit2, mat_temp, Ncoeff, gauss_order);
                         }
                     }
                 }
@@ -191,80 +381,76 @@ namespace OpenMEEG {
                     ++iNl;
                 }
             }
-            // ** Construct P: the null-space projector **
-            Matrix W;
-            {
-                Matrix U, s;
-                mat.svd(U, s, W);
-            }
-
-            SparseMatrix S(Nc,Nc);
-            // we set S to 0 everywhere, except in the last part of the diag:
-            for ( unsigned i = Nl; i < Nc; ++i) {
-                S(i, i) = 1.0;
-            }
-            P = (W * S) * W.transpose(); // P is a projector: P^2 = P and mat*P*X = 0
+            N = null_space_basis(mat);
             if ( filename.length() != 0 ) {
-                std::cout << "Saving projector P (" << filename << ")." << std::endl;
-                P.save(filename);
+                std::cout << "Saving null-space basis (" << filename << ")." << std::endl;
+                N.save(filename);
             }
-        } else {
-            std::cout << "Loading projector P (" << filename << ")." << std::endl;
-            P.load(filename);
         }
 
         // ** Get the gradient of P1&P0 elements on the meshes **
-        Matrix MM(M.transpose() * M);
-        SymMatrix RR(Nc, Nc); RR.set(0.);
+        FastSparseMatrix::Triplets RR_entries;
         for ( Geometry::const_iterator mit = geo.begin(); mit != geo.end(); ++mit) {
-            mit->gradient_norm2(RR);
+            mit->gradient_norm2(RR_entries);
         }
+        const FastSparseMatrix RR(Nc, Nc, RR_entries);
+        FastSparseMatrix::Triplets().swap(RR_entries);
 
         // ** Choose Regularization parameter **
-        SparseMatrix alphas(Nc,Nc); // diagonal matrix
-        Matrix Z;
+        const Matrix MD(M);
         if ( alpha < 0 ) { // try an automatic method... TODO find better estimation
-            double nRR_v = RR.submat(0, geo.nb_vertices(), 0, geo.nb_vertices()).frobenius_norm();
-            alphas.set(0.);
-            alpha = MM.frobenius_norm() / (1.e3*nRR_v);
-            beta  = alpha * 50000.;
-            for ( Vertices::const_iterator vit = geo.vertex_begin(); vit != geo.vertex_end(); ++vit) {
-                alphas(vit->index(), vit->index()) = alpha;
-            }
-            for ( Meshes::const_iterator mit = geo.begin(); mit != geo.end(); ++mit) {
-                if ( !mit->outermost() ) {
-                    for ( Mesh::const_iterator tit = mit->begin(); tit != mit->end(); ++tit) {
-                        alphas(tit->index(), tit->index()) = beta;
-                    }
+            double nRR_v = 0.;
+            for ( unsigned i = 0; i < geo.nb_vertices(); ++i) {
+                for ( size_t k = RR.row_begin(i); k < RR.row_end(i) && RR.column(k) < geo.nb_vertices(); ++k) {
+                    nRR_v += RR.value(k)*RR.value(k);
                 }
             }
+            nRR_v = sqrt(nRR_v);
+            // |M'M| = |MM'|, the latter being only nb_sensors x nb_sensors.
+            alpha = MD.multt(MD).frobenius_norm() / (1.e3*nRR_v);
+            beta  = alpha * 50000.;
             std::cout << "AUTOMATIC alphas = " << alpha << "\tbeta = " << beta << std::endl;
         } else {
-            for ( Vertices::const_iterator vit = geo.vertex_begin(); vit != geo.vertex_end(); ++vit) {
-                alphas(vit->index(), vit->index()) = alpha;
-            }
-            for ( Meshes::const_iterator mit = geo.begin(); mit != geo.end(); ++mit) {
-                if ( !mit->outermost() ) {
-                    for ( Mesh::const_iterator tit = mit->begin(); tit != mit->end(); ++tit) {
-                        alphas(tit->index(), tit->index()) = beta;
-                    }
+            std::cout << "alphas = " << alpha << "\tbeta = " << beta << std::endl;
+        }
+        Vector alphas(Nc); // diagonal of the regularization weights
+        alphas.set(0.);
+        for ( Vertices::const_iterator vit = geo.vertex_begin(); vit != geo.vertex_end(); ++vit) {
+            alphas(vit->index()) = alpha;
+        }
+        for ( Meshes::const_iterator mit = geo.begin(); mit != geo.end(); ++mit) {
+            if ( !mit->outermost() ) {
+                for ( Mesh::const_iterator tit = mit->begin(); tit != mit->end(); ++tit) {
+                    alphas(tit->index()) = beta;
                 }
             }
-            std::cout << "alphas = " << alpha << "\tbeta = " << beta << std::endl;
         }
-        Z = P.transpose() * (MM + alphas*RR) * P;
-
-        // ** PseudoInverse and return **
-        // X = P * { (M*P)' * (M*P) + (R*P)' * (R*P) }¡(-1) * (M*P)'m
-        // X = P * { P'*M'*M*P + P'*R'*R*P }¡(-1) * P'*M'm
-        // X = P * { P'*(MM + a*RR)*P }¡(-1) * P'*M'm
-        // X = P * Z¡(-1) * P' * M'm
-        Matrix rhs = P.transpose() * M.transpose();
-        mat = P * Z.pinverse() * rhs;
+
+        // ** Solve and return **
+        // X = P * { P'*(M'M + a*RR)*P }^(-1) * P'*M'm with P = N*N' becomes
+        // X = N * Z^(-1) * (M*N)'m with Z = (M*N)'*(M*N) + N'*(a*RR)*N, a Nk x Nk symmetric matrix which may be
+        // indefinite or singular (see symmetric_solve).
+        const Matrix MN = MD*N;
+        Matrix RN = RR*N;
+        for ( unsigned j = 0; j < Nk; ++j) {
+            for ( unsigned i = 0; i < Nc; ++i) {
+                RN(i, j) *= alphas(i);
+            }
+        }
+        const Matrix Zfull = MN.tmult(MN)+N.tmult(RN);
+        SymMatrix Z(Nk);
+        for ( unsigned j = 0; j < Nk; ++j) {
+            for ( unsigned i = 0; i <= j; ++i) {
+                Z(i, j) = 0.5*(Zfull(i, j)+Zfull(j, i));
+            }
+        }
+        Matrix rhs = MN.transpose();
+        mat = N * symmetric_solve(Z, rhs);
     }
 
     void assemble_Surf2Vol(const Geometry& geo, Matrix& mat, const std::map<const Domain, Vertices> m_points) 
     {
+        TIMED_SCOPE("assemble_Surf2Vol");
         const double K = 1.0/(4.0*M_PI);
 
         unsigned size = 0; // total number of inside points
@@ -275,13 +461,14 @@ namespace OpenMEEG {
         mat = Matrix(size, (geo.size() - geo.outermost_interface().nb_triangles()));
         mat.set(0.0);
 
+        const GeometryView view(geo);
         for ( std::map<const Domain, Vertices>::const_iterator dvit = m_points.begin(); dvit != m_points.end(); ++dvit) {
             for ( Geometry::const_iterator mit = geo.begin(); mit != geo.end(); ++mit) {
                 int orientation = dvit->first.mesh_orientation(*mit);
                 if ( orientation != 0 ) {
-                    operatorDinternal(*mit, mat, dvit->second, orientation * -1. * K);
+                    operatorDinternal(view, *mit, mat, dvit->second, orientation * -1. * K);
                     if ( !mit->outermost() ) {
-                        operatorSinternal(*mit, mat, dvit->second, orientation * K / geo.sigma(dvit->first));
+                        operatorSinternal(view, *mit, mat, dvit->second, orientation * K / geo.sigma(dvit->first));
                     }
                 }
             }
@@ -293,6 +480,14 @@ namespace OpenMEEG {
         assemble_HM(geo, *this, gauss_order);
     }
 
+    #ifdef USE_MPI
+    DistributedHeadMat::DistributedHeadMat(const Geometry& geo, const unsigned gauss_order, MPI_Comm comm):
+        DistributedSymMatrix(0, comm)
+    {
+        assemble_HM(geo, *this, gauss_order);
+    }
+    #endif
+
     CorticalMat::CorticalMat(const Geometry& geo, const Head2EEGMat& M, const std::string& domain_name, const unsigned gauss_order, double a, double b, const std::string &filename)
     {
         assemble_cortical(geo, *this, M, domain_name, gauss_order, a, b, filename);
@@ -52,6 +52,7 @@ namespace OpenMEEG {
     // mat is the linear application which maps x (the unknown vector in symmetric system) -> v (potential at the electrodes)
     void assemble_Head2EEG(SparseMatrix& mat, const Geometry& geo, const Matrix& positions )
     {
+        TIMED_SCOPE("assemble_Head2EEG");
         mat = SparseMatrix(positions.nlin(), (geo.size()-geo.outermost_interface().nb_triangles()));
 
         Vect3 current_position;
@@ -79,6 +80,7 @@ namespace OpenMEEG {
     // difference with Head2EEG is that it interpolates the inner skull layer instead of the scalp layer. 
     void assemble_Head2ECoG(SparseMatrix& mat, const Geometry& geo, const Matrix& positions, const Interface& i)
     {
+        TIMED_SCOPE("assemble_Head2ECoG");
         mat = SparseMatrix(positions.nlin(), (geo.size()-geo.outermost_interface().nb_triangles()));
 
         Vect3 current_position;
@@ -105,6 +107,7 @@ namespace OpenMEEG {
     // mat is the linear application which maps x (the unknown vector in symmetric system) -> bFerguson (contrib to MEG response)
     void assemble_Head2MEG(Matrix& mat, const Geometry& geo, const Sensors& sensors) 
     {
+        TIMED_SCOPE("assemble_Head2MEG");
         Matrix positions = sensors.getPositions();
         Matrix orientations = sensors.getOrientations();
         const unsigned nbIntegrationPoints = sensors.getNumberOfPositions();
@@ -139,6 +142,7 @@ namespace OpenMEEG {
     // mat is the linear application which maps x (the unknown vector in symmetric system) -> binf (contrib to MEG response)
     void assemble_SurfSource2MEG(Matrix& mat, const Mesh& sources_mesh, const Sensors& sensors)
     {
+        TIMED_SCOPE("assemble_SurfSource2MEG");
         Matrix positions = sensors.getPositions();
         Matrix orientations = sensors.getOrientations();
         const unsigned nsquids = positions.nlin();
@@ -146,12 +150,13 @@ namespace OpenMEEG {
         mat = Matrix(nsquids, sources_mesh.nb_vertices());
         mat.set(0.0);
 
+        const GeometryView view(sources_mesh);
         for ( unsigned i = 0; i < nsquids; ++i) {
             PROGRESSBAR(i, nsquids);
             Vect3 p(positions(i, 0), positions(i, 1), positions(i, 2));
             Matrix FergusonMat(3, mat.ncol());
             FergusonMat.set(0.0);
-            operatorFerguson(p, sources_mesh, FergusonMat, 0, 1.);
+            operatorFerguson(view, p, sources_mesh, FergusonMat, 0, 1.);
             for ( unsigned j = 0; j < mat.ncol(); ++j) {
                 Vect3 fergusonField(FergusonMat(0, j), FergusonMat(1, j), FergusonMat(2, j));
                 Vect3 normalizedDirection(orientations(i, 0), orientations(i, 1), orientations(i, 2));
@@ -174,6 +179,7 @@ namespace OpenMEEG {
     // sources is the name of a file containing the description of the sources - one dipole per line: x1 x2 x3 n1 n2 n3, x being the position and n the orientation.
     void assemble_DipSource2MEG(Matrix& mat, const Matrix& dipoles, const Sensors& sensors)
     {
+        TIMED_SCOPE("assemble_DipSource2MEG");
         Matrix positions = sensors.getPositions();
         Matrix orientations = sensors.getOrientations();
 
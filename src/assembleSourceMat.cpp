@@ -48,12 +48,17 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #include <operators.h>
 #include <assemble.h>
 #include <sensors.h>
+#include <integrator.h>
+#include <checkpoint.h>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
 
 namespace OpenMEEG {
 
     void assemble_SurfSourceMat(Matrix& mat, const Geometry& geo, Mesh& mesh_source, const unsigned gauss_order) 
     {
+        TIMED_SCOPE("assemble_SurfSourceMat");
         mat = Matrix((geo.size()-geo.outermost_interface().nb_triangles()), mesh_source.nb_vertices());
         mat.set(0.0);
 
@@ -92,9 +97,15 @@ namespace OpenMEEG {
         assemble_SurfSourceMat(*this, geo, mesh_source, gauss_order);
     }
 
-    void assemble_DipSourceMat(Matrix& rhs, const Geometry& geo, const Matrix& dipoles,
-            const unsigned gauss_order, const bool adapt_rhs, const std::string& domain_name = "") 
+    //  Number of dipoles of a block of the DipSourceMat checkpoint.
+
+    static const unsigned dipoles_per_block = 64;
+
+    void assemble_DipSourceMat(Matrix& rhs, const GeometryView& view, const Geometry& geo, const Matrix& dipoles,
+            const unsigned gauss_order, const bool adapt_rhs, const std::string& domain_name,
+            const std::string& checkpoint_name)
     {
+        TIMED_SCOPE("assemble_DipSourceMat");
         const double   K         = 1.0/(4.*M_PI);
         const unsigned size      = (geo.size() - geo.outermost_interface().nb_triangles());
         const unsigned n_dipoles = dipoles.nlin();
@@ -102,48 +113,81 @@ namespace OpenMEEG {
         rhs = Matrix(size, n_dipoles);
         rhs.set(0.);
 
-        Vector rhs_col(rhs.nlin());
-        for ( unsigned s = 0; s < n_dipoles; ++s) {
-            PROGRESSBAR(s, n_dipoles);
-            const Vect3 r(dipoles(s, 0), dipoles(s, 1), dipoles(s, 2));
-            const Vect3 q(dipoles(s, 3), dipoles(s, 4), dipoles(s, 5));
+        //  With checkpoints, the dipoles are assembled by groups, each group being a block of the checkpoint.
 
-            Domain domain;
+        Checkpoint checkpoint(checkpoint_name, Fingerprint() << geo << dipoles << gauss_order << adapt_rhs << domain_name
+                                                            << QuadraturePolicy::accuracy());
+        const unsigned group = checkpoint.active() ? dipoles_per_block : std::max(n_dipoles, 1U);
 
-            if ( domain_name == "" ) {
-                domain = geo.domain(r);
-            } else {
-                domain = geo.domain(domain_name);
+        for ( unsigned first = 0; first < n_dipoles; first += group) {
+            const unsigned last = std::min(first+group, n_dipoles);
+
+            std::ostringstream name;
+            name << "dipoles" << first;
+            Matrix done;
+            if ( checkpoint.restore(name.str(), done) && done.nlin() == size && done.ncol() == last-first ) {
+                for ( unsigned s = first; s < last; ++s) {
+                    rhs.setcol(s, done.getcol(s-first));
+                }
+                continue;
             }
-            const double sigma = domain.sigma();
-
-            rhs_col.set(0.);
-            // iterate over the domain's interfaces (half-spaces)
-            for ( Domain::const_iterator hit = domain.begin(); hit != domain.end(); ++hit ) {
-                // iterate over the meshes of the interface
-                for ( Interface::const_iterator omit = hit->interface().begin(); omit != hit->interface().end(); ++omit ) {
-                    //  Treat the mesh.
-                    double coeffD = (hit->inside())?(K * omit->orientation()):(-K * omit->orientation());
-                    operatorDipolePotDer(r, q, omit->mesh(), rhs_col, coeffD, gauss_order, adapt_rhs);
-
-                    if ( !omit->mesh().outermost() ) {
-                        double coeff = ( hit->inside() )?(-omit->orientation() * K / sigma):(omit->orientation() * K / sigma);
-                        operatorDipolePot(r, q, omit->mesh(), rhs_col, coeff, gauss_order, adapt_rhs);
+
+            //  Dipoles are independent: each thread assembles its own columns (the operators below then
+            //  run serially in the thread). A single dipole (adjoint gains) is parallelized over triangles.
+
+            TaskSchedule schedule(first, last);
+            #pragma omp parallel if(last-first>1)
+            for ( int s; schedule.next(s); ) {
+                const Vect3 r(dipoles(s, 0), dipoles(s, 1), dipoles(s, 2));
+                const Vect3 q(dipoles(s, 3), dipoles(s, 4), dipoles(s, 5));
+
+                const Domain& domain = (domain_name=="") ? geo.domain(r) : geo.domain(domain_name);
+                const double  sigma  = domain.sigma();
+
+                Vector rhs_col(rhs.nlin());
+                rhs_col.set(0.);
+                // iterate over the domain's interfaces (half-spaces)
+                for ( Domain::const_iterator hit = domain.begin(); hit != domain.end(); ++hit ) {
+                    // iterate over the meshes of the interface
+                    for ( Interface::const_iterator omit = hit->interface().begin(); omit != hit->interface().end(); ++omit ) {
+                        //  Treat the mesh.
+                        double coeffD = (hit->inside())?(K * omit->orientation()):(-K * omit->orientation());
+                        operatorDipolePotDer(view, r, q, omit->mesh(), rhs_col, coeffD, gauss_order, adapt_rhs);
+
+                        if ( !omit->mesh().outermost() ) {
+                            double coeff = ( hit->inside() )?(-omit->orientation() * K / sigma):(omit->orientation() * K / sigma);
+                            operatorDipolePot(view, r, q, omit->mesh(), rhs_col, coeff, gauss_order, adapt_rhs);
+                        }
                     }
                 }
+                rhs.setcol(s, rhs_col);
+                #pragma omp critical
+                PROGRESSBAR(s, n_dipoles);
+            }
+
+            if ( checkpoint.active() ) {
+                checkpoint.save(name.str(), rhs.submat(0, size, first, last-first));
             }
-            rhs.setcol(s, rhs_col);
         }
     }
 
     DipSourceMat::DipSourceMat(const Geometry& geo, const Matrix& dipoles, const unsigned gauss_order,
                                const bool adapt_rhs, const std::string& domain_name)
     {
-        assemble_DipSourceMat(*this, geo, dipoles, gauss_order, adapt_rhs, domain_name);
+        const GeometryView view(geo);
+        assemble_DipSourceMat(*this, view, geo, dipoles, gauss_order, adapt_rhs, domain_name, "DipSourceMat");
+    }
+
+    DipSourceMat::DipSourceMat(const GeometryView& view, const Geometry& geo, const Matrix& dipoles,
+                               const unsigned gauss_order, const bool adapt_rhs, const std::string& domain_name,
+                               const std::string& checkpoint)
+    {
+        assemble_DipSourceMat(*this, view, geo, dipoles, gauss_order, adapt_rhs, domain_name, checkpoint);
     }
 
     void assemble_EITSourceMat(Matrix& mat, const Geometry& geo, const Sensors& electrodes, const unsigned gauss_order)
     {
+        TIMED_SCOPE("assemble_EITSourceMat");
         //  A Matrix to be applied to the scalp-injected current to obtain the Source Term of the EIT foward problem.
 
         unsigned n_sensors = electrodes.getNumberOfSensors();
@@ -157,6 +201,7 @@ namespace OpenMEEG {
         mat.set(0.);
 
         const Interface& i = geo.outermost_interface();
+        const GeometryView view(geo);
 
         // We iterate over the meshes (or pair of domains)
         for ( Interface::const_iterator omit1 = i.begin(); omit1 != i.end(); ++omit1) {
@@ -167,10 +212,10 @@ namespace OpenMEEG {
                                                                   // equals -1, if they are not
                 if ( orientation != 0 ) {
                     //  Compute S.
-                    operatorS(*mit2, omit1->mesh(), transmat, geo.sigma_inv(omit1->mesh(), *mit2) * ( -1. * K * orientation), gauss_order);
+                    operatorS(view, *mit2, omit1->mesh(), transmat, geo.sigma_inv(omit1->mesh(), *mit2) * ( -1. * K * orientation), gauss_order);
 
                     //  First compute D.
-                    operatorD(*mit2, omit1->mesh(), transmat, (K * orientation), gauss_order, true);
+                    operatorD(view, *mit2, omit1->mesh(), transmat, (K * orientation), gauss_order, true);
                     if ( omit1->mesh() == *mit2 ) {
                         operatorP1P0(omit1->mesh(), transmat, 0.5 * orientation);
                     }
@@ -202,6 +247,7 @@ namespace OpenMEEG {
     void assemble_DipSource2InternalPotMat(Matrix& mat, const Geometry& geo, const Matrix& dipoles,
                                            const Matrix& points, const std::string& domain_name)     
     {
+        TIMED_SCOPE("assemble_DipSource2InternalPotMat");
         // Points with one more column for the index of the domain they belong
         std::vector<Domain> points_domain;
         std::vector<Vect3>  points_;
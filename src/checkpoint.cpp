@@ -0,0 +1,229 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#if WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include <ChunkedBinIO.H>
+#include <geometry.h>
+#include <checkpoint.h>
+
+namespace OpenMEEG {
+
+    std::string              Checkpoint::directory_;
+    std::vector<std::string> Checkpoint::opened_;
+
+    Fingerprint& Fingerprint::add(const void* data, const size_t n)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for ( size_t i = 0; i < n; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        return *this;
+    }
+
+    Fingerprint& Fingerprint::operator<<(const Matrix& M)
+    {
+        *this << static_cast<unsigned>(M.nlin()) << static_cast<unsigned>(M.ncol());
+        for ( size_t j = 0; j < M.ncol(); ++j) {
+            for ( size_t i = 0; i < M.nlin(); ++i) {
+                *this << M(i, j);
+            }
+        }
+        return *this;
+    }
+
+    Fingerprint& Fingerprint::operator<<(const Geometry& geo)
+    {
+        *this << geo.nb_vertices() << geo.size();
+        for ( Vertices::const_iterator vit = geo.vertex_begin(); vit != geo.vertex_end(); ++vit) {
+            *this << vit->x() << vit->y() << vit->z() << vit->index();
+        }
+        for ( Geometry::const_iterator mit = geo.begin(); mit != geo.end(); ++mit) {
+            *this << mit->name() << mit->nb_triangles();
+            for ( Mesh::const_iterator tit = mit->begin(); tit != mit->end(); ++tit) {
+                *this << tit->index() << tit->s1().index() << tit->s2().index() << tit->s3().index();
+            }
+        }
+        for ( Domains::const_iterator dit = geo.domain_begin(); dit != geo.domain_end(); ++dit) {
+            *this << dit->name() << dit->sigma();
+        }
+        return *this;
+    }
+
+    void Checkpoint::set_directory(const std::string& dir)
+    {
+        directory_ = dir;
+    #if WIN32
+        _mkdir(dir.c_str());
+    #else
+        mkdir(dir.c_str(), 0755);
+    #endif
+    }
+
+    Checkpoint::Checkpoint(const std::string& name, const Fingerprint& key): name_(name), active_(enabled()), restored_(0)
+    {
+        if ( !active_ ) {
+            return;
+        }
+
+        std::ostringstream oss;
+        oss << std::hex << std::setw(16) << std::setfill('0') << key.value();
+        const std::string fingerprint = oss.str();
+
+        // Read the manifest of a previous run on the same inputs.
+
+        std::ifstream ifs(manifest().c_str());
+        std::string tag, value;
+        if ( ifs >> tag >> value && tag == "fingerprint" && value == fingerprint ) {
+            std::string block;
+            uint32_t    sum;
+            while ( ifs >> block >> sum ) {
+                blocks_[block] = sum;
+            }
+            ifs.close();
+            std::cout << "Checkpoint " << manifest() << ": " << blocks_.size() << " completed blocks." << std::endl;
+        } else {
+            if ( ifs.is_open() ) {
+                std::cout << "Checkpoint " << manifest() << " was written for other inputs: it is restarted." << std::endl;
+                ifs.close();
+                discard(name_);
+            }
+            std::ofstream ofs(manifest().c_str());
+            if ( !ofs ) {
+                std::cerr << "Error: cannot write the checkpoint manifest " << manifest() << std::endl;
+                exit(1);
+            }
+            ofs << "fingerprint " << fingerprint << std::endl;
+        }
+
+        if ( std::find(opened_.begin(), opened_.end(), name_) == opened_.end() ) {
+            opened_.push_back(name_);
+        }
+    }
+
+    bool Checkpoint::checksum(const std::string& filename, uint32_t& sum)
+    {
+        std::ifstream ifs(filename.c_str(), std::ios::binary);
+        if ( !ifs ) {
+            return false;
+        }
+        const std::vector<char> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+        sum = maths::Chunked::adler32(data.empty() ? 0 : &data[0], data.size());
+        return true;
+    }
+
+    bool Checkpoint::restore(const std::string& block, Matrix& M)
+    {
+        if ( !active_ ) {
+            return false;
+        }
+        const Blocks::const_iterator bit = blocks_.find(block);
+        if ( bit == blocks_.end() ) {
+            return false;
+        }
+        uint32_t sum;
+        if ( !checksum(filename(block), sum) || sum != bit->second ) {
+            std::cout << "Checkpoint block " << filename(block) << " is missing or corrupted: it is computed again." << std::endl;
+            return false;
+        }
+        M.load(filename(block));
+        ++restored_;
+        return true;
+    }
+
+    void Checkpoint::save(const std::string& block, const Matrix& M)
+    {
+        if ( !active_ ) {
+            return;
+        }
+
+        // The block is complete on disk before it appears in the manifest.
+
+        const std::string file = filename(block);
+        const std::string tmp  = directory_+"/"+name_+"."+block+".tmp.bin";
+        M.save(tmp);
+        uint32_t sum;
+        if ( !checksum(tmp, sum) || std::rename(tmp.c_str(), file.c_str()) != 0 ) {
+            std::cerr << "Error: cannot write the checkpoint block " << file << std::endl;
+            exit(1);
+        }
+
+        #pragma omp critical (checkpoint_manifest)
+        {
+            std::ofstream ofs(manifest().c_str(), std::ios::app);
+            ofs << block << ' ' << sum << std::endl;
+            blocks_[block] = sum;
+        }
+    }
+
+    void Checkpoint::discard(const std::string& name)
+    {
+        const std::string manifest = directory_+"/"+name+".manifest";
+        std::ifstream ifs(manifest.c_str());
+        std::string block, sum;
+        if ( ifs >> block >> sum ) { // fingerprint
+            while ( ifs >> block >> sum ) {
+                std::remove((directory_+"/"+name+"."+block+".bin").c_str());
+            }
+        }
+        ifs.close();
+        std::remove(manifest.c_str());
+    }
+
+    void Checkpoint::discard_all()
+    {
+        for ( std::vector<std::string>::const_iterator nit = opened_.begin(); nit != opened_.end(); ++nit) {
+            discard(*nit);
+        }
+        opened_.clear();
+    }
+}
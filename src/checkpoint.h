@@ -0,0 +1,134 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_CHECKPOINT_H
+#define OPENMEEG_CHECKPOINT_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <matrix.h>
+#include <DLLDefinesOpenMEEG.h>
+
+namespace OpenMEEG {
+
+    class Geometry;
+
+    /** \brief 64 bits FNV-1a hash of the inputs of an assembly, used to recognize its checkpoints.
+    **/
+
+    class OPENMEEG_EXPORT Fingerprint {
+    public:
+
+        Fingerprint(): hash(14695981039346656037ULL) { }
+
+        Fingerprint& operator<<(const double x)       { return add(&x, sizeof(x)); }
+        Fingerprint& operator<<(const unsigned n)     { return add(&n, sizeof(n)); }
+        Fingerprint& operator<<(const bool b)         { return *this << static_cast<unsigned>(b); }
+        Fingerprint& operator<<(const std::string& s) { *this << static_cast<unsigned>(s.size()); return add(s.data(), s.size()); }
+        Fingerprint& operator<<(const Matrix& M);
+        Fingerprint& operator<<(const Geometry& geo); ///< vertices, triangles, meshes names and conductivities
+
+        uint64_t value() const { return hash; }
+
+    private:
+
+        Fingerprint& add(const void* data, const size_t n);
+
+        uint64_t hash;
+    };
+
+    /** \brief Checkpoints of a long assembly, so that a preempted job restarts where it stopped.
+
+        When a checkpoint directory is set, the assembly named name saves each completed block of work
+        (a pair of meshes, a group of dipoles, ...) as the file dir/name.block.bin and appends its name and
+        its Adler-32 checksum to the manifest dir/name.manifest. The manifest starts with the fingerprint of
+        the inputs of the assembly: the blocks of a manifest written for other inputs are ignored (and the
+        manifest is rewritten). On restart, a block is restored only if its file matches its checksum,
+        otherwise it is computed again. The blocks are written to a temporary file renamed once complete.
+        Without a checkpoint directory (the default), restore() returns false and save() does nothing.
+    **/
+
+    class OPENMEEG_EXPORT Checkpoint {
+    public:
+
+        /// \brief Set the checkpoint directory (it is created if needed).
+        static void               set_directory(const std::string& dir);
+        static const std::string& directory() { return directory_; }
+        static bool               enabled()   { return directory_ != ""; }
+
+        /// \brief Remove the manifests and the blocks of all the checkpoints opened by the process
+        /// (once their results are saved).
+        static void discard_all();
+
+        Checkpoint(const std::string& name, const Fingerprint& key);
+
+        bool active() const { return active_; }
+
+        /// \return true if the block was completed by a previous run and is intact (it is then loaded in M).
+        bool restore(const std::string& block, Matrix& M);
+
+        /// \brief Persist a completed block (may be called from several threads).
+        void save(const std::string& block, const Matrix& M);
+
+        unsigned nb_restored() const { return restored_; }
+
+    private:
+
+        typedef std::map<std::string, uint32_t> Blocks;
+
+        std::string manifest() const { return directory_+"/"+name_+".manifest"; }
+        std::string filename(const std::string& block) const { return directory_+"/"+name_+"."+block+".bin"; }
+
+        static bool checksum(const std::string& filename, uint32_t& sum);
+        static void discard(const std::string& name);
+
+        static std::string              directory_;
+        static std::vector<std::string> opened_;
+
+        std::string name_;
+        bool        active_;
+        Blocks      blocks_;
+        unsigned    restored_;
+    };
+}
+
+#endif  //! OPENMEEG_CHECKPOINT_H
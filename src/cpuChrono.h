@@ -43,22 +43,27 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #include <time.h>
 
 #include "DLLDefinesOpenMEEG.h"
+#include <timings.h>
 
 namespace OpenMEEG {
 
+    //  Measures both the CPU time (summed over all the threads) and the wall clock time.
+
     class OPENMEEG_EXPORT cpuChrono {
 
         clock_t ellapsed;
         clock_t tstart;
+        double  wall_ellapsed;
+        double  wall_start;
 
     public:
 
-        cpuChrono(): ellapsed(0),tstart(0) { }
+        cpuChrono(): ellapsed(0),tstart(0),wall_ellapsed(0.0),wall_start(0.0) { }
         ~cpuChrono(){}
 
-        void start() { tstart = clock();                      }
-        void stop()  { ellapsed += (ellapsed+clock()-tstart); }
-        void zero()  { ellapsed=0;                            }
+        void start() { tstart = clock(); wall_start = timings::wall_clock();                 }
+        void stop()  { ellapsed += clock()-tstart; wall_ellapsed += timings::wall_clock()-wall_start; }
+        void zero()  { ellapsed = 0; wall_ellapsed = 0.0;                                    }
 
         clock_t getEllapsedT() const { return ellapsed; }
 
@@ -66,9 +71,12 @@ namespace OpenMEEG {
             return (double)(ellapsed)/CLOCKS_PER_SEC;
         }
 
+        double getWallS() const { return wall_ellapsed; }
+
         void dispEllapsed() const {
             std::cout <<  "-------------------------------------------" << std::endl;
-            std::cout <<  "| Elapsed Time: " << getEllapsedS() << " s." << std::endl;
+            std::cout <<  "| Elapsed Time: " << getWallS() << " s." << std::endl;
+            std::cout <<  "| CPU Time: " << getEllapsedS() << " s." << std::endl;
             std::cout <<  "-------------------------------------------" << std::endl;
         }
     };
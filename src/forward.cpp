@@ -49,6 +49,18 @@ void getHelp(char** argv);
 int main(int argc, char **argv)
 {
     print_version(argv[0]);
+    thread_option(argc, argv);
+
+    // Simulation options: noise seed, number of samples per chunk and sensor noise covariance.
+    const std::string seed_option  = extract_option(argc, argv, "-seed");
+    const std::string chunk_option = extract_option(argc, argv, "-chunk");
+    const std::string cov_file     = extract_option(argc, argv, "-noise-cov");
+    const unsigned long seed  = (seed_option!="") ? strtoul(seed_option.c_str(), 0, 10) : 0;
+    const long          chunk = (chunk_option!="") ? atol(chunk_option.c_str()) : ForwardSimulator::default_chunk;
+    if ( chunk<=0 ) {
+        cerr << "Invalid chunk size " << chunk_option << endl;
+        return 1;
+    }
 
     if(argc==1)
     {
@@ -75,17 +87,20 @@ int main(int argc, char **argv)
 
     // declaration of argument variables======================================================================
     Matrix GainMatrix;
-    Matrix RealSourcesData;
     double NoiseLevel;
 
     GainMatrix.load(argv[1]);
-    RealSourcesData.load(argv[2]);
     NoiseLevel = atof(argv[4]);
 
-    Forward SimulatedData(GainMatrix,RealSourcesData,NoiseLevel);
+    ForwardSimulator simulator(GainMatrix,NoiseLevel,seed);
+    if ( cov_file != "" ) {
+        Matrix NoiseCovariance;
+        NoiseCovariance.load(cov_file);
+        simulator.set_noise_covariance(SymMatrix(NoiseCovariance));
+    }
 
-    // write output variables ===================================================================================
-    SimulatedData.save(argv[3]);
+    // simulate and write the output by chunks of samples ======================================================
+    simulator.run(argv[2],argv[3],chunk);
 
     // Stop Chrono
     C.stop();
@@ -96,11 +111,21 @@ int main(int argc, char **argv)
 
 void getHelp(char** argv)
 {
-    cout << argv[0] << " [filepaths...]" << endl << endl;
+    cout << argv[0] << " [options] [filepaths...]" << endl << endl;
 
     cout << "   Compute the forward problem " << endl;
     cout << "   Filepaths are in order :" << endl;
     cout << "   GainMatrix (bin), RealSourcesData (txt), SimulatedData (txt), NoiseLevel (float)" << endl << endl;
 
+    cout << "   Options :" << endl;
+    cout << "   -seed n          : seed of the noise (default 0); the noise only depends on the seed," << endl;
+    cout << "                      not on the chunk size or on the number of threads." << endl;
+    cout << "   -chunk n         : number of time samples simulated at once (default " << ForwardSimulator::default_chunk << ")." << endl;
+    cout << "                      Sources stored in a chunked file (.omc) are read by chunks and outputs" << endl;
+    cout << "                      written to a .omc file are streamed, so long recordings fit in memory." << endl;
+    cout << "   -noise-cov file  : sensor noise covariance (square matrix): colored noise of covariance" << endl;
+    cout << "                      NoiseLevel^2*cov instead of white noise." << endl;
+    cout << "   -threads n       : number of threads (default OMP_NUM_THREADS)." << endl << endl;
+
     exit(0);
 }
@@ -43,29 +43,25 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #include "matrix.h"
 #include "symmatrix.h"
 #include "vector.h"
+#include "simulation.h"
 
 namespace OpenMEEG {
 
     class Forward : public virtual Matrix
     {
     public:
-        Forward (const Matrix& GainMatrix, const Matrix& RealSourcesData, double NoiseLevel);
+        Forward (const Matrix& GainMatrix, const Matrix& RealSourcesData, double NoiseLevel, const unsigned long seed=0);
         virtual ~Forward () {};
     };
 
-    void compute_forward(Matrix& SimulatedData, const Matrix& GainMatrix, const Matrix& RealSourcesData, double NoiseLevel) {
+    //  White noise of standard deviation NoiseLevel, reproducible for a given seed (see ForwardSimulator).
 
-        SimulatedData = GainMatrix * RealSourcesData;
-
-        int nT = RealSourcesData.ncol();
-        for(int frame=0;frame<nT;frame++)
-        {
-            for(size_t i=0;i<SimulatedData.nlin();i++) SimulatedData(i,frame) += NoiseLevel * gaussian();
-        }
+    inline void compute_forward(Matrix& SimulatedData, const Matrix& GainMatrix, const Matrix& RealSourcesData, double NoiseLevel, const unsigned long seed=0) {
+        SimulatedData = ForwardSimulator(GainMatrix,NoiseLevel,seed).simulate(RealSourcesData);
     }
 
-    Forward::Forward(const Matrix& GainMatrix, const Matrix& RealSourcesData, double NoiseLevel) {
-        compute_forward(*this,GainMatrix,RealSourcesData,NoiseLevel);
+    inline Forward::Forward(const Matrix& GainMatrix, const Matrix& RealSourcesData, double NoiseLevel, const unsigned long seed) {
+        compute_forward(*this,GainMatrix,RealSourcesData,NoiseLevel,seed);
     }
 }
 
@@ -42,6 +42,7 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #include <matrix.h>
 #include <symmatrix.h>
 #include <vector.h>
+#include <ChunkedBinIO.H>
 #include <cpuChrono.h>
 #include <gain.h>
 
@@ -52,7 +53,30 @@ void getHelp(char** argv);
 
 int main(int argc, char **argv)
 {
+#ifdef USE_MPI
+    MPIEnvironment mpi(argc, argv);
+#endif
+
     print_version(argv[0]);
+    thread_option(argc, argv);
+
+    // Optional timing report (json, csv or text depending on the suffix)
+    const std::string timings_file = extract_option(argc, argv, "-timings");
+    if ( timings_file != "" ) {
+        timings::enable(argv[0]);
+    }
+
+    // Mixed precision: single precision products/factorizations checked or refined in double precision,
+    // and gains saved in the chunked format (.omc) are stored in single precision.
+    const std::string precision_option = extract_option(argc, argv, "-precision");
+    const Precision precision = (precision_option=="mixed") ? MIXED_PRECISION : FULL_PRECISION;
+    if ( precision_option != "" && precision_option != "mixed" && precision_option != "double" ) {
+        cerr << "Unknown precision " << precision_option << " (use mixed or double)." << endl;
+        return 1;
+    }
+    if ( precision == MIXED_PRECISION ) {
+        maths::ChunkedBinIO::set_single_precision(true);
+    }
 
     if ( argc<2 ) {
         cerr << "Not enough arguments \nPlease try \"" << argv[0] << " -h\" or \"" << argv[0] << " --help \" \n" << endl;
@@ -76,6 +100,14 @@ int main(int argc, char **argv)
         return 0;
     }
 
+#ifdef USE_MPI
+    const bool distributed = (mpi.size() > 1);
+    if ( distributed && Option != "-EEGadjoint" && Option != "-MEGadjoint" && Option != "-EEGMEGadjoint" ) {
+        cerr << "Only the adjoint gains (-EEGadjoint, -MEGadjoint, -EEGMEGadjoint) are computed by several MPI processes." << endl;
+        return 1;
+    }
+#endif
+
     // for use with EEG DATA
     if ( !strcmp(argv[1], "-EEG") ) {
         if ( argc<6 ) {
@@ -90,7 +122,7 @@ int main(int argc, char **argv)
         Matrix SourceMat;
         SourceMat.load(argv[3]);
 
-        GainEEG EEGGainMat(HeadMatInv, SourceMat, Head2EEGMat);
+        GainEEG EEGGainMat(HeadMatInv, SourceMat, Head2EEGMat, precision);
         EEGGainMat.save(argv[5]);
     }
     // compute the gain matrix with the adjoint method for use with EEG DATA
@@ -103,13 +135,26 @@ int main(int argc, char **argv)
         Geometry geo;
         geo.read(argv[2], argv[3]);
         Matrix dipoles(argv[4]);
-        SymMatrix HeadMat;
-        HeadMat.load(argv[5]);
         SparseMatrix Head2EEGMat;
         Head2EEGMat.load(argv[6]);
 
-        GainEEGadjoint EEGGainMat(geo, dipoles, HeadMat, Head2EEGMat);
-        EEGGainMat.save(argv[7]);
+    #ifdef USE_MPI
+        if ( distributed ) {
+            // The head matrix is distributed, factorized and solved by all the processes.
+            DistributedSymMatrix HeadMat;
+            HeadMat.load(argv[5]);
+            GainEEGadjoint EEGGainMat(geo, dipoles, HeadMat, Head2EEGMat);
+            if ( mpi.rank() == 0 ) {
+                EEGGainMat.save(argv[7]);
+            }
+        } else
+    #endif
+        {
+            SymMatrix HeadMat;
+            HeadMat.load(argv[5]);
+            GainEEGadjoint EEGGainMat(geo, dipoles, HeadMat, Head2EEGMat, precision);
+            EEGGainMat.save(argv[7]);
+        }
     }
     // for use with MEG DATA
     else if ( !strcmp(argv[1], "-MEG") ) {
@@ -127,7 +172,7 @@ int main(int argc, char **argv)
         Matrix Source2MEGMat;
         Source2MEGMat.load(argv[5]);
 
-        GainMEG MEGGainMat(HeadMatInv, SourceMat, Head2MEGMat, Source2MEGMat);
+        GainMEG MEGGainMat(HeadMatInv, SourceMat, Head2MEGMat, Source2MEGMat, precision);
         MEGGainMat.save(argv[6]);
     }
     // compute the gain matrix with the adjoint method for use with MEG DATA
@@ -140,15 +185,27 @@ int main(int argc, char **argv)
         Geometry geo;
         geo.read(argv[2], argv[3]);
         Matrix dipoles(argv[4]);
-        SymMatrix HeadMat;
-        HeadMat.load(argv[5]);
         Matrix Head2MEGMat;
         Head2MEGMat.load(argv[6]);
         Matrix Source2MEGMat;
         Source2MEGMat.load(argv[7]);
 
-        GainMEGadjoint MEGGainMat(geo, dipoles, HeadMat, Head2MEGMat, Source2MEGMat);
-        MEGGainMat.save(argv[8]);
+    #ifdef USE_MPI
+        if ( distributed ) {
+            DistributedSymMatrix HeadMat;
+            HeadMat.load(argv[5]);
+            GainMEGadjoint MEGGainMat(geo, dipoles, HeadMat, Head2MEGMat, Source2MEGMat);
+            if ( mpi.rank() == 0 ) {
+                MEGGainMat.save(argv[8]);
+            }
+        } else
+    #endif
+        {
+            SymMatrix HeadMat;
+            HeadMat.load(argv[5]);
+            GainMEGadjoint MEGGainMat(geo, dipoles, HeadMat, Head2MEGMat, Source2MEGMat, precision);
+            MEGGainMat.save(argv[8]);
+        }
     }
     // compute the gain matrices with the adjoint method for use with EEG and MEG DATA
     else if ( !strcmp(argv[1], "-EEGMEGadjoint") ) {
@@ -160,8 +217,6 @@ int main(int argc, char **argv)
         Geometry geo;
         geo.read(argv[2], argv[3]);
         Matrix dipoles(argv[4]);
-        SymMatrix HeadMat;
-        HeadMat.load(argv[5]);
         SparseMatrix Head2EEGMat;
         Head2EEGMat.load(argv[6]);
         Matrix Head2MEGMat;
@@ -169,9 +224,24 @@ int main(int argc, char **argv)
         Matrix Source2MEGMat;
         Source2MEGMat.load(argv[8]);
 
-        GainEEGMEGadjoint EEGMEGGainMat(geo, dipoles, HeadMat, Head2EEGMat, Head2MEGMat, Source2MEGMat);
-        EEGMEGGainMat.saveEEG(argv[9]);
-        EEGMEGGainMat.saveMEG(argv[10]);
+    #ifdef USE_MPI
+        if ( distributed ) {
+            DistributedSymMatrix HeadMat;
+            HeadMat.load(argv[5]);
+            GainEEGMEGadjoint EEGMEGGainMat(geo, dipoles, HeadMat, Head2EEGMat, Head2MEGMat, Source2MEGMat);
+            if ( mpi.rank() == 0 ) {
+                EEGMEGGainMat.saveEEG(argv[9]);
+                EEGMEGGainMat.saveMEG(argv[10]);
+            }
+        } else
+    #endif
+        {
+            SymMatrix HeadMat;
+            HeadMat.load(argv[5]);
+            GainEEGMEGadjoint EEGMEGGainMat(geo, dipoles, HeadMat, Head2EEGMat, Head2MEGMat, Source2MEGMat, precision);
+            EEGMEGGainMat.saveEEG(argv[9]);
+            EEGMEGGainMat.saveMEG(argv[10]);
+        }
     }
     else if ( (!strcmp(argv[1], "-InternalPotential"))|(!strcmp(argv[1], "-IP")) ) {
         if ( argc<7 ) {
@@ -187,7 +257,7 @@ int main(int argc, char **argv)
         Matrix Source2IPMat;
         Source2IPMat.load(argv[5]);
 
-        GainInternalPot InternalPotGainMat(HeadMatInv, SourceMat, Head2IPMat, Source2IPMat);
+        GainInternalPot InternalPotGainMat(HeadMatInv, SourceMat, Head2IPMat, Source2IPMat, precision);
         InternalPotGainMat.save(argv[6]);
     }
     else if ( (!strcmp(argv[1], "-StimInternalPotential"))|(!strcmp(argv[1], "-SIP")) ) {
@@ -202,7 +272,7 @@ int main(int argc, char **argv)
         Matrix Head2IPMat;
         Head2IPMat.load(argv[4]);
 
-        GainStimInternalPot StimInternalPotGainMat(HeadMatInv, SourceMat, Head2IPMat);
+        GainStimInternalPot StimInternalPotGainMat(HeadMatInv, SourceMat, Head2IPMat, precision);
         StimInternalPotGainMat.save(argv[5]);
     }
     else
@@ -214,12 +284,22 @@ int main(int argc, char **argv)
     C.stop();
     C.dispEllapsed();
 
+    if ( timings_file != "" ) {
+        timings::save_report(timings_file);
+    }
+
     return 0;
 }
 
 void getHelp(char** argv)
 {
     cout << argv[0] <<" [-option] [filepaths...]" << endl << endl;
+    cout << "   -timings file : write a timing report (file.json, file.csv or text) of the computation phases." << endl;
+    cout << "   -threads n : number of threads used by the linear algebra (default OMP_NUM_THREADS)." << endl;
+    cout << "   -precision mixed|double : with mixed, products and solves run in single precision and are" << endl;
+    cout << "                 checked (or refined) in double precision; .omc gains are stored in single precision." << endl;
+    cout << "   When run by several MPI processes (mpirun), the adjoint gains distribute the factorization of HeadMat" << endl;
+    cout << "   (read in parallel when it is a .bin file) and the dipoles over all of them (in double precision)." << endl << endl;
 
     cout << "-option :" << endl;
     cout << "   -EEG :   Compute the gain for EEG " << endl;
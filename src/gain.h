@@ -42,12 +42,16 @@ knowledge of the CeCILL-B license and that you accept its terms.
 
 #define USE_GMRES 0
 
+#include <sstream>
+
 #include "matrix.h"
 #include "sparse_matrix.h"
 #include "symmatrix.h"
 #include "matvectOps.h"
+#include "matexpr.h"
 #include "geometry.h"
 #include "assemble.h"
+#include "geometry_view.h"
 #include "gmres.h"
 
 namespace OpenMEEG {
@@ -55,8 +59,8 @@ namespace OpenMEEG {
     class GainMEG : public Matrix {
     public:
         using Matrix::operator=;
-        GainMEG (const SymMatrix& HeadMatInv,const Matrix& SourceMat, const Matrix& Head2MEGMat, const Matrix& Source2MEGMat) {
-            *this = Source2MEGMat+(Head2MEGMat*HeadMatInv)*SourceMat;
+        GainMEG (const SymMatrix& HeadMatInv,const Matrix& SourceMat, const Matrix& Head2MEGMat, const Matrix& Source2MEGMat, const Precision precision=FULL_PRECISION) {
+            *this = Source2MEGMat+maths::product(Head2MEGMat,HeadMatInv,SourceMat,precision);
         }
         ~GainMEG () {};
     };
@@ -64,18 +68,84 @@ namespace OpenMEEG {
     class GainEEG : public Matrix {
     public:
         using Matrix::operator=;
-        GainEEG (const SymMatrix& HeadMatInv,const Matrix& SourceMat, const SparseMatrix& Head2EEGMat) {
-            *this = (Head2EEGMat*HeadMatInv)*SourceMat;
+        GainEEG (const SymMatrix& HeadMatInv,const Matrix& SourceMat, const SparseMatrix& Head2EEGMat, const Precision precision=FULL_PRECISION) {
+            *this = maths::product(Head2EEGMat,HeadMatInv,SourceMat,precision).eval();
         }
         ~GainEEG () {};
     };
 
+    /** \brief Adjoint leadfields: LeadField(:,i) += mtemp(rows,:)*DipSourceMat(dipole i).
+
+        The dipoles are processed by blocks: the source columns of a block are assembled in
+        parallel (see assemble_DipSourceMat) and applied with one matrix product per leadfield,
+        written in place in the leadfield columns. LeadField uses the first rows of mtemp and
+        LeadField2 (if any) the following ones. The view of geo is built once for all the blocks,
+        and each block has its own checkpoint (AdjointDipSourceMat.<first dipole>), numbering the
+        dipoles from first_dipole. */
+
+    inline void adjoint_leadfields(const Geometry& geo,const Matrix& dipoles,const Matrix& mtemp,Matrix& LeadField,Matrix* LeadField2=0,
+                                   const size_t first_dipole=0) {
+        TIMED_SCOPE("adjoint_leadfields");
+        const unsigned gauss_order = 3;
+        const size_t   n_dipoles   = dipoles.nlin();
+        const size_t   block       = SymMatrix::panel_width(mtemp.ncol());
+        const GeometryView view(geo);
+        Matrix* leadfields[2] = { &LeadField, LeadField2 };
+        for (size_t j=0;j<n_dipoles;j+=block) {
+            const size_t bsize = std::min(block,n_dipoles-j);
+            std::ostringstream checkpoint;
+            checkpoint << "AdjointDipSourceMat." << first_dipole+j;
+            const Matrix dsm   = DipSourceMat(view,geo,dipoles.submat(j,bsize,0,dipoles.ncol()),gauss_order,true,"",checkpoint.str());
+            for (size_t k=0,row=0;k<2 && leadfields[k]!=0;row+=leadfields[k]->nlin(),++k) {
+                Matrix& LF = *leadfields[k];
+            #ifdef HAVE_BLAS
+                DGEMM(CblasNoTrans,CblasNoTrans,(int)LF.nlin(),(int)bsize,(int)dsm.nlin(),1.,mtemp.data()+row,(int)mtemp.nlin(),
+                      dsm.data(),(int)dsm.nlin(),1.,LF.data()+j*LF.nlin(),(int)LF.nlin());
+            #else
+                const Matrix& P = mtemp.submat(row,LF.nlin(),0,mtemp.ncol())*dsm;
+                for (size_t c=0;c<bsize;++c)
+                    for (size_t i=0;i<LF.nlin();++i)
+                        LF(i,j+c) += P(i,c);
+            #endif
+            }
+            PROGRESSBAR(j+bsize-1,n_dipoles);
+        }
+    }
+
+#ifdef USE_MPI
+    /// Adjoint leadfields shared by the processes of comm: each one computes those of a range of dipoles,
+    /// and the leadfields are then gathered on all of them.
+
+    inline void adjoint_leadfields(const Geometry& geo,const Matrix& dipoles,const Matrix& mtemp,Matrix& LeadField,Matrix* LeadField2,MPI_Comm comm) {
+        int rank,size;
+        MPI_Comm_rank(comm,&rank);
+        MPI_Comm_size(comm,&size);
+        const size_t n_dipoles = dipoles.nlin();
+        const size_t first     = n_dipoles*rank/size;
+        const size_t number    = n_dipoles*(rank+1)/size-first;
+        Matrix* leadfields[2] = { &LeadField, LeadField2 };
+        Matrix  parts[2];
+        for (size_t k=0;k<2 && leadfields[k]!=0;++k)
+            parts[k] = (number!=0) ? leadfields[k]->submat(0,leadfields[k]->nlin(),first,number) : Matrix(leadfields[k]->nlin(),1);
+        if (number!=0)
+            adjoint_leadfields(geo,dipoles.submat(first,number,0,dipoles.ncol()),mtemp,parts[0],(LeadField2!=0) ? &parts[1] : 0,first);
+        for (size_t k=0;k<2 && leadfields[k]!=0;++k) {
+            Matrix& LF = *leadfields[k];
+            std::vector<int> counts(size),displs(size);
+            for (int p=0;p<size;++p) {
+                displs[p] = LF.nlin()*(n_dipoles*p/size);
+                counts[p] = LF.nlin()*(n_dipoles*(p+1)/size)-displs[p];
+            }
+            MPI_Allgatherv(parts[k].data(),counts[rank],MPI_DOUBLE,LF.data(),&counts[0],&displs[0],MPI_DOUBLE,comm);
+        }
+    }
+#endif
+
     class GainEEGadjoint : public Matrix {
         public:
             using Matrix::operator=;
-            GainEEGadjoint (const Geometry& geo,const Matrix& dipoles,const SymMatrix& HeadMat, const SparseMatrix& Head2EEGMat) {
+            GainEEGadjoint (const Geometry& geo,const Matrix& dipoles,const SymMatrix& HeadMat, const SparseMatrix& Head2EEGMat, const Precision precision=FULL_PRECISION) {
                 Matrix LeadField(Head2EEGMat.nlin(),dipoles.nlin());
-                int gauss_order = 3;
                 // Consider the GMRes solver for problem with dimension > 15,000 (3,000 vertices per interface) else use LAPACK solver
                 #if USE_GMRES
                 Matrix mtemp(Head2EEGMat.nlin(),HeadMat.nlin());
@@ -90,15 +160,26 @@ namespace OpenMEEG {
                 }
                 #else
                 Matrix mtemp(Head2EEGMat.transpose());
-                HeadMat.solveLin(mtemp); // solving the system AX=B with LAPACK
+                HeadMat.solveLin(mtemp,precision); // solving the system AX=B with LAPACK
                 mtemp=mtemp.transpose();
                 #endif
-                for ( unsigned i = 0; i < LeadField.ncol(); ++i) {
-                    LeadField.setcol(i,mtemp * DipSourceMat(geo, dipoles.submat(i, 1, 0, dipoles.ncol()), gauss_order, true, "").getcol(0)); // TODO ugly
-                    PROGRESSBAR(i,LeadField.ncol());
-                }
+                LeadField.set(0.0);
+                adjoint_leadfields(geo,dipoles,mtemp,LeadField);
                 *this = LeadField;
             }
+        #ifdef USE_MPI
+            /// Distributed version: HeadMat is factorized in place by the processes of its communicator.
+            GainEEGadjoint (const Geometry& geo,const Matrix& dipoles,DistributedSymMatrix& HeadMat, const SparseMatrix& Head2EEGMat) {
+                Matrix LeadField(Head2EEGMat.nlin(),dipoles.nlin());
+                Matrix mtemp(Head2EEGMat.transpose());
+                HeadMat.factorize();
+                HeadMat.solveLin(mtemp);
+                mtemp = mtemp.transpose();
+                LeadField.set(0.0);
+                adjoint_leadfields(geo,dipoles,mtemp,LeadField,0,HeadMat.communicator());
+                *this = LeadField;
+            }
+        #endif
             ~GainEEGadjoint () {};
     };
 
@@ -108,9 +189,9 @@ namespace OpenMEEG {
             GainMEGadjoint (const Geometry& geo, const Matrix& dipoles,
                             const SymMatrix& HeadMat,
                             const Matrix& Head2MEGMat,
-                            const Matrix& Source2MEGMat) {
-                Matrix LeadField(Head2MEGMat.nlin(),dipoles.nlin());
-                int gauss_order = 3;
+                            const Matrix& Source2MEGMat,
+                            const Precision precision=FULL_PRECISION) {
+                Matrix LeadField(Source2MEGMat,DEEP_COPY); // the adjoint part is accumulated to the direct contribution
                 // Consider the GMRes solver for problem with dimension > 15,000 (3,000 vertices per interface) else use LAPACK solver
                 #if USE_GMRES
                 Matrix mtemp(Head2MEGMat.nlin(),HeadMat.nlin()); 
@@ -125,24 +206,35 @@ namespace OpenMEEG {
                 }
                 #else
                 Matrix mtemp(Head2MEGMat.transpose());
-                HeadMat.solveLin(mtemp); // solving the system AX=B with LAPACK
+                HeadMat.solveLin(mtemp,precision); // solving the system AX=B with LAPACK
                 mtemp=mtemp.transpose();
                 #endif
-                for (unsigned i=0;i<LeadField.ncol();i++) {
-                    LeadField.setcol(i, mtemp * DipSourceMat(geo, dipoles.submat(i, 1, 0, dipoles.ncol()), gauss_order, true, "").getcol(0)+Source2MEGMat.getcol(i)); // TODO ugly
-                    PROGRESSBAR(i,LeadField.ncol());
-                }
+                adjoint_leadfields(geo,dipoles,mtemp,LeadField);
                 *this = LeadField;
             }
+        #ifdef USE_MPI
+            /// Distributed version: HeadMat is factorized in place by the processes of its communicator.
+            GainMEGadjoint (const Geometry& geo, const Matrix& dipoles,
+                            DistributedSymMatrix& HeadMat,
+                            const Matrix& Head2MEGMat,
+                            const Matrix& Source2MEGMat) {
+                Matrix LeadField(Source2MEGMat,DEEP_COPY);
+                Matrix mtemp(Head2MEGMat.transpose());
+                HeadMat.factorize();
+                HeadMat.solveLin(mtemp);
+                mtemp = mtemp.transpose();
+                adjoint_leadfields(geo,dipoles,mtemp,LeadField,0,HeadMat.communicator());
+                *this = LeadField;
+            }
+        #endif
             ~GainMEGadjoint () {};
     };
 
     class GainEEGMEGadjoint {
         public:
-            GainEEGMEGadjoint (const Geometry& geo,const Matrix& dipoles,const SymMatrix& HeadMat, const SparseMatrix& Head2EEGMat, const Matrix& Head2MEGMat, const Matrix& Source2MEGMat) {
-                unsigned gauss_order = 3;
+            GainEEGMEGadjoint (const Geometry& geo,const Matrix& dipoles,const SymMatrix& HeadMat, const SparseMatrix& Head2EEGMat, const Matrix& Head2MEGMat, const Matrix& Source2MEGMat, const Precision precision=FULL_PRECISION) {
                 this->EEGleadfield = Matrix(Head2EEGMat.nlin(), dipoles.nlin());
-                this->MEGleadfield = Matrix(Head2MEGMat.nlin(), dipoles.nlin());
+                this->MEGleadfield = Matrix(Source2MEGMat,DEEP_COPY);
                 Matrix RHS(Head2EEGMat.nlin()+Head2MEGMat.nlin(), HeadMat.nlin());
 
                 for ( unsigned i = 0; i < Head2EEGMat.nlin(); ++i) {
@@ -165,16 +257,32 @@ namespace OpenMEEG {
                 }
                 #else
                 Matrix mtemp(RHS.transpose());
-                HeadMat.solveLin(mtemp); // solving the system AX=B with LAPACK
+                HeadMat.solveLin(mtemp,precision); // solving the system AX=B with LAPACK
                 mtemp = mtemp.transpose();
                 #endif
-                for ( unsigned i = 0; i < dipoles.nlin(); ++i) {
-                    Vector dsm = DipSourceMat(geo,dipoles.submat(i, 1, 0, dipoles.ncol()), gauss_order, true, "").getcol(0); // TODO ugly
-                    EEGleadfield.setcol(i, mtemp.submat(0, Head2EEGMat.nlin(), 0, HeadMat.nlin()) * dsm);
-                    MEGleadfield.setcol(i, mtemp.submat(Head2EEGMat.nlin(), Head2MEGMat.nlin(), 0, HeadMat.nlin()) * dsm + Source2MEGMat.getcol(i));
-                    PROGRESSBAR(i, dipoles.nlin());
+                EEGleadfield.set(0.0);
+                adjoint_leadfields(geo,dipoles,mtemp,EEGleadfield,&MEGleadfield);
+            }
+        #ifdef USE_MPI
+            /// Distributed version: HeadMat is factorized in place by the processes of its communicator.
+            GainEEGMEGadjoint (const Geometry& geo,const Matrix& dipoles,DistributedSymMatrix& HeadMat, const SparseMatrix& Head2EEGMat, const Matrix& Head2MEGMat, const Matrix& Source2MEGMat) {
+                this->EEGleadfield = Matrix(Head2EEGMat.nlin(), dipoles.nlin());
+                this->MEGleadfield = Matrix(Source2MEGMat,DEEP_COPY);
+                Matrix RHS(Head2EEGMat.nlin()+Head2MEGMat.nlin(), HeadMat.nlin());
+                for ( unsigned i = 0; i < Head2EEGMat.nlin(); ++i) {
+                    RHS.setlin(i, Head2EEGMat.getlin(i));
+                }
+                for ( unsigned i = 0; i < Head2MEGMat.nlin(); ++i) {
+                    RHS.setlin(i + Head2EEGMat.nlin(), Head2MEGMat.getlin(i));
                 }
+                Matrix mtemp(RHS.transpose());
+                HeadMat.factorize();
+                HeadMat.solveLin(mtemp);
+                mtemp = mtemp.transpose();
+                EEGleadfield.set(0.0);
+                adjoint_leadfields(geo,dipoles,mtemp,EEGleadfield,&MEGleadfield,HeadMat.communicator());
             }
+        #endif
             
             void saveEEG( const std::string filename ) const { EEGleadfield.save(filename); }
 
@@ -189,8 +297,8 @@ namespace OpenMEEG {
     class GainInternalPot : public Matrix {
     public:
         using Matrix::operator=;
-        GainInternalPot (const SymMatrix& HeadMatInv, const Matrix& SourceMat, const Matrix& Head2IPMat, const Matrix& Source2IPMat) {
-            *this = Source2IPMat + (Head2IPMat * HeadMatInv) * SourceMat;
+        GainInternalPot (const SymMatrix& HeadMatInv, const Matrix& SourceMat, const Matrix& Head2IPMat, const Matrix& Source2IPMat, const Precision precision=FULL_PRECISION) {
+            *this = Source2IPMat+maths::product(Head2IPMat,HeadMatInv,SourceMat,precision);
         }
         ~GainInternalPot () {};
     };
@@ -198,8 +306,8 @@ namespace OpenMEEG {
    class GainStimInternalPot : public Matrix {
     public:
         using Matrix::operator=;
-        GainStimInternalPot (const SymMatrix& HeadMatInv, const Matrix& SourceMat, const Matrix& Head2IPMat) {
-            *this = (Head2IPMat * HeadMatInv) * SourceMat;
+        GainStimInternalPot (const SymMatrix& HeadMatInv, const Matrix& SourceMat, const Matrix& Head2IPMat, const Precision precision=FULL_PRECISION) {
+            *this = maths::product(Head2IPMat,HeadMatInv,SourceMat,precision).eval();
         }
         ~GainStimInternalPot () {};
     };
@@ -40,6 +40,9 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #include <geometry.h>
 #include <geometry_reader.h>
 #include <geometry_io.h>
+#include <geometry_snapshot.h>
+#include <mesh_reader.h>
+#include <algorithm>
 
 namespace OpenMEEG {
 
@@ -137,6 +140,8 @@ namespace OpenMEEG {
 
     void Geometry::read(const std::string& geomFileName, const std::string& condFileName, const bool OLD_ORDERING) 
     {
+        TIMED_SCOPE("Geometry::read");
+
         // clear all first
         vertices_.clear();
         meshes_.clear();
@@ -145,6 +150,17 @@ namespace OpenMEEG {
 
         GeometryReader geoR(*this);
 
+        // a snapshot holds the geometry already built (the cond file, if given, overrides its conductivities)
+        if ( GeometrySnapshot::is_snapshot(geomFileName) ) {
+            GeometrySnapshot::load(*this, geomFileName, OLD_ORDERING);
+            if ( condFileName != "" ) {
+                geoR.read_cond(condFileName);
+                has_cond_ = true;
+            }
+            info();
+            return;
+        }
+
         geoR.read_geom(geomFileName);
 
         if ( condFileName != "" ) {
@@ -323,8 +339,6 @@ namespace OpenMEEG {
         meshes_.clear();
         vertices_.clear();
         unsigned n_vert_max = 0;
-        unsigned iit = 0;
-        std::map<const Vertex *, Vertex *> map_vertices;
 
         // count the vertices
         for ( Meshes::const_iterator mit = m.begin(); mit != m.end(); ++mit) {
@@ -334,23 +348,29 @@ namespace OpenMEEG {
         vertices_.reserve(n_vert_max);
         meshes_.reserve(m.size());
 
-        for ( Meshes::const_iterator mit = m.begin(); mit != m.end(); ++mit, ++iit) {
-            meshes_.push_back(Mesh(vertices_, mit->name()));
-            for ( Mesh::const_vertex_iterator vit = mit->vertex_begin(); vit != mit->vertex_end(); vit++) {
-                meshes_[iit].add_vertex(**vit);
-                map_vertices[*vit] = *meshes_[iit].vertex_rbegin();
+        // Copy the meshes in the geometry, welding the vertices they share.
+        VertexWelder welder(vertices_, n_vert_max);
+        for ( Meshes::const_iterator mit = m.begin(); mit != m.end(); ++mit) {
+            MeshData data;
+            // positions of the mesh vertices, looked up by address for the triangles.
+            std::vector<std::pair<const Vertex *, unsigned> > positions;
+            positions.reserve(mit->nb_vertices());
+            for ( Mesh::const_vertex_iterator vit = mit->vertex_begin(); vit != mit->vertex_end(); ++vit) {
+                positions.push_back(std::make_pair(*vit, data.points.size()));
+                data.points.push_back(**vit);
             }
-        }
-
-        // Copy the triangles in the geometry.
-        iit = 0;
-        for ( Meshes::const_iterator mit = m.begin(); mit != m.end(); ++mit, ++iit) {
+            std::sort(positions.begin(), positions.end());
+            data.triangles.reserve(3*mit->nb_triangles());
             for ( Mesh::const_iterator tit = mit->begin(); tit != mit->end(); ++tit) {
-                meshes_[iit].push_back(Triangle(map_vertices[(*tit)[0]], 
-                                                map_vertices[(*tit)[1]], 
-                                                map_vertices[(*tit)[2]]));
+                for ( unsigned k = 0; k < 3; ++k) {
+                    const std::pair<const Vertex *, unsigned> key((*tit)[k], 0);
+                    data.triangles.push_back(std::lower_bound(positions.begin(), positions.end(), key)->second);
+                }
             }
-            meshes_[iit].update();
+            meshes_.push_back(Mesh());
+            meshes_.back().name() = mit->name();
+            meshes_.back().import(data, welder);
+            meshes_.back().update();
         }
     }
 }
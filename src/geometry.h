@@ -66,6 +66,9 @@ namespace OpenMEEG {
         /// friend class for reading geom/cond files.
         friend class GeometryReader;
 
+        /// friend class for reading/writing geometry snapshots.
+        friend class GeometrySnapshot;
+
     public:
 
         /// Default iterator of a Geometry is an Iterator on the meshes
@@ -46,6 +46,7 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #include <IOUtils.H>
 #include <PropertiesSpecialized.h>
 #include <geometry_io.h>
+#include <mesh_reader.h>
 
 namespace OpenMEEG {
 
@@ -224,15 +225,43 @@ namespace OpenMEEG {
                         >> io_utils::token(interfacename[i], ':') 
                         >> io_utils::filename(filename[i], '"', false);
                 }
-                Mesh m;
                 fullname[i] = (is_relative_path(filename[i]))?path+filename[i]:filename[i];
-                nb_vertices += m.load(fullname[i], false, false); 
+            }
+            // Parse the mesh files concurrently (.tri, .bnd and .off files, the others are counted)
+            std::vector<MeshData> data(nb_interfaces);
+            std::vector<unsigned> nb_mesh_vertices(nb_interfaces);
+            std::vector<char>     parsed(nb_interfaces);
+            #pragma omp parallel for schedule(dynamic)
+            for ( int i = 0; i < static_cast<int>(nb_interfaces); ++i ) {
+                parsed[i] = read_mesh_data(fullname[i], data[i]);
+                if ( !parsed[i] ) {
+                    #pragma omp critical
+                    {
+                        Mesh m;
+                        nb_mesh_vertices[i] = m.load(fullname[i], false, false);
+                    }
+                } else {
+                    nb_mesh_vertices[i] = data[i].points.size();
+                }
+            }
+            for ( unsigned i = 0; i < nb_interfaces; ++i ) {
+                nb_vertices += nb_mesh_vertices[i];
             }
             geo_.vertices_.reserve(nb_vertices);
-            // Second really load the meshes
+            // Second put the meshes in the geometry, in order, welding the shared vertices
+            VertexWelder welder(geo_.vertices_, nb_vertices);
             for ( unsigned i = 0; i < nb_interfaces; ++i ) {
-                geo_.meshes_.push_back(Mesh(geo_.vertices_, interfacename[i]));
-                geo_.meshes_[i].load(fullname[i], false);
+                if ( parsed[i] ) {
+                    geo_.meshes_.push_back(Mesh());
+                    geo_.meshes_[i].name() = interfacename[i];
+                    geo_.meshes_[i].import(data[i], welder);
+                    geo_.meshes_[i].update();
+                    data[i] = MeshData(); // release the parsed copy
+                } else {
+                    geo_.meshes_.push_back(Mesh(geo_.vertices_, interfacename[i]));
+                    geo_.meshes_[i].load(fullname[i], false);
+                    welder.sync();
+                }
                 interfaces.push_back( Interface(interfacename[i]) );
                 interfaces[i].push_back(OrientedMesh(geo_.meshes_[i], true)); // one mesh per interface, (well oriented)
             }
@@ -0,0 +1,625 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#if !WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <ChunkedBinIO.H>
+#include <geometry.h>
+#include <geometry_snapshot.h>
+
+namespace OpenMEEG {
+
+    const uint32_t GeometrySnapshot::version;
+
+    namespace {
+
+        const char     magic[8]   = { 'O', 'M', 'G', 'E', 'O', 'S', 'N', 'P' };
+        const uint32_t byte_order = 0x01020304;
+
+        //  Header flags. The two ordering flags tell which numbering(s) of the unknowns (see
+        //  Geometry::generate_indices) the stored indices correspond to.
+
+        const uint32_t HAS_COND         = 1;
+        const uint32_t IS_NESTED        = 2;
+        const uint32_t ORDERING_DEFAULT = 4;
+        const uint32_t ORDERING_OLD     = 8;
+
+        typedef enum { VERTICES, VERTEX_INDICES, MESHES, MESH_VERTICES, TRIANGLES, TRIANGLE_INDICES, NORMALS, AREAS,
+                       ADJACENCY_VERTICES, ADJACENCY_OFFSETS, ADJACENCY_TRIANGLES, DOMAINS, HALFSPACES,
+                       ORIENTED_MESHES, NAMES, NB_SECTIONS } Section;
+
+        struct Header {
+            char     magic[8];
+            uint32_t version;
+            uint32_t byte_order;
+            uint32_t flags;
+            uint32_t size;                 // Number of unknowns.
+            uint32_t nb_vertices;
+            uint32_t nb_mesh_vertices;     // Sum of the numbers of vertices of the meshes.
+            uint32_t nb_meshes;
+            uint32_t nb_triangles;
+            uint32_t nb_domains;
+            uint32_t nb_halfspaces;
+            uint32_t nb_oriented_meshes;
+            uint32_t nb_adjacency_rows;
+            uint32_t nb_adjacency_entries;
+            uint32_t names_size;
+            uint32_t checksum;             // Adler-32 of the file after the header.
+            uint32_t reserved;
+            uint64_t file_size;
+            uint64_t offsets[NB_SECTIONS];
+        };
+
+        //  Vertices, triangles and adjacency rows of a mesh are ranges of the corresponding sections.
+        //  Vertices and triangle corners are given by their position in the vertex section, the adjacency
+        //  rows are sorted by vertex position and list the positions of the triangles within the mesh.
+
+        struct MeshRecord {
+            uint32_t name;
+            uint32_t name_length;
+            uint32_t first_vertex;
+            uint32_t nb_vertices;
+            uint32_t first_triangle;
+            uint32_t nb_triangles;
+            uint32_t first_row;
+            uint32_t nb_rows;
+            uint32_t outermost;
+            uint32_t reserved;
+        };
+
+        struct DomainRecord {
+            double   sigma;
+            uint32_t name;
+            uint32_t name_length;
+            uint32_t first_halfspace;
+            uint32_t nb_halfspaces;
+            uint32_t outermost;
+            uint32_t reserved;
+        };
+
+        //  A half-space holds its own interface (the name, the outermost flag and the oriented meshes).
+
+        struct HalfSpaceRecord {
+            uint32_t name;
+            uint32_t name_length;
+            uint32_t first_oriented_mesh;
+            uint32_t nb_oriented_meshes;
+            uint32_t outermost;
+            uint32_t inside;
+        };
+
+        struct OrientedMeshRecord {
+            uint32_t mesh;
+            uint32_t well_oriented;
+        };
+
+        //  Read only view of a whole file: mapped in memory when the system allows it, read at once otherwise.
+
+        class MappedFile {
+        public:
+
+            MappedFile(const std::string& filename): data_(0),size_(0) {
+            #if WIN32
+                std::ifstream ifs(filename.c_str(),std::ios::in|std::ios::binary);
+                if (!ifs.is_open())
+                    return;
+                ifs.seekg(0,std::ios::end);
+                buffer_.resize(ifs.tellg());
+                ifs.seekg(0,std::ios::beg);
+                if (buffer_.size()!=0 && ifs.read(&buffer_[0],buffer_.size())) {
+                    data_ = &buffer_[0];
+                    size_ = buffer_.size();
+                }
+            #else
+                const int fd = open(filename.c_str(),O_RDONLY);
+                if (fd<0)
+                    return;
+                struct stat st;
+                if (fstat(fd,&st)==0 && st.st_size>0) {
+                    void* map = mmap(0,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+                    if (map!=MAP_FAILED) {
+                        data_ = static_cast<const char*>(map);
+                        size_ = st.st_size;
+                    }
+                }
+                close(fd);
+            #endif
+            }
+
+            ~MappedFile() {
+            #if !WIN32
+                if (data_)
+                    munmap(const_cast<char*>(data_),size_);
+            #endif
+            }
+
+            const char* data() const { return data_; }
+            size_t      size() const { return size_; }
+
+        private:
+
+            const char*       data_;
+            size_t            size_;
+        #if WIN32
+            std::vector<char> buffer_;
+        #endif
+        };
+
+        template <typename T>
+        const T* section(const char* data,const Header& header,const Section s) {
+            return reinterpret_cast<const T*>(data+header.offsets[s]);
+        }
+
+        //  Bytes of the sections of a snapshot being written.
+
+        class Writer {
+        public:
+
+            Writer(Header& header): header_(header),buffer_(sizeof(Header),0) { }
+
+            template <typename T>
+            void append(const Section s,const std::vector<T>& v) {
+                header_.offsets[s] = buffer_.size();
+                const char* p = (v.size()) ? reinterpret_cast<const char*>(&v[0]) : 0;
+                buffer_.insert(buffer_.end(),p,p+v.size()*sizeof(T));
+                buffer_.resize((buffer_.size()+7)/8*8,0);
+            }
+
+            std::vector<char>& buffer() { return buffer_; }
+
+        private:
+
+            Header&           header_;
+            std::vector<char> buffer_;
+        };
+
+        class NameTable {
+        public:
+
+            void add(const std::string& name,uint32_t& offset,uint32_t& length) {
+                offset = names_.size();
+                length = name.size();
+                names_.insert(names_.end(),name.begin(),name.end());
+            }
+
+            const std::vector<char>& names() const { return names_; }
+
+        private:
+
+            std::vector<char> names_;
+        };
+
+        //  The numberings of Geometry::generate_indices which the indices of the geometry correspond to.
+
+        uint32_t orderings(const Geometry& geo) {
+            const Vertex* base = &*geo.vertex_begin();
+            uint32_t result = 0;
+            for (unsigned old=0;old<2;++old) {
+                std::vector<unsigned> vindices(geo.nb_vertices());
+                unsigned index = 0;
+                if (!old)
+                    for (;index<vindices.size();++index)
+                        vindices[index] = index;
+                bool same = true;
+                for (Geometry::const_iterator mit=geo.begin();mit!=geo.end();++mit) {
+                    if (old)
+                        for (Mesh::const_vertex_iterator vit=mit->vertex_begin();vit!=mit->vertex_end();++vit)
+                            vindices[*vit-base] = index++;
+                    if (!mit->outermost())
+                        for (Mesh::const_iterator tit=mit->begin();tit!=mit->end();++tit)
+                            same = same && tit->index()==index++;
+                }
+                for (Geometry::const_iterator mit=geo.begin();mit!=geo.end();++mit)
+                    if (mit->outermost())
+                        for (Mesh::const_iterator tit=mit->begin();tit!=mit->end();++tit)
+                            same = same && tit->index()==index++;
+                for (unsigned i=0;i<vindices.size();++i)
+                    same = same && geo.vertices()[i].index()==vindices[i];
+                if (same && index==geo.size())
+                    result |= (old) ? ORDERING_OLD : ORDERING_DEFAULT;
+            }
+            return result;
+        }
+
+        //  Validation of a snapshot held in memory.
+
+        class Validator {
+        public:
+
+            Validator(const std::string& filename): filename_(filename),ok_(true) { }
+
+            bool operator()(const bool cond,const char* message) {
+                if (!cond && ok_)
+                    std::cerr << "Snapshot " << filename_ << ": " << message << "." << std::endl;
+                ok_ = ok_ && cond;
+                return cond;
+            }
+
+            bool section(const Header& header,const size_t size,const Section s,const uint64_t count,const size_t elemsize) {
+                const uint64_t offset = header.offsets[s];
+                return (*this)(offset>=sizeof(Header) && offset%8==0 && offset<=size && count<=(size-offset)/elemsize,
+                               "a section exceeds the file");
+            }
+
+            bool range(const uint64_t first,const uint64_t n,const uint64_t total,const char* message) {
+                return (*this)(first<=total && n<=total-first,message);
+            }
+
+            bool ok() const { return ok_; }
+
+        private:
+
+            const std::string filename_;
+            bool              ok_;
+        };
+
+        bool validate(const MappedFile& file,const std::string& filename) {
+
+            Validator valid(filename);
+            if (!valid(file.data()!=0,"unable to read the file") || !valid(file.size()>=sizeof(Header),"truncated header"))
+                return false;
+
+            const char*   data   = file.data();
+            const Header& header = *reinterpret_cast<const Header*>(data);
+            if (!valid(std::memcmp(header.magic,magic,sizeof(magic))==0,"not a geometry snapshot") ||
+                !valid(header.byte_order==byte_order,"written on a machine with another byte order") ||
+                !valid(header.version==GeometrySnapshot::version,"unsupported version") ||
+                !valid(header.file_size==file.size(),"truncated file") ||
+                !valid(header.checksum==maths::Chunked::adler32(data+sizeof(Header),file.size()-sizeof(Header)),"bad checksum"))
+                return false;
+
+            const size_t size = file.size();
+            const uint64_t nv = header.nb_vertices;
+            const uint64_t nt = header.nb_triangles;
+            valid.section(header,size,VERTICES,3*nv,sizeof(double));
+            valid.section(header,size,VERTEX_INDICES,nv,sizeof(uint32_t));
+            valid.section(header,size,MESHES,header.nb_meshes,sizeof(MeshRecord));
+            valid.section(header,size,MESH_VERTICES,header.nb_mesh_vertices,sizeof(uint32_t));
+            valid.section(header,size,TRIANGLES,3*nt,sizeof(uint32_t));
+            valid.section(header,size,TRIANGLE_INDICES,nt,sizeof(uint32_t));
+            valid.section(header,size,NORMALS,3*nt,sizeof(double));
+            valid.section(header,size,AREAS,nt,sizeof(double));
+            valid.section(header,size,ADJACENCY_VERTICES,header.nb_adjacency_rows,sizeof(uint32_t));
+            valid.section(header,size,ADJACENCY_OFFSETS,header.nb_adjacency_rows+1ULL,sizeof(uint32_t));
+            valid.section(header,size,ADJACENCY_TRIANGLES,header.nb_adjacency_entries,sizeof(uint32_t));
+            valid.section(header,size,DOMAINS,header.nb_domains,sizeof(DomainRecord));
+            valid.section(header,size,HALFSPACES,header.nb_halfspaces,sizeof(HalfSpaceRecord));
+            valid.section(header,size,ORIENTED_MESHES,header.nb_oriented_meshes,sizeof(OrientedMeshRecord));
+            valid.section(header,size,NAMES,header.names_size,sizeof(char));
+            if (!valid.ok() || !valid(nv>0 && header.nb_meshes>0,"empty geometry"))
+                return false;
+
+            const uint32_t* mesh_vertices = section<uint32_t>(data,header,MESH_VERTICES);
+            for (unsigned i=0;i<header.nb_mesh_vertices;++i)
+                valid(mesh_vertices[i]<nv,"vertex out of range");
+            const uint32_t* triangles = section<uint32_t>(data,header,TRIANGLES);
+            for (unsigned i=0;i<3*nt;++i)
+                valid(triangles[i]<nv,"triangle vertex out of range");
+            const uint32_t* rows = section<uint32_t>(data,header,ADJACENCY_VERTICES);
+            for (unsigned i=0;i<header.nb_adjacency_rows;++i)
+                valid(rows[i]<nv,"adjacency vertex out of range");
+            const uint32_t* offsets = section<uint32_t>(data,header,ADJACENCY_OFFSETS);
+            valid(offsets[0]==0 && offsets[header.nb_adjacency_rows]==header.nb_adjacency_entries,"bad adjacency offsets");
+            for (unsigned i=0;i<header.nb_adjacency_rows;++i)
+                valid(offsets[i]<=offsets[i+1],"bad adjacency offsets");
+            if (!valid.ok())
+                return false;
+
+            const uint32_t*   adjacency = section<uint32_t>(data,header,ADJACENCY_TRIANGLES);
+            const MeshRecord* meshes    = section<MeshRecord>(data,header,MESHES);
+            for (unsigned m=0;m<header.nb_meshes;++m) {
+                const MeshRecord& mesh = meshes[m];
+                valid.range(mesh.name,mesh.name_length,header.names_size,"mesh name out of range");
+                valid.range(mesh.first_vertex,mesh.nb_vertices,header.nb_mesh_vertices,"mesh vertices out of range");
+                valid.range(mesh.first_triangle,mesh.nb_triangles,nt,"mesh triangles out of range");
+                if (valid.range(mesh.first_row,mesh.nb_rows,header.nb_adjacency_rows,"mesh adjacency out of range"))
+                    for (unsigned i=offsets[mesh.first_row];i<offsets[mesh.first_row+mesh.nb_rows];++i)
+                        valid(adjacency[i]<mesh.nb_triangles,"adjacent triangle out of range");
+            }
+
+            const DomainRecord*       domains    = section<DomainRecord>(data,header,DOMAINS);
+            const HalfSpaceRecord*    halfspaces = section<HalfSpaceRecord>(data,header,HALFSPACES);
+            const OrientedMeshRecord* oriented   = section<OrientedMeshRecord>(data,header,ORIENTED_MESHES);
+            for (unsigned d=0;d<header.nb_domains;++d) {
+                valid.range(domains[d].name,domains[d].name_length,header.names_size,"domain name out of range");
+                valid.range(domains[d].first_halfspace,domains[d].nb_halfspaces,header.nb_halfspaces,"domain half-spaces out of range");
+            }
+            for (unsigned h=0;h<header.nb_halfspaces;++h) {
+                valid.range(halfspaces[h].name,halfspaces[h].name_length,header.names_size,"interface name out of range");
+                valid.range(halfspaces[h].first_oriented_mesh,halfspaces[h].nb_oriented_meshes,header.nb_oriented_meshes,"interface meshes out of range");
+            }
+            for (unsigned i=0;i<header.nb_oriented_meshes;++i)
+                valid(oriented[i].mesh<header.nb_meshes,"interface mesh out of range");
+
+            return valid.ok();
+        }
+    }
+
+    bool GeometrySnapshot::is_snapshot(const std::string& filename) {
+        std::ifstream ifs(filename.c_str(),std::ios::in|std::ios::binary);
+        char buf[sizeof(magic)];
+        return ifs.read(buf,sizeof(magic)) && std::memcmp(buf,magic,sizeof(magic))==0;
+    }
+
+    bool GeometrySnapshot::check(const std::string& filename) {
+        const MappedFile file(filename);
+        return validate(file,filename);
+    }
+
+    void GeometrySnapshot::save(const Geometry& geo,const std::string& filename) {
+
+        Header header;
+        std::memset(&header,0,sizeof(Header));
+        std::memcpy(header.magic,magic,sizeof(magic));
+        header.version    = version;
+        header.byte_order = byte_order;
+        header.flags      = ((geo.has_cond()) ? HAS_COND : 0) | ((geo.is_nested()) ? IS_NESTED : 0) | orderings(geo);
+        header.size       = geo.size();
+
+        const Vertex* base = &*geo.vertex_begin();
+        std::vector<double>   coords;
+        std::vector<uint32_t> vindices;
+        coords.reserve(3*geo.nb_vertices());
+        vindices.reserve(geo.nb_vertices());
+        for (Vertices::const_iterator vit=geo.vertex_begin();vit!=geo.vertex_end();++vit) {
+            coords.push_back(vit->x());
+            coords.push_back(vit->y());
+            coords.push_back(vit->z());
+            vindices.push_back(vit->index());
+        }
+
+        NameTable names;
+        std::vector<MeshRecord> meshes(geo.nb_meshes());
+        std::vector<uint32_t>   mesh_vertices,triangles,tindices,rows,offsets(1,0),adjacency;
+        std::vector<double>     normals,areas;
+        for (unsigned m=0;m<geo.nb_meshes();++m) {
+            const Mesh& mesh   = geo.meshes()[m];
+            MeshRecord& record = meshes[m];
+            names.add(mesh.name(),record.name,record.name_length);
+            record.first_vertex   = mesh_vertices.size();
+            record.nb_vertices    = mesh.nb_vertices();
+            record.first_triangle = tindices.size();
+            record.nb_triangles   = mesh.nb_triangles();
+            record.first_row      = rows.size();
+            record.nb_rows        = mesh.links_.size();
+            record.outermost      = mesh.outermost();
+            record.reserved       = 0;
+            for (Mesh::const_vertex_iterator vit=mesh.vertex_begin();vit!=mesh.vertex_end();++vit)
+                mesh_vertices.push_back(*vit-base);
+            for (Mesh::const_iterator tit=mesh.begin();tit!=mesh.end();++tit) {
+                for (unsigned i=0;i<3;++i) {
+                    triangles.push_back(&tit->vertex(i)-base);
+                    normals.push_back(tit->normal()(i));
+                }
+                tindices.push_back(tit->index());
+                areas.push_back(tit->area());
+            }
+
+            //  The links are ordered by vertex address, i.e. by vertex position.
+
+            const Triangle* first = &*mesh.begin();
+            for (std::map<const Vertex*,Mesh::VectPTriangle>::const_iterator lit=mesh.links_.begin();lit!=mesh.links_.end();++lit) {
+                rows.push_back(lit->first-base);
+                for (Mesh::VectPTriangle::const_iterator tit=lit->second.begin();tit!=lit->second.end();++tit)
+                    adjacency.push_back(*tit-first);
+                offsets.push_back(adjacency.size());
+            }
+        }
+
+        std::vector<DomainRecord>       domains(geo.nb_domains());
+        std::vector<HalfSpaceRecord>    halfspaces;
+        std::vector<OrientedMeshRecord> oriented;
+        for (unsigned d=0;d<geo.nb_domains();++d) {
+            const Domain& domain = geo.domains()[d];
+            DomainRecord& record = domains[d];
+            names.add(domain.name(),record.name,record.name_length);
+            record.sigma           = domain.sigma();
+            record.first_halfspace = halfspaces.size();
+            record.nb_halfspaces   = domain.size();
+            record.outermost       = domain.outermost();
+            record.reserved        = 0;
+            for (Domain::const_iterator hit=domain.begin();hit!=domain.end();++hit) {
+                const Interface& interface = hit->interface();
+                HalfSpaceRecord hs;
+                names.add(interface.name(),hs.name,hs.name_length);
+                hs.first_oriented_mesh = oriented.size();
+                hs.nb_oriented_meshes  = interface.size();
+                hs.outermost           = interface.outermost();
+                hs.inside              = hit->inside();
+                halfspaces.push_back(hs);
+                for (Interface::const_iterator omit=interface.begin();omit!=interface.end();++omit) {
+                    OrientedMeshRecord om;
+                    om.mesh          = &omit->mesh()-&geo.meshes()[0];
+                    om.well_oriented = omit->second;
+                    oriented.push_back(om);
+                }
+            }
+        }
+
+        header.nb_vertices          = geo.nb_vertices();
+        header.nb_mesh_vertices     = mesh_vertices.size();
+        header.nb_meshes            = geo.nb_meshes();
+        header.nb_triangles         = tindices.size();
+        header.nb_domains           = geo.nb_domains();
+        header.nb_halfspaces        = halfspaces.size();
+        header.nb_oriented_meshes   = oriented.size();
+        header.nb_adjacency_rows    = rows.size();
+        header.nb_adjacency_entries = adjacency.size();
+        header.names_size           = names.names().size();
+
+        Writer writer(header);
+        writer.append(VERTICES,coords);
+        writer.append(VERTEX_INDICES,vindices);
+        writer.append(MESHES,meshes);
+        writer.append(MESH_VERTICES,mesh_vertices);
+        writer.append(TRIANGLES,triangles);
+        writer.append(TRIANGLE_INDICES,tindices);
+        writer.append(NORMALS,normals);
+        writer.append(AREAS,areas);
+        writer.append(ADJACENCY_VERTICES,rows);
+        writer.append(ADJACENCY_OFFSETS,offsets);
+        writer.append(ADJACENCY_TRIANGLES,adjacency);
+        writer.append(DOMAINS,domains);
+        writer.append(HALFSPACES,halfspaces);
+        writer.append(ORIENTED_MESHES,oriented);
+        writer.append(NAMES,names.names());
+
+        std::vector<char>& buffer = writer.buffer();
+        header.file_size = buffer.size();
+        header.checksum  = maths::Chunked::adler32(&buffer[sizeof(Header)],buffer.size()-sizeof(Header));
+        std::memcpy(&buffer[0],&header,sizeof(Header));
+
+        std::ofstream ofs(filename.c_str(),std::ios::out|std::ios::binary);
+        if (!ofs.is_open() || !ofs.write(&buffer[0],buffer.size())) {
+            std::cerr << "Error writing geometry snapshot " << filename << std::endl;
+            exit(1);
+        }
+    }
+
+    void GeometrySnapshot::load(Geometry& geo,const std::string& filename,const bool OLD_ORDERING) {
+
+        const MappedFile file(filename);
+        if (!validate(file,filename))
+            exit(1);
+
+        const char*   data   = file.data();
+        const Header& header = *reinterpret_cast<const Header*>(data);
+
+        geo.vertices_.clear();
+        geo.meshes_.clear();
+        geo.domains_.clear();
+
+        //  The vertex storage is filled first and never grows afterwards (meshes point into it).
+
+        const double*   coords   = section<double>(data,header,VERTICES);
+        const uint32_t* vindices = section<uint32_t>(data,header,VERTEX_INDICES);
+        geo.vertices_.reserve(header.nb_vertices);
+        for (unsigned i=0;i<header.nb_vertices;++i)
+            geo.vertices_.push_back(Vertex(coords[3*i],coords[3*i+1],coords[3*i+2],vindices[i]));
+
+        const char*       names         = section<char>(data,header,NAMES);
+        const MeshRecord* meshes        = section<MeshRecord>(data,header,MESHES);
+        const uint32_t*   mesh_vertices = section<uint32_t>(data,header,MESH_VERTICES);
+        const uint32_t*   triangles     = section<uint32_t>(data,header,TRIANGLES);
+        const uint32_t*   tindices      = section<uint32_t>(data,header,TRIANGLE_INDICES);
+        const double*     normals       = section<double>(data,header,NORMALS);
+        const double*     areas         = section<double>(data,header,AREAS);
+        const uint32_t*   rows          = section<uint32_t>(data,header,ADJACENCY_VERTICES);
+        const uint32_t*   offsets       = section<uint32_t>(data,header,ADJACENCY_OFFSETS);
+        const uint32_t*   adjacency     = section<uint32_t>(data,header,ADJACENCY_TRIANGLES);
+
+        geo.meshes_.resize(header.nb_meshes);
+        Vertex* vertices = &geo.vertices_[0];
+        #pragma omp parallel for schedule(dynamic)
+        for (int m=0;m<static_cast<int>(header.nb_meshes);++m) {
+            const MeshRecord& record = meshes[m];
+            Mesh& mesh = geo.meshes_[m];
+            mesh.name_         = std::string(names+record.name,record.name_length);
+            mesh.all_vertices_ = &geo.vertices_;
+            mesh.outermost_    = record.outermost!=0;
+            mesh.allocate_     = false;
+            mesh.vertices_.reserve(record.nb_vertices);
+            for (unsigned i=record.first_vertex;i<record.first_vertex+record.nb_vertices;++i)
+                mesh.vertices_.push_back(vertices+mesh_vertices[i]);
+            mesh.reserve(record.nb_triangles);
+            for (unsigned t=record.first_triangle;t<record.first_triangle+record.nb_triangles;++t) {
+                const uint32_t* corners = triangles+3*t;
+                mesh.push_back(Triangle(vertices+corners[0],vertices+corners[1],vertices+corners[2],tindices[t]));
+                Triangle& triangle = mesh.back();
+                triangle.normal() = Normal(normals[3*t],normals[3*t+1],normals[3*t+2]);
+                triangle.area()   = areas[t];
+            }
+            Triangle* first = (record.nb_triangles) ? &mesh[0] : 0;
+            for (unsigned r=record.first_row;r<record.first_row+record.nb_rows;++r) {
+                Mesh::VectPTriangle& links = mesh.links_.insert(mesh.links_.end(),std::make_pair(vertices+rows[r],Mesh::VectPTriangle()))->second;
+                links.reserve(offsets[r+1]-offsets[r]);
+                for (unsigned i=offsets[r];i<offsets[r+1];++i)
+                    links.push_back(first+adjacency[i]);
+            }
+        }
+
+        const DomainRecord*       domains    = section<DomainRecord>(data,header,DOMAINS);
+        const HalfSpaceRecord*    halfspaces = section<HalfSpaceRecord>(data,header,HALFSPACES);
+        const OrientedMeshRecord* oriented   = section<OrientedMeshRecord>(data,header,ORIENTED_MESHES);
+        geo.domains_.resize(header.nb_domains);
+        for (unsigned d=0;d<header.nb_domains;++d) {
+            const DomainRecord& record = domains[d];
+            Domain& domain = geo.domains_[d];
+            domain.name()      = std::string(names+record.name,record.name_length);
+            domain.sigma()     = record.sigma;
+            domain.outermost() = record.outermost!=0;
+            for (unsigned h=record.first_halfspace;h<record.first_halfspace+record.nb_halfspaces;++h) {
+                const HalfSpaceRecord& hs = halfspaces[h];
+                Interface interface(std::string(names+hs.name,hs.name_length));
+                for (unsigned i=hs.first_oriented_mesh;i<hs.first_oriented_mesh+hs.nb_oriented_meshes;++i)
+                    interface.push_back(OrientedMesh(geo.meshes_[oriented[i].mesh],oriented[i].well_oriented!=0));
+                if (hs.outermost)
+                    interface.set_to_outermost();
+                domain.push_back(HalfSpace(interface,hs.inside!=0));
+            }
+        }
+
+        geo.has_cond_  = (header.flags&HAS_COND)!=0;
+        geo.is_nested_ = (header.flags&IS_NESTED)!=0;
+        geo.size_      = header.size;
+
+        //  Renumber the unknowns if the snapshot holds the other standard ordering.
+
+        const uint32_t ordering = (OLD_ORDERING) ? ORDERING_OLD : ORDERING_DEFAULT;
+        if ((header.flags&(ORDERING_DEFAULT|ORDERING_OLD))!=0 && (header.flags&ordering)==0) {
+            for (Vertices::iterator vit=geo.vertex_begin();vit!=geo.vertex_end();++vit)
+                vit->index() = unsigned(-1);
+            for (Geometry::iterator mit=geo.begin();mit!=geo.end();++mit)
+                for (Mesh::iterator tit=mit->begin();tit!=mit->end();++tit)
+                    tit->index() = unsigned(-1);
+            geo.generate_indices(OLD_ORDERING);
+        }
+    }
+}
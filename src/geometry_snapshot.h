@@ -0,0 +1,83 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_GEOMETRY_SNAPSHOT_H
+#define OPENMEEG_GEOMETRY_SNAPSHOT_H
+
+#include <stdint.h>
+#include <string>
+#include <DLLDefinesOpenMEEG.h>
+
+namespace OpenMEEG {
+
+    class Geometry;
+
+    //  The geometry snapshot format (suffix .omg).
+    //
+    //  A snapshot stores a fully built Geometry (after the reading of the .geom/.cond files, the checks of the
+    //  meshes orientations and the numbering of the unknowns) so that it can be rebuilt without any parsing nor
+    //  any geometric computation. The file is made of a header (magic, version, byte order, counts and the
+    //  offset of every section) followed by flat arrays aligned on 8 bytes, so it can be mapped in memory and
+    //  used in place: vertices (coordinates and indices), triangles (vertex positions, indices, normals and
+    //  areas), the CSR adjacency vertex -> triangles of each mesh, the meshes, the domains with their
+    //  half-spaces and interfaces (oriented meshes), the conductivities and a table of names.
+    //  An Adler-32 checksum of everything following the header is stored in the header.
+
+    class OPENMEEG_EXPORT GeometrySnapshot {
+    public:
+
+        static const uint32_t version = 1;
+
+        /// \return true if the file starts with the snapshot magic.
+        static bool is_snapshot(const std::string& filename);
+
+        /// \brief Write the geometry to a snapshot file.
+        static void save(const Geometry& geo, const std::string& filename);
+
+        /// \brief Rebuild a geometry from a snapshot file. The unknowns are renumbered if the snapshot was
+        /// written with the other ordering than the one asked for.
+        static void load(Geometry& geo, const std::string& filename, const bool OLD_ORDERING = false);
+
+        /// \brief Validate a snapshot file (header, checksum, sizes of the sections and bounds of all the
+        /// indices) without building the geometry. Problems are reported on std::cerr.
+        static bool check(const std::string& filename);
+    };
+}
+
+#endif  //  ! OPENMEEG_GEOMETRY_SNAPSHOT_H
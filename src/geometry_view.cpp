@@ -0,0 +1,203 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <geometry.h>
+#include <geometry_view.h>
+
+namespace OpenMEEG {
+
+    void KernelSetup::init(const Vect3& v0, const Vect3& v1, const Vect3& v2, const Vect3& normal, const double a)
+    {
+        p0 = v0;
+        p1 = v1;
+        p2 = v2;
+        n    = normal;
+        area = a;
+
+        center = (p0+p1+p2)/3.0;
+        radius = std::max((p0-center).norm(), std::max((p1-center).norm(), (p2-center).norm()));
+
+        // analyticS
+
+        p1p0 = p1-p0; p2p1 = p2-p1; p0p2 = p0-p2;
+        norm2p1p0 = p1p0.norm(); norm2p2p1 = p2p1.norm(); norm2p0p2 = p0p2.norm();
+
+        nu0 = (p1p0^n);
+        nu1 = (p2p1^n);
+        nu2 = (p0p2^n);
+        nu0.normalize();
+        nu1.normalize();
+        nu2.normalize();
+
+        // analyticDipPotDer (the edges are taken in the opposite direction)
+
+        const Vect3 p0p1 = p0-p1;
+        const Vect3 p1p2 = p1-p2;
+        const Vect3 p2p0 = p2-p0;
+        Vect3 p0p1n = p0p1; p0p1n.normalize();
+        Vect3 p1p2n = p1p2; p1p2n.normalize();
+        Vect3 p2p0n = p2p0; p2p0n.normalize();
+
+        H0 = (p0p1*p1p2n)*p1p2n+p1; H0p0DivNorm2 = p0-H0; H0p0DivNorm2 = H0p0DivNorm2/H0p0DivNorm2.norm2();
+        H1 = (p1p2*p2p0n)*p2p0n+p2; H1p1DivNorm2 = p1-H1; H1p1DivNorm2 = H1p1DivNorm2/H1p1DivNorm2.norm2();
+        H2 = (p2p0*p0p1n)*p0p1n+p0; H2p2DivNorm2 = p2-H2; H2p2DivNorm2 = H2p2DivNorm2/H2p2DivNorm2.norm2();
+
+        dn = p2p0^p0p1;
+        dn.normalize();
+    }
+
+    GeometryView::GeometryView(const Geometry& geo): base_(&*geo.vertex_begin())
+    {
+        x_.reserve(geo.nb_vertices());
+        y_.reserve(geo.nb_vertices());
+        z_.reserve(geo.nb_vertices());
+        vertex_index_.reserve(geo.nb_vertices());
+        for ( Vertices::const_iterator vit = geo.vertex_begin(); vit != geo.vertex_end(); ++vit) {
+            add_vertex(*vit);
+        }
+        for ( Geometry::const_iterator mit = geo.begin(); mit != geo.end(); ++mit) {
+            add_mesh(*mit);
+        }
+        init_setups();
+    }
+
+    GeometryView::GeometryView(const Mesh& m): base_(0)
+    {
+        add_mesh(m);
+        positions_.clear();
+        init_setups();
+    }
+
+    GeometryView::GeometryView(const Mesh& m1, const Mesh& m2): base_(0)
+    {
+        add_mesh(m1);
+        if ( &m1 != &m2 ) {
+            add_mesh(m2);
+        }
+        positions_.clear();
+        init_setups();
+    }
+
+    const GeometryView::MeshRange& GeometryView::range(const Mesh& m) const
+    {
+        std::map<const Mesh *, unsigned>::const_iterator it = mesh_ids_.find(&m);
+        if ( it == mesh_ids_.end() ) {
+            std::cerr << "GeometryView: mesh " << m.name() << " is not part of the view." << std::endl;
+            exit(1);
+        }
+        return ranges_[it->second];
+    }
+
+    void GeometryView::add_vertex(const Vertex& v)
+    {
+        x_.push_back(v.x());
+        y_.push_back(v.y());
+        z_.push_back(v.z());
+        vertex_index_.push_back(v.index());
+    }
+
+    int32_t GeometryView::position(const Vertex* v)
+    {
+        if ( base_ ) {
+            return v-base_;
+        }
+        std::map<const Vertex *, int32_t>::iterator it = positions_.lower_bound(v);
+        if ( it == positions_.end() || it->first != v ) {
+            it = positions_.insert(it, std::make_pair(v, int32_t(x_.size())));
+            add_vertex(*v);
+        }
+        return it->second;
+    }
+
+    void GeometryView::add_mesh(const Mesh& m)
+    {
+        MeshRange range;
+        range.first_triangle = areas_.size();
+        range.nb_triangles   = m.nb_triangles();
+        range.first_vertex   = mesh_vertices_.size();
+        range.nb_vertices    = m.nb_vertices();
+        mesh_ids_[&m] = ranges_.size();
+        ranges_.push_back(range);
+
+        for ( Mesh::const_vertex_iterator vit = m.vertex_begin(); vit != m.vertex_end(); ++vit) {
+            mesh_vertices_.push_back(position(*vit));
+        }
+
+        for ( Mesh::const_iterator tit = m.begin(); tit != m.end(); ++tit) {
+            for ( unsigned k = 0; k < 3; ++k) {
+                corners_.push_back(position(&tit->vertex(k)));
+                const Vect3 e = tit->vertex(k+1)-tit->vertex(k);
+                ex_[k].push_back(e.x());
+                ey_[k].push_back(e.y());
+                ez_[k].push_back(e.z());
+                elength_[k].push_back(e.norm());
+            }
+            nx_.push_back(tit->normal().x());
+            ny_.push_back(tit->normal().y());
+            nz_.push_back(tit->normal().z());
+            areas_.push_back(tit->area());
+            triangle_index_.push_back(tit->index());
+        }
+
+        // adjacency, in the order of the links of the mesh
+        if ( adjacency_offsets_.empty() ) {
+            adjacency_offsets_.push_back(0);
+        }
+        const Triangle* first = (m.nb_triangles() != 0) ? &*m.begin() : 0;
+        for ( Mesh::const_vertex_iterator vit = m.vertex_begin(); vit != m.vertex_end(); ++vit) {
+            const Mesh::VectPTriangle& triangles = m.get_triangles_for_vertex(**vit);
+            for ( Mesh::VectPTriangle::const_iterator tit = triangles.begin(); tit != triangles.end(); ++tit) {
+                adjacency_.push_back(range.first_triangle+(*tit-first));
+            }
+            adjacency_offsets_.push_back(adjacency_.size());
+        }
+    }
+
+    void GeometryView::init_setups()
+    {
+        const int ntriangles = nb_triangles();
+        setups_.resize(ntriangles);
+        #pragma omp parallel for
+        for ( int t = 0; t < ntriangles; ++t) {
+            setups_[t].init(corner(t, 0), corner(t, 1), corner(t, 2), normal(t), areas_[t]);
+        }
+    }
+}
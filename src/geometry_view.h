@@ -0,0 +1,164 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_GEOMETRY_VIEW_H
+#define OPENMEEG_GEOMETRY_VIEW_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include <vect3.h>
+#include <mesh.h>
+
+namespace OpenMEEG {
+
+    class Geometry;
+
+    /** \brief Setup data of the analytic kernels (see analytics.h) for one triangle.
+
+        It only depends on the triangle, so it is computed once per triangle (GeometryView keeps a table of them)
+        and the kernels then only read it.
+    **/
+
+    struct OPENMEEG_EXPORT KernelSetup {
+
+        void init(const Vect3& p0, const Vect3& p1, const Vect3& p2, const Vect3& n, const double area);
+
+        Vect3  p0, p1, p2;                      ///< corners
+        Vect3  p1p0, p2p1, p0p2;                ///< edges
+        double norm2p1p0, norm2p2p1, norm2p0p2; ///< edge lengths
+        Vect3  n;                               ///< unit normal
+        Vect3  nu0, nu1, nu2;                   ///< unit normals of the edges, in the plane of the triangle
+        double area;
+        Vect3  center;                          ///< barycenter
+        double radius;                          ///< largest distance from the barycenter to a corner
+
+        // analyticDipPotDer: feet of the altitudes, scaled altitudes and the normal (of opposite orientation).
+        Vect3  H0, H1, H2;
+        Vect3  H0p0DivNorm2, H1p1DivNorm2, H2p2DivNorm2, dn;
+    };
+
+    /** \brief Immutable structure-of-arrays view of the meshes of a geometry, for the assembly kernels.
+
+        Vertices are numbered by their position in the view (the order of the vertex storage when built from a
+        Geometry) and triangles mesh after mesh. Coordinates, normals, areas, edge vectors and unknown indices
+        are stored in contiguous arrays (one per component), the triangle connectivity as int32 triples.
+        The setup data of the analytic kernels is computed once for all triangles, when the view is built.
+        The edge k of a triangle goes from its corner k to its corner k+1 (mod 3).
+        For each mesh, the view gives the ranges of its triangles and of its vertex list (in the order of the
+        mesh) and, for each entry of this list, the triangles of the mesh containing the vertex.
+    **/
+
+    class OPENMEEG_EXPORT GeometryView {
+    public:
+
+        struct MeshRange {
+            unsigned first_triangle;
+            unsigned nb_triangles;
+            unsigned first_vertex;   ///< first entry of the mesh in mesh_vertices()
+            unsigned nb_vertices;
+        };
+
+        GeometryView(const Geometry& geo);
+        explicit GeometryView(const Mesh& m);
+        GeometryView(const Mesh& m1, const Mesh& m2);
+
+        unsigned nb_vertices()  const { return x_.size();         }
+        unsigned nb_triangles() const { return areas_.size();     }
+        unsigned nb_meshes()    const { return ranges_.size();    }
+
+        /// Vertices.
+        const double*   x()             const { return &x_[0];           }
+        const double*   y()             const { return &y_[0];           }
+        const double*   z()             const { return &z_[0];           }
+        const unsigned* vertex_index()  const { return &vertex_index_[0]; } ///< \brief unknown indices of the vertices
+        Vect3           vertex(const int32_t v) const { return Vect3(x_[v], y_[v], z_[v]); }
+
+        /// Triangles.
+        const int32_t*  corners(const unsigned t)                  const { return &corners_[3*t]; }
+        Vect3           corner(const unsigned t, const unsigned k) const { return vertex(corners_[3*t+k%3]); }
+        Vect3           edge(const unsigned t, const unsigned k)   const { return Vect3(ex_[k%3][t], ey_[k%3][t], ez_[k%3][t]); }
+        double          edge_length(const unsigned t, const unsigned k) const { return elength_[k%3][t]; }
+        Vect3           normal(const unsigned t)                   const { return Vect3(nx_[t], ny_[t], nz_[t]); }
+        const double*   areas()         const { return &areas_[0];          }
+        const unsigned* triangle_index() const { return &triangle_index_[0]; } ///< \brief unknown indices of the triangles
+        const KernelSetup& setup(const unsigned t) const { return setups_[t]; } ///< \brief kernel setup of triangle t
+
+        /// \return the corner (0, 1 or 2) of triangle t at vertex v.
+        unsigned corner_of(const unsigned t, const int32_t v) const {
+            const int32_t* c = corners(t);
+            return (c[0] == v) ? 0 : (c[1] == v) ? 1 : 2;
+        }
+
+        /// Meshes.
+        const MeshRange& range(const Mesh& m) const;
+        const int32_t*   mesh_vertices()      const { return &mesh_vertices_[0]; } ///< \brief vertex lists of the meshes
+
+        /// Triangles containing the vertex of entry i of mesh_vertices() (within the mesh of this entry).
+        const int32_t* adjacent_begin(const unsigned i) const { return &adjacency_[0]+adjacency_offsets_[i];   }
+        const int32_t* adjacent_end(const unsigned i)   const { return &adjacency_[0]+adjacency_offsets_[i+1]; }
+
+    private:
+
+        int32_t position(const Vertex* v);
+        void    add_vertex(const Vertex& v);
+        void    add_mesh(const Mesh& m);
+        void    init_setups();
+
+        const Vertex*                     base_;      ///< vertex storage of the geometry (0 for free meshes)
+        std::map<const Vertex *, int32_t> positions_; ///< positions of the vertices of free meshes
+        std::map<const Mesh *, unsigned>  mesh_ids_;
+        std::vector<MeshRange>            ranges_;
+
+        std::vector<double>   x_, y_, z_;
+        std::vector<unsigned> vertex_index_;
+
+        std::vector<int32_t>  corners_;
+        std::vector<double>   nx_, ny_, nz_, areas_;
+        std::vector<double>   ex_[3], ey_[3], ez_[3], elength_[3];
+        std::vector<unsigned> triangle_index_;
+        std::vector<KernelSetup> setups_;
+
+        std::vector<int32_t>  mesh_vertices_;
+        std::vector<unsigned> adjacency_offsets_;
+        std::vector<int32_t>  adjacency_;
+    };
+}
+
+#endif  //! OPENMEEG_GEOMETRY_VIEW_H
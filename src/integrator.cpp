@@ -0,0 +1,91 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <cmath>
+#include <iomanip>
+#include <integrator.h>
+
+namespace OpenMEEG {
+
+    double        QuadraturePolicy::accuracy_  = 0.0;
+    double        QuadraturePolicy::ratios_[4] = { 0.0, 0.0, 0.0, 0.0 };
+    unsigned long QuadraturePolicy::counts_[4] = { 0, 0, 0, 0 };
+
+    void QuadraturePolicy::set_accuracy(const double eps)
+    {
+        // Degrees of the rules with 3, 6, 7 and 16 points and constants C of their error estimates C (h/d)^(p+2).
+        // Each constant is the largest ratio relative error/(h/d)^(p+2) measured for the S kernel on random pairs
+        // of distinct triangles (d>h) of the Head1 and Head2 models, against an adaptive reference to 1e-12
+        // (2.2e-3, 1.2e-4, 8.5e-5 and 2.3e-7), rounded up to a power of 10 as a margin.
+        static const unsigned degrees[4]   = { 2, 4, 5, 8 };
+        static const double   constants[4] = { 1e-2, 1e-3, 1e-4, 1e-6 };
+        accuracy_ = (eps > 0.0 && eps < 1.0) ? eps : 0.0;
+        for ( unsigned i = 0; i < 4; ++i) {
+            ratios_[i] = (accuracy_ > 0.0) ? std::pow(accuracy_/constants[i], 1.0/(degrees[i]+2)) : 0.0;
+        }
+        reset_statistics();
+    }
+
+    void QuadraturePolicy::reset_statistics()
+    {
+        for ( unsigned i = 0; i < 4; ++i) {
+            counts_[i] = 0;
+        }
+    }
+
+    void QuadraturePolicy::report(std::ostream& os)
+    {
+        unsigned long total = 0;
+        for ( unsigned i = 0; i < 4; ++i) {
+            total += counts_[i];
+        }
+        if ( total == 0 ) {
+            return;
+        }
+        unsigned long evaluations = 0;
+        os << "Quadrature rules (accuracy " << accuracy_ << "):" << std::endl;
+        for ( unsigned i = 0; i < 4; ++i) {
+            evaluations += counts_[i]*nbPts[i];
+            os << "    " << std::setw(2) << nbPts[i] << " points: " << std::setw(12) << counts_[i] << " integrals ("
+               << std::fixed << std::setprecision(1) << 100.0*counts_[i]/total << "%)" << std::endl;
+        }
+        os.unsetf(std::ios::fixed);
+        os << "    " << evaluations << " kernel evaluations (" << total*nbPts[3] << " with 16 points everywhere)." << std::endl;
+    }
+}
@@ -41,11 +41,13 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #define OPENMEEG_INTEGRATOR_H
 
 #include <cmath>
+#include <algorithm>
 #include <iostream>
 
 #include <vertex.h>
 #include <triangle.h>
 #include <mesh.h>
+#include <timings.h>
 
 namespace OpenMEEG {
 
@@ -178,11 +180,56 @@ namespace OpenMEEG {
 
     static const unsigned nbPts[4] = {3, 6, 7, 16};
 
+    /** \brief Runtime choice of the quadrature rule of the integrals between two triangles.
+
+        The integrand is smooth on a triangle far from the singularity of the kernel (the other triangle), and
+        the relative error of a rule exact for polynomials of degree p then behaves as C (h/d)^(p+2), h being
+        the size of the triangle and d its distance to the singularity (C was measured for the S kernel on the
+        Head models, with some margin). Given an accuracy target, the lowest order meeting it is used, the
+        order requested by the user being an upper bound (used for close pairs).
+        With a null accuracy (the default), the requested order is always used. Orders above 3 (the highest
+        available rule) are treated as 3.
+        When the timings are enabled (-timings), the number of integrals computed with each rule is recorded.
+    **/
+
+    class OPENMEEG_EXPORT QuadraturePolicy
+    {
+    public:
+
+        static void   set_accuracy(const double eps);
+        static double accuracy() { return accuracy_; }
+        static bool   enabled()  { return accuracy_ > 0.0; }
+
+        /// \return the order to use on a triangle of diameter size at the given distance of the singularity.
+
+        static unsigned order(const unsigned max_order, const double size, const double distance)
+        {
+            const unsigned last = std::min(max_order, 3U);
+            unsigned ord = 0;
+            while ( ord < last && !(size < ratios_[ord]*distance) ) {
+                ++ord;
+            }
+            if ( timings::enabled() ) {
+                #pragma omp atomic
+                ++counts_[ord];
+            }
+            return ord;
+        }
+
+        static unsigned long count(const unsigned ord) { return counts_[ord]; }
+        static void          reset_statistics();
+        static void          report(std::ostream& os);
+
+    private:
+
+        static double        accuracy_;
+        static double        ratios_[4];   ///< largest size/distance ratio for each order
+        static unsigned long counts_[4];
+    };
+
     template <class T, class I>
     class OPENMEEG_EXPORT Integrator 
     {
-        unsigned order;
-
     public:
 
         inline Integrator()             { setOrder(3);   }
@@ -199,14 +246,21 @@ namespace OpenMEEG {
             }
         }
 
-        virtual inline T integrate(const I& fc, const Triangle& Trg) 
+        inline T integrate(const I& fc, const Triangle& Trg) 
         {
             const Vect3 points[3] = { Trg.s1(), Trg.s2(), Trg.s3() };
+            return integrate(fc, points);
+        }
+
+        virtual inline T integrate(const I& fc, const Vect3 points[3]) 
+        {
             return triangle_integration(fc, points);
         }
 
     protected:
 
+        unsigned order;
+
         inline T triangle_integration(const I& fc, const Vect3 points[3]) 
         {
             // compute double area of triangle defined by points
@@ -224,6 +278,17 @@ namespace OpenMEEG {
         }
     };
 
+    /** \brief Globally adaptive integration on a triangle.
+
+        The integral on a piece is given by the rule of the chosen order and its error is estimated by the
+        difference with the rule of the order below (orders 0 and 1 are both estimated with the rules of orders
+        1 and 0). The rules of orders 2 and 3 both have the centroid as first point: its value is computed once.
+        Until the sum of the errors of the pieces is below tolerance times the integral, the piece with the
+        largest error is split in 4 (at the middles of its edges). The work list is of bounded size and lives on
+        the stack of the calling thread: there is no allocation and an integrator can be shared by threads.
+        Pieces are not split beyond max_depth levels.
+    **/
+
     template <class T, class I>
     class OPENMEEG_EXPORT AdaptiveIntegrator: public Integrator<T, I> 
     {
@@ -231,55 +296,124 @@ namespace OpenMEEG {
 
     public:
 
+        using base::integrate;
+
         inline AdaptiveIntegrator() : tolerance(0.0001) {}
         inline AdaptiveIntegrator(double tol) : tolerance(tol) {}
         inline ~AdaptiveIntegrator() {}
 
-        inline double norm(const double a) { return fabs(a);  }
-        inline double norm(const Vect3& a) { return a.norm(); }
+        static inline double norm(const double a) { return fabs(a);  }
+        static inline double norm(const Vect3& a) { return a.norm(); }
 
-        virtual inline T integrate(const I& fc, const Triangle& Trg) {
-            const Vect3 points[3] = { Trg.s1(), Trg.s2(), Trg.s3() };
-            T I0 = base::triangle_integration(fc, points);
-            return adaptive_integration(fc, points, I0, 0);
+        virtual inline T integrate(const I& fc, const Vect3 points[3]) 
+        {
+            Piece    work[capacity];
+            unsigned n = 1;
+
+            init(work[0], fc, points, 0);
+            T      total = work[0].value;
+            double error = work[0].error;
+
+            while ( n != 0 && n+3 <= capacity && error > tolerance*norm(total) ) {
+                std::pop_heap(work, work+n, larger_error);
+                const Piece parent = work[--n]; // a copy, as its slot is reused by the first child
+                error -= parent.error;
+                if ( parent.depth == max_depth ) { // this piece is kept as is.
+                    continue;
+                }
+
+                Vect3 children[4][3];
+                split(parent.points, children);
+                total -= parent.value;
+                for ( unsigned k = 0; k < 4; ++k, ++n) {
+                    init(work[n], fc, children[k], parent.depth+1);
+                    total += work[n].value;
+                    error += work[n].error;
+                    std::push_heap(work, work+n+1, larger_error);
+                }
+            }
+            return total;
         }
 
     private:
 
-        double tolerance;
+        static const unsigned max_depth = 10;
+        static const unsigned capacity  = 97; ///< 32 splits at most
+
+        struct Piece {
+            Vect3    points[3];
+            T        value;
+            double   error;
+            unsigned depth;
+        };
+
+        static bool larger_error(const Piece& a, const Piece& b) { return a.error < b.error; }
+
+        /// Split a triangle in 4: the middles of the edges are shared by the children.
 
-        inline T adaptive_integration(const I& fc, const Vect3 * points, T I0, unsigned n) 
+        static void split(const Vect3 points[3], Vect3 children[4][3])
         {
-            Vect3 newpoint0(0.0, 0.0, 0.0);
-            multadd(newpoint0, 0.5, points[0]);
-            multadd(newpoint0, 0.5, points[1]);
-            Vect3 newpoint1(0.0, 0.0, 0.0);
-            multadd(newpoint1, 0.5, points[1]);
-            multadd(newpoint1, 0.5, points[2]);
-            Vect3 newpoint2(0.0, 0.0, 0.0);
-            multadd(newpoint2, 0.5, points[2]);
-            multadd(newpoint2, 0.5, points[0]);
-            Vect3 points1[3] = {points[0], newpoint0, newpoint2};
-            Vect3 points2[3] = {points[1], newpoint1, newpoint0};
-            Vect3 points3[3] = {points[2], newpoint2, newpoint1};
-            Vect3 points4[3] = {newpoint0, newpoint1, newpoint2};
-            T I1 = base::triangle_integration(fc, points1);
-            T I2 = base::triangle_integration(fc, points2);
-            T I3 = base::triangle_integration(fc, points3);
-            T I4 = base::triangle_integration(fc, points4);
-            T sum = I1+I2+I3+I4;
-            if ( norm(I0-sum) > tolerance*norm(I0) ) {
-                n = n+1;
-                if ( n < 10 ) {
-                    I1 = adaptive_integration(fc, points1, I1, n);
-                    I2 = adaptive_integration(fc, points2, I2, n);
-                    I3 = adaptive_integration(fc, points3, I3, n);
-                    I4 = adaptive_integration(fc, points4, I4, n);
-                    I0 = I1+I2+I3+I4;
+            Vect3 middles[3];
+            for ( unsigned k = 0; k < 3; ++k) {
+                middles[k] = Vect3(0.0, 0.0, 0.0);
+                multadd(middles[k], 0.5, points[k]);
+                multadd(middles[k], 0.5, points[(k+1)%3]);
+            }
+            for ( unsigned k = 0; k < 3; ++k) {
+                children[k][0] = points[k];
+                children[k][1] = middles[k];
+                children[k][2] = middles[(k+2)%3];
+            }
+            children[3][0] = middles[0];
+            children[3][1] = middles[1];
+            children[3][2] = middles[2];
+        }
+
+        /// Weighted sum of the rule ord on points, starting at its point first (the value at point 0 is f0).
+
+        static inline T rule(const I& fc, const Vect3 points[3], const unsigned ord, const unsigned first, T& f0)
+        {
+            T result = 0;
+            for ( unsigned i = first; i < nbPts[ord]; ++i) {
+                Vect3 v(0.0, 0.0, 0.0);
+                for ( unsigned j = 0; j < 3; ++j) {
+                    v.multadd(cordBars[ord][i][j], points[j]);
                 }
+                const T value = fc.f(v);
+                if ( i == 0 ) {
+                    f0 = value;
+                }
+                multadd(result, cordBars[ord][i][3], value);
+            }
+            if ( first != 0 ) {
+                multadd(result, cordBars[ord][0][3], f0);
+            }
+            return result;
+        }
+
+        inline void init(Piece& piece, const I& fc, const Vect3 points[3], const unsigned depth)
+        {
+            const unsigned high   = (base::order == 0) ? 1 : base::order;
+            const unsigned low    = high-1;
+            const unsigned shared = (low == 2) ? 1 : 0;
+
+            // double area of the piece
+
+            const double S = ((points[1]-points[0])^(points[2]-points[0])).norm();
+
+            T f0;
+            const T fine   = rule(fc, points, high, 0, f0);
+            const T coarse = rule(fc, points, low, shared, f0);
+
+            for ( unsigned k = 0; k < 3; ++k) {
+                piece.points[k] = points[k];
             }
-            return I0;
+            piece.value = fine*S;
+            piece.error = norm(fine-coarse)*S;
+            piece.depth = depth;
         }
+
+        double tolerance;
     };
 }
 
@@ -0,0 +1,154 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <cstring>
+
+#include <matrix.h>
+#include <symmatrix.h>
+#include <cpuChrono.h>
+#include <om_utils.h>
+#include <inverse_operator.h>
+#include <simulation.h>
+
+using namespace std;
+using namespace OpenMEEG;
+
+void getHelp(char** argv);
+
+int main(int argc, char **argv)
+{
+    print_version(argv[0]);
+    thread_option(argc, argv);
+
+    // Optional timing report (json, csv or text depending on the suffix)
+    const std::string timings_file = extract_option(argc, argv, "-timings");
+    if ( timings_file != "" ) {
+        timings::enable(argv[0]);
+    }
+
+    const std::string method_option = extract_option(argc, argv, "-method");
+    const std::string snr_option    = extract_option(argc, argv, "-snr");
+    const std::string cov_file      = extract_option(argc, argv, "-noise-cov");
+    const std::string kernel_file   = extract_option(argc, argv, "-kernel");
+    const std::string chunk_option  = extract_option(argc, argv, "-chunk");
+
+    if(argc==1)
+    {
+        cerr << "Not enough arguments \nPlease try \"" << argv[0] << " -h\" or \"" << argv[0] << " --help \" \n" << endl;
+        return 0;
+    }
+
+    if ((!strcmp(argv[1],"-h")) | (!strcmp(argv[1],"--help"))) getHelp(argv);
+
+    const double snr   = (snr_option!="") ? atof(snr_option.c_str()) : 3.0;
+    const long   chunk = (chunk_option!="") ? atol(chunk_option.c_str()) : ForwardSimulator::default_chunk;
+    if ( chunk<=0 ) {
+        cerr << "Invalid chunk size " << chunk_option << endl;
+        return 1;
+    }
+
+    if ( argc!=4 && !(argc==2 && kernel_file!="") ) {
+        cerr << "Bad arguments \nPlease try \"" << argv[0] << " -h\" or \"" << argv[0] << " --help \" \n" << endl;
+        return 1;
+    }
+
+    disp_argv(argc,argv);
+
+    // Start Chrono
+    cpuChrono C;
+    C.start();
+
+    InverseOperator::Method method;
+    try {
+        method = InverseOperator::method((method_option!="") ? method_option : "mne");
+    } catch (std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    Matrix GainMatrix;
+    GainMatrix.load(argv[1]);
+
+    Matrix NoiseCovariance;
+    if ( cov_file!="" ) {
+        NoiseCovariance.load(cov_file);
+    }
+    const InverseOperator inverse = (cov_file!="") ? InverseOperator(GainMatrix,SymMatrix(NoiseCovariance),snr,method)
+                                                   : InverseOperator(GainMatrix,snr,method);
+
+    if ( kernel_file!="" ) {
+        inverse.normalized_kernel().save(kernel_file);
+    }
+
+    if ( argc==4 ) {
+        inverse.apply(argv[2],argv[3],chunk);
+    }
+
+    // Stop Chrono
+    C.stop();
+    C.dispEllapsed();
+
+    if ( timings_file != "" ) {
+        timings::save_report(timings_file);
+    }
+
+    return 0;
+}
+
+void getHelp(char** argv)
+{
+    cout << argv[0] << " [options] [filepaths...]" << endl << endl;
+
+    cout << "   Compute source estimates with a linear inverse operator (MNE, dSPM or sLORETA)" << endl;
+    cout << "   Filepaths are in order :" << endl;
+    cout << "   GainMatrix, SensorsData (sensors x samples), SourcesEstimates (sources x samples)" << endl << endl;
+
+    cout << "   Options :" << endl;
+    cout << "   -method m        : mne (default), dspm (noise normalized) or sloreta (resolution normalized)." << endl;
+    cout << "   -snr s           : signal to noise ratio of the data (regularization 1/s^2, default 3)." << endl;
+    cout << "   -noise-cov file  : sensor noise covariance (square matrix) used to whiten the gain (default identity)." << endl;
+    cout << "   -kernel file     : save the inverse operator (sources x sensors), the estimates being kernel*data." << endl;
+    cout << "                      With this option, the data and estimates filepaths may be omitted." << endl;
+    cout << "   -chunk n         : number of samples processed at once (default " << ForwardSimulator::default_chunk << ")," << endl;
+    cout << "                      data in a chunked file (.omc) are read by chunks and .omc estimates are streamed." << endl;
+    cout << "   -timings file    : write a timing report (file.json, file.csv or text) of the computation phases." << endl;
+    cout << "   -threads n       : number of threads used by the linear algebra (default OMP_NUM_THREADS)." << endl << endl;
+
+    exit(0);
+}
@@ -0,0 +1,197 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <cmath>
+#include <stdexcept>
+
+#include <MatLibConfig.h>
+#include <inverse_operator.h>
+#include <simulation.h>
+
+namespace OpenMEEG {
+
+    namespace {
+
+        //  With the packed U'U factorization of the noise covariance (U(i,j), i<=j, at i+j*(j+1)/2),
+        //  the whitener is W=U^{-T}: W*B is a forward substitution with U', W'*B a back substitution with U.
+
+        void whiten(const SymMatrix& U,Matrix& B) {
+            const size_t  m  = B.nlin();
+            const double* up = U.data();
+            #pragma omp parallel for schedule(static)
+            for (int c=0;c<static_cast<int>(B.ncol());++c) {
+                double* x = B.data()+c*m;
+                for (size_t i=0;i<m;++i) {
+                    const double* col = up+i*(i+1)/2;
+                    double s = x[i];
+                    for (size_t k=0;k<i;++k)
+                        s -= col[k]*x[k];
+                    x[i] = s/col[i];
+                }
+            }
+        }
+
+        void whiten_transposed(const SymMatrix& U,Matrix& B) {
+            const size_t  m  = B.nlin();
+            const double* up = U.data();
+            #pragma omp parallel for schedule(static)
+            for (int c=0;c<static_cast<int>(B.ncol());++c) {
+                double* x = B.data()+c*m;
+                for (size_t i=m;i-->0;) {
+                    double s = x[i];
+                    for (size_t k=i+1;k<m;++k)
+                        s -= up[i+k*(k+1)/2]*x[k];
+                    x[i] = s/up[i+i*(i+1)/2];
+                }
+            }
+        }
+    }
+
+    InverseOperator::InverseOperator(const Matrix& gain,const double snr,const Method method) {
+        build(gain,0,snr,method);
+    }
+
+    InverseOperator::InverseOperator(const Matrix& gain,const SymMatrix& noise_covariance,const double snr,const Method method) {
+        build(gain,&noise_covariance,snr,method);
+    }
+
+    InverseOperator::Method InverseOperator::method(const std::string& name) {
+        if (name=="mne")
+            return MNE;
+        if (name=="dspm")
+            return DSPM;
+        if (name=="sloreta")
+            return SLORETA;
+        throw std::runtime_error("unknown inverse method "+name+" (use mne, dspm or sloreta)");
+    }
+
+    void InverseOperator::build(const Matrix& gain,const SymMatrix* noise_covariance,const double snr,const Method method) {
+        TIMED_SCOPE("InverseOperator::build");
+        const size_t m = gain.nlin();
+        const size_t n = gain.ncol();
+        if (snr<=0.0)
+            throw std::runtime_error("the signal to noise ratio must be positive");
+
+        //  Whitened gain.
+
+        Matrix WG(gain,DEEP_COPY);
+        SymMatrix U;
+        if (noise_covariance) {
+            if (noise_covariance->nlin()!=m)
+                throw std::runtime_error("the noise covariance does not match the number of sensors");
+            U = SymMatrix(*noise_covariance,DEEP_COPY);
+            if (cholesky_factorize(U)!=0)
+                throw std::runtime_error("the noise covariance is not positive definite");
+            whiten(U,WG);
+        }
+
+        //  Economy SVD of the whitened gain and regularized inverse of its singular values. The source
+        //  covariance a*I is chosen such that trace(a*WG*WG')=m.
+
+        Matrix Us,S,V;
+        WG.svd(Us,S,V,false);
+        const size_t r = std::min(m,n);
+
+        double power = 0.0;
+        for (size_t i=0;i<r;++i)
+            power += S(i,i)*S(i,i);
+        if (power==0.0)
+            throw std::runtime_error("the gain matrix is zero");
+
+        const double a       = m/power;
+        const double lambda2 = 1.0/(snr*snr);
+
+        Vector f(r);
+        for (size_t i=0;i<r;++i)
+            f(i) = a*S(i,i)/(a*S(i,i)*S(i,i)+lambda2);
+
+        //  K = (V*diag(f))*(U'*W) with U'*W = (W'*U)'.
+
+        Matrix VF(V,DEEP_COPY);
+        for (size_t i=0;i<r;++i)
+            for (size_t j=0;j<n;++j)
+                VF(j,i) *= f(i);
+
+        if (noise_covariance)
+            whiten_transposed(U,Us);
+        K = VF*Us.transpose();
+
+        //  Normalizations: the whitened noise has a unit covariance, so the noise variance of source j is
+        //  the squared norm of the row j of V*diag(f); sLORETA uses the data covariance a*WG*WG'+lambda2*I.
+
+        norm = Vector(n);
+        #pragma omp parallel for schedule(static)
+        for (int j=0;j<static_cast<int>(n);++j) {
+            double d = 0.0;
+            for (size_t i=0;i<r;++i) {
+                const double w = VF(j,i)*VF(j,i);
+                d += (method==SLORETA) ? w*(1.0+a*S(i,i)*S(i,i)/lambda2) : w;
+            }
+            norm(j) = (method==MNE) ? 1.0 : (d>0.0) ? 1.0/sqrt(d) : 0.0;
+        }
+
+        std::cout << "Inverse operator (" << ((method==MNE) ? "MNE" : (method==DSPM) ? "dSPM" : "sLORETA")
+                  << ") for " << n << " sources and " << m << " sensors, snr " << snr << "." << std::endl;
+    }
+
+    Matrix InverseOperator::normalized_kernel() const {
+        Matrix NK(K,DEEP_COPY);
+        for (size_t j=0;j<NK.ncol();++j)
+            for (size_t i=0;i<NK.nlin();++i)
+                NK(i,j) *= norm(i);
+        return NK;
+    }
+
+    Matrix InverseOperator::apply(const Matrix& data) const {
+        TIMED_SCOPE("InverseOperator::apply");
+        if (data.nlin()!=K.ncol())
+            throw std::runtime_error("the data do not match the number of sensors of the inverse operator");
+        Matrix estimates = K*data;
+        for (size_t t=0;t<estimates.ncol();++t)
+            for (size_t j=0;j<estimates.nlin();++j)
+                estimates(j,t) *= norm(j);
+        return estimates;
+    }
+
+    //  Applying the operator by chunks is a noiseless simulation with the normalized kernel as gain.
+
+    void InverseOperator::apply(const std::string& data_file,const std::string& output_file,const size_t chunk) const {
+        ForwardSimulator(normalized_kernel(),0.0).run(data_file,output_file,chunk);
+    }
+}
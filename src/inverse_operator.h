@@ -0,0 +1,100 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_INVERSE_OPERATOR_H
+#define OPENMEEG_INVERSE_OPERATOR_H
+
+#include <string>
+
+#include <DLLDefinesOpenMEEG.h>
+#include <matrix.h>
+#include <symmatrix.h>
+#include <vector.h>
+
+namespace OpenMEEG {
+
+    /** \brief Linear inverse operator (minimum norm estimate and its noise normalized variants).
+
+        The gain G (sensors x sources) is whitened by the noise covariance C=U'U (W=U^{-T}), the
+        source covariance is scaled so that the whitened data have unit power per sensor, and the
+        regularized pseudo-inverse is obtained from a single economy SVD W*G=U*S*V':
+
+            K = V*diag(f)*U'*W with f = a*s/(a*s^2+lambda^2), lambda^2 = 1/snr^2
+
+        The operator is stored as the kernel K (sources x sensors) and a normalization per source:
+        1 for MNE, the inverse of the noise standard deviation of the estimate for dSPM and of the
+        standard deviation given by the resolution matrix for sLORETA. Applying it is then a matrix
+        product, done by chunks of time samples for long recordings.
+    **/
+
+    class OPENMEEG_EXPORT InverseOperator {
+    public:
+
+        typedef enum { MNE, DSPM, SLORETA } Method;
+
+        /// \brief Operator for a white noise of unit variance on every sensor.
+        InverseOperator(const Matrix& gain,const double snr=3.0,const Method method=MNE);
+
+        /// \brief Operator for the given sensor noise covariance.
+        InverseOperator(const Matrix& gain,const SymMatrix& noise_covariance,const double snr=3.0,const Method method=MNE);
+
+        const Matrix& kernel()        const { return K;    }
+        const Vector& normalization() const { return norm; }
+
+        /// \brief Kernel with the normalization applied to its rows: estimates are normalized_kernel()*data.
+        Matrix normalized_kernel() const;
+
+        /// \brief Source estimates of the data (sensors x samples).
+        Matrix apply(const Matrix& data) const;
+
+        /// \brief Source estimates of the data of a file, computed and written by chunks of samples (see ForwardSimulator::run).
+        void apply(const std::string& data_file,const std::string& output_file,const size_t chunk) const;
+
+        static Method method(const std::string& name);
+
+    private:
+
+        void build(const Matrix& gain,const SymMatrix* noise_covariance,const double snr,const Method method);
+
+        Matrix K;
+        Vector norm;
+    };
+}
+
+#endif  //! OPENMEEG_INVERSE_OPERATOR_H
@@ -38,6 +38,7 @@ knowledge of the CeCILL-B license and that you accept its terms.
 */
 
 #include <mesh.h>
+#include <mesh_reader.h>
 #include <Triangle_triangle_intersection.h>
 
 namespace OpenMEEG {
@@ -279,6 +280,161 @@ namespace OpenMEEG {
         update(); // Updating triangles (areas + normals)
     }
 
+    void Mesh::rebuild(const std::vector<Vect3>& points, const std::vector<unsigned>& triangles)
+    {
+        const std::string name      = name_;
+        const bool        outermost = outermost_;
+        destroy();
+        name_         = name;
+        outermost_    = outermost;
+        allocate_     = true;
+        all_vertices_ = new Vertices;
+        all_vertices_->reserve(points.size()); // no reallocation: triangles point into this storage
+        for ( std::vector<Vect3>::const_iterator pit = points.begin(); pit != points.end(); ++pit) {
+            all_vertices_->push_back(Vertex(*pit));
+            vertices_.push_back(&(*all_vertices_->rbegin()));
+        }
+        reserve(triangles.size()/3);
+        for ( unsigned i = 0; i < triangles.size(); i += 3) {
+            push_back(Triangle(vertices_[triangles[i]], vertices_[triangles[i+1]], vertices_[triangles[i+2]]));
+        }
+        update();
+    }
+
+    void Mesh::icosphere(const unsigned& level, const double& radius, const Vect3& center)
+    {
+        const double t = (1.+std::sqrt(5.))/2.;
+        const double coords[12][3] = { {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+                                       {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+                                       {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1} };
+        const unsigned faces[60] = { 0, 11, 5,  0, 5, 1,  0, 1, 7,  0, 7, 10,  0, 10, 11,
+                                     1, 5, 9,  5, 11, 4,  11, 10, 2,  10, 7, 6,  7, 1, 8,
+                                     3, 9, 4,  3, 4, 2,  3, 2, 6,  3, 6, 8,  3, 8, 9,
+                                     4, 9, 5,  2, 4, 11,  6, 2, 10,  8, 6, 7,  9, 8, 1 };
+
+        // Subdivision is done on the unit sphere: new vertices are the projected edge midpoints.
+        std::vector<Vect3>    points;
+        std::vector<unsigned> triangles(faces, faces+60);
+        for ( unsigned i = 0; i < 12; ++i) {
+            Vect3 p(coords[i][0], coords[i][1], coords[i][2]);
+            points.push_back(p/p.norm());
+        }
+
+        for ( unsigned l = 0; l < level; ++l) {
+            std::map<std::pair<unsigned, unsigned>, unsigned> midpoints;
+            std::vector<unsigned> refined;
+            refined.reserve(4*triangles.size());
+            for ( unsigned i = 0; i < triangles.size(); i += 3) {
+                unsigned m[3];
+                for ( unsigned k = 0; k < 3; ++k) {
+                    const unsigned a = triangles[i+k];
+                    const unsigned b = triangles[i+(k+1)%3];
+                    const std::pair<unsigned, unsigned> edge(std::min(a, b), std::max(a, b));
+                    std::map<std::pair<unsigned, unsigned>, unsigned>::const_iterator mit = midpoints.find(edge);
+                    if ( mit == midpoints.end() ) {
+                        Vect3 p = (points[a]+points[b])/2.;
+                        points.push_back(p/p.norm());
+                        mit = midpoints.insert(std::make_pair(edge, points.size()-1)).first;
+                    }
+                    m[k] = mit->second;
+                }
+                const unsigned split[12] = { triangles[i], m[0], m[2],  triangles[i+1], m[1], m[0],
+                                             triangles[i+2], m[2], m[1],  m[0], m[1], m[2] };
+                refined.insert(refined.end(), split, split+12);
+            }
+            triangles.swap(refined);
+        }
+
+        for ( std::vector<Vect3>::iterator pit = points.begin(); pit != points.end(); ++pit) {
+            *pit = center+radius*(*pit);
+        }
+        rebuild(points, triangles);
+        correct_global_orientation();
+        update();
+    }
+
+    void Mesh::loop_subdivide(const unsigned& niter)
+    {
+        for ( unsigned n = 0; n < niter; ++n) {
+            std::map<const Vertex *, unsigned> index;
+            std::vector<Vect3> points;
+            points.reserve(nb_vertices());
+            for ( const_vertex_iterator vit = vertex_begin(); vit != vertex_end(); ++vit) {
+                index[*vit] = points.size();
+                points.push_back(**vit);
+            }
+            std::vector<unsigned> triangles;
+            triangles.reserve(3*nb_triangles());
+            for ( const_iterator tit = begin(); tit != end(); ++tit) {
+                triangles.push_back(index[&tit->s1()]);
+                triangles.push_back(index[&tit->s2()]);
+                triangles.push_back(index[&tit->s3()]);
+            }
+
+            // Each edge gets a new (odd) vertex, computed from the edge end points and the opposite vertices.
+            typedef std::map<std::pair<unsigned, unsigned>, std::vector<unsigned> > EdgeOpposites;
+            EdgeOpposites edges;
+            std::vector< std::set<unsigned> > neighbors(points.size());
+            for ( unsigned i = 0; i < triangles.size(); i += 3) {
+                for ( unsigned k = 0; k < 3; ++k) {
+                    const unsigned a = triangles[i+k];
+                    const unsigned b = triangles[i+(k+1)%3];
+                    edges[std::make_pair(std::min(a, b), std::max(a, b))].push_back(triangles[i+(k+2)%3]);
+                    neighbors[a].insert(b);
+                    neighbors[b].insert(a);
+                }
+            }
+
+            std::vector<Vect3> new_points(points.size());
+            std::vector< std::vector<unsigned> > boundary_neighbors(points.size());
+            std::map<std::pair<unsigned, unsigned>, unsigned> odd;
+            for ( EdgeOpposites::const_iterator eit = edges.begin(); eit != edges.end(); ++eit) {
+                const Vect3& a = points[eit->first.first];
+                const Vect3& b = points[eit->first.second];
+                if ( eit->second.size() == 2 ) {
+                    new_points.push_back(0.375*(a+b)+0.125*(points[eit->second[0]]+points[eit->second[1]]));
+                } else {
+                    new_points.push_back(0.5*(a+b));
+                    boundary_neighbors[eit->first.first].push_back(eit->first.second);
+                    boundary_neighbors[eit->first.second].push_back(eit->first.first);
+                }
+                odd[eit->first] = new_points.size()-1;
+            }
+
+            // Even vertices are smoothed with the (Warren) Loop weights, boundary vertices along the boundary only.
+            for ( unsigned i = 0; i < points.size(); ++i) {
+                if ( boundary_neighbors[i].size() == 0 ) {
+                    const unsigned valence = neighbors[i].size();
+                    const double   beta    = (valence == 3)?3./16.:3./(8.*valence);
+                    Vect3 sum(0., 0., 0.);
+                    for ( std::set<unsigned>::const_iterator it = neighbors[i].begin(); it != neighbors[i].end(); ++it) {
+                        sum += points[*it];
+                    }
+                    new_points[i] = (1.-valence*beta)*points[i]+beta*sum;
+                } else if ( boundary_neighbors[i].size() == 2 ) {
+                    new_points[i] = 0.75*points[i]+0.125*(points[boundary_neighbors[i][0]]+points[boundary_neighbors[i][1]]);
+                } else {
+                    new_points[i] = points[i];
+                }
+            }
+
+            std::vector<unsigned> refined;
+            refined.reserve(4*triangles.size());
+            for ( unsigned i = 0; i < triangles.size(); i += 3) {
+                unsigned m[3];
+                for ( unsigned k = 0; k < 3; ++k) {
+                    const unsigned a = triangles[i+k];
+                    const unsigned b = triangles[i+(k+1)%3];
+                    m[k] = odd[std::make_pair(std::min(a, b), std::max(a, b))];
+                }
+                const unsigned split[12] = { triangles[i], m[0], m[2],  triangles[i+1], m[1], m[0],
+                                             triangles[i+2], m[2], m[1],  m[0], m[1], m[2] };
+                refined.insert(refined.end(), split, split+12);
+            }
+            rebuild(new_points, refined);
+        }
+    }
+
     /// P0gradient_norm2 : aux function to compute the square norm of the surfacic gradient
     inline double Mesh::P0gradient_norm2(const Triangle &t1, const Triangle &t2) const
     {
@@ -291,45 +447,82 @@ namespace OpenMEEG {
         return p1^p2/(p0*(p1^p2));
     }
 
+    /// Add the upper half of sparse entries to a symmetric matrix (summing them first in a reproducible order).
+    static void add_entries(const FastSparseMatrix::Triplets& entries, SymMatrix& A)
+    {
+        const FastSparseMatrix S(A.nlin(), A.ncol(), entries);
+        for ( size_t i = 0; i < S.nlin(); ++i) {
+            for ( size_t k = S.row_begin(i); k < S.row_end(i); ++k) {
+                if ( i <= S.column(k) ) {
+                    A(i, S.column(k)) += S.value(k);
+                }
+            }
+        }
+    }
+
     /// Sq. Norm Surface Gradient: square norm of the surfacic gradient of the P1 and P0 elements
     void Mesh::gradient_norm2(SymMatrix &A) const 
     {
-        /// V
-        // self
-        for ( const_vertex_iterator vit = vertex_begin(); vit != vertex_end(); ++vit) {
-            for ( VectPTriangle::const_iterator tit = links_.at(*vit).begin(); tit != links_.at(*vit).end(); ++tit) {
-                Vertex * v2;
-                Vertex * v3;
-                if ( ((**tit)[0]) == *vit) {
-                    v2 = (**tit)[1]; v3 = (**tit)[2];
-                } else if ( (**tit)[1] == *vit) {
-                    v2 = (**tit)[2]; v3 = (**tit)[0];
-                } else {
-                    v2 = (**tit)[0]; v3 = (**tit)[1];
+        FastSparseMatrix::Triplets entries;
+        gradient_norm2(entries);
+        add_entries(entries, A);
+    }
+
+    /// Off-diagonal entries are appended twice ((i,j) and (j,i)), the loops being split among threads.
+    void Mesh::gradient_norm2(FastSparseMatrix::Triplets& A) const 
+    {
+        #pragma omp parallel
+        {
+            FastSparseMatrix::Triplets local;
+            /// V
+            // self
+            #pragma omp for nowait
+            for ( const_vertex_iterator vit = vertex_begin(); vit < vertex_end(); ++vit) {
+                double norm2 = 0.;
+                for ( VectPTriangle::const_iterator tit = links_.at(*vit).begin(); tit != links_.at(*vit).end(); ++tit) {
+                    Vertex * v2;
+                    Vertex * v3;
+                    if ( ((**tit)[0]) == *vit) {
+                        v2 = (**tit)[1]; v3 = (**tit)[2];
+                    } else if ( (**tit)[1] == *vit) {
+                        v2 = (**tit)[2]; v3 = (**tit)[0];
+                    } else {
+                        v2 = (**tit)[0]; v3 = (**tit)[1];
+                    }
+                    norm2 += P1gradient(**vit, *v2, *v3).norm2() * std::pow((*tit)->area(),2);
                 }
-                A((*vit)->index(), (*vit)->index()) += P1gradient(**vit, *v2, *v3).norm2() * std::pow((*tit)->area(),2);
+                local.push_back(FastSparseMatrix::Triplet((*vit)->index(), (*vit)->index(), norm2));
             }
-        }
-        // edges
-        for ( const_iterator tit = begin(); tit != end(); ++tit) {
-            for ( unsigned j = 0; j < 3; ++j) {
-                if ( ((*tit)(j)).index() < ((*tit)(j+1)).index() ) { // sym matrix only lower half
-                    A(((*tit)(j)).index(), ((*tit)(j+1)).index()) += P1gradient((*tit)(j), (*tit)(j+1), (*tit)(j+2)) * P1gradient((*tit)(j+1), (*tit)(j+2), (*tit)(j+3)) * std::pow(tit->area(),2);
+            // edges
+            #pragma omp for nowait
+            for ( const_iterator tit = begin(); tit < end(); ++tit) {
+                for ( unsigned j = 0; j < 3; ++j) {
+                    const unsigned i1 = ((*tit)(j)).index();
+                    const unsigned i2 = ((*tit)(j+1)).index();
+                    if ( i1 < i2 ) { // sym matrix only lower half
+                        const double value = P1gradient((*tit)(j), (*tit)(j+1), (*tit)(j+2)) * P1gradient((*tit)(j+1), (*tit)(j+2), (*tit)(j+3)) * std::pow(tit->area(),2);
+                        local.push_back(FastSparseMatrix::Triplet(i1, i2, value));
+                        local.push_back(FastSparseMatrix::Triplet(i2, i1, value));
+                    }
                 }
             }
-        }
 
-        // P0 gradients: loop on triangles
-        if ( !outermost_ ) { // if it is an outermost mesh: p=0 thus no need for computing it
-            for ( const_iterator tit = begin(); tit != end(); ++tit) {
-                A(tit->index(), tit->index()) = 0.;
-                VectPTriangle Tadj = adjacent_triangles(*tit);
-                for ( VectPTriangle::const_iterator tit2 = Tadj.begin(); tit2 != Tadj.end(); ++tit2) {
-                    if ( tit->index() < (*tit2)->index() ) { // sym matrix only lower half
-                        A(tit->index(), (*tit2)->index()) += P0gradient_norm2(*tit, **tit2) * tit->area() * (*tit2)->area();
+            // P0 gradients: loop on triangles
+            if ( !outermost_ ) { // if it is an outermost mesh: p=0 thus no need for computing it
+                #pragma omp for nowait
+                for ( const_iterator tit = begin(); tit < end(); ++tit) {
+                    VectPTriangle Tadj = adjacent_triangles(*tit);
+                    for ( VectPTriangle::const_iterator tit2 = Tadj.begin(); tit2 != Tadj.end(); ++tit2) {
+                        if ( tit->index() < (*tit2)->index() ) { // sym matrix only lower half
+                            const double value = P0gradient_norm2(*tit, **tit2) * tit->area() * (*tit2)->area();
+                            local.push_back(FastSparseMatrix::Triplet(tit->index(), (*tit2)->index(), value));
+                            local.push_back(FastSparseMatrix::Triplet((*tit2)->index(), tit->index(), value));
+                        }
                     }
                 }
             }
+            #pragma omp critical
+            A.insert(A.end(), local.begin(), local.end());
         }
     }
 
@@ -337,17 +530,34 @@ namespace OpenMEEG {
     // "Discrete Laplace Operator on Meshed Surfaces". by Belkin, Sun, Wang
     void Mesh::laplacian(SymMatrix &A) const 
     {
-        double h;
-        for ( const_iterator tit = begin(); tit != end(); ++tit) {
-            for ( unsigned j = 0; j < 3; ++j) {
-                if ( ((*tit)(j)).index() < ((*tit)(j+1)).index() ) { // sym matrix only lower half
-                    h = ((*tit)(j+1)-(*tit)(j)).norm();
-                    A(((*tit)(j)).index(), ((*tit)(j+1)).index()) += -tit->area()/(12.*M_PI*std::pow(h,2)) * exp(-((*tit)(j)-(*tit)(j+1)).norm2()/(4.*h));
+        FastSparseMatrix::Triplets entries;
+        laplacian(entries);
+        add_entries(entries, A);
+    }
+
+    /// The diagonal (minus the sum of the line) is accumulated along with each off-diagonal entry.
+    void Mesh::laplacian(FastSparseMatrix::Triplets& A) const 
+    {
+        #pragma omp parallel
+        {
+            FastSparseMatrix::Triplets local;
+            #pragma omp for nowait
+            for ( const_iterator tit = begin(); tit < end(); ++tit) {
+                for ( unsigned j = 0; j < 3; ++j) {
+                    const unsigned i1 = ((*tit)(j)).index();
+                    const unsigned i2 = ((*tit)(j+1)).index();
+                    if ( i1 < i2 ) { // sym matrix only lower half
+                        const double h = ((*tit)(j+1)-(*tit)(j)).norm();
+                        const double value = -tit->area()/(12.*M_PI*std::pow(h,2)) * exp(-((*tit)(j)-(*tit)(j+1)).norm2()/(4.*h));
+                        local.push_back(FastSparseMatrix::Triplet(i1, i2, value));
+                        local.push_back(FastSparseMatrix::Triplet(i2, i1, value));
+                        local.push_back(FastSparseMatrix::Triplet(i1, i1, -value));
+                        local.push_back(FastSparseMatrix::Triplet(i2, i2, -value));
+                    }
                 }
             }
-        }
-        for ( const_vertex_iterator vit = vertex_begin(); vit != vertex_end(); ++vit) {
-            A((*vit)->index(), (*vit)->index()) = -A.getlin((*vit)->index()).sum();
+            #pragma omp critical
+            A.insert(A.end(), local.begin(), local.end());
         }
     }
 
@@ -424,6 +634,28 @@ namespace OpenMEEG {
             destroy();
         }
 
+        // .tri, .bnd and .off files are parsed once, the vertex storage being allocated to the exact size.
+        MeshData data;
+        if ( read_all && read_mesh_data(filename, data) ) {
+            if ( verbose ) {
+                std::cout << "loading : " << filename << " as a \"" << getNameExtension(filename) << "\" file."<< std::endl;
+            }
+            if ( all_vertices_ == 0 ) {
+                all_vertices_ = new Vertices;
+                allocate_ = true;
+            }
+            VertexWelder welder(*all_vertices_, data.points.size());
+            import(data, welder);
+            update();
+            if ( verbose ) {
+                info();
+            }
+            if ( allocate_ ) {
+                generate_indices();
+            }
+            return 0;
+        }
+
         if ( read_all && ( all_vertices_ == 0 ) ) {
             unsigned nb_v = load(filename, false, false); // first allocates memory for the vertices
             all_vertices_ = new Vertices;
@@ -471,6 +703,26 @@ namespace OpenMEEG {
         return return_value;
     }
 
+    void Mesh::import(const MeshData& data, VertexWelder& welder)
+    {
+        all_vertices_ = &welder.storage();
+        std::vector<Vertex *> points(data.points.size());
+        std::vector<bool> in_mesh(welder.storage().capacity(), false);
+        vertices_.reserve(points.size());
+        for ( unsigned i = 0; i < points.size(); ++i) {
+            points[i] = welder(data.points[i]);
+            const size_t position = welder.position(points[i]);
+            if ( !in_mesh[position] ) { // vertices duplicated in the file are added once
+                in_mesh[position] = true;
+                vertices_.push_back(points[i]);
+            }
+        }
+        reserve(data.triangles.size()/3);
+        for ( unsigned i = 0; i < data.triangles.size(); i += 3) {
+            push_back(Triangle(points[data.triangles[i]], points[data.triangles[i+1]], points[data.triangles[i+2]]));
+        }
+    }
+
     void Mesh::generate_indices() {
         unsigned index = 0;
         for ( vertex_iterator vit = vertex_begin(); vit != vertex_end(); ++vit, ++index) {
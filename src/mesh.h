@@ -53,6 +53,7 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #include <IOUtils.H>
 #include <om_utils.h>
 #include <sparse_matrix.h>
+#include <fast_sparse_matrix.h>
 
 #ifdef USE_VTK
 #include <vtkPolyData.h>
@@ -77,6 +78,9 @@ extern "C" {
 
 namespace OpenMEEG {
 
+    struct MeshData;
+    class  VertexWelder;
+
     enum Filetype { VTK, TRI, BND, MESH, OFF, GIFTI };
 
     /** 
@@ -86,6 +90,9 @@ namespace OpenMEEG {
 
     class OPENMEEG_EXPORT Mesh: public Triangles {
 
+        /// friend class for reading/writing geometry snapshots.
+        friend class GeometrySnapshot;
+
     public:
         
         typedef std::vector<Triangle *>                                       VectPTriangle;
@@ -116,10 +123,8 @@ namespace OpenMEEG {
         }
 
         /// constructor loading directly a mesh file \param filename \param verbose \param name Mesh name
-        Mesh(std::string filename, const bool verbose = true, const std::string _name = ""): name_(_name), outermost_(false), allocate_(true) { 
-            unsigned nb_v = load(filename, false, false); 
-            all_vertices_ = new Vertices(nb_v); // allocates space for the vertices
-            load(filename, verbose);
+        Mesh(std::string filename, const bool verbose = true, const std::string _name = ""): name_(_name), all_vertices_(0), outermost_(false), allocate_(false) { 
+            load(filename, verbose); // allocates space for the vertices
         }
 
         /// Destructor
@@ -165,6 +170,7 @@ namespace OpenMEEG {
         VectPTriangle adjacent_triangles(const Triangle&) const; ///< \brief get the adjacent triangles
         Normal normal(const Vertex& v) const; ///< \brief get the Normal at vertex
         void laplacian(SymMatrix &A) const; ///< \brief compute mesh laplacian
+        void laplacian(FastSparseMatrix::Triplets& A) const; ///< \brief append the entries of the mesh laplacian (for a FastSparseMatrix)
 
               bool& outermost()       { return outermost_; } /// \brief Returns True if it is an outermost mesh.
         const bool& outermost() const { return outermost_; }
@@ -176,8 +182,24 @@ namespace OpenMEEG {
          **/
         void smooth(const double& smoothing_intensity, const unsigned& niter);
 
+        /** \brief Replace the mesh by a sphere obtained by recursive subdivision of an icosahedron
+          \param level number of subdivisions (10*4^level+2 vertices, 20*4^level triangles)
+          \param radius
+          \param center
+          \return void
+         **/
+        void icosphere(const unsigned& level, const double& radius = 1., const Vect3& center = Vect3(0., 0., 0.));
+
+        /** \brief Loop subdivision: each iteration splits every triangle into 4 and smoothes the vertex positions
+          \param niter
+          \return void
+         **/
+        void loop_subdivide(const unsigned& niter = 1);
+
         /// \brief Compute the square norm of the surfacic gradient
         void gradient_norm2(SymMatrix &A) const;
+        /// \brief Append the entries of the square norm of the surfacic gradient (for a FastSparseMatrix)
+        void gradient_norm2(FastSparseMatrix::Triplets& A) const;
 
         // for IO:s --------------------------------------------------------------------
         /** Read mesh from file
@@ -185,6 +207,9 @@ namespace OpenMEEG {
           \param \optional verbose. 
           \param \optional read_all. If False then it only returns the total number of vertices */
         unsigned load(const std::string& filename, const bool& verbose = true, const bool& read_all = true);
+        /** Fill the mesh with the points and triangles of a mesh file, the points being welded to the vertices already
+            in the storage of the welder (which becomes the vertex storage of the mesh). */
+        void import(const MeshData& data, VertexWelder& welder);
         unsigned load_tri(std::istream& , const bool& read_all = true);
         unsigned load_tri(const std::string&, const bool& read_all = true);
         unsigned load_bnd(std::istream& , const bool& read_all = true);
@@ -237,6 +262,7 @@ namespace OpenMEEG {
 
         void destroy();
         void copy(const Mesh&);
+        void rebuild(const std::vector<Vect3>& points, const std::vector<unsigned>& triangles); ///< replace the mesh by these points and index triples
         // regarding mesh orientation
         const EdgeMap compute_edge_map() const;
         void  orient_adjacent_triangles(std::stack<Triangle *>& t_stack, std::map<Triangle *, bool>& tri_reoriented);
@@ -0,0 +1,374 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <stdint.h>
+
+#include <om_utils.h>
+#include <mesh_reader.h>
+#include <GeometryExceptions.H>
+
+namespace OpenMEEG {
+
+    namespace {
+
+        //  Powers of ten that are exact in double precision.
+
+        const double powers_of_ten[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+        inline bool is_digit(const char c) { return c>='0' && c<='9'; }
+        inline bool is_blank(const char c) { return std::isspace(static_cast<unsigned char>(c))!=0; }
+
+        //  Tokens of a '\0' terminated buffer. Blanks and comments (from '#' to the end of the line) are skipped.
+
+        class Tokenizer {
+        public:
+
+            Tokenizer(const char* begin,const char* end): p(begin),last(end) { }
+
+            void skip() {
+                while (p<last)
+                    if (*p=='#')
+                        skip_line();
+                    else if (is_blank(*p))
+                        ++p;
+                    else
+                        break;
+            }
+
+            void skip_line() {
+                while (p<last && *p!='\n')
+                    ++p;
+            }
+
+            bool character(const char c) {
+                skip();
+                if (p==last || *p!=c)
+                    return false;
+                ++p;
+                return true;
+            }
+
+            bool word(std::string& w) {
+                skip();
+                const char* start = p;
+                while (p<last && !is_blank(*p))
+                    ++p;
+                w.assign(start,p);
+                return p!=start;
+            }
+
+            bool number(unsigned& n) {
+                skip();
+                if (p==last || !is_digit(*p))
+                    return false;
+                n = 0;
+                for (;p<last && is_digit(*p);++p)
+                    n = 10*n+(*p-'0');
+                return true;
+            }
+
+            //  Decimal numbers with at most 19 significant digits whose value is an integer below 2^53 times a
+            //  power of ten within [1e-22,1e22] are exactly converted by one multiplication or division (both
+            //  operands being exact, the result is correctly rounded). This covers the coordinates written
+            //  by usual tools, other numbers are converted by strtod.
+
+            bool number(double& x) {
+                skip();
+                const char* start = p;
+                const char* q     = p;
+                bool negative = false;
+                if (q<last && (*q=='-' || *q=='+'))
+                    negative = (*q++=='-');
+
+                uint64_t mantissa = 0;
+                int      digits   = 0;
+                int      exponent = 0;
+                bool     exact    = true;
+                bool     found    = false;
+                for (;q<last && is_digit(*q);++q,found=true)
+                    if (digits<19) {
+                        mantissa = 10*mantissa+(*q-'0');
+                        if (mantissa!=0)
+                            ++digits;
+                    } else {
+                        ++exponent;
+                        exact = exact && *q=='0';
+                    }
+                if (q<last && *q=='.')
+                    for (++q;q<last && is_digit(*q);++q,found=true)
+                        if (digits<19) {
+                            mantissa = 10*mantissa+(*q-'0');
+                            if (mantissa!=0)
+                                ++digits;
+                            --exponent;
+                        } else {
+                            exact = exact && *q=='0';
+                        }
+                if (!found)
+                    return false;
+
+                if (q<last && (*q=='e' || *q=='E')) {
+                    const char* r = q+1;
+                    bool negative_exponent = false;
+                    if (r<last && (*r=='-' || *r=='+'))
+                        negative_exponent = (*r++=='-');
+                    if (r<last && is_digit(*r)) {
+                        int e = 0;
+                        for (;r<last && is_digit(*r);++r)
+                            if (e<100000)
+                                e = 10*e+(*r-'0');
+                        exponent += negative_exponent ? -e : e;
+                        q = r;
+                    }
+                }
+
+                //  Anything else glued to the number (nan, inf, 1.0f, 1,5...) is left to the iostream readers.
+
+                if (q<last && !is_blank(*q) && *q!='#')
+                    return false;
+                p = q;
+
+                if (exact && mantissa<(static_cast<uint64_t>(1)<<53) && exponent>=-22 && exponent<=22) {
+                    x = static_cast<double>(mantissa);
+                    x = (exponent<0) ? x/powers_of_ten[-exponent] : x*powers_of_ten[exponent];
+                    if (negative)
+                        x = -x;
+                } else {
+                    x = std::strtod(start,0);
+                }
+                return true;
+            }
+
+            bool point(Vect3& v) { return number(v.x()) && number(v.y()) && number(v.z()); }
+
+        private:
+
+            const char* p;
+            const char* last;
+        };
+
+        bool read_points(Tokenizer& tokens,const unsigned npts,const unsigned values_per_point,MeshData& data) {
+            data.points.resize(npts);
+            for (unsigned i=0;i<npts;++i) {
+                if (!tokens.point(data.points[i]))
+                    return false;
+                for (unsigned k=3;k<values_per_point;++k) {
+                    double trash;
+                    if (!tokens.number(trash))
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        bool read_triangles(Tokenizer& tokens,const unsigned ntrgs,const bool with_size,MeshData& data) {
+            data.triangles.resize(3*ntrgs);
+            for (unsigned i=0;i<ntrgs;++i) {
+                unsigned n;
+                if (with_size && (!tokens.number(n) || n!=3))
+                    return false;
+                for (unsigned k=0;k<3;++k) {
+                    unsigned& index = data.triangles[3*i+k];
+                    if (!tokens.number(index) || index>=data.points.size())
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        bool read_tri(Tokenizer& tokens,MeshData& data) {
+            unsigned npts,ntrgs;
+            return tokens.character('-') && tokens.number(npts) && read_points(tokens,npts,6,data) &&
+                   tokens.character('-') && tokens.number(ntrgs) && tokens.number(ntrgs) && tokens.number(ntrgs) &&
+                   read_triangles(tokens,ntrgs,false,data);
+        }
+
+        bool read_off(Tokenizer& tokens,MeshData& data) {
+            std::string st;
+            unsigned npts,ntrgs,nedges;
+            return tokens.word(st) && st=="OFF" && tokens.number(npts) && tokens.number(ntrgs) && tokens.number(nedges) &&
+                   read_points(tokens,npts,3,data) && read_triangles(tokens,ntrgs,true,data);
+        }
+
+        bool read_bnd(Tokenizer& tokens,MeshData& data) {
+            std::string st;
+            if (!tokens.word(st))
+                return false;
+            if (st=="Type=") {
+                tokens.skip_line();
+                if (!tokens.word(st))
+                    return false;
+            }
+            unsigned npts,ntrgs;
+            if (st!="NumberPositions=" || !tokens.number(npts) || !tokens.word(st))
+                return false;
+            if (st=="UnitPosition") {
+                tokens.skip_line();
+                if (!tokens.word(st))
+                    return false;
+            }
+            return st=="Positions" && read_points(tokens,npts,3,data) &&
+                   tokens.word(st) && st=="NumberPolygons=" && tokens.number(ntrgs) &&
+                   tokens.word(st) && st=="TypePolygons=" && tokens.word(st) && st=="3" &&
+                   tokens.word(st) && st=="Polygons" && read_triangles(tokens,ntrgs,false,data);
+        }
+    }
+
+    bool read_mesh_data(const std::string& filename, MeshData& data)
+    {
+        std::string extension = getNameExtension(filename);
+        std::transform(extension.begin(), extension.end(), extension.begin(), (int(*)(int))std::tolower);
+        if ( extension != "tri" && extension != "bnd" && extension != "off" ) {
+            return false;
+        }
+
+        std::ifstream ifs(filename.c_str(), std::ios::binary);
+        if ( !ifs ) {
+            return false;
+        }
+        ifs.seekg(0, std::ios::end);
+        const std::streamoff size = ifs.tellg();
+        ifs.seekg(0, std::ios::beg);
+        std::vector<char> buffer(size+1);
+        ifs.read(&buffer[0], size);
+        buffer[size] = '\0';
+        if ( !ifs ) {
+            return false;
+        }
+
+        Tokenizer tokens(&buffer[0], &buffer[0]+size);
+        const bool ok = ( extension == "tri" ) ? read_tri(tokens, data) :
+                        ( extension == "bnd" ) ? read_bnd(tokens, data) : read_off(tokens, data);
+        if ( !ok ) {
+            data.points.clear();
+            data.triangles.clear();
+        }
+        return ok;
+    }
+
+    const unsigned VertexWelder::empty;
+
+    VertexWelder::VertexWelder(Vertices& storage, const size_t capacity): storage_(storage), known_(0)
+    {
+        storage_.reserve(storage_.size()+capacity);
+        size_t n = 16;
+        while ( n < 2*storage_.capacity() ) {
+            n *= 2;
+        }
+        table_.assign(n, empty);
+        mask_ = n-1;
+        sync();
+    }
+
+    /// Mix of the bits of the coordinates (-0 and 0 being equal, they are given the same bits).
+    size_t VertexWelder::hash(const Vect3& p) const
+    {
+        uint32_t h = 0x811c9dc5u;
+        for ( unsigned i = 0; i < 3; ++i) {
+            const double c = p(i)+0.0;
+            uint32_t words[2];
+            std::memcpy(words, &c, sizeof(c));
+            for ( unsigned k = 0; k < 2; ++k) {
+                h ^= words[k];
+                h *= 0x01000193u;
+                h ^= h >> 15;
+                h *= 0x2c1b3c6du;
+                h ^= h >> 12;
+            }
+        }
+        return h;
+    }
+
+    void VertexWelder::insert(const unsigned pos)
+    {
+        for ( size_t i = hash(storage_[pos])&mask_; ; i = (i+1)&mask_) {
+            if ( table_[i] == empty ) {
+                table_[i] = pos;
+                return;
+            }
+            if ( storage_[table_[i]] == storage_[pos] ) { // already present: the first one is kept
+                return;
+            }
+        }
+    }
+
+    void VertexWelder::grow()
+    {
+        table_.assign(2*table_.size(), empty);
+        mask_ = table_.size()-1;
+        for ( unsigned pos = 0; pos < known_; ++pos) {
+            insert(pos);
+        }
+    }
+
+    void VertexWelder::sync()
+    {
+        for ( ; known_ < storage_.size(); ++known_) {
+            if ( 2*(known_+1) > table_.size() ) {
+                grow();
+            }
+            insert(known_);
+        }
+    }
+
+    Vertex* VertexWelder::operator()(const Vect3& p)
+    {
+        for ( size_t i = hash(p)&mask_; ; i = (i+1)&mask_) {
+            const unsigned pos = table_[i];
+            if ( pos == empty ) {
+                if ( storage_.size() == storage_.capacity() ) {
+                    throw FullVertexStorage();
+                }
+                storage_.push_back(Vertex(p));
+                sync();
+                return &storage_.back();
+            }
+            if ( storage_[pos] == p ) {
+                return &storage_[pos];
+            }
+        }
+    }
+}
@@ -0,0 +1,101 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_MESH_READER_H
+#define OPENMEEG_MESH_READER_H
+
+#include <string>
+#include <vector>
+#include <vect3.h>
+#include <vertex.h>
+#include <DLLDefinesOpenMEEG.h>
+
+namespace OpenMEEG {
+
+    /// \brief Points and triangles (3 point indices each) of a mesh file, before any welding of the vertices.
+
+    struct OPENMEEG_EXPORT MeshData {
+        std::vector<Vect3>    points;
+        std::vector<unsigned> triangles;
+    };
+
+    /// \brief Read a .tri, .bnd or .off mesh file in a single pass (the file is read at once and the numbers are
+    /// parsed without iostreams nor locale). Files of other formats, or that cannot be parsed, are left to the
+    /// iostream readers of Mesh. \return false in that case.
+
+    OPENMEEG_EXPORT bool read_mesh_data(const std::string& filename, MeshData& data);
+
+    /// \brief Weld vertices with identical coordinates: the vertices of a storage are put in a hash table and the
+    /// points that are not found there are appended to the storage.
+    /// The storage must not be reallocated once meshes point into it: room for capacity more vertices is reserved
+    /// at construction, and FullVertexStorage is thrown if more are added.
+
+    class OPENMEEG_EXPORT VertexWelder {
+    public:
+
+        VertexWelder(Vertices& storage, const size_t capacity);
+
+        /// \return the vertex of the storage at point p (appended if new).
+        Vertex* operator()(const Vect3& p);
+
+        /// Add to the table the vertices appended to the storage by other means.
+        void sync();
+
+              Vertices& storage()       { return storage_; }
+        const Vertices& storage() const { return storage_; }
+
+        /// Position of a vertex in the storage.
+        size_t position(const Vertex* v) const { return v-&storage_[0]; }
+
+    private:
+
+        static const unsigned empty = ~0u;
+
+        size_t hash(const Vect3& p) const;
+        void   insert(const unsigned pos);
+        void   grow();
+
+        Vertices&             storage_;
+        std::vector<unsigned> table_;
+        size_t                mask_;
+        size_t                known_;
+    };
+}
+
+#endif  //  ! OPENMEEG_MESH_READER_H
@@ -53,6 +53,13 @@ void getHelp(char** argv);
 int main(int argc, char **argv)
 {
     print_version(argv[0]);
+    thread_option(argc, argv);
+
+    // Optional timing report (json, csv or text depending on the suffix)
+    const std::string timings_file = extract_option(argc, argv, "-timings");
+    if ( timings_file != "" ) {
+        timings::enable(argv[0]);
+    }
 
     if(argc==1)
     {
@@ -78,12 +85,18 @@ int main(int argc, char **argv)
     C.stop();
     C.dispEllapsed();
 
+    if ( timings_file != "" ) {
+        timings::save_report(timings_file);
+    }
+
     return 0;
 }
 
 void getHelp(char** argv)
 {
     cout << argv[0] <<" [-option] [filepaths...]" << endl << endl;
+    cout << "   -timings file : write a timing report (file.json, file.csv or text) of the computation phases." << endl;
+    cout << "   -threads n : number of threads used by the linear algebra (default OMP_NUM_THREADS)." << endl << endl;
 
     cout << "   Inverse HeadMatrix " << endl;
     cout << "   Filepaths are in order :" << endl;
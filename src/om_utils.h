@@ -45,12 +45,14 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #endif
 
 #include <string>
+#include <cstdlib>
 #include <cmath>
 #include <iostream>
 #include <algorithm>
 #include <cctype>
 
 #include "OpenMEEGConfigure.h"
+#include <thread_budget.h>
 
 #ifdef USE_PROGRESSBAR
     #define PROGRESSBAR(a,b) progressbar((a),(b))
@@ -103,6 +105,35 @@ namespace OpenMEEG {
         return (double)(sqrt(-2*log(x))*cos(2*M_PI*drandom()));
     }
 
+    //  Remove the option "name value" from the command line and return its value ("" if absent).
+
+    inline std::string extract_option(int& argc, char** argv, const char* name) {
+        for ( int i = 1; i+1 < argc; ++i) {
+            if ( std::string(argv[i]) == name ) {
+                const std::string value = argv[i+1];
+                for ( int j = i+2; j < argc; ++j) {
+                    argv[j-2] = argv[j];
+                }
+                argc -= 2;
+                return value;
+            }
+        }
+        return "";
+    }
+
+    //  Set the thread budget of OpenMP and BLAS from the option "-threads n" (also spelled "--threads n").
+    //  Without it, the budget is the OpenMP default (OMP_NUM_THREADS or the number of processors).
+
+    inline void thread_option(int& argc, char** argv) {
+        std::string value = extract_option(argc, argv, "-threads");
+        const std::string long_value = extract_option(argc, argv, "--threads");
+        if ( long_value != "" ) {
+            value = long_value;
+        }
+        const int n = ( value != "" ) ? atoi(value.c_str()) : 0;
+        threads::set_budget(( n > 0 ) ? n : 0);
+    }
+
     inline void disp_argv(int argc, char **argv) {
         std::cout << std::endl << "| ------ " << argv[0] << std::endl;
         for( int i = 1; i < argc; i += 1 )
@@ -114,40 +145,44 @@ namespace OpenMEEG {
 
 #ifdef USE_PROGRESSBAR
     inline void progressbar(unsigned n, unsigned N, unsigned w = 20) {
-        // w : nb of steps
-        const char* cprog = ".";
-        const char* cprog1 = "*";
-        const char* cbeg = "[";
-        const char* cend = "]";
-        unsigned p = (unsigned)std::min( (unsigned)floor(1.f*n*(w+1)/N), w);
-
-        static unsigned pprev = -1;
-        if (N>1) {
-            if (n == 0) {
-                pprev = -1;
-            }
-
-            if (p != pprev) {
-                if (n>1) {
-                    // clear previous string
-                    for(unsigned i = 0; i < (w+2); ++i)
-                        std::cout<< "\b";
+        // Called from inside parallel loops as well: only one thread updates the bar at a time.
+        #pragma omp critical (progressbar)
+        {
+            // w : nb of steps
+            const char* cprog = ".";
+            const char* cprog1 = "*";
+            const char* cbeg = "[";
+            const char* cend = "]";
+            unsigned p = (unsigned)std::min( (unsigned)floor(1.f*n*(w+1)/N), w);
+
+            static unsigned pprev = -1;
+            if (N>1) {
+                if (n == 0) {
+                    pprev = -1;
+                }
 
-                    std::cout<< cbeg;
-                    for(unsigned i = 0; i < p; ++i) {
-                        std::cout<< cprog1;
-                    }
-                    for(unsigned i = p; i < w; ++i) {
-                        std::cout<< cprog;
+                if (p != pprev) {
+                    if (n>1) {
+                        // clear previous string
+                        for(unsigned i = 0; i < (w+2); ++i)
+                            std::cout<< "\b";
+
+                        std::cout<< cbeg;
+                        for(unsigned i = 0; i < p; ++i) {
+                            std::cout<< cprog1;
+                        }
+                        for(unsigned i = p; i < w; ++i) {
+                            std::cout<< cprog;
+                        }
+                        std::cout<< cend;
                     }
-                    std::cout<< cend;
                 }
+                pprev = p;
+                if (n >= (N-1)) {
+                    std::cout<<"\n";
+                }
+                std::cout.flush();
             }
-            pprev = p;
-            if (n >= (N-1)) {
-                std::cout<<"\n";
-            }
-            std::cout.flush();
         }
     }
 #endif
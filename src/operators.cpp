@@ -37,89 +37,280 @@ The fact that you are presently reading this means that you have had
 knowledge of the CeCILL-B license and that you accept its terms.
 */
 
+#include <vector>
+#include <algorithm>
+
 #include <operators.h>
 
 namespace OpenMEEG {
 
-    void operatorDinternal(const Mesh& m, Matrix& mat, const Vertices& points, const double& coeff)
+    void operatorDinternal(const GeometryView& view, const Mesh& m, Matrix& mat, const Vertices& points, const double& coeff)
     {
         std::cout << "INTERNAL OPERATOR D..." << std::endl;
+        TIMED_SCOPE("operatorDinternal");
+        timings::count(points.size()*m.nb_triangles());
+        const GeometryView::MeshRange& range = view.range(m);
         for ( Vertices::const_iterator vit = points.begin(); vit != points.end(); ++vit)  {
-            for ( Mesh::const_iterator tit = m.begin(); tit != m.end(); ++tit) {
-                _operatorDinternal(*tit, *vit, mat, coeff);
+            for ( unsigned t = range.first_triangle; t < range.first_triangle+range.nb_triangles; ++t) {
+                _operatorDinternal(view, t, *vit, mat, coeff);
             }
         }
     }
 
-    void operatorSinternal(const Mesh& m, Matrix& mat, const Vertices& points, const double& coeff) 
+    void operatorSinternal(const GeometryView& view, const Mesh& m, Matrix& mat, const Vertices& points, const double& coeff) 
     {
         std::cout << "INTERNAL OPERATOR S..." << std::endl;
+        TIMED_SCOPE("operatorSinternal");
+        timings::count(points.size()*m.nb_triangles());
+        const GeometryView::MeshRange& range  = view.range(m);
+        const unsigned*                tindex = view.triangle_index();
         for ( Vertices::const_iterator vit = points.begin(); vit != points.end(); ++vit)  {
-            for ( Mesh::const_iterator tit = m.begin(); tit != m.end(); ++tit) {
-                mat(vit->index(), tit->index()) = _operatorSinternal(*tit, *vit) * coeff;
+            for ( unsigned t = range.first_triangle; t < range.first_triangle+range.nb_triangles; ++t) {
+                mat(vit->index(), tindex[t]) = _operatorSinternal(view, t, *vit) * coeff;
             }
         }
     }
 
     // General routine for applying _operatorFerguson (see this function for further comments)
     // to an entire mesh, and storing coordinates of the output in a Matrix.
-    void operatorFerguson(const Vect3& x, const Mesh& m, Matrix& mat, const unsigned& offsetI, const double& coeff)
+    void operatorFerguson(const GeometryView& view, const Vect3& x, const Mesh& m, Matrix& mat, const unsigned& offsetI, const double& coeff)
     {
+        TIMED_SCOPE("operatorFerguson");
+        timings::count(m.nb_vertices());
+        const GeometryView::MeshRange& range  = view.range(m);
+        const unsigned*                vindex = view.vertex_index();
+        const int first = range.first_vertex;
+        const int last  = first + range.nb_vertices;
         #pragma omp parallel for
-        for ( Mesh::const_vertex_iterator vit = m.vertex_begin(); vit < m.vertex_end(); ++vit) {
-            Vect3 v = _operatorFerguson(x, **vit, m);
-            mat(offsetI + 0, (*vit)->index()) += v.x() * coeff;
-            mat(offsetI + 1, (*vit)->index()) += v.y() * coeff;
-            mat(offsetI + 2, (*vit)->index()) += v.z() * coeff;
+        for ( int i = first; i < last; ++i) {
+            const Vect3    v     = _operatorFerguson(view, x, i);
+            const unsigned index = vindex[view.mesh_vertices()[i]];
+            mat(offsetI + 0, index) += v.x() * coeff;
+            mat(offsetI + 1, index) += v.y() * coeff;
+            mat(offsetI + 2, index) += v.z() * coeff;
         }
     }
 
-    void operatorDipolePotDer(const Vect3& r0, const Vect3& q, const Mesh& m, Vector& rhs, const double& coeff, const unsigned gauss_order, const bool adapt_rhs) 
+    void operatorDipolePotDer(const GeometryView& view, const Vect3& r0, const Vect3& q, const Mesh& m, Vector& rhs, const double& coeff, const unsigned gauss_order, const bool adapt_rhs) 
     {
-        static analyticDipPotDer anaDPD;
+        TIMED_SCOPE("operatorDipolePotDer");
+        timings::count(m.nb_triangles());
 
-        Integrator<Vect3, analyticDipPotDer>* gauss;
-        if ( adapt_rhs ) {
-            gauss = new AdaptiveIntegrator<Vect3, analyticDipPotDer>(0.001);
-        } else {
-            gauss = new Integrator<Vect3, analyticDipPotDer>;
-        }
+        analyticDipPotDer anaDPD;
+
+        Integrator<Vect3, analyticDipPotDer>         fixed;
+        AdaptiveIntegrator<Vect3, analyticDipPotDer> adaptive(0.001);
+        Integrator<Vect3, analyticDipPotDer>&        gauss = adapt_rhs ? adaptive : fixed;
+
+        gauss.setOrder(gauss_order);
+
+        //  Triangles share vertices: integrate in parallel, then accumulate serially (no critical
+        //  section per triangle, and the same summation order whatever the number of threads).
 
-        gauss->setOrder(gauss_order);
+        const GeometryView::MeshRange& range = view.range(m);
+        const int first = range.first_triangle;
+        const int last  = first + range.nb_triangles;
+        std::vector<Vect3> values(m.nb_triangles());
         #pragma omp parallel for private(anaDPD)
-        for ( Mesh::const_iterator tit = m.begin(); tit < m.end(); ++tit) {
-            anaDPD.init(*tit, q, r0);
-            Vect3 v = gauss->integrate(anaDPD, *tit);
-            #pragma omp critical
-            {
-                rhs(tit->s1().index() ) += v(0) * coeff;
-                rhs(tit->s2().index() ) += v(1) * coeff;
-                rhs(tit->s3().index() ) += v(2) * coeff;
-            }
+        for ( int t = first; t < last; ++t) {
+            const Vect3 points[3] = { view.corner(t, 0), view.corner(t, 1), view.corner(t, 2) };
+            anaDPD.init(view, t, q, r0);
+            values[t-first] = gauss.integrate(anaDPD, points);
+        }
+        const unsigned* vindex = view.vertex_index();
+        for ( int t = first; t < last; ++t) {
+            const Vect3&   v       = values[t-first];
+            const int32_t* corners = view.corners(t);
+            rhs(vindex[corners[0]]) += v(0) * coeff;
+            rhs(vindex[corners[1]]) += v(1) * coeff;
+            rhs(vindex[corners[2]]) += v(2) * coeff;
         }
-        delete gauss;
     }
 
-    void operatorDipolePot(const Vect3& r0, const Vect3& q, const Mesh& m, Vector& rhs, const double& coeff, const unsigned gauss_order, const bool adapt_rhs) 
+    void operatorDipolePot(const GeometryView& view, const Vect3& r0, const Vect3& q, const Mesh& m, Vector& rhs, const double& coeff, const unsigned gauss_order, const bool adapt_rhs) 
     {
-        static analyticDipPot anaDP;
+        TIMED_SCOPE("operatorDipolePot");
+        timings::count(m.nb_triangles());
+
+        analyticDipPot anaDP;
 
         anaDP.init(q, r0);
-        Integrator<double, analyticDipPot> *gauss;
-        if ( adapt_rhs ) {
-            gauss = new AdaptiveIntegrator<double, analyticDipPot>(0.001);
-        } else {
-            gauss = new Integrator<double, analyticDipPot>;
-        }
 
-        gauss->setOrder(gauss_order);
+        Integrator<double, analyticDipPot>         fixed;
+        AdaptiveIntegrator<double, analyticDipPot> adaptive(0.001);
+        Integrator<double, analyticDipPot>&        gauss = adapt_rhs ? adaptive : fixed;
+
+        gauss.setOrder(gauss_order);
+        const GeometryView::MeshRange& range  = view.range(m);
+        const unsigned*                tindex = view.triangle_index();
+        const int first = range.first_triangle;
+        const int last  = first + range.nb_triangles;
         #pragma omp parallel for
-        for ( Mesh::const_iterator tit = m.begin(); tit < m.end(); ++tit) {
-            double d = gauss->integrate(anaDP, *tit);
-            #pragma omp critical
-            rhs(tit->index()) += d * coeff;
+        for ( int t = first; t < last; ++t) {
+            // Each triangle has its own unknown: no concurrent update.
+            const Vect3 points[3] = { view.corner(t, 0), view.corner(t, 1), view.corner(t, 2) };
+            rhs(tindex[t]) += gauss.integrate(anaDP, points) * coeff;
+        }
+    }
+
+    void operatorDinternal(const Mesh& m, Matrix& mat, const Vertices& points, const double& coeff)
+    {
+        const GeometryView view(m);
+        operatorDinternal(view, m, mat, points, coeff);
+    }
+
+    void operatorSinternal(const Mesh& m, Matrix& mat, const Vertices& points, const double& coeff) 
+    {
+        const GeometryView view(m);
+        operatorSinternal(view, m, mat, points, coeff);
+    }
+
+    void operatorFerguson(const Vect3& x, const Mesh& m, Matrix& mat, const unsigned& offsetI, const double& coeff)
+    {
+        const GeometryView view(m);
+        operatorFerguson(view, x, m, mat, offsetI, coeff);
+    }
+
+    void operatorDipolePotDer(const Vect3& r0, const Vect3& q, const Mesh& m, Vector& rhs, const double& coeff, const unsigned gauss_order, const bool adapt_rhs) 
+    {
+        const GeometryView view(m);
+        operatorDipolePotDer(view, r0, q, m, rhs, coeff, gauss_order, adapt_rhs);
+    }
+
+    void operatorDipolePot(const Vect3& r0, const Vect3& q, const Mesh& m, Vector& rhs, const double& coeff, const unsigned gauss_order, const bool adapt_rhs) 
+    {
+        const GeometryView view(m);
+        operatorDipolePot(view, r0, q, m, rhs, coeff, gauss_order, adapt_rhs);
+    }
+
+    #ifdef USE_MPI
+
+    // Values of a matrix at the entries (rows[i], cols[j]), accessed by the indices rows[i] and cols[j].
+
+    class EntryCache {
+    public:
+
+        EntryCache(const std::vector<size_t>& rows, const std::vector<size_t>& cols, const Matrix& v): values(v)
+        {
+            for ( unsigned i = 0; i < rows.size(); ++i) {
+                row.resize(std::max(row.size(), rows[i]+1));
+                row[rows[i]] = i;
+            }
+            for ( unsigned j = 0; j < cols.size(); ++j) {
+                col.resize(std::max(col.size(), cols[j]+1));
+                col[cols[j]] = j;
+            }
+        }
+
+        double operator()(const unsigned i, const unsigned j) const { return values(row[i], col[j]); }
+
+    private:
+
+        std::vector<unsigned> row;
+        std::vector<unsigned> col;
+        const Matrix          values;
+    };
+
+    // Triangles adjacent to the vertices (entries of mesh_vertices()) first..first+used.size()-1 marked in used.
+
+    static std::vector<unsigned> adjacent_triangles(const GeometryView& view, const unsigned first, const std::vector<bool>& used)
+    {
+        std::vector<bool> marked(view.nb_triangles(), false);
+        std::vector<unsigned> triangles;
+        for ( unsigned v = 0; v < used.size(); ++v) {
+            if ( used[v] ) {
+                for ( const int32_t* tit = view.adjacent_begin(first+v); tit != view.adjacent_end(first+v); ++tit) {
+                    if ( !marked[*tit] ) {
+                        marked[*tit] = true;
+                        triangles.push_back(*tit);
+                    }
+                }
+            }
+        }
+        return triangles;
+    }
+
+    void operatorN(const GeometryView& view, const Mesh& m1, const Mesh& m2, DistributedSymMatrix& mat, const double& coeff, const unsigned gauss_order)
+    {
+        std::cout << "OPERATOR N (distributed) ... (arg : mesh " << m1.name() << " , mesh " << m2.name() << " )" << std::endl;
+
+        TIMED_SCOPE("operatorN");
+        timings::count(m1.nb_vertices()*m2.nb_vertices());
+
+        const GeometryView::MeshRange& r1 = view.range(m1);
+        const GeometryView::MeshRange& r2 = view.range(m2);
+        const unsigned* tindex = view.triangle_index();
+        const unsigned* vindex = view.vertex_index();
+        const int32_t*  mv     = view.mesh_vertices();
+        const double*   areas  = view.areas();
+        const int v1_end = r1.first_vertex + r1.nb_vertices;
+        const int v2_end = r2.first_vertex + r2.nb_vertices;
+
+        // As in the serial version, S is read from mat (indexed by the triangle unknowns) unless one of
+        // the meshes is outermost, in which case S divided by the areas is indexed relatively to the meshes.
+
+        const bool     outermost = m1.outermost() || m2.outermost();
+        const unsigned first1    = outermost ? tindex[r1.first_triangle] : 0;
+        const unsigned first2    = outermost ? tindex[r2.first_triangle] : 0;
+
+        // The same groups of rows are handled on all the processes (fetch is collective).
+
+        const int rows_per_group = 256;
+        for ( int group = r1.first_vertex; group < v1_end; group += rows_per_group) {
+            const int group_end = std::min(group+rows_per_group, v1_end);
+
+            std::vector<std::pair<int, int> > entries;
+            std::vector<bool> used1(r1.nb_vertices, false);
+            std::vector<bool> used2(r2.nb_vertices, false);
+            for ( int v1 = group; v1 < group_end; ++v1) {
+                const int v2_begin = ( &m1 != &m2 ) ? r2.first_vertex : ( outermost ? v1 : r1.first_vertex );
+                const int v2_last  = ( &m1 != &m2 || outermost ) ? v2_end : v1+1;
+                for ( int v2 = v2_begin; v2 < v2_last; ++v2) {
+                    if ( mat.owns(vindex[mv[v1]], vindex[mv[v2]]) ) {
+                        entries.push_back(std::make_pair(v1, v2));
+                        used1[v1-r1.first_vertex] = true;
+                        used2[v2-r2.first_vertex] = true;
+                    }
+                }
+            }
+
+            const std::vector<unsigned> triangles1 = adjacent_triangles(view, r1.first_vertex, used1);
+            const std::vector<unsigned> triangles2 = adjacent_triangles(view, r2.first_vertex, used2);
+            std::vector<size_t> rows(triangles1.size());
+            std::vector<size_t> cols(triangles2.size());
+            for ( unsigned i = 0; i < triangles1.size(); ++i) {
+                rows[i] = tindex[triangles1[i]] - first1;
+            }
+            for ( unsigned j = 0; j < triangles2.size(); ++j) {
+                cols[j] = tindex[triangles2[j]] - first2;
+            }
+
+            Matrix values;
+            if ( outermost ) {
+                values = Matrix(rows.size(), cols.size());
+                TaskSchedule columns(0, cols.size());
+                #pragma omp parallel
+                for ( int j; columns.next(j); ) {
+                    for ( int i = 0; i < static_cast<int>(rows.size()); ++i) {
+                        // the serial version only computes S(t1, t2) for t1 <= t2 on a mesh.
+                        const unsigned t1 = ( &m1 == &m2 ) ? std::min(triangles1[i], triangles2[j]) : triangles1[i];
+                        const unsigned t2 = ( &m1 == &m2 ) ? std::max(triangles1[i], triangles2[j]) : triangles2[j];
+                        values(i, j) = _operatorS(view, t1, t2, gauss_order) / ( areas[t1] * areas[t2]);
+                    }
+                }
+            } else {
+                values = mat.fetch(rows, cols);
+            }
+
+            const EntryCache S(rows, cols, values);
+            #pragma omp parallel for
+            for ( int k = 0; k < static_cast<int>(entries.size()); ++k) {
+                const int v1 = entries[k].first;
+                const int v2 = entries[k].second;
+                mat(vindex[mv[v1]], vindex[mv[v2]]) += _operatorN(view, v1, v2, m1, m2, r1, r2, S) * coeff;
+            }
         }
-        delete gauss;
     }
+    #endif
 
 } // namespace OpenMEEG
@@ -50,8 +50,14 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #include <symmatrix.h>
 #include <sparse_matrix.h>
 #include <geometry.h>
+#include <geometry_view.h>
 #include <integrator.h>
 #include <analytics.h>
+#include <task_schedule.h>
+
+#ifdef USE_MPI
+#include <distributed_matrix.h>
+#endif
 
 namespace OpenMEEG {
 
@@ -69,11 +75,37 @@ namespace OpenMEEG {
     void operatorSinternal(const Mesh& , Matrix& , const Vertices&, const double& );
     void operatorDinternal(const Mesh& , Matrix& , const Vertices&, const double& );
     void operatorFerguson(const Vect3& , const Mesh& , Matrix& , const unsigned&, const double&);
+    void operatorSinternal(const GeometryView& , const Mesh& , Matrix& , const Vertices&, const double& );
+    void operatorDinternal(const GeometryView& , const Mesh& , Matrix& , const Vertices&, const double& );
+    void operatorFerguson(const GeometryView& , const Vect3& , const Mesh& , Matrix& , const unsigned&, const double&);
     void operatorDipolePotDer(const Vect3& , const Vect3& , const Mesh& , Vector&, const double&, const unsigned, const bool);
     void operatorDipolePot   (const Vect3& , const Vect3& , const Mesh& , Vector&, const double&, const unsigned, const bool);
+    void operatorDipolePotDer(const GeometryView& , const Vect3& , const Vect3& , const Mesh& , Vector&, const double&, const unsigned, const bool);
+    void operatorDipolePot   (const GeometryView& , const Vect3& , const Vect3& , const Mesh& , Vector&, const double&, const unsigned, const bool);
+
+    // The kernels work on the triangles (numbered as in a GeometryView) and on the entries of the vertex
+    // lists of the meshes (mesh_vertices() of the view), so that the loops run over contiguous arrays.
+
+    /// Order of the quadrature on triangle Tq of a kernel singular on triangle T (see QuadraturePolicy).
+
+    inline unsigned pair_order(const GeometryView& view, const unsigned T, const unsigned Tq, const unsigned gauss_order)
+    {
+        if ( !QuadraturePolicy::enabled() ) {
+            return gauss_order;
+        }
+        const KernelSetup& s  = view.setup(T);
+        const KernelSetup& sq = view.setup(Tq);
+        return QuadraturePolicy::order(gauss_order, 2.0*sq.radius, (s.center-sq.center).norm()-s.radius);
+    }
+
+    /// Entries of mat computed by the calling process: all of them, except for a distributed matrix
+    /// (see distributed_matrix.h), of which each process only computes the entries it owns.
+
+    template<class T>
+    inline bool owns(const T&, const unsigned, const unsigned) { return true; }
 
     #ifndef OPTIMIZED_OPERATOR_D
-    inline double _operatorD(const Triangle& T, const Vertex& V, const Mesh& m, const unsigned gauss_order)
+    inline double _operatorD(const GeometryView& view, const unsigned T, const unsigned V, const unsigned gauss_order)
     {
         // consider varying order of quadrature with the distance between T and T2
         STATIC_OMP analyticD analyD;
@@ -86,123 +118,143 @@ namespace OpenMEEG {
 
         double total = 0;
 
-        const Mesh::VectPTriangle& Tadj = m.get_triangles_for_vertex(V); // loop on triangles of which V is a vertex
-
-        for ( Mesh::VectPTriangle::const_iterator tit = Tadj.begin(); tit != Tadj.end(); ++tit) {
-            analyD.init(**tit, V);
-            total += gauss.integrate(analyD, T);
+        const Vect3   points[3] = { view.corner(T, 0), view.corner(T, 1), view.corner(T, 2) };
+        const int32_t v         = view.mesh_vertices()[V];
+        for ( const int32_t* tit = view.adjacent_begin(V); tit != view.adjacent_end(V); ++tit) { // loop on triangles of which V is a vertex
+            analyD.init(view, *tit, v);
+            gauss.setOrder(pair_order(view, *tit, T, gauss_order));
+            total += gauss.integrate(analyD, points);
         }
         return total;
     }
     #else
 
     template<class T>
-    inline void _operatorD(const Triangle& T1, const Triangle& T2, T& mat, const double& coeff, const unsigned gauss_order)
+    inline void _operatorD(const GeometryView& view, const unsigned T1, const unsigned T2, T& mat, const double& coeff, const unsigned gauss_order)
     {
         //this version of _operatorD add in the Matrix the contribution of T2 on T1
         // for all the P1 functions it gets involved
         // consider varying order of quadrature with the distance between T1 and T2
+        const unsigned  row     = view.triangle_index()[T1];
+        const unsigned* vindex  = view.vertex_index();
+        const int32_t*  corners = view.corners(T2);
+        if ( !owns(mat, row, vindex[corners[0]]) && !owns(mat, row, vindex[corners[1]]) && !owns(mat, row, vindex[corners[2]]) ) {
+            return;
+        }
+
         STATIC_OMP analyticD3 analyD;
 
-        analyD.init(T2);
+        analyD.init(view, T2);
+        const Vect3 points[3] = { view.corner(T1, 0), view.corner(T1, 1), view.corner(T1, 2) };
+        const unsigned order = pair_order(view, T2, T1, gauss_order);
     #ifdef ADAPT_LHS
         AdaptiveIntegrator<Vect3, analyticD3> gauss(0.005);
-        gauss.setOrder(gauss_order);
-        Vect3 total = gauss.integrate(analyD, T1);
+        gauss.setOrder(order);
+        Vect3 total = gauss.integrate(analyD, points);
     #else
-        STATIC_OMP Integrator<Vect3, analyticD3> gauss(gauss_order);
-        Vect3 total = gauss.integrate(analyD, T1);
+        STATIC_OMP Integrator<Vect3, analyticD3> gauss;
+        gauss.setOrder(order);
+        Vect3 total = gauss.integrate(analyD, points);
     #endif //ADAPT_LHS
 
         for ( unsigned i = 0; i < 3; ++i) {
-            mat(T1.index(), T2(i).index()) += total(i) * coeff;
+            if ( owns(mat, row, vindex[corners[i]]) ) {
+                mat(row, vindex[corners[i]]) += total(i) * coeff;
+            }
         }
     }
     #endif //OPTIMIZED_OPERATOR_D
 
-    inline void _operatorDinternal(const Triangle& T2, const Vertex& P, Matrix & mat, const double& coeff)
+    inline void _operatorDinternal(const GeometryView& view, const unsigned T2, const Vertex& P, Matrix & mat, const double& coeff)
     {
         static analyticD3 analyD;
 
-        analyD.init(T2);
+        analyD.init(view, T2);
 
         Vect3 total = analyD.f(P);
 
+        const int32_t* corners = view.corners(T2);
         for ( unsigned i = 0; i < 3; ++i) {
-            mat(P.index(), T2(i).index()) += total(i) * coeff;
+            mat(P.index(), view.vertex_index()[corners[i]]) += total(i) * coeff;
         }
     }
 
-    inline double _operatorS(const Triangle& T1, const Triangle& T2, const unsigned gauss_order)
+    inline double _operatorS(const GeometryView& view, const unsigned T1, const unsigned T2, const unsigned gauss_order)
     {
-        STATIC_OMP Triangle *oldT = 0;
         STATIC_OMP analyticS analyS;
 
-        if ( oldT != &T1 ) { // a few computations are needed only when changing triangle T1
-            oldT = (Triangle*)&T1;
-            analyS.init(T1);
-        }
+        analyS.init(view, T1);
+        const Vect3    points[3] = { view.corner(T2, 0), view.corner(T2, 1), view.corner(T2, 2) };
+        const unsigned order     = pair_order(view, T1, T2, gauss_order);
     #ifdef ADAPT_LHS
         AdaptiveIntegrator<double, analyticS> gauss(0.005);
-        gauss.setOrder(gauss_order);
-        return gauss.integrate(analyS, T2);
+        gauss.setOrder(order);
+        return gauss.integrate(analyS, points);
     #else
         STATIC_OMP Integrator<double, analyticS> gauss;
-        gauss.setOrder(gauss_order);
-        return gauss.integrate(analyS, T2);
+        gauss.setOrder(order);
+        return gauss.integrate(analyS, points);
     #endif //ADAPT_LHS
     }
 
-    inline double _operatorSinternal(const Triangle& T, const Vertex& P)
+    inline double _operatorSinternal(const GeometryView& view, const unsigned T, const Vertex& P)
     {
         static analyticS analyS;
-        analyS.init(T);
+        analyS.init(view, T);
         return analyS.f(P);
     }
 
     template<class T>
-    inline double _operatorN(const Vertex& V1, const Vertex& V2, const Mesh& m1, const Mesh& m2, const T& mat)
+    inline double _operatorN(const GeometryView& view, const unsigned V1, const unsigned V2, const Mesh& m1, const Mesh& m2,
+                             const GeometryView::MeshRange& r1, const GeometryView::MeshRange& r2, const T& mat)
     {
         double Iqr, Aqr;
         double result = 0.0;
 
-        const Mesh::VectPTriangle& trgs1 = m1.get_triangles_for_vertex(V1);
-        const Mesh::VectPTriangle& trgs2 = m2.get_triangles_for_vertex(V2);
-
-        for ( Mesh::VectPTriangle::const_iterator tit1 = trgs1.begin(); tit1 != trgs1.end(); ++tit1 ) {
-            for ( Mesh::VectPTriangle::const_iterator tit2 = trgs2.begin(); tit2 != trgs2.end(); ++tit2 ) {
+        const unsigned* tindex = view.triangle_index();
+        const double*   areas  = view.areas();
+        const unsigned  first1 = tindex[r1.first_triangle];
+        const unsigned  first2 = tindex[r2.first_triangle];
+        const int32_t   v1     = view.mesh_vertices()[V1];
+        const int32_t   v2     = view.mesh_vertices()[V2];
+        const bool      shared = (&m1 != &m2) && (view.vertex(v1) == view.vertex(v2));
+
+        for ( const int32_t* tit1 = view.adjacent_begin(V1); tit1 != view.adjacent_end(V1); ++tit1 ) {
+            const unsigned k1 = view.corner_of(*tit1, v1);
+            for ( const int32_t* tit2 = view.adjacent_begin(V2); tit2 != view.adjacent_end(V2); ++tit2 ) {
+                const unsigned k2 = view.corner_of(*tit2, v2);
                 if ( m1.outermost() || m2.outermost() ) {
-                    Iqr = mat((*tit1)->index() - m1.begin()->index(), (*tit2)->index() - m2.begin()->index());
+                    Iqr = mat(tindex[*tit1] - first1, tindex[*tit2] - first2);
                 } else {
                     // we here divided (precalculated) operatorS by the product of areas.
-                    Iqr = mat((*tit1)->index(), (*tit2)->index()) / ( (*tit1)->area() * (*tit2)->area());
+                    Iqr = mat(tindex[*tit1], tindex[*tit2]) / ( areas[*tit1] * areas[*tit2]);
                 }
             #ifndef OPTIMIZED_OPERATOR_N
                 // A1 , B1 , A2, B2 are the two opposite vertices to V1 and V2 (triangles A1, B1, V1 and A2, B2, V2)
-                Vect3 A1 = (*tit1)->next(V1);
-                Vect3 B1 = (*tit1)->prev(V1);
-                Vect3 A2 = (*tit2)->next(V2);
-                Vect3 B2 = (*tit2)->prev(V2);
+                Vect3 P1 = view.vertex(v1);
+                Vect3 P2 = view.vertex(v2);
+                Vect3 A1 = view.corner(*tit1, k1+1);
+                Vect3 B1 = view.corner(*tit1, k1+2);
+                Vect3 A2 = view.corner(*tit2, k2+1);
+                Vect3 B2 = view.corner(*tit2, k2+2);
                 Vect3 A1B1 = B1 - A1;
                 Vect3 A2B2 = B2 - A2;
-                Vect3 A1V1 = V1 - A1;
-                Vect3 A2V2 = V2 - A2;
+                Vect3 A1V1 = P1 - A1;
+                Vect3 A2V2 = P2 - A2;
                 double coef1 = A1V1 * A1B1 / A1B1.norm2();
                 double coef2 = A2V2 * A2B2 / A2B2.norm2();
-                Vect3 aq = V1 - (A1 + A1B1 * coef1);
-                Vect3 br = V2 - (A2 + A2B2 * coef2);
+                Vect3 aq = P1 - (A1 + A1B1 * coef1);
+                Vect3 br = P2 - (A2 + A2B2 * coef2);
                 aq /= aq.norm2();
                 br /= br.norm2();
 
-                Aqr = -0.25 * ((aq ^ (*tit1)->normal()) * (br ^ (*tit2)->normal()));
+                Aqr = -0.25 * ((aq ^ view.normal(*tit1)) * (br ^ view.normal(*tit2)));
             #else
-                Vect3 CB1 = (*tit1)->next(V1) - (*tit1)->prev(V1);
-                Vect3 CB2 = (*tit2)->next(V2) - (*tit2)->prev(V2);
-
-                Aqr = -0.25 * (CB1 * CB2);
+                // the edges opposite to V1 and V2 (next - prev is the opposite of the edge k+1).
+                Aqr = -0.25 * (view.edge(*tit1, k1+1) * view.edge(*tit2, k2+1));
             #endif
                 // if it is the same shared vertex
-                if ( (&m1 != &m2) && (V1 == V2) ) {
+                if ( shared ) {
                     result += 2. * Aqr * Iqr;
                 } else {
                     result += Aqr * Iqr;
@@ -221,10 +273,17 @@ namespace OpenMEEG {
         }
     }
 
+    #ifdef USE_MPI
+    // Operator N for a distributed matrix: the entries of operator S that it needs are fetched from the
+    // processes owning them (or computed when S is not part of mat), by groups of rows to bound the memory.
+    void operatorN(const GeometryView& view, const Mesh& m1, const Mesh& m2, DistributedSymMatrix& mat, const double& coeff, const unsigned gauss_order);
+    #endif
+
     template<class T>
-    void operatorN(const Mesh& m1, const Mesh& m2, T& mat, const double& coeff, const unsigned gauss_order)
+    void operatorN(const GeometryView& view, const Mesh& m1, const Mesh& m2, T& mat, const double& coeff, const unsigned gauss_order)
     {
         // This function has the following arguments:
+        //    the view of the meshes
         //    the 2 interacting meshes
         //    the storage Matrix for the result
         //    the coefficient to be appleid to each matrix element (depending on conductivities, ...)
@@ -232,32 +291,52 @@ namespace OpenMEEG {
 
         std::cout << "OPERATOR N ... (arg : mesh " << m1.name() << " , mesh " << m2.name() << " )" << std::endl;
 
+        TIMED_SCOPE("operatorN");
+        timings::count(m1.nb_vertices()*m2.nb_vertices());
+
+        const GeometryView::MeshRange& r1 = view.range(m1);
+        const GeometryView::MeshRange& r2 = view.range(m2);
+        const unsigned* tindex = view.triangle_index();
+        const unsigned* vindex = view.vertex_index();
+        const int32_t*  mv     = view.mesh_vertices();
+        const double*   areas  = view.areas();
+        const int t1_end = r1.first_triangle + r1.nb_triangles;
+        const int t2_end = r2.first_triangle + r2.nb_triangles;
+        const int v1_end = r1.first_vertex + r1.nb_vertices;
+        const int v2_end = r2.first_vertex + r2.nb_vertices;
+
         unsigned i = 0; // for the PROGRESSBAR
         if ( &m1 == &m2 ) {
             if ( m1.outermost() ) {
                 // we thus precompute operator S divided by the product of triangles area.
                 SymMatrix matS(m1.nb_triangles());
-                for ( Mesh::const_iterator tit1 = m1.begin(); tit1 != m1.end(); ++tit1) {
+                TaskSchedule triangles(r1.first_triangle, t1_end);
+                #pragma omp parallel
+                for ( int t1; triangles.next(t1); ) {
+                    #pragma omp critical
                     PROGRESSBAR(i++, m1.nb_triangles());
-                    #pragma omp parallel for
-                    for ( Mesh::const_iterator tit2 = tit1; tit2 < m1.end(); ++tit2) {
-                        matS(tit1->index() - m1.begin()->index(), tit2->index() - m1.begin()->index()) = _operatorS(*tit1, *tit2, gauss_order) / ( tit1->area() * tit2->area());
+                    for ( int t2 = t1; t2 < t1_end; ++t2) {
+                        matS(tindex[t1] - tindex[r1.first_triangle], tindex[t2] - tindex[r1.first_triangle]) = _operatorS(view, t1, t2, gauss_order) / ( areas[t1] * areas[t2]);
                     }
                 }
                 i = 0 ;
-                for ( Mesh::const_vertex_iterator vit1 = m1.vertex_begin(); vit1 != m1.vertex_end(); ++vit1) {
+                TaskSchedule vertices(r1.first_vertex, v1_end);
+                #pragma omp parallel
+                for ( int v1; vertices.next(v1); ) {
+                    #pragma omp critical
                     PROGRESSBAR(i++, m1.nb_vertices());
-                    #pragma omp parallel for
-                    for ( Mesh::const_vertex_iterator vit2 = vit1; vit2 < m1.vertex_end(); ++vit2) {
-                        mat((*vit1)->index(), (*vit2)->index()) += _operatorN(**vit1, **vit2, m1, m1, matS) * coeff;
+                    for ( int v2 = v1; v2 < v1_end; ++v2) {
+                        mat(vindex[mv[v1]], vindex[mv[v2]]) += _operatorN(view, v1, v2, m1, m1, r1, r1, matS) * coeff;
                     }
                 }
             } else {
-                for ( Mesh::const_vertex_iterator vit1 = m1.vertex_begin(); vit1 != m1.vertex_end(); ++vit1) {
+                TaskSchedule vertices(r1.first_vertex, v1_end);
+                #pragma omp parallel
+                for ( int v1; vertices.next(v1); ) {
+                    #pragma omp critical
                     PROGRESSBAR(i++, m1.nb_vertices());
-                    #pragma omp parallel for
-                    for ( Mesh::const_vertex_iterator vit2 = m1.vertex_begin(); vit2 <= vit1; ++vit2) {
-                        mat((*vit1)->index(), (*vit2)->index()) += _operatorN(**vit1, **vit2, m1, m1, mat) * coeff;
+                    for ( int v2 = r1.first_vertex; v2 <= v1; ++v2) {
+                        mat(vindex[mv[v1]], vindex[mv[v2]]) += _operatorN(view, v1, v2, m1, m1, r1, r1, mat) * coeff;
                     }
                 }
             }
@@ -265,27 +344,33 @@ namespace OpenMEEG {
             if ( m1.outermost() || m2.outermost() ) {
                 // we thus precompute operator S divided by the product of triangles area.
                 Matrix matS(m1.nb_triangles(), m2.nb_triangles());
-                for ( Mesh::const_iterator tit1 = m1.begin(); tit1 != m1.end(); ++tit1) {
+                TaskSchedule triangles(r1.first_triangle, t1_end);
+                #pragma omp parallel
+                for ( int t1; triangles.next(t1); ) {
+                    #pragma omp critical
                     PROGRESSBAR(i++, m1.nb_triangles());
-                    #pragma omp parallel for
-                    for ( Mesh::const_iterator tit2 = m2.begin(); tit2 < m2.end(); ++tit2) {
-                        matS(tit1->index() - m1.begin()->index(), tit2->index() - m2.begin()->index()) = _operatorS(*tit1, *tit2, gauss_order) / ( tit1->area() * tit2->area());
+                    for ( int t2 = r2.first_triangle; t2 < t2_end; ++t2) {
+                        matS(tindex[t1] - tindex[r1.first_triangle], tindex[t2] - tindex[r2.first_triangle]) = _operatorS(view, t1, t2, gauss_order) / ( areas[t1] * areas[t2]);
                     }
                 }
                 i = 0 ;
-                for ( Mesh::const_vertex_iterator vit1 = m1.vertex_begin(); vit1 != m1.vertex_end(); ++vit1) {
+                TaskSchedule vertices(r1.first_vertex, v1_end);
+                #pragma omp parallel
+                for ( int v1; vertices.next(v1); ) {
+                    #pragma omp critical
                     PROGRESSBAR(i++, m1.nb_vertices());
-                    #pragma omp parallel for
-                    for ( Mesh::const_vertex_iterator vit2 = m2.vertex_begin(); vit2 < m2.vertex_end(); ++vit2) {
-                        mat((*vit1)->index(), (*vit2)->index()) += _operatorN(**vit1, **vit2, m1, m2, matS) * coeff;
+                    for ( int v2 = r2.first_vertex; v2 < v2_end; ++v2) {
+                        mat(vindex[mv[v1]], vindex[mv[v2]]) += _operatorN(view, v1, v2, m1, m2, r1, r2, matS) * coeff;
                     }
                 }
             } else {
-                for ( Mesh::const_vertex_iterator vit1 = m1.vertex_begin(); vit1 != m1.vertex_end(); ++vit1) {
+                TaskSchedule vertices(r1.first_vertex, v1_end);
+                #pragma omp parallel
+                for ( int v1; vertices.next(v1); ) {
+                    #pragma omp critical
                     PROGRESSBAR(i++, m1.nb_vertices());
-                    #pragma omp parallel for
-                    for ( Mesh::const_vertex_iterator vit2 = m2.vertex_begin(); vit2 < m2.vertex_end(); ++vit2) {
-                        mat((*vit1)->index(), (*vit2)->index()) += _operatorN(**vit1, **vit2, m1, m2, mat) * coeff;
+                    for ( int v2 = r2.first_vertex; v2 < v2_end; ++v2) {
+                        mat(vindex[mv[v1]], vindex[mv[v2]]) += _operatorN(view, v1, v2, m1, m2, r1, r2, mat) * coeff;
                     }
                 }
             }
@@ -293,9 +378,10 @@ namespace OpenMEEG {
     }
 
     template<class T>
-    void operatorS(const Mesh& m1, const Mesh& m2, T& mat, const double& coeff, const unsigned gauss_order)
+    void operatorS(const GeometryView& view, const Mesh& m1, const Mesh& m2, T& mat, const double& coeff, const unsigned gauss_order)
     {
         // This function has the following arguments:
+        //    the view of the meshes
         //    the 2 interacting meshes
         //    the storage Matrix for the result
         //    the coefficient to be appleid to each matrix element (depending on conductivities, ...)
@@ -303,26 +389,43 @@ namespace OpenMEEG {
 
         std::cout << "OPERATOR S ... (arg : mesh " << m1.name() << " , mesh " << m2.name() << " )" << std::endl;
 
+        TIMED_SCOPE("operatorS");
+        timings::count(m1.nb_triangles()*m2.nb_triangles());
+
+        const GeometryView::MeshRange& r1 = view.range(m1);
+        const GeometryView::MeshRange& r2 = view.range(m2);
+        const unsigned* tindex = view.triangle_index();
+        const int t1_end = r1.first_triangle + r1.nb_triangles;
+        const int t2_end = r2.first_triangle + r2.nb_triangles;
+
         unsigned i = 0; // for the PROGRESSBAR
         // The operator S is given by Sij=\Int G*PSI(I, i)*Psi(J, j) with
         // PSI(A, a) is a P0 test function on layer A and triangle a
         if ( &m1 == &m2 ) {
-            for ( Mesh::const_iterator tit1 = m1.begin(); tit1 != m1.end(); ++tit1) {
+            TaskSchedule triangles(r1.first_triangle, t1_end);
+            #pragma omp parallel
+            for ( int t1; triangles.next(t1); ) {
+                #pragma omp critical
                 PROGRESSBAR(i++, m1.nb_triangles());
-                #pragma omp parallel for
-                for ( Mesh::const_iterator tit2 = tit1; tit2 < m1.end(); ++tit2) {
-                    mat(tit1->index(), tit2->index()) = _operatorS(*tit1, *tit2, gauss_order) * coeff;
+                for ( int t2 = t1; t2 < t1_end; ++t2) {
+                    if ( owns(mat, tindex[t1], tindex[t2]) ) {
+                        mat(tindex[t1], tindex[t2]) = _operatorS(view, t1, t2, gauss_order) * coeff;
+                    }
                 }
             }
         } else {
             // TODO check the symmetry of _operatorS. 
             // if we invert tit1 with tit2: results in HeadMat differs at 4.e-5 which is too big.
             // using ADAPT_LHS with tolerance at 0.000005 (for _opS) drops this at 6.e-6. (but increase the computation time)
-            for ( Mesh::const_iterator tit1 = m1.begin(); tit1 != m1.end(); ++tit1) {
+            TaskSchedule triangles(r1.first_triangle, t1_end);
+            #pragma omp parallel
+            for ( int t1; triangles.next(t1); ) {
+                #pragma omp critical
                 PROGRESSBAR(i++, m1.nb_triangles());
-                #pragma omp parallel for
-                for ( Mesh::const_iterator tit2 = m2.begin(); tit2 < m2.end(); ++tit2) {
-                    mat(tit1->index(), tit2->index()) = _operatorS(*tit1, *tit2, gauss_order) * coeff;
+                for ( int t2 = r2.first_triangle; t2 < t2_end; ++t2) {
+                    if ( owns(mat, tindex[t1], tindex[t2]) ) {
+                        mat(tindex[t1], tindex[t2]) = _operatorS(view, t1, t2, gauss_order) * coeff;
+                    }
                 }
             }
         }
@@ -330,34 +433,54 @@ namespace OpenMEEG {
 
     #ifndef OPTIMIZED_OPERATOR_D
     template<class T>
-    void operatorD(const Mesh& m1, const Mesh& m2, T& mat, const double& coeff, const unsigned gauss_order, const bool star = false)
+    void operatorD(const GeometryView& view, const Mesh& m1, const Mesh& m2, T& mat, const double& coeff, const unsigned gauss_order, const bool star = false)
     {
         // This function (NON OPTIMIZED VERSION) has the following arguments:
+        //    the view of the meshes
         //    the 2 interacting meshes
         //    the storage Matrix for the result
         //    the coefficient to be appleid to each matrix element (depending on conductivities, ...)
         //    the gauss order parameter (for adaptive integration)
         //    an optional star parameter, which denotes the adjoint of the operator
 
+        TIMED_SCOPE("operatorD");
+        timings::count(m1.nb_triangles()*m2.nb_vertices());
+
+        const GeometryView::MeshRange& r1 = view.range(m1);
+        const GeometryView::MeshRange& r2 = view.range(m2);
+        const unsigned* tindex = view.triangle_index();
+        const unsigned* vindex = view.vertex_index();
+        const int32_t*  mv     = view.mesh_vertices();
+
         unsigned i = 0; // for the PROGRESSBAR
         if ( star ) {
             std::cout << "OPERATOR D*... (arg : mesh " << m1.name() << " , mesh " << m2.name() << " )" << std::endl;
-            for ( Mesh::const_iterator tit = m2.begin(); tit != m2.end(); ++tit) {
+            const int v_end = r1.first_vertex + r1.nb_vertices;
+            TaskSchedule triangles(r2.first_triangle, r2.first_triangle + r2.nb_triangles);
+            #pragma omp parallel
+            for ( int t; triangles.next(t); ) {
+                #pragma omp critical
                 PROGRESSBAR(i++, m2.nb_triangles());
-                #pragma omp parallel for
-                for ( Mesh::const_vertex_iterator vit = m1.vertex_begin(); vit < m1.vertex_end(); ++vit) {
+                for ( int v = r1.first_vertex; v < v_end; ++v) {
                     // P1 functions are tested thus looping on vertices
-                    mat((*vit)->index(), tit->index()) += _operatorD(*tit, **vit, m1, gauss_order) * coeff;
+                    if ( owns(mat, vindex[mv[v]], tindex[t]) ) {
+                        mat(vindex[mv[v]], tindex[t]) += _operatorD(view, t, v, gauss_order) * coeff;
+                    }
                 }
             }
         } else {
             std::cout << "OPERATOR D ... (arg : mesh " << m1.name() << " , mesh " << m2.name() << " )" << std::endl;
-            for ( Mesh::const_iterator tit = m1.begin(); tit != m1.end(); ++tit) {
+            const int v_end = r2.first_vertex + r2.nb_vertices;
+            TaskSchedule triangles(r1.first_triangle, r1.first_triangle + r1.nb_triangles);
+            #pragma omp parallel
+            for ( int t; triangles.next(t); ) {
+                #pragma omp critical
                 PROGRESSBAR(i++, m1.nb_triangles());
-                #pragma omp parallel for
-                for ( Mesh::const_vertex_iterator vit = m2.vertex_begin(); vit < m2.vertex_end(); ++vit) {
+                for ( int v = r2.first_vertex; v < v_end; ++v) {
                     // P1 functions are tested thus looping on vertices
-                    mat(tit->index(), (*vit)->index()) += _operatorD(*tit, **vit, m2, gauss_order) * coeff;
+                    if ( owns(mat, tindex[t], vindex[mv[v]]) ) {
+                        mat(tindex[t], vindex[mv[v]]) += _operatorD(view, t, v, gauss_order) * coeff;
+                    }
                 }
             }
         }
@@ -366,15 +489,22 @@ namespace OpenMEEG {
     #else // OPTIMIZED_OPERATOR_D
 
     template<class T>
-    void operatorD(const Mesh& m1, const Mesh& m2, T& mat, const double& coeff, const unsigned gauss_order, const bool star = false)
+    void operatorD(const GeometryView& view, const Mesh& m1, const Mesh& m2, T& mat, const double& coeff, const unsigned gauss_order, const bool star = false)
     {
         // This function (OPTIMIZED VERSION) has the following arguments:
+        //    the view of the meshes
         //    the 2 interacting meshes
         //    the storage Matrix for the result
         //    the coefficient to be appleid to each matrix element (depending on conductivities, ...)
         //    the gauss order parameter (for adaptive integration)
         //    an optional star parameter, which denotes the adjoint of the operator
 
+        TIMED_SCOPE("operatorD");
+        timings::count(m1.nb_triangles()*m2.nb_triangles());
+
+        const GeometryView::MeshRange& r1 = view.range(m1);
+        const GeometryView::MeshRange& r2 = view.range(m2);
+
         unsigned i = 0; // for the PROGRESSBAR
         if ( star ) {
             std::cout << "OPERATOR D*(Optimized) ... (arg : mesh " << m1.name() << " , mesh " << m2.name() << " )" << std::endl;
@@ -382,27 +512,51 @@ namespace OpenMEEG {
             std::cout << "OPERATOR D (Optimized) ... (arg : mesh " << m1.name() << " , mesh " << m2.name() << " )" << std::endl;
         }
 
-        for ( Mesh::const_iterator tit1 = m1.begin(); tit1 != m1.end(); ++tit1) {
+        for ( unsigned t1 = r1.first_triangle; t1 < r1.first_triangle + r1.nb_triangles; ++t1) {
             PROGRESSBAR(i++, m1.nb_triangles());
-            for ( Mesh::const_iterator tit2 = m2.begin(); tit2 != m2.end(); ++tit2) {
+            for ( unsigned t2 = r2.first_triangle; t2 < r2.first_triangle + r2.nb_triangles; ++t2) {
                 //In this version of the function, in order to skip multiple computations of the same quantities
                 //    loops are run over the triangles but the Matrix cannot be filled in this function anymore
                 //    That's why the filling is done is function _operatorD
                 if ( star ) {
-                    _operatorD(*tit2, *tit1, mat, coeff, gauss_order);
+                    _operatorD(view, t2, t1, mat, coeff, gauss_order);
                 } else {
-                    _operatorD(*tit1, *tit2, mat, coeff, gauss_order);
+                    _operatorD(view, t1, t2, mat, coeff, gauss_order);
                 }
             }
         }
     }
     #endif // OPTIMIZED_OPERATOR_D
 
+    // Same operators for meshes which are not part of a view (a view of the two meshes is built).
+
+    template<class T>
+    void operatorN(const Mesh& m1, const Mesh& m2, T& mat, const double& coeff, const unsigned gauss_order)
+    {
+        const GeometryView view(m1, m2);
+        operatorN(view, m1, m2, mat, coeff, gauss_order);
+    }
+
+    template<class T>
+    void operatorS(const Mesh& m1, const Mesh& m2, T& mat, const double& coeff, const unsigned gauss_order)
+    {
+        const GeometryView view(m1, m2);
+        operatorS(view, m1, m2, mat, coeff, gauss_order);
+    }
+
+    template<class T>
+    void operatorD(const Mesh& m1, const Mesh& m2, T& mat, const double& coeff, const unsigned gauss_order, const bool star = false)
+    {
+        const GeometryView view(m1, m2);
+        operatorD(view, m1, m2, mat, coeff, gauss_order, star);
+    }
+
     template<class T>
     void operatorP1P0(const Mesh& m, T& mat, const double& coeff)
     {
         // This time mat(i, j)+= ... the Matrix is incremented by the P1P0 operator
         std::cout << "OPERATOR P1P0... (arg : mesh " << m.name() << " )" << std::endl;
+        TIMED_SCOPE("operatorP1P0");
         for (Mesh::const_iterator tit = m.begin(); tit != m.end(); ++tit) {
             for (Mesh::VectPVertex::const_iterator pit = m.vertex_begin(); pit != m.vertex_end(); ++pit) {
                 mat(tit->index(), (*pit)->index()) += _operatorP1P0(*tit, **pit) * coeff;
@@ -410,33 +564,23 @@ namespace OpenMEEG {
         }
     }
 
-    inline Vect3 _operatorFerguson(const Vect3& x, const Vertex& V1, const Mesh& m)
+    inline Vect3 _operatorFerguson(const GeometryView& view, const Vect3& x, const unsigned V1)
     {
-        double opS;
-
-        STATIC_OMP Vect3 result;
         STATIC_OMP analyticS analyS;
-
-        result.x() = 0.0;
-        result.y() = 0.0;
-        result.z() = 0.0;
+        Vect3 result(0.0, 0.0, 0.0);
 
         //loop over triangles of which V1 is a vertex
-        const Mesh::VectPTriangle& trgs = m.get_triangles_for_vertex(V1);
-
-        for ( Mesh::VectPTriangle::const_iterator tit = trgs.begin(); tit != trgs.end(); ++tit) {
-
-            const Triangle& T1 = **tit;
+        const int32_t v1 = view.mesh_vertices()[V1];
+        for ( const int32_t* tit = view.adjacent_begin(V1); tit != view.adjacent_end(V1); ++tit) {
 
             // A1 , B1  are the two opposite vertices to V1 (triangle A1, B1, V1)
-            Vect3 A1   = T1.next(V1);
-            Vect3 B1   = T1.prev(V1);
-            Vect3 A1B1 = (A1 - B1) * (0.5 / T1.area());
-            
-            analyS.init(V1, A1, B1);
-            opS = analyS.f(x);
-
-            result += (A1B1 * opS);
+            // The setup of the triangle uses the normal of the mesh (A1-V1)^(B1-V1), the opposite of the normal
+            // (A1-V1)^(V1-B1) of the original formulation, which changes the sign of the integral: hence B1-A1.
+            const unsigned k    = view.corner_of(*tit, v1);
+            const Vect3    A1B1 = (view.corner(*tit, k+2) - view.corner(*tit, k+1)) * (0.5 / view.areas()[*tit]);
+
+            analyS.init(view, *tit);
+            result += (A1B1 * analyS.f(x));
         }
         return result;
     }
@@ -51,6 +51,7 @@ void getHelp(char** argv);
 int main(int argc, char **argv) // TODO a quoi ça sert ?
 {
     print_version(argv[0]);
+    thread_option(argc, argv);
 
     if (argc==1) {
         cerr << "Not enough arguments \nPlease try \"" << argv[0] << " -h\" or \"" << argv[0] << " --help \" \n" << endl;
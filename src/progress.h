@@ -0,0 +1,108 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_PROGRESS_H
+#define OPENMEEG_PROGRESS_H
+
+#include <stdexcept>
+
+#include <DLLDefinesOpenMEEG.h>
+
+namespace OpenMEEG {
+
+    /** \brief Progress and cancellation of the computations run by a thread.
+
+        A Progress attached to a thread is seen by the assemblies it then runs: each loop distributed by a
+        TaskSchedule adds its tasks to total() and counts them in done() as they are handed out, so that
+        another thread can follow the computation. The loops are added as they start, so done()/total() is
+        only an estimate of the completed fraction.
+
+        cancel() may be called from any thread. The running loop stops handing out its tasks and the next
+        one throws Cancelled (the factorizations and other LAPACK calls are not interrupted). The results of
+        a cancelled computation are meaningless, even when no exception was thrown.
+    **/
+
+    class OPENMEEG_EXPORT Progress {
+    public:
+
+        Progress(): done_work(0), total_work(0), cancel_requested(false) { }
+
+        void cancel()          { cancel_requested = true; }
+        bool cancelled() const { return cancel_requested;  }
+
+        unsigned long done()  const { return done_work;  }
+        unsigned long total() const { return total_work; }
+
+        /// \brief Make this object the progress of the calling thread (until detach()).
+
+        void attach();
+        void detach();
+
+        /// \brief The progress of the calling thread (0 if none is attached).
+
+        static Progress* current();
+
+        /// \brief Used by the computations: throw Cancelled if the computation of the calling thread was cancelled.
+
+        static void check();
+
+        void add_work(const unsigned long n);
+        void advance() {
+            #pragma omp atomic
+            ++done_work;
+        }
+
+    private:
+
+        Progress(const Progress&);
+        Progress& operator=(const Progress&);
+
+        volatile unsigned long done_work;
+        volatile unsigned long total_work;
+        volatile bool          cancel_requested;
+    };
+
+    class OPENMEEG_EXPORT Cancelled: public std::runtime_error {
+    public:
+
+        Cancelled(): std::runtime_error("The computation was cancelled.") { }
+    };
+}
+
+#endif  //! OPENMEEG_PROGRESS_H
@@ -0,0 +1,452 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+//  Real-time application of an inverse (or gain) operator: the operator is loaded once and
+//  blocks of sensor samples received on stdin, a pair of FIFOs or a Unix domain socket are
+//  answered with the corresponding source estimates.
+//
+//  Frames (in both directions) are a header { 'O','M','R','T', rows, cols, flags } of uint32
+//  followed by rows x cols doubles (column major, native byte order). A request has as many rows
+//  as sensors and one column per sample, the answer one row per source. A request with no sample
+//  closes the session.
+
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <MatLibConfig.h>
+#include <matrix.h>
+#include <random.h>
+#include <om_utils.h>
+
+using namespace std;
+using namespace OpenMEEG;
+
+namespace {
+
+    struct FrameHeader {
+        char     magic[4];
+        uint32_t rows;
+        uint32_t cols;
+        uint32_t flags;
+    };
+
+    const char Magic[4] = { 'O', 'M', 'R', 'T' };
+
+    //  Flag of the answer to a rejected request (which has no samples).
+
+    const uint32_t Rejected = 1;
+
+    //  Largest number of values of the request and answer buffers (256MB each).
+
+    const size_t max_frame_values = static_cast<size_t>(1) << 25;
+
+    volatile sig_atomic_t interrupted = 0;
+
+    void on_signal(int) { interrupted = 1; }
+
+    bool read_all(const int fd,void* buffer,const size_t n) {
+        char* p = static_cast<char*>(buffer);
+        for (size_t done=0;done<n;) {
+            const ssize_t r = read(fd,p+done,n-done);
+            if (r<0 && errno==EINTR && !interrupted)
+                continue;
+            if (r<=0)
+                return false;
+            done += r;
+        }
+        return true;
+    }
+
+    bool write_all(const int fd,const void* buffer,const size_t n) {
+        const char* p = static_cast<const char*>(buffer);
+        for (size_t done=0;done<n;) {
+            const ssize_t w = write(fd,p+done,n-done);
+            if (w<0 && errno==EINTR && !interrupted)
+                continue;
+            if (w<=0)
+                return false;
+            done += w;
+        }
+        return true;
+    }
+
+    bool write_frame(const int fd,const size_t rows,const size_t cols,const double* values,const uint32_t flags=0) {
+        FrameHeader header;
+        std::memcpy(header.magic,Magic,4);
+        header.rows  = rows;
+        header.cols  = cols;
+        header.flags = flags;
+        return write_all(fd,&header,sizeof(header)) && write_all(fd,values,rows*cols*sizeof(double));
+    }
+
+    //  Skip the rows*cols doubles of a rejected request.
+
+    bool discard(const int fd,const uint32_t rows,const uint32_t cols) {
+        double buffer[4096];
+        for (uint64_t remaining=static_cast<uint64_t>(rows)*cols;remaining!=0;) {
+            const size_t n = std::min(remaining,static_cast<uint64_t>(4096));
+            if (!read_all(fd,buffer,n*sizeof(double)))
+                return false;
+            remaining -= n;
+        }
+        return true;
+    }
+
+    bool read_header(const int fd,FrameHeader& header) {
+        if (!read_all(fd,&header,sizeof(header)))
+            return false;
+        if (std::memcmp(header.magic,Magic,4)!=0) {
+            cerr << "Bad frame header." << endl;
+            return false;
+        }
+        return true;
+    }
+
+    //  Per frame latencies (in seconds), reported in microseconds.
+
+    class Latencies {
+    public:
+
+        void add(const double t) { values.push_back(t); }
+
+        void report(std::ostream& os,const char* what) {
+            if (values.empty())
+                return;
+            std::vector<double> v(values);
+            std::sort(v.begin(),v.end());
+            double sum = 0.0;
+            for (size_t i=0;i<v.size();++i)
+                sum += v[i];
+            const double us = 1e6;
+            os << what << ": " << v.size() << " frames, latency (us) mean " << us*sum/v.size()
+               << " min " << us*v.front() << " median " << us*v[v.size()/2]
+               << " p99 " << us*v[std::min(v.size()-1,(v.size()*99)/100)] << " max " << us*v.back() << endl;
+        }
+
+        void clear() { values.clear(); }
+
+    private:
+
+        std::vector<double> values;
+    };
+
+    //  Answer the frames read on in_fd until the end of the session. Buffers are only reallocated
+    //  when the number of samples per frame changes. Requests whose number of channels does not match
+    //  the operator, or too large to be answered, get a Rejected answer and are dropped.
+
+    bool serve(const Matrix& op,const int in_fd,const int out_fd,Latencies& latencies) {
+        std::vector<double> data;
+        std::vector<double> estimates;
+        FrameHeader header;
+        while (!interrupted && read_header(in_fd,header)) {
+            if (header.cols==0)
+                return true;
+            const size_t n = header.cols;
+            bool accepted = header.rows==op.ncol() && n<=max_frame_values/std::max<size_t>(std::max(op.nlin(),op.ncol()),1);
+            if (accepted) {
+                try {
+                    data.resize(op.ncol()*n);
+                    estimates.resize(op.nlin()*n);
+                } catch (std::bad_alloc&) {
+                    accepted = false;
+                }
+            }
+            if (!accepted) {
+                cerr << "Rejected frame of " << header.rows << " channels x " << header.cols << " samples (operator of "
+                     << op.ncol() << " channels)." << endl;
+                if (!write_frame(out_fd,0,0,0,Rejected) || !discard(in_fd,header.rows,header.cols))
+                    return false;
+                continue;
+            }
+            if (!read_all(in_fd,&data[0],data.size()*sizeof(double)))
+                return false;
+            const double t0 = timings::wall_clock();
+        #ifdef HAVE_BLAS
+            DGEMM(CblasNoTrans,CblasNoTrans,(int)op.nlin(),(int)n,(int)op.ncol(),1.,op.data(),(int)op.nlin(),
+                  &data[0],(int)op.ncol(),0.,&estimates[0],(int)op.nlin());
+        #else
+            for (size_t t=0;t<n;++t)
+                for (size_t i=0;i<op.nlin();++i) {
+                    double s = 0.0;
+                    for (size_t j=0;j<op.ncol();++j)
+                        s += op(i,j)*data[j+t*op.ncol()];
+                    estimates[i+t*op.nlin()] = s;
+                }
+        #endif
+            if (!write_frame(out_fd,op.nlin(),n,&estimates[0]))
+                return false;
+            latencies.add(timings::wall_clock()-t0);
+        }
+        return !interrupted;
+    }
+
+    //  Test client: send frames of random data, check the answers against op*data and report the
+    //  round trip latencies.
+
+    int client(const Matrix& op,const int fd,const unsigned nframes,const unsigned nsamples) {
+        const maths::Philox rng(1);
+        Matrix   data(op.ncol(),nsamples);
+        Latencies latencies;
+        double   max_error = 0.0;
+        for (unsigned f=0;f<nframes;++f) {
+            for (size_t t=0;t<nsamples;++t)
+                for (size_t i=0;i<op.ncol();i+=2) {
+                    double g0,g1;
+                    rng.gaussians(f*nsamples+t,i/2,g0,g1);
+                    data(i,t) = g0;
+                    if (i+1<op.ncol())
+                        data(i+1,t) = g1;
+                }
+            const double t0 = timings::wall_clock();
+            FrameHeader header;
+            if (!write_frame(fd,data.nlin(),data.ncol(),data.data()) || !read_header(fd,header)) {
+                cerr << "Communication error with the server." << endl;
+                return 1;
+            }
+            if (header.flags & Rejected) {
+                cerr << "The server rejected the frame." << endl;
+                return 1;
+            }
+            if (header.rows!=op.nlin() || header.cols!=nsamples) {
+                cerr << "Communication error with the server." << endl;
+                return 1;
+            }
+            Matrix estimates(op.nlin(),nsamples);
+            if (!read_all(fd,estimates.data(),estimates.size()*sizeof(double))) {
+                cerr << "Communication error with the server." << endl;
+                return 1;
+            }
+            latencies.add(timings::wall_clock()-t0);
+            const Matrix ref = op*data;
+            max_error = std::max(max_error,(estimates-ref).frobenius_norm()/ref.frobenius_norm());
+        }
+        write_frame(fd,op.ncol(),0,0);
+        latencies.report(cout,"client round trip");
+        cout << "Maximal relative error: " << max_error << endl;
+        return (max_error<1e-12) ? 0 : 1;
+    }
+
+    int listen_on(const std::string& path) {
+        sockaddr_un address;
+        if (path.size()>=sizeof(address.sun_path)) {
+            cerr << "Socket path too long: " << path << endl;
+            return -1;
+        }
+        const int fd = socket(AF_UNIX,SOCK_STREAM,0);
+        std::memset(&address,0,sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path,path.c_str());
+        unlink(path.c_str());
+        if (fd<0 || bind(fd,reinterpret_cast<sockaddr*>(&address),sizeof(address))<0 || listen(fd,1)<0) {
+            cerr << "Cannot listen on " << path << ": " << strerror(errno) << endl;
+            return -1;
+        }
+        return fd;
+    }
+
+    int connect_to(const std::string& path) {
+        sockaddr_un address;
+        std::memset(&address,0,sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path,path.c_str(),sizeof(address.sun_path)-1);
+        const int fd = socket(AF_UNIX,SOCK_STREAM,0);
+        if (fd<0 || connect(fd,reinterpret_cast<sockaddr*>(&address),sizeof(address))<0) {
+            cerr << "Cannot connect to " << path << ": " << strerror(errno) << endl;
+            return -1;
+        }
+        return fd;
+    }
+}
+
+void getHelp(char** argv);
+
+int main(int argc, char **argv)
+{
+    thread_option(argc, argv);
+
+    const std::string socket_path  = extract_option(argc, argv, "-socket");
+    const std::string fifo_in      = extract_option(argc, argv, "-fifo-in");
+    const std::string fifo_out     = extract_option(argc, argv, "-fifo-out");
+    const std::string client_path  = extract_option(argc, argv, "-client");
+    const std::string frames_opt   = extract_option(argc, argv, "-frames");
+    const std::string samples_opt  = extract_option(argc, argv, "-samples");
+    bool loopback = false;
+    for (int i=1;i<argc;++i)
+        if (!strcmp(argv[i],"-loopback")) {
+            loopback = true;
+            for (int j=i;j+1<argc;++j)
+                argv[j] = argv[j+1];
+            --argc;
+            break;
+        }
+
+    if ( argc==1 ) {
+        cerr << "Not enough arguments \nPlease try \"" << argv[0] << " -h\" or \"" << argv[0] << " --help \" \n" << endl;
+        return 0;
+    }
+
+    if ( (!strcmp(argv[1],"-h")) | (!strcmp(argv[1],"--help")) ) getHelp(argv);
+
+    if ( argc!=2 ) {
+        cerr << "Bad arguments \nPlease try \"" << argv[0] << " -h\" or \"" << argv[0] << " --help \" \n" << endl;
+        return 1;
+    }
+
+    //  On stdin/stdout, the standard output carries the frames: messages go to the error stream.
+
+    const bool pipes = socket_path=="" && fifo_in=="" && client_path=="" && !loopback;
+    std::ostream& log = (pipes) ? cerr : cout;
+
+    Matrix op;
+    op.load(argv[1]);
+    log << "Operator of " << op.nlin() << " sources and " << op.ncol() << " channels loaded from " << argv[1] << "." << endl;
+
+    //  No SA_RESTART: an interruption must make the blocking accept/read return.
+
+    struct sigaction action;
+    std::memset(&action,0,sizeof(action));
+    action.sa_handler = on_signal;
+    sigaction(SIGINT,&action,0);
+    sigaction(SIGTERM,&action,0);
+    signal(SIGPIPE,SIG_IGN);
+
+    const unsigned nframes  = (frames_opt!="")  ? atoi(frames_opt.c_str())  : 100;
+    const unsigned nsamples = (samples_opt!="") ? atoi(samples_opt.c_str()) : 1;
+
+    if ( client_path!="" ) {
+        const int fd = connect_to(client_path);
+        return (fd<0) ? 1 : client(op,fd,nframes,nsamples);
+    }
+
+    if ( loopback ) {
+        int fds[2];
+        if ( socketpair(AF_UNIX,SOCK_STREAM,0,fds)<0 ) {
+            cerr << "socketpair: " << strerror(errno) << endl;
+            return 1;
+        }
+        const pid_t pid = fork();
+        if ( pid==0 ) {
+            close(fds[0]);
+            Latencies latencies;
+            const bool ok = serve(op,fds[1],fds[1],latencies);
+            latencies.report(cout,"server");
+            _exit(ok ? 0 : 1);
+        }
+        close(fds[1]);
+        const int status = client(op,fds[0],nframes,nsamples);
+        close(fds[0]);
+        int server_status = 1;
+        waitpid(pid,&server_status,0);
+        return (status==0 && WIFEXITED(server_status) && WEXITSTATUS(server_status)==0) ? 0 : 1;
+    }
+
+    Latencies latencies;
+    bool ok = true;
+    if ( socket_path!="" ) {
+        const int server = listen_on(socket_path);
+        if ( server<0 )
+            return 1;
+        log << "Listening on " << socket_path << "." << endl;
+        while ( !interrupted ) {
+            const int fd = accept(server,0,0);
+            if ( fd<0 ) {
+                //  A signal or a client gone before being accepted: retry at once. Running out of
+                //  descriptors or memory may be transient: retry after a pause. Anything else is fatal.
+                if ( errno==EINTR || errno==ECONNABORTED )
+                    continue;
+                cerr << "accept: " << strerror(errno) << endl;
+                if ( errno==EMFILE || errno==ENFILE || errno==ENOBUFS || errno==ENOMEM ) {
+                    sleep(1);
+                    continue;
+                }
+                ok = false;
+                break;
+            }
+            serve(op,fd,fd,latencies);
+            close(fd);
+            latencies.report(log,"session");
+            latencies.clear();
+        }
+        close(server);
+        unlink(socket_path.c_str());
+    } else {
+        const int in  = (fifo_in!="")  ? open(fifo_in.c_str(),O_RDONLY)  : STDIN_FILENO;
+        const int out = (fifo_out!="") ? open(fifo_out.c_str(),O_WRONLY) : STDOUT_FILENO;
+        if ( in<0 || out<0 ) {
+            cerr << "Cannot open the fifos: " << strerror(errno) << endl;
+            return 1;
+        }
+        ok = serve(op,in,out,latencies);
+        latencies.report(log,"session");
+    }
+
+    return ok ? 0 : 1;
+}
+
+void getHelp(char** argv)
+{
+    cout << argv[0] << " [options] Operator" << endl << endl;
+
+    cout << "   Apply an operator (e.g. the kernel saved by om_inverse -kernel, or a gain matrix) to blocks of" << endl;
+    cout << "   sensor samples received from an acquisition system, with per frame latency statistics." << endl;
+    cout << "   Frames are a header of four uint32 (\"OMRT\", rows, columns, flags=0) followed by the" << endl;
+    cout << "   column major doubles: requests are channels x samples, answers sources x samples." << endl;
+    cout << "   A request without samples ends the session. Requests with a wrong number of channels or too many" << endl;
+    cout << "   samples are dropped and answered by an empty frame with flags=1." << endl << endl;
+
+    cout << "   Options :" << endl;
+    cout << "   (none)              : read the requests on the standard input, answer on the standard output." << endl;
+    cout << "   -fifo-in f -fifo-out g : read the requests from the named pipe f, answer on g." << endl;
+    cout << "   -socket path        : serve the clients connecting to the Unix domain socket path (until interrupted)." << endl;
+    cout << "   -client path        : test client: send random frames to the server at path and check the answers." << endl;
+    cout << "   -loopback           : run the test client against a server process on a socket pair." << endl;
+    cout << "   -frames n -samples s: number of frames (100) and samples per frame (1) sent by the test client." << endl << endl;
+
+    exit(0);
+}
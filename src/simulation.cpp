@@ -0,0 +1,200 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <fstream>
+#include <memory>
+#include <cstring>
+#include <stdexcept>
+
+#include <MatLibConfig.h>
+#include <ChunkedBinIO.H>
+#include <om_utils.h>
+#include <simulation.h>
+
+namespace OpenMEEG {
+
+    namespace {
+
+        bool is_chunked(const std::string& name) {
+            const std::string& tag = maths::ChunkedBinIO::MagicTag;
+            std::ifstream ifs(name.c_str(),std::ios::binary);
+            std::string buffer(tag.size(),'\0');
+            ifs.read(&buffer[0],tag.size());
+            return ifs && buffer==tag;
+        }
+    }
+
+    int cholesky_factorize(SymMatrix& U) {
+        const size_t n = U.nlin();
+        int info = 0;
+    #ifdef HAVE_LAPACK
+        DPPTRF('U',n,U.data(),info);
+    #else
+        for (size_t j=0;j<n && info==0;++j) {
+            for (size_t i=0;i<j;++i) {
+                double s = U(i,j);
+                for (size_t k=0;k<i;++k)
+                    s -= U(k,i)*U(k,j);
+                U(i,j) = s/U(i,i);
+            }
+            double d = U(j,j);
+            for (size_t k=0;k<j;++k)
+                d -= U(k,j)*U(k,j);
+            if (d<=0.0)
+                info = j+1;
+            else
+                U(j,j) = sqrt(d);
+        }
+    #endif
+        return info;
+    }
+
+    const size_t ForwardSimulator::default_chunk;
+
+    ForwardSimulator::ForwardSimulator(const Matrix& G,const double noise_level,const unsigned long seed):
+        gain(G),level(noise_level),rng(seed),model(WHITE)
+    { }
+
+    void ForwardSimulator::set_noise_covariance(const SymMatrix& covariance) {
+        const size_t n = gain.nlin();
+        if (covariance.nlin()!=n)
+            throw std::runtime_error("the noise covariance does not match the number of sensors");
+
+        //  U'U factorization of the packed covariance, factor = U'.
+
+        SymMatrix U(covariance,DEEP_COPY);
+        if (cholesky_factorize(U)!=0)
+            throw std::runtime_error("the noise covariance is not positive definite");
+
+        factor = Matrix(n,n);
+        factor.set(0.0);
+        for (size_t j=0;j<n;++j)
+            for (size_t i=j;i<n;++i)
+                factor(i,j) = U(j,i);
+        model = COLORED;
+    }
+
+    //  Channels are taken by pairs: one Box-Muller draw of counter (sample,channel/2) gives both.
+
+    void ForwardSimulator::add_noise(Matrix& data,const size_t first) const {
+        const size_t n  = data.nlin();
+        const int    nt = data.ncol();
+        Matrix z;
+        if (model==COLORED) {
+            z = Matrix(n,nt);
+            z.set(0.0);
+        }
+        Matrix& target = (model==COLORED) ? z : data;
+        #pragma omp parallel for schedule(static)
+        for (int t=0;t<nt;++t) {
+            double* col = target.data()+t*n;
+            for (size_t i=0;i<n;i+=2) {
+                double g0,g1;
+                rng.gaussians(first+t,i/2,g0,g1);
+                col[i] += level*g0;
+                if (i+1<n)
+                    col[i+1] += level*g1;
+            }
+        }
+        if (model==COLORED) {
+        #ifdef HAVE_BLAS
+            DGEMM(CblasNoTrans,CblasNoTrans,(int)n,nt,(int)n,1.,factor.data(),(int)n,z.data(),(int)n,1.,data.data(),(int)n);
+        #else
+            data += factor*z;
+        #endif
+        }
+    }
+
+    Matrix ForwardSimulator::simulate(const Matrix& sources,const size_t first) const {
+        TIMED_SCOPE("ForwardSimulator::simulate");
+        if (sources.nlin()!=gain.ncol())
+            throw std::runtime_error("the number of sources does not match the gain matrix");
+        Matrix data = gain*sources;
+        if (level!=0.0)
+            add_noise(data,first);
+        return data;
+    }
+
+    void ForwardSimulator::run(const std::string& sources_file,const std::string& output_file,const size_t chunk) const {
+        TIMED_SCOPE("ForwardSimulator::run");
+
+        //  Owned by auto_ptr: if the simulation throws, the files are still closed (the chunks already
+        //  written to an .omc output then remain readable).
+
+        std::auto_ptr<maths::ChunkedMatrixReader> reader;
+        Matrix sources;
+        size_t nsamples;
+        if (is_chunked(sources_file)) {
+            reader.reset(new maths::ChunkedMatrixReader(sources_file));
+            nsamples = reader->info().ncol();
+        } else {
+            sources.load(sources_file);
+            nsamples = sources.ncol();
+        }
+
+        const size_t nsensors = gain.nlin();
+        const size_t width    = std::max(std::min(chunk,nsamples),static_cast<size_t>(1));
+
+        std::auto_ptr<maths::ChunkedMatrixWriter> writer;
+        Matrix output;
+        if (getNameExtension(output_file)=="omc") {
+            writer.reset(new maths::ChunkedMatrixWriter(output_file,LinOpInfo(nsensors,nsamples,LinOp::FULL,2),nsensors,width));
+        } else {
+            output = Matrix(nsensors,nsamples);
+        }
+
+        std::cout << "Simulating " << nsamples << " samples on " << nsensors << " sensors by chunks of " << width << " samples." << std::endl;
+
+        for (size_t j=0,bj=0;j<nsamples;j+=width,++bj) {
+            const size_t n    = std::min(width,nsamples-j);
+            const Matrix data = simulate((reader.get()) ? reader->columns(j,n) : sources.submat(0,sources.nlin(),j,n),j);
+            if (writer.get()) {
+                writer->write_tile(0,bj,data);
+            } else {
+                std::copy(data.data(),data.data()+data.size(),output.data()+j*nsensors);
+            }
+        }
+
+        if (writer.get()) {
+            writer->close();
+        } else {
+            output.save(output_file);
+        }
+    }
+}
@@ -0,0 +1,102 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_SIMULATION_H
+#define OPENMEEG_SIMULATION_H
+
+#include <string>
+
+#include <DLLDefinesOpenMEEG.h>
+#include <matrix.h>
+#include <symmatrix.h>
+#include <random.h>
+
+namespace OpenMEEG {
+
+    /// \brief U'U (Cholesky) factorization, in place, of a packed noise covariance (LAPACK DPPTRF, or a
+    /// plain implementation without LAPACK). \return 0 or, as DPPTRF, j if the leading minor j is not positive.
+
+    OPENMEEG_EXPORT int cholesky_factorize(SymMatrix& U);
+
+    /** \brief Forward simulation of sensor data: Gain*Sources + noise.
+
+        The time samples are processed by chunks of columns (one matrix product per chunk), so
+        that arbitrarily long recordings can be simulated in bounded memory: with run(), the
+        sources are read by chunks from a chunked (.omc) file and the simulated data are written
+        chunk by chunk (any other format is read and written in one piece).
+
+        The noise of sample t on channel i is drawn from a counter based generator keyed by the
+        seed and indexed by (t,i): a simulation is reproducible for a given seed whatever the
+        chunk size and the number of threads. The noise is white (level*N(0,I)) or colored by a
+        sensor covariance C (level*L*N(0,I) with C=LL', the Cholesky factorization of C).
+    **/
+
+    class OPENMEEG_EXPORT ForwardSimulator {
+    public:
+
+        typedef enum { WHITE, COLORED } NoiseModel;
+
+        ForwardSimulator(const Matrix& gain,const double noise_level,const unsigned long seed=0);
+
+        /// \brief Use the noise of covariance noise_level^2*covariance (sensors x sensors).
+        void set_noise_covariance(const SymMatrix& covariance);
+
+        NoiseModel noise_model() const { return model; }
+
+        /// \brief Simulated data of the samples [first,first+sources.ncol()) given their sources.
+        Matrix simulate(const Matrix& sources,const size_t first=0) const;
+
+        /// \brief Simulate the sources of a file into an output file, chunk samples at a time.
+        void run(const std::string& sources_file,const std::string& output_file,const size_t chunk=default_chunk) const;
+
+        static const size_t default_chunk = 4096;
+
+    private:
+
+        void add_noise(Matrix& data,const size_t first) const;
+
+        const Matrix        gain;
+        const double        level;
+        const maths::Philox rng;
+        NoiseModel          model;
+        Matrix              factor; // lower Cholesky factor of the noise covariance
+    };
+}
+
+#endif  //! OPENMEEG_SIMULATION_H
@@ -0,0 +1,131 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <task_schedule.h>
+
+namespace OpenMEEG {
+
+    TaskSchedule::TaskSchedule(const int first,const int last): progress(Progress::current()) {
+        Progress::check();
+        unsigned nthreads = 1;
+    #ifdef USE_OMP
+        nthreads = omp_get_max_threads();
+    #endif
+        ranges.resize(nthreads);
+        const long ntasks = (last>first) ? last-first : 0;
+        for (unsigned i=0;i<nthreads;++i) {
+            ranges[i].begin = first+static_cast<int>(ntasks*i/nthreads);
+            ranges[i].end   = first+static_cast<int>(ntasks*(i+1)/nthreads);
+        #ifdef USE_OMP
+            omp_init_lock(&ranges[i].lock);
+        #endif
+        }
+        if (progress!=0)
+            progress->add_work(ntasks);
+    }
+
+    TaskSchedule::~TaskSchedule() {
+    #ifdef USE_OMP
+        for (unsigned i=0;i<ranges.size();++i)
+            omp_destroy_lock(&ranges[i].lock);
+    #endif
+    }
+
+    bool TaskSchedule::next(int& task) {
+        if (progress==0)
+            return take(task);
+        if (progress->cancelled() || !take(task))
+            return false;
+        progress->advance();
+        return true;
+    }
+
+    bool TaskSchedule::take(int& task) {
+    #ifdef USE_OMP
+        const unsigned id = omp_get_thread_num();
+        Range& own = ranges[id];
+        omp_set_lock(&own.lock);
+        const bool found = own.begin<own.end;
+        if (found)
+            task = own.begin++;
+        omp_unset_lock(&own.lock);
+        return found || steal(id,task);
+    #else
+        Range& own = ranges[0];
+        if (own.begin==own.end)
+            return false;
+        task = own.begin++;
+        return true;
+    #endif
+    }
+
+    //  The victims are visited in a round robin order starting after the thief. The stolen tasks are
+    //  in no range until the thief publishes them: no other thread can take them in the meantime.
+
+    bool TaskSchedule::steal(const unsigned thief,int& task) {
+    #ifdef USE_OMP
+        const unsigned nthreads = ranges.size();
+        for (unsigned k=1;k<nthreads;++k) {
+            Range& victim = ranges[(thief+k)%nthreads];
+            omp_set_lock(&victim.lock);
+            const int remaining = victim.end-victim.begin;
+            if (remaining<=0) {
+                omp_unset_lock(&victim.lock);
+                continue;
+            }
+            const int middle = victim.end-(remaining+1)/2;
+            const int end    = victim.end;
+            victim.end = middle;
+            omp_unset_lock(&victim.lock);
+
+            Range& own = ranges[thief];
+            omp_set_lock(&own.lock);
+            own.begin = middle+1;
+            own.end   = end;
+            omp_unset_lock(&own.lock);
+            task = middle;
+            return true;
+        }
+    #else
+        (void) thief;
+        (void) task;
+    #endif
+        return false;
+    }
+}
@@ -0,0 +1,109 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef OPENMEEG_TASK_SCHEDULE_H
+#define OPENMEEG_TASK_SCHEDULE_H
+
+#include <vector>
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif
+
+#include <thread_budget.h>
+#include <progress.h>
+#include <DLLDefinesOpenMEEG.h>
+
+namespace OpenMEEG {
+
+    /** \brief Work stealing schedule of the tasks first..last-1 among the threads of an OpenMP parallel region.
+
+        Each thread starts with a contiguous range of tasks, as with a static schedule (so that neighbouring
+        rows of a matrix are assembled by the same thread), and takes them from its front. A thread whose
+        range is exhausted steals the back half of the range of another one. The tasks may thus have very
+        different costs, as the rows of the triangular loops of the symmetric operators.
+
+        The schedule is created outside of the parallel region, in which all the threads call next():
+
+            TaskSchedule schedule(first,last);
+            #pragma omp parallel
+            for (int task; schedule.next(task);)
+                ...
+
+        The BLAS calls are single threaded during the lifetime of the schedule (see threads::SerialBlas).
+        The tasks are counted by the Progress attached to the creating thread, if any: once it is cancelled,
+        no more tasks are handed out and the creation of the next schedule throws Cancelled.
+    **/
+
+    class OPENMEEG_EXPORT TaskSchedule {
+    public:
+
+        TaskSchedule(const int first,const int last);
+        ~TaskSchedule();
+
+        /// Get the next task of the calling thread, false when all the tasks were handed out.
+
+        bool next(int& task);
+
+    private:
+
+        TaskSchedule(const TaskSchedule&);
+        TaskSchedule& operator=(const TaskSchedule&);
+
+        //  Remaining tasks [begin,end) of a thread (padded to a cache line to avoid false sharing).
+
+        struct Range {
+            int        begin;
+            int        end;
+        #ifdef USE_OMP
+            omp_lock_t lock;
+        #endif
+            char       padding[64];
+        };
+
+        bool take(int& task);
+        bool steal(const unsigned thief,int& task);
+
+        std::vector<Range>  ranges;
+        Progress*           progress;
+        threads::SerialBlas serial_blas;
+    };
+}
+
+#endif  //! OPENMEEG_TASK_SCHEDULE_H
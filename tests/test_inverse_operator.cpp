@@ -0,0 +1,101 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include <matrix.h>
+#include <symmatrix.h>
+#include <inverse_operator.h>
+
+using namespace OpenMEEG;
+
+//  Numerical references of the inverse operators, computed from their definitions (and not from the SVD
+//  used by InverseOperator) on a small gain matrix and a correlated noise covariance.
+
+void check(const bool cond,const char* msg,const double value) {
+    std::cout << msg << ": " << value << std::endl;
+    if (!cond) {
+        std::cerr << "Error: " << msg << std::endl;
+        exit(1);
+    }
+}
+
+int main()
+{
+    const size_t m = 12;    // sensors
+    const size_t n = 40;    // sources
+
+    Matrix G(m,n);
+    for (size_t i=0;i<m;++i)
+        for (size_t j=0;j<n;++j)
+            G(i,j) = sin(1.0+i+0.37*j*(i+1))+0.1*cos(0.5*j);
+
+    SymMatrix C(m);
+    for (size_t i=0;i<m;++i)
+        for (size_t j=i;j<m;++j)
+            C(i,j) = ((i==j) ? 2.0 : 0.0)+0.5*exp(-0.5*(j-i));
+
+    //  MNE at a high SNR, with a white noise: the pseudo-inverse of G.
+
+    const InverseOperator mne(G,1e6);
+    const Matrix& K  = mne.kernel();
+    const Matrix& Gp = G.pinverse();
+    check((K-Gp).frobenius_norm()<=1e-8*Gp.frobenius_norm(),"MNE vs pseudo-inverse",(K-Gp).frobenius_norm()/Gp.frobenius_norm());
+
+    //  With a noise covariance, the whitened pseudo-inverse pinv(W*G)*W is still a right inverse of G.
+
+    const InverseOperator mne_cov(G,C,1e6);
+    const Matrix& KC = mne_cov.kernel();
+    Matrix I(m,m);
+    I.set(0.0);
+    for (size_t i=0;i<m;++i)
+        I(i,i) = 1.0;
+    check((G*KC-I).frobenius_norm()<=1e-8,"MNE with noise covariance: G*K-I",(G*KC-I).frobenius_norm());
+
+    //  dSPM: the rows of the normalized kernel N have a unit noise variance, diag(N*C*N')=1.
+
+    const double snr = 3.0;
+    const Matrix& N  = InverseOperator(G,C,snr,InverseOperator::DSPM).normalized_kernel();
+    const Matrix& NC = N*Matrix(C);
+    double dspm_error = 0.0;
+    for (size_t j=0;j<n;++j) {
+        double d = 0.0;
+        for (size_t i=0;i<m;++i)
+            d += NC(j,i)*N(j,i);
+        dspm_error = std::max(dspm_error,std::abs(d-1.0));
+    }
+    check(dspm_error<=1e-10,"dSPM noise normalization",dspm_error);
+
+    //  sLORETA: with the source covariance a*I, trace(a*G'*C^{-1}*G)=m, the standardization is given by the
+    //  covariance of the estimate K*(a*G*G'+lambda^2*C)*K' (up to the constant factor lambda^2).
+
+    const InverseOperator sloreta(G,C,snr,InverseOperator::SLORETA);
+    const Matrix& Ci  = Matrix(C).inverse();
+    const Matrix& GCG = G.transpose()*Ci*G;
+    double trace = 0.0;
+    for (size_t j=0;j<n;++j)
+        trace += GCG(j,j);
+    const double  a       = m/trace;
+    const double  lambda2 = 1.0/(snr*snr);
+    const Matrix& KS      = sloreta.kernel();
+    const Matrix& D       = G*G.transpose()*a+Matrix(C)*lambda2;
+    const Matrix& KD      = KS*D;
+    double sloreta_error = 0.0;
+    for (size_t j=0;j<n;++j) {
+        double d = 0.0;
+        for (size_t i=0;i<m;++i)
+            d += KD(j,i)*KS(j,i);
+        const double expected = sqrt(lambda2/d);
+        sloreta_error = std::max(sloreta_error,std::abs(sloreta.normalization()(j)-expected)/expected);
+    }
+    check(sloreta_error<=1e-10,"sLORETA standardization",sloreta_error);
+
+    //  The MNE kernel of the regularized problem is a*G'*(a*G*G'+lambda^2*C)^{-1}.
+
+    const InverseOperator regularized(G,C,snr);
+    const Matrix& KR       = regularized.kernel();
+    const Matrix& expected = G.transpose()*D.inverse()*a;
+    check((KR-expected).frobenius_norm()<=1e-10*expected.frobenius_norm(),"regularized MNE",
+          (KR-expected).frobenius_norm()/expected.frobenius_norm());
+
+    return 0;
+}
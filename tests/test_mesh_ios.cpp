@@ -78,5 +78,14 @@ int main (int argc, char** argv)
     mesh2.load("tmp.off");
     assert(are_equal(mesh1, mesh2));
 
+    // Mesh loaded in a storage that already holds vertices: room is made for the new ones.
+    Vertices storage;
+    storage.push_back(Vertex(10.0, 10.0, 10.0));
+    storage.reserve(1);
+    Mesh mesh3(storage);
+    mesh3.load(argv[1]);
+    assert(are_equal(mesh3, mesh_orig));
+    assert(storage.size() == 1+mesh_orig.nb_vertices());
+
     return 0;
 }
@@ -47,6 +47,7 @@ using namespace OpenMEEG;
 int main( int argc, char **argv)
 {
     print_version(argv[0]);
+    thread_option(argc, argv);
 
     command_usage("Check mesh intersections in geometry file");
     const char* geom_filename = command_option("-g",(const char *) NULL,"Input .geom file");
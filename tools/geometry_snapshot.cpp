@@ -0,0 +1,186 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include "mesh.h"
+#include "geometry.h"
+#include "geometry_snapshot.h"
+#include "options.h"
+#include <string>
+
+using namespace OpenMEEG;
+
+bool differ(const bool cond, const char* what)
+{
+    if ( cond ) {
+        std::cerr << "Snapshot and geometry differ: " << what << std::endl;
+    }
+    return cond;
+}
+
+/// Check that two geometries are identical (including the numbering of the unknowns, the normals and areas,
+/// the links of the meshes and the domains).
+bool same_geometry(const Geometry& g1, const Geometry& g2)
+{
+    if ( differ(g1.nb_vertices() != g2.nb_vertices() || g1.nb_meshes() != g2.nb_meshes() ||
+                g1.nb_domains() != g2.nb_domains() || g1.size() != g2.size(), "sizes") ||
+         differ(g1.has_cond() != g2.has_cond() || g1.is_nested() != g2.is_nested(), "flags") ) {
+        return false;
+    }
+
+    const Vertex* base1 = &*g1.vertex_begin();
+    const Vertex* base2 = &*g2.vertex_begin();
+    for ( unsigned i = 0; i < g1.nb_vertices(); ++i) {
+        const Vertex& v1 = g1.vertices()[i];
+        const Vertex& v2 = g2.vertices()[i];
+        if ( differ(v1.x() != v2.x() || v1.y() != v2.y() || v1.z() != v2.z() || v1.index() != v2.index(), "vertices") ) {
+            return false;
+        }
+    }
+
+    for ( unsigned m = 0; m < g1.nb_meshes(); ++m) {
+        const Mesh& m1 = g1.meshes()[m];
+        const Mesh& m2 = g2.meshes()[m];
+        if ( differ(m1.name() != m2.name() || m1.outermost() != m2.outermost() ||
+                    m1.nb_vertices() != m2.nb_vertices() || m1.nb_triangles() != m2.nb_triangles(), "meshes") ) {
+            return false;
+        }
+        for ( unsigned i = 0; i < m1.nb_vertices(); ++i) {
+            const Vertex* v1 = m1.vertices()[i];
+            const Vertex* v2 = m2.vertices()[i];
+            if ( differ(v1-base1 != v2-base2, "mesh vertices") ) {
+                return false;
+            }
+            const Mesh::VectPTriangle& l1 = m1.get_triangles_for_vertex(*v1);
+            const Mesh::VectPTriangle& l2 = m2.get_triangles_for_vertex(*v2);
+            if ( differ(l1.size() != l2.size(), "links") ) {
+                return false;
+            }
+            for ( unsigned j = 0; j < l1.size(); ++j) {
+                if ( differ(l1[j]-&m1[0] != l2[j]-&m2[0], "links") ) {
+                    return false;
+                }
+            }
+        }
+        for ( unsigned t = 0; t < m1.nb_triangles(); ++t) {
+            const Triangle& t1 = m1[t];
+            const Triangle& t2 = m2[t];
+            for ( unsigned i = 0; i < 3; ++i) {
+                if ( differ(&t1.vertex(i)-base1 != &t2.vertex(i)-base2 || t1.normal()(i) != t2.normal()(i), "triangles") ) {
+                    return false;
+                }
+            }
+            if ( differ(t1.index() != t2.index() || t1.area() != t2.area(), "triangles") ) {
+                return false;
+            }
+        }
+    }
+
+    for ( unsigned d = 0; d < g1.nb_domains(); ++d) {
+        const Domain& d1 = g1.domains()[d];
+        const Domain& d2 = g2.domains()[d];
+        if ( differ(d1.name() != d2.name() || d1.sigma() != d2.sigma() || d1.outermost() != d2.outermost() ||
+                    d1.size() != d2.size(), "domains") ) {
+            return false;
+        }
+        for ( unsigned h = 0; h < d1.size(); ++h) {
+            const Interface& i1 = d1[h].interface();
+            const Interface& i2 = d2[h].interface();
+            if ( differ(d1[h].inside() != d2[h].inside() || i1.name() != i2.name() ||
+                        i1.outermost() != i2.outermost() || i1.size() != i2.size(), "interfaces") ) {
+                return false;
+            }
+            for ( unsigned i = 0; i < i1.size(); ++i) {
+                if ( differ(&i1[i].mesh()-&g1.meshes()[0] != &i2[i].mesh()-&g2.meshes()[0] ||
+                            i1[i].orientation() != i2[i].orientation(), "interfaces") ) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+int main( int argc, char **argv)
+{
+    print_version(argv[0]);
+    thread_option(argc, argv);
+
+    command_usage("Write a binary snapshot of a geometry (-g [-c] -o), or validate a snapshot (-i), optionally against the geometry it was made from (-g [-c])");
+    const char *geom_filename     = command_option("-g",(const char *) NULL,"Input .geom file");
+    const char *cond_filename     = command_option("-c",(const char *) NULL,"Input .cond file");
+    const char *output_filename   = command_option("-o",(const char *) NULL,"Output snapshot file (.omg)");
+    const char *snapshot_filename = command_option("-i",(const char *) NULL,"Input snapshot file to validate");
+    const bool  old_ordering      = command_option("-old-ordering", false, "Number the unknowns mesh by mesh");
+    const bool  verbous           = command_option("-v", false, "Verbous mode");
+
+    if (command_option("-h",(const char *)0,0)) return 0;
+
+    if ( !snapshot_filename && !(geom_filename && output_filename) ) {
+        std::cout << "Not enough arguments, try the -h option" << std::endl;
+        return 1;
+    }
+
+    Geometry geo;
+    if ( geom_filename ) {
+        geo.read(geom_filename, (cond_filename) ? cond_filename : "", old_ordering);
+    }
+
+    if ( output_filename ) {
+        GeometrySnapshot::save(geo, output_filename);
+        snapshot_filename = output_filename;
+    }
+
+    if ( !GeometrySnapshot::check(snapshot_filename) ) {
+        return 1;
+    }
+
+    Geometry snapshot;
+    snapshot.read(snapshot_filename, "", old_ordering);
+    if ( geom_filename && !same_geometry(geo, snapshot) ) {
+        return 1;
+    }
+    std::cout << "Snapshot " << snapshot_filename << " : OK" << std::endl;
+
+    if ( verbous ) {
+        snapshot.info(verbous);
+    }
+
+    return 0;
+}
@@ -71,7 +71,7 @@ void getHelp(char** argv);
 void decoupe (double dt, double x, int*nx, double*dx)
 {
     *nx = (int)(x/dt + 0.5);
-    *nx = (nx > 0)?*nx:1;
+    *nx = (*nx > 0)?*nx:1;
     *dx = x/ *nx;
 }
 
@@ -269,6 +269,8 @@ int cylindre (char namesurf[], char namepatches[], char namepatchcount[], double
     for (i=0;i<nt;i++) {
         surf.push_back(T[i]);
     }
+    surf.build_mesh_vertices();
+    surf.update();
     surf.save(namesurf);
 
     //the electrode
@@ -333,6 +335,7 @@ int cylindre (char namesurf[], char namepatches[], char namepatchcount[], double
 int main(int argc, char** argv)
 {
     print_version(argv[0]);
+    thread_option(argc, argv);
 
     command_usage("Make nerve geometry from existing parameters or make nerve geometry and parameter file from commandline user interface.");
     if ((!strcmp(argv[1], "-h")) | (!strcmp(argv[1], "--help"))) getHelp(argv);
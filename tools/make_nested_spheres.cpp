@@ -0,0 +1,146 @@
+/*
+Project Name : OpenMEEG
+
+© INRIA and ENPC (contributors: Geoffray ADDE, Maureen CLERC, Alexandre
+GRAMFORT, Renaud KERIVEN, Jan KYBIC, Perrine LANDREAU, Théodore PAPADOPOULO,
+Emmanuel OLIVI
+Maureen.Clerc.AT.sophia.inria.fr, keriven.AT.certis.enpc.fr,
+kybic.AT.fel.cvut.cz, papadop.AT.sophia.inria.fr)
+
+The OpenMEEG software is a C++ package for solving the forward/inverse
+problems of electroencephalography and magnetoencephalography.
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's authors,  the holders of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+
+#include "mesh.h"
+#include "options.h"
+
+using namespace std;
+using namespace OpenMEEG;
+
+template <typename T>
+static vector<T> parse_list(const char* s)
+{
+    vector<T> values;
+    istringstream iss(s);
+    T value;
+    while ( iss >> value ) {
+        values.push_back(value);
+    }
+    return values;
+}
+
+int main( int argc, char **argv)
+{
+    print_version(argv[0]);
+    thread_option(argc, argv);
+
+    command_usage("Make a nested spheres head model (.geom, .cond and one .tri per interface) from refined icospheres.\n"
+                  "The default radii and conductivities are those of the Head1-3 models and of the analytic solutions in tests/analytic");
+    const char *output_basename = command_option("-o", (const char *) NULL, "Output basename (basename.geom, basename.cond, basename.<i>.tri)");
+    const unsigned level        = command_option("-l", 3, "Refinement level: each interface has 10*4^level+2 vertices");
+    const char *radii_option    = command_option("-r", "0.87 0.92 1", "Radii of the interfaces, from inside to outside");
+    const char *sigma_option    = command_option("-c", "1 0.0125 1", "Conductivities of the domains, from inside to outside");
+    const char *names_option    = command_option("-d", "Brain Skull Scalp", "Names of the domains, from inside to outside");
+
+    if (command_option("-h",(const char *)0,0)) return 0;
+
+    if ( !output_basename ) {
+        std::cout << "Not enough arguments, try the -h option" << std::endl;
+        return 1;
+    }
+
+    const vector<double> radii = parse_list<double>(radii_option);
+    const vector<double> sigma = parse_list<double>(sigma_option);
+    vector<string>       names = parse_list<string>(names_option);
+    const unsigned nb_interfaces = radii.size();
+
+    if ( nb_interfaces == 0 || sigma.size() != nb_interfaces ) {
+        std::cerr << "The number of conductivities must match the number of radii." << std::endl;
+        return 1;
+    }
+    for ( unsigned i = 1; i < nb_interfaces; ++i) {
+        if ( radii[i] <= radii[i-1] ) {
+            std::cerr << "Radii must be increasing." << std::endl;
+            return 1;
+        }
+    }
+    if ( names.size() != nb_interfaces ) {
+        names.clear();
+        for ( unsigned i = 0; i < nb_interfaces; ++i) {
+            ostringstream oss;
+            oss << "Domain" << i+1;
+            names.push_back(oss.str());
+        }
+    }
+
+    const string basename(output_basename);
+    const string stem = basename.substr(basename.find_last_of("/\\")+1); // mesh names in the .geom are relative
+
+    unsigned nb_vertices  = 0;
+    unsigned nb_triangles = 0;
+    for ( unsigned i = 0; i < nb_interfaces; ++i) {
+        Mesh m;
+        m.icosphere(level, radii[i]);
+        ostringstream oss;
+        oss << basename << "." << i+1 << ".tri";
+        m.save(oss.str());
+        nb_vertices  = m.nb_vertices();
+        nb_triangles = m.nb_triangles();
+    }
+
+    ofstream geom((basename+".geom").c_str());
+    geom << "# Domain Description 1.1" << endl << endl;
+    geom << "Interfaces " << nb_interfaces << endl << endl;
+    for ( unsigned i = 0; i < nb_interfaces; ++i) {
+        geom << "Interface: \"" << stem << "." << i+1 << ".tri\"" << endl;
+    }
+    geom << endl << "Domains " << nb_interfaces+1 << endl << endl;
+    geom << "Domain " << names[0] << ": -1" << endl;
+    for ( unsigned i = 1; i < nb_interfaces; ++i) {
+        geom << "Domain " << names[i] << ": " << i << " -" << i+1 << endl;
+    }
+    geom << "Domain Air: " << nb_interfaces << endl;
+
+    ofstream cond((basename+".cond").c_str());
+    cond << "# Properties Description 1.0 (Conductivities)" << endl << endl;
+    cond << "Air         0.0" << endl;
+    for ( unsigned i = 0; i < nb_interfaces; ++i) {
+        cond << names[i] << string((names[i].size() < 12)?12-names[i].size():1, ' ') << sigma[i] << endl;
+    }
+
+    std::cout << nb_interfaces << " interfaces with " << nb_vertices << " vertices and " << nb_triangles << " triangles each." << std::endl;
+    std::cout << "Number of unknowns of the head matrix : " << nb_interfaces*nb_vertices+(nb_interfaces-1)*nb_triangles << std::endl;
+
+    return 0;
+}
@@ -65,6 +65,7 @@ void conversion(maths::ifstream& ifs,const char* input_format,maths::ofstream& o
 int main(int argc, char **argv) try {
 
     print_version(argv[0]);
+    thread_option(argc, argv);
 
     command_usage("Convert full/sparse/symmetric vectors/matrices between different formats");
     const char* input_filename = command_option("-i",(const char *) NULL,"Input matrix/vector");
@@ -53,6 +53,7 @@ template<class T> void print_infos(const T& M);
 int main( int argc, char **argv)
 {
     print_version(argv[0]);
+    thread_option(argc, argv);
     //TODO doesn't say txt, if you don't specify it
 
     command_usage("Provides informations on a Matrix generated with OpenMEEG");
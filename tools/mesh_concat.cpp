@@ -46,6 +46,7 @@ using namespace OpenMEEG;
 int main( int argc, char **argv)
 {
     print_version(argv[0]);
+    thread_option(argc, argv);
 
     command_usage("Concat 2 mesh and save the result");
     
@@ -48,6 +48,7 @@ double determinant3x3(const Matrix& mat);
 
 int main( int argc, char **argv) {
     print_version(argv[0]);
+    thread_option(argc, argv);
 
     command_usage("Convert mesh between different formats");
     const char *input_filename = command_option("-i", (const char *) NULL, "Input Mesh");
@@ -46,6 +46,7 @@ using namespace OpenMEEG;
 int main( int argc, char **argv)
 {
     print_version(argv[0]);
+    thread_option(argc, argv);
 
     command_usage("Get info about a Mesh");
     const char *input_filename = command_option("-i",(const char *) NULL,"Input Mesh");
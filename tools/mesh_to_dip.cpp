@@ -47,6 +47,7 @@ using namespace OpenMEEG;
 int main( int argc, char **argv)
 {
     print_version(argv[0]);
+    thread_option(argc, argv);
 
     command_usage("Convert mesh file to a dipole file");
     const char *input_filename  = command_option("-i", (const char *) NULL, "Input Mesh");
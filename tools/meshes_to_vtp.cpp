@@ -48,6 +48,7 @@ using namespace OpenMEEG;
 int main( int argc, char **argv) {
 
     print_version(argv[0]);
+    thread_option(argc, argv);
 
     command_usage("Convert meshes into a single VTK/VTP file.");
     const char * input[7];
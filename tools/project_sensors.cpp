@@ -50,6 +50,7 @@ using namespace OpenMEEG;
 int main( int argc, char** argv)
 {
     print_version(argv[0]);
+    thread_option(argc, argv);
 
     command_usage("Project the sensors onto the given mesh:");
     const char *sensors_filename = command_option("-i",(const char *) NULL,"Sensors positions");
@@ -61,6 +61,7 @@ Vector cross_product(const Vector &a, const Vector &b)
 int main( int argc, char** argv)
 {
     print_version(argv[0]);
+    thread_option(argc, argv);
 
     command_usage("Convert squids positions from the CTF MEG coordinate system to the MRI coordinate system");
     const char *squids_filename = command_option("-i",(const char *) NULL,"Squids positions in CTF coordinate system");
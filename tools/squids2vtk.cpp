@@ -48,6 +48,7 @@ using namespace OpenMEEG;
 int main( int argc, char** argv)
 {
     print_version(argv[0]);
+    thread_option(argc, argv);
 
     command_usage("Convert squids in text file to a vtk file for vizualisation");
     const char *input_filename = command_option("-i",(const char *) NULL,"Squids positions in original coordinate system");